@@ -66,13 +66,16 @@ static void usage() {
         "         To dump all services.\n"
         "or:\n"
         "       dumpsys [-t TIMEOUT] [--priority LEVEL] [--clients] [--dump] [--pid] [--thread] "
-        "[--help | "
+        "[--binder-stats COMMAND] [--help | "
         "-l | --skip SERVICES "
         "| SERVICE [ARGS]]\n"
         "         --help: shows this help\n"
         "         -l: only list services, do not dump them\n"
         "         -t TIMEOUT_SEC: TIMEOUT to use in seconds instead of default 10 seconds\n"
         "         -T TIMEOUT_MS: TIMEOUT to use in milliseconds instead of default 10 seconds\n"
+        "         --binder-stats COMMAND: run COMMAND on the binder transaction stats of the\n"
+        "               service's process instead of usual dump. COMMAND must be one of\n"
+        "               start | stop | reset | dump\n"
         "         --clients: dump client PIDs instead of usual dump\n"
         "         --dump: ask the service to dump itself (this is the default)\n"
         "         --pid: dump PID instead of usual dump\n"
@@ -111,6 +114,24 @@ static bool ConvertPriorityTypeToBitmask(const String16& type, int& bitmask) {
     return false;
 }
 
+static bool ConvertBinderStatsCommand(const char* name,
+                                      binder::debug::TransactionStats::Command& command) {
+    using binder::debug::TransactionStats;
+    static const std::pair<const char*, TransactionStats::Command> kCommands[] = {
+            {"start", TransactionStats::Command::START},
+            {"stop", TransactionStats::Command::STOP},
+            {"reset", TransactionStats::Command::RESET},
+            {"dump", TransactionStats::Command::DUMP},
+    };
+    for (const auto& [candidate, value] : kCommands) {
+        if (!strcmp(name, candidate)) {
+            command = value;
+            return true;
+        }
+    }
+    return false;
+}
+
 String16 ConvertBitmaskToPriorityType(int bitmask) {
     if (bitmask == IServiceManager::DUMP_FLAG_PRIORITY_CRITICAL) {
         return String16(PriorityDumper::PRIORITY_ARG_CRITICAL);
@@ -141,7 +162,8 @@ int Dumpsys::main(int argc, char* const argv[]) {
         {"dump", no_argument, 0, 0},           {"pid", no_argument, 0, 0},
         {"priority", required_argument, 0, 0}, {"proto", no_argument, 0, 0},
         {"skip", no_argument, 0, 0},           {"stability", no_argument, 0, 0},
-        {"thread", no_argument, 0, 0},         {0, 0, 0, 0}};
+        {"thread", no_argument, 0, 0},         {"binder-stats", required_argument, 0, 0},
+        {0, 0, 0, 0}};
 
     // Must reset optind, otherwise subsequent calls will fail (wouldn't happen on main.cpp, but
     // happens on test cases).
@@ -182,6 +204,13 @@ int Dumpsys::main(int argc, char* const argv[]) {
                 dumpTypeFlags |= TYPE_THREAD;
             } else if (!strcmp(longOptions[optionIndex].name, "clients")) {
                 dumpTypeFlags |= TYPE_CLIENTS;
+            } else if (!strcmp(longOptions[optionIndex].name, "binder-stats")) {
+                if (!ConvertBinderStatsCommand(optarg, binderStatsCommand_)) {
+                    fprintf(stderr, "\n");
+                    usage();
+                    return -1;
+                }
+                dumpTypeFlags |= TYPE_BINDER_STATS;
             }
             break;
 
@@ -406,6 +435,21 @@ static status_t dumpClientsToFd(const sp<IBinder>& service, const unique_fd& fd)
     return OK;
 }
 
+static status_t dumpBinderStatsToFd(const sp<IBinder>& service,
+                                    binder::debug::TransactionStats::Command command,
+                                    const unique_fd& fd) {
+    const auto remoteBinder = service->remoteBinder();
+    if (remoteBinder == nullptr) {
+        WriteStringToFd("Binder transaction stats are not available for local binders.\n",
+                        fd.get());
+        return OK;
+    }
+    if (command == binder::debug::TransactionStats::Command::DUMP) {
+        return remoteBinder->transactionStatsCommand(command, fd);
+    }
+    return remoteBinder->transactionStatsCommand(command);
+}
+
 static void reportDumpError(const String16& serviceName, status_t error, const char* context) {
     if (error == OK) return;
 
@@ -432,6 +476,7 @@ status_t Dumpsys::startDumpThread(int dumpTypeFlags, const String16& serviceName
     unique_fd remote_end(sfd[1]);
     sfd[0] = sfd[1] = -1;
 
+    const binder::debug::TransactionStats::Command binderStatsCommand = binderStatsCommand_;
     // dump blocks until completion, so spawn a thread..
     activeThread_ = std::thread([=, remote_end{std::move(remote_end)}]() mutable {
         if (dumpTypeFlags & TYPE_PID) {
@@ -450,6 +495,10 @@ status_t Dumpsys::startDumpThread(int dumpTypeFlags, const String16& serviceName
             status_t err = dumpClientsToFd(service, remote_end);
             reportDumpError(serviceName, err, "dumping clients info");
         }
+        if (dumpTypeFlags & TYPE_BINDER_STATS) {
+            status_t err = dumpBinderStatsToFd(service, binderStatsCommand, remote_end);
+            reportDumpError(serviceName, err, "running binder transaction stats command");
+        }
 
         // other types always act as a header, this is usually longer
         if (dumpTypeFlags & TYPE_DUMP) {
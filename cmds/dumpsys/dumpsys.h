@@ -21,6 +21,7 @@
 
 #include <android-base/unique_fd.h>
 #include <binder/IServiceManager.h>
+#include <binder/TransactionStats.h>
 
 namespace android {
 
@@ -52,11 +53,12 @@ class Dumpsys {
     static void setServiceArgs(Vector<String16>& args, bool asProto, int priorityFlags);
 
     enum Type {
-        TYPE_DUMP = 0x1,       // dump using `dump` function
-        TYPE_PID = 0x2,        // dump pid of server only
-        TYPE_STABILITY = 0x4,  // dump stability information of server
-        TYPE_THREAD = 0x8,     // dump thread usage of server only
-        TYPE_CLIENTS = 0x10,   // dump pid of clients
+        TYPE_DUMP = 0x1,           // dump using `dump` function
+        TYPE_PID = 0x2,            // dump pid of server only
+        TYPE_STABILITY = 0x4,      // dump stability information of server
+        TYPE_THREAD = 0x8,         // dump thread usage of server only
+        TYPE_CLIENTS = 0x10,       // dump pid of clients
+        TYPE_BINDER_STATS = 0x20,  // run a binder transaction stats command in the server
     };
 
     /**
@@ -127,6 +129,8 @@ class Dumpsys {
 
   private:
     android::IServiceManager* sm_;
+    binder::debug::TransactionStats::Command binderStatsCommand_ =
+            binder::debug::TransactionStats::Command::DUMP;
     std::thread activeThread_;
     mutable android::base::unique_fd redirectFd_;
 };
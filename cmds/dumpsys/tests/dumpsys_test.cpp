@@ -657,6 +657,16 @@ TEST_F(DumpsysTest, ListServiceWithClients) {
     const std::string format("Client PIDs are not available for local binders.\n");
     AssertOutputFormat(format);
 }
+
+// Tests 'dumpsys --binder-stats dump service_name'
+TEST_F(DumpsysTest, BinderStatsOfService) {
+    ExpectCheckService("Locksmith");
+
+    CallMain({"--binder-stats", "dump", "Locksmith"});
+
+    const std::string format("Binder transaction stats are not available for local binders.\n");
+    AssertOutputFormat(format);
+}
 // Tests 'dumpsys --thread --stability'
 TEST_F(DumpsysTest, ListAllServicesWithMultipleOptions) {
     ExpectListServices({"Locksmith", "Valet"});
@@ -25,7 +25,14 @@
 #include <binder/Stability.h>
 #include <cutils/android_filesystem_config.h>
 #include <cutils/multiuser.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <thread>
+#include <unordered_map>
 
 #ifndef VENDORSERVICEMANAGER
 #include <vintf/VintfObject.h>
@@ -72,20 +79,6 @@ static std::vector<ManifestWithDescription> GetManifestsWithDescription() {
 #endif
 }
 
-// func true -> stop search and forEachManifest will return true
-static bool forEachManifest(const std::function<bool(const ManifestWithDescription&)>& func) {
-    for (const ManifestWithDescription& mwd : GetManifestsWithDescription()) {
-        if (mwd.manifest == nullptr) {
-            ALOGE("NULL VINTF MANIFEST!: %s", mwd.description);
-            // note, we explicitly do not retry here, so that we can detect VINTF
-            // or other bugs (b/151696835)
-            continue;
-        }
-        if (func(mwd)) return true;
-    }
-    return false;
-}
-
 static std::string getNativeInstanceName(const vintf::ManifestInstance& instance) {
     return instance.package() + "/" + instance.instance();
 }
@@ -115,142 +108,198 @@ static std::string getAidlInstanceName(const vintf::ManifestInstance& instance)
     return instance.package() + "." + instance.interface() + "/" + instance.instance();
 }
 
+// Everything that servicemanager looks up in the VINTF manifests, indexed once when the manifests
+// are loaded, so that each query is a hash lookup instead of a scan of every manifest. Where an
+// instance is declared in several manifests, the answers are the same as those of the scans that
+// this replaces.
+struct VintfIndex {
+    struct Instance {
+        // manifest that the instance was first found in
+        const char* description = nullptr;
+        // from the first manifest that declares the instance
+        std::optional<std::string> updatableViaApex;
+        // from the last manifest that declares the instance
+        std::optional<std::string> ip;
+        std::optional<uint64_t> port;
+    };
+
+    // by "package/instance"
+    std::unordered_map<std::string, Instance> nativeInstances;
+    // by "some.package.IFoo/instance"
+    std::unordered_map<std::string, Instance> aidlInstances;
+    // Instance names by "package" for native instances, and by "some.package.IFoo" for AIDL
+    // instances. Sorted for each manifest, in manifest order.
+    std::unordered_map<std::string, std::vector<std::string>> nativeInstancesForPackage;
+    std::unordered_map<std::string, std::vector<std::string>> aidlInstancesForInterface;
+    // fully qualified instance names by APEX
+    std::unordered_map<std::string, std::vector<std::string>> namesForApex;
+
+    // the manifests this was built from
+    std::vector<std::shared_ptr<const vintf::HalManifest>> manifests;
+
+    static std::shared_ptr<const VintfIndex> build(
+            const std::vector<ManifestWithDescription>& manifests) {
+        auto index = std::make_shared<VintfIndex>();
+        for (const ManifestWithDescription& mwd : manifests) {
+            index->manifests.push_back(mwd.manifest);
+            if (mwd.manifest == nullptr) continue;
+
+            std::map<std::string, std::set<std::string>> nativeForPackage;
+            std::map<std::string, std::set<std::string>> aidlForInterface;
+            // instances already found in this manifest
+            std::set<std::string> seen;
+            mwd.manifest->forEachInstance([&](const auto& manifestInstance) {
+                std::string name;
+                std::unordered_map<std::string, Instance>* instances;
+                if (manifestInstance.format() == vintf::HalFormat::NATIVE) {
+                    name = getNativeInstanceName(manifestInstance);
+                    instances = &index->nativeInstances;
+                    nativeForPackage[manifestInstance.package()].insert(
+                            manifestInstance.instance());
+                } else if (manifestInstance.format() == vintf::HalFormat::AIDL) {
+                    name = getAidlInstanceName(manifestInstance);
+                    instances = &index->aidlInstances;
+                    aidlForInterface[manifestInstance.package() + "." +
+                                     manifestInstance.interface()]
+                            .insert(manifestInstance.instance());
+                } else {
+                    return true; // continue (libvintf uses opposite convention)
+                }
+
+                auto [it, inserted] = instances->try_emplace(name);
+                if (inserted) {
+                    it->second.description = mwd.description;
+                    it->second.updatableViaApex = manifestInstance.updatableViaApex();
+                }
+                if (seen.insert(name).second) {
+                    it->second.ip = manifestInstance.ip();
+                    it->second.port = manifestInstance.port();
+                }
+                if (manifestInstance.updatableViaApex().has_value()) {
+                    index->namesForApex[manifestInstance.updatableViaApex().value()].push_back(
+                            name);
+                }
+                return true; // continue (libvintf uses opposite convention)
+            });
+
+            for (auto& [package, instances] : nativeForPackage) {
+                auto& all = index->nativeInstancesForPackage[package];
+                all.insert(all.end(), instances.begin(), instances.end());
+            }
+            for (auto& [iface, instances] : aidlForInterface) {
+                auto& all = index->aidlInstancesForInterface[iface];
+                all.insert(all.end(), instances.begin(), instances.end());
+            }
+        }
+        return index;
+    }
+};
+
+// Returns the index of the current manifests, which is rebuilt whenever libvintf loads different
+// ones.
+static std::shared_ptr<const VintfIndex> getVintfIndex() {
+    [[clang::no_destroy]] static std::mutex mutex;
+    [[clang::no_destroy]] static std::shared_ptr<const VintfIndex> index;
+
+    std::vector<ManifestWithDescription> manifests = GetManifestsWithDescription();
+    for (const ManifestWithDescription& mwd : manifests) {
+        if (mwd.manifest == nullptr) {
+            ALOGE("NULL VINTF MANIFEST!: %s", mwd.description);
+            // note, we explicitly do not retry here, so that we can detect VINTF
+            // or other bugs (b/151696835)
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    bool stale = index == nullptr || index->manifests.size() != manifests.size();
+    for (size_t i = 0; !stale && i < manifests.size(); i++) {
+        stale = index->manifests[i] != manifests[i].manifest;
+    }
+    if (stale) {
+        index = VintfIndex::build(manifests);
+    }
+    return index;
+}
+
 static bool isVintfDeclared(const std::string& name) {
+    std::shared_ptr<const VintfIndex> index = getVintfIndex();
+
     NativeName nname;
     if (NativeName::fill(name, &nname)) {
-        bool found = forEachManifest([&](const ManifestWithDescription& mwd) {
-            if (mwd.manifest->hasNativeInstance(nname.package, nname.instance)) {
-                ALOGI("Found %s in %s VINTF manifest.", name.c_str(), mwd.description);
-                return true; // break
-            }
-            return false; // continue
-        });
-        if (!found) {
+        auto it = index->nativeInstances.find(name);
+        if (it == index->nativeInstances.end()) {
             ALOGI("Could not find %s in the VINTF manifest.", name.c_str());
+            return false;
         }
-        return found;
+        ALOGI("Found %s in %s VINTF manifest.", name.c_str(), it->second.description);
+        return true;
     }
 
     AidlName aname;
     if (!AidlName::fill(name, &aname)) return false;
 
-    bool found = forEachManifest([&](const ManifestWithDescription& mwd) {
-        if (mwd.manifest->hasAidlInstance(aname.package, aname.iface, aname.instance)) {
-            ALOGI("Found %s in %s VINTF manifest.", name.c_str(), mwd.description);
-            return true; // break
-        }
-        return false;  // continue
-    });
-
-    if (!found) {
-        std::set<std::string> instances;
-        forEachManifest([&](const ManifestWithDescription& mwd) {
-            std::set<std::string> res = mwd.manifest->getAidlInstances(aname.package, aname.iface);
-            instances.insert(res.begin(), res.end());
-            return true;
-        });
-
-        std::string available;
-        if (instances.empty()) {
-            available = "No alternative instances declared in VINTF";
-        } else {
-            // for logging only. We can't return this information to the client
-            // because they may not have permissions to find or list those
-            // instances
-            available = "VINTF declared instances: " + base::Join(instances, ", ");
-        }
-        // Although it is tested, explicitly rebuilding qualified name, in case it
-        // becomes something unexpected.
-        ALOGI("Could not find %s.%s/%s in the VINTF manifest. %s.", aname.package.c_str(),
-              aname.iface.c_str(), aname.instance.c_str(), available.c_str());
+    if (auto it = index->aidlInstances.find(name); it != index->aidlInstances.end()) {
+        ALOGI("Found %s in %s VINTF manifest.", name.c_str(), it->second.description);
+        return true;
     }
 
-    return found;
+    std::string available;
+    auto instances = index->aidlInstancesForInterface.find(aname.package + "." + aname.iface);
+    if (instances == index->aidlInstancesForInterface.end()) {
+        available = "No alternative instances declared in VINTF";
+    } else {
+        // for logging only. We can't return this information to the client
+        // because they may not have permissions to find or list those
+        // instances
+        std::set<std::string> unique(instances->second.begin(), instances->second.end());
+        available = "VINTF declared instances: " + base::Join(unique, ", ");
+    }
+    // Although it is tested, explicitly rebuilding qualified name, in case it
+    // becomes something unexpected.
+    ALOGI("Could not find %s.%s/%s in the VINTF manifest. %s.", aname.package.c_str(),
+          aname.iface.c_str(), aname.instance.c_str(), available.c_str());
+    return false;
 }
 
 static std::optional<std::string> getVintfUpdatableApex(const std::string& name) {
+    std::shared_ptr<const VintfIndex> index = getVintfIndex();
+
     NativeName nname;
     if (NativeName::fill(name, &nname)) {
-        std::optional<std::string> updatableViaApex;
-
-        forEachManifest([&](const ManifestWithDescription& mwd) {
-            bool cont = mwd.manifest->forEachInstance([&](const auto& manifestInstance) {
-                if (manifestInstance.format() != vintf::HalFormat::NATIVE) return true;
-                if (manifestInstance.package() != nname.package) return true;
-                if (manifestInstance.instance() != nname.instance) return true;
-                updatableViaApex = manifestInstance.updatableViaApex();
-                return false; // break (libvintf uses opposite convention)
-            });
-            return !cont;
-        });
-
-        return updatableViaApex;
+        auto it = index->nativeInstances.find(name);
+        if (it == index->nativeInstances.end()) return std::nullopt;
+        return it->second.updatableViaApex;
     }
 
     AidlName aname;
     if (!AidlName::fill(name, &aname)) return std::nullopt;
 
-    std::optional<std::string> updatableViaApex;
-
-    forEachManifest([&](const ManifestWithDescription& mwd) {
-        bool cont = mwd.manifest->forEachInstance([&](const auto& manifestInstance) {
-            if (manifestInstance.format() != vintf::HalFormat::AIDL) return true;
-            if (manifestInstance.package() != aname.package) return true;
-            if (manifestInstance.interface() != aname.iface) return true;
-            if (manifestInstance.instance() != aname.instance) return true;
-            updatableViaApex = manifestInstance.updatableViaApex();
-            return false; // break (libvintf uses opposite convention)
-        });
-        return !cont;
-    });
-
-    return updatableViaApex;
+    auto it = index->aidlInstances.find(name);
+    if (it == index->aidlInstances.end()) return std::nullopt;
+    return it->second.updatableViaApex;
 }
 
 static std::vector<std::string> getVintfUpdatableNames(const std::string& apexName) {
-    std::vector<std::string> names;
-
-    forEachManifest([&](const ManifestWithDescription& mwd) {
-        mwd.manifest->forEachInstance([&](const auto& manifestInstance) {
-            if (manifestInstance.updatableViaApex().has_value() &&
-                manifestInstance.updatableViaApex().value() == apexName) {
-                if (manifestInstance.format() == vintf::HalFormat::NATIVE) {
-                    names.push_back(getNativeInstanceName(manifestInstance));
-                } else if (manifestInstance.format() == vintf::HalFormat::AIDL) {
-                    names.push_back(getAidlInstanceName(manifestInstance));
-                }
-            }
-            return true; // continue (libvintf uses opposite convention)
-        });
-        return false; // continue
-    });
+    std::shared_ptr<const VintfIndex> index = getVintfIndex();
 
-    return names;
+    auto it = index->namesForApex.find(apexName);
+    if (it == index->namesForApex.end()) return {};
+    return it->second;
 }
 
 static std::optional<ConnectionInfo> getVintfConnectionInfo(const std::string& name) {
     AidlName aname;
     if (!AidlName::fill(name, &aname)) return std::nullopt;
 
-    std::optional<std::string> ip;
-    std::optional<uint64_t> port;
-    forEachManifest([&](const ManifestWithDescription& mwd) {
-        mwd.manifest->forEachInstance([&](const auto& manifestInstance) {
-            if (manifestInstance.format() != vintf::HalFormat::AIDL) return true;
-            if (manifestInstance.package() != aname.package) return true;
-            if (manifestInstance.interface() != aname.iface) return true;
-            if (manifestInstance.instance() != aname.instance) return true;
-            ip = manifestInstance.ip();
-            port = manifestInstance.port();
-            return false; // break (libvintf uses opposite convention)
-        });
-        return false; // continue
-    });
-
-    if (ip.has_value() && port.has_value()) {
+    std::shared_ptr<const VintfIndex> index = getVintfIndex();
+    auto it = index->aidlInstances.find(name);
+    if (it == index->aidlInstances.end()) return std::nullopt;
+
+    const VintfIndex::Instance& instance = it->second;
+    if (instance.ip.has_value() && instance.port.has_value()) {
         ConnectionInfo info;
-        info.ipAddress = *ip;
-        info.port = *port;
+        info.ipAddress = *instance.ip;
+        info.port = *instance.port;
         return std::make_optional<ConnectionInfo>(info);
     } else {
         return std::nullopt;
@@ -258,18 +307,15 @@ static std::optional<ConnectionInfo> getVintfConnectionInfo(const std::string& n
 }
 
 static std::vector<std::string> getVintfInstances(const std::string& interface) {
+    std::shared_ptr<const VintfIndex> index = getVintfIndex();
+
     size_t lastDot = interface.rfind('.');
     if (lastDot == std::string::npos) {
         // This might be a package for native instance.
-        std::vector<std::string> ret;
-        (void)forEachManifest([&](const ManifestWithDescription& mwd) {
-            auto instances = mwd.manifest->getNativeInstances(interface);
-            ret.insert(ret.end(), instances.begin(), instances.end());
-            return false; // continue
-        });
         // If found, return it without error log.
-        if (!ret.empty()) {
-            return ret;
+        if (auto it = index->nativeInstancesForPackage.find(interface);
+            it != index->nativeInstancesForPackage.end()) {
+            return it->second;
         }
 
         ALOGE("VINTF interfaces require names in Java package format (e.g. some.package.foo.IFoo) "
@@ -277,17 +323,10 @@ static std::vector<std::string> getVintfInstances(const std::string& interface)
               interface.c_str());
         return {};
     }
-    const std::string package = interface.substr(0, lastDot);
-    const std::string iface = interface.substr(lastDot+1);
-
-    std::vector<std::string> ret;
-    (void)forEachManifest([&](const ManifestWithDescription& mwd) {
-        auto instances = mwd.manifest->getAidlInstances(package, iface);
-        ret.insert(ret.end(), instances.begin(), instances.end());
-        return false;  // continue
-    });
 
-    return ret;
+    auto it = index->aidlInstancesForInterface.find(interface);
+    if (it == index->aidlInstancesForInterface.end()) return {};
+    return it->second;
 }
 
 static bool meetsDeclarationRequirements(const sp<IBinder>& binder, const std::string& name) {
@@ -354,6 +393,27 @@ Status ServiceManager::checkService(const std::string& name, sp<IBinder>* outBin
     return Status::ok();
 }
 
+Status ServiceManager::getServices(const std::vector<std::string>& names,
+                                   std::vector<NamedService>* outServices) {
+    // enough for every service a process looks up at boot, while bounding the size of the reply
+    constexpr size_t kMaxServices = 1024;
+    if (names.size() > kMaxServices) {
+        return Status::fromExceptionCode(Status::EX_ILLEGAL_ARGUMENT, "Too many services.");
+    }
+
+    outServices->clear();
+    outServices->reserve(names.size());
+    for (const std::string& name : names) {
+        NamedService service;
+        service.name = name;
+        // same as checkService for each of the names, so access is checked for each of them and
+        // lazy services aren't started
+        service.binder = tryGetService(name, false);
+        outServices->push_back(std::move(service));
+    }
+    return Status::ok();
+}
+
 sp<IBinder> ServiceManager::tryGetService(const std::string& name, bool startIfNotFound) {
     auto ctx = mAccess->getCallingContext();
 
@@ -520,6 +580,7 @@ Status ServiceManager::listServices(int32_t dumpPriority, std::vector<std::strin
             outList->push_back(name);
         }
     }
+    std::sort(outList->begin(), outList->end());
 
     return Status::ok();
 }
@@ -984,6 +1045,8 @@ Status ServiceManager::getServiceDebugInfo(std::vector<ServiceDebugInfo>* outRet
 
         outReturn->push_back(std::move(info));
     }
+    std::sort(outReturn->begin(), outReturn->end(),
+              [](const ServiceDebugInfo& a, const ServiceDebugInfo& b) { return a.name < b.name; });
 
     return Status::ok();
 }
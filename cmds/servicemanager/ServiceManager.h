@@ -20,6 +20,8 @@
 #include <android/os/IClientCallback.h>
 #include <android/os/IServiceCallback.h>
 
+#include <unordered_map>
+
 #include "Access.h"
 
 namespace android {
@@ -27,6 +29,7 @@ namespace android {
 using os::ConnectionInfo;
 using os::IClientCallback;
 using os::IServiceCallback;
+using os::NamedService;
 using os::ServiceDebugInfo;
 
 class ServiceManager : public os::BnServiceManager, public IBinder::DeathRecipient {
@@ -57,6 +60,8 @@ public:
                                           const sp<IClientCallback>& cb) override;
     binder::Status tryUnregisterService(const std::string& name, const sp<IBinder>& binder) override;
     binder::Status getServiceDebugInfo(std::vector<ServiceDebugInfo>* outReturn) override;
+    binder::Status getServices(const std::vector<std::string>& names,
+                               std::vector<NamedService>* outServices) override;
     void binderDied(const wp<IBinder>& who) override;
     void handleClientCallbacks();
 
@@ -84,9 +89,10 @@ private:
         ~Service();
     };
 
-    using ServiceCallbackMap = std::map<std::string, std::vector<sp<IServiceCallback>>>;
-    using ClientCallbackMap = std::map<std::string, std::vector<sp<IClientCallback>>>;
-    using ServiceMap = std::map<std::string, Service>;
+    // Hashed, since every lookup is by exact name. Listings are sorted when they are made.
+    using ServiceCallbackMap = std::unordered_map<std::string, std::vector<sp<IServiceCallback>>>;
+    using ClientCallbackMap = std::unordered_map<std::string, std::vector<sp<IClientCallback>>>;
+    using ServiceMap = std::unordered_map<std::string, Service>;
 
     // removes a callback from mNameToRegistrationCallback, removing it if the vector is empty
     // this updates iterator to the next location
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/logging.h>
+#include <binder/Binder.h>
+
+#include "Access.h"
+#include "ServiceManager.h"
+
+using android::Access;
+using android::BBinder;
+using android::IBinder;
+using android::NamedService;
+using android::ServiceManager;
+using android::sp;
+using android::binder::Status;
+using android::os::IServiceManager;
+
+namespace {
+
+class PermissiveAccess : public Access {
+public:
+    CallingContext getCallingContext() override { return CallingContext{}; }
+    bool canAdd(const CallingContext&, const std::string&) override { return true; }
+    bool canFind(const CallingContext&, const std::string&) override { return true; }
+    bool canList(const CallingContext&) override { return true; }
+};
+
+class LinkableBinder : public BBinder {
+    android::status_t linkToDeath(const sp<DeathRecipient>&, void*, uint32_t) override {
+        // let SM linkToDeath
+        return android::OK;
+    }
+};
+
+// Names like those of the services of a device, which mostly share long prefixes.
+std::string serviceName(size_t i) {
+    return "android.hardware.benchmark.IService" + std::to_string(i / 8) + "/instance" +
+            std::to_string(i % 8);
+}
+
+sp<ServiceManager> makeServiceManager(size_t numServices) {
+    sp<ServiceManager> sm = sp<ServiceManager>::make(std::make_unique<PermissiveAccess>());
+    for (size_t i = 0; i < numServices; i++) {
+        Status status = sm->addService(serviceName(i), sp<LinkableBinder>::make(),
+                                       false /*allowIsolated*/,
+                                       IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT);
+        CHECK(status.isOk()) << status;
+    }
+    return sm;
+}
+
+// Looks up every service, one at a time.
+void BM_checkService(benchmark::State& state) {
+    const size_t numServices = state.range(0);
+    sp<ServiceManager> sm = makeServiceManager(numServices);
+    std::vector<std::string> names;
+    for (size_t i = 0; i < numServices; i++) names.push_back(serviceName(i));
+
+    for (auto _ : state) {
+        for (const std::string& name : names) {
+            sp<IBinder> out;
+            Status status = sm->checkService(name, &out);
+            CHECK(status.isOk() && out != nullptr) << status;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * numServices);
+    sm->clear();
+}
+BENCHMARK(BM_checkService)->Arg(100)->Arg(1000)->Arg(5000);
+
+// Looks up every service, in batches as large as allowed.
+void BM_getServices(benchmark::State& state) {
+    constexpr size_t kBatch = 1024;
+    const size_t numServices = state.range(0);
+    sp<ServiceManager> sm = makeServiceManager(numServices);
+    std::vector<std::vector<std::string>> batches;
+    for (size_t i = 0; i < numServices; i++) {
+        if (i % kBatch == 0) batches.emplace_back();
+        batches.back().push_back(serviceName(i));
+    }
+
+    for (auto _ : state) {
+        for (const auto& batch : batches) {
+            std::vector<NamedService> out;
+            Status status = sm->getServices(batch, &out);
+            CHECK(status.isOk() && out.size() == batch.size()) << status;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * numServices);
+    sm->clear();
+}
+BENCHMARK(BM_getServices)->Arg(100)->Arg(1000)->Arg(5000);
+
+// Looks up services which aren't registered, as clients polling for them do.
+void BM_checkMissingService(benchmark::State& state) {
+    const size_t numServices = state.range(0);
+    sp<ServiceManager> sm = makeServiceManager(numServices);
+    const std::string missing = serviceName(numServices);
+
+    for (auto _ : state) {
+        sp<IBinder> out;
+        Status status = sm->checkService(missing, &out);
+        CHECK(status.isOk() && out == nullptr) << status;
+    }
+    sm->clear();
+}
+BENCHMARK(BM_checkMissingService)->Arg(100)->Arg(1000)->Arg(5000);
+
+// Repeated VINTF queries, which are answered from the index of the manifests.
+void BM_isDeclared(benchmark::State& state) {
+    sp<ServiceManager> sm = makeServiceManager(0);
+
+    for (auto _ : state) {
+        bool declared;
+        Status status = sm->isDeclared("android.hardware.benchmark.IService/default", &declared);
+        CHECK(status.isOk()) << status;
+    }
+}
+BENCHMARK(BM_isDeclared);
+
+} // namespace
+
+BENCHMARK_MAIN();
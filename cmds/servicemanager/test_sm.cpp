@@ -38,6 +38,7 @@ using android::base::StartsWith;
 using android::binder::Status;
 using android::os::BnServiceCallback;
 using android::os::IServiceManager;
+using android::os::NamedService;
 using testing::_;
 using testing::ElementsAre;
 using testing::NiceMock;
@@ -267,6 +268,72 @@ TEST(GetService, NotAllowedFromIsolated) {
     EXPECT_EQ(nullptr, out.get());
 }
 
+TEST(GetServices, HappyHappy) {
+    auto sm = getPermissiveServiceManager();
+    sp<IBinder> foo = getBinder();
+    sp<IBinder> bar = getBinder();
+
+    EXPECT_TRUE(sm->addService("foo", foo, false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+    EXPECT_TRUE(sm->addService("bar", bar, false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+
+    std::vector<NamedService> out;
+    EXPECT_TRUE(sm->getServices({"bar", "baz", "foo"}, &out).isOk());
+    ASSERT_EQ(3u, out.size());
+    EXPECT_EQ("bar", out[0].name);
+    EXPECT_EQ(bar, out[0].binder);
+    EXPECT_EQ("baz", out[1].name);
+    EXPECT_EQ(nullptr, out[1].binder);
+    EXPECT_EQ("foo", out[2].name);
+    EXPECT_EQ(foo, out[2].binder);
+}
+
+TEST(GetServices, NoPermissionsForOneService) {
+    std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
+
+    EXPECT_CALL(*access, getCallingContext()).WillRepeatedly(Return(Access::CallingContext{}));
+    EXPECT_CALL(*access, canAdd(_, _)).WillRepeatedly(Return(true));
+    EXPECT_CALL(*access, canFind(_, "foo")).WillOnce(Return(false));
+    EXPECT_CALL(*access, canFind(_, "bar")).WillOnce(Return(true));
+
+    sp<ServiceManager> sm = sp<NiceMock<MockServiceManager>>::make(std::move(access));
+
+    sp<IBinder> bar = getBinder();
+    EXPECT_TRUE(sm->addService("foo", getBinder(), false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+    EXPECT_TRUE(sm->addService("bar", bar, false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+
+    std::vector<NamedService> out;
+    EXPECT_TRUE(sm->getServices({"foo", "bar"}, &out).isOk());
+    ASSERT_EQ(2u, out.size());
+    EXPECT_EQ(nullptr, out[0].binder);
+    EXPECT_EQ(bar, out[1].binder);
+}
+
+TEST(GetServices, DoesNotStartLazyServices) {
+    std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
+
+    ON_CALL(*access, getCallingContext()).WillByDefault(Return(Access::CallingContext{}));
+    ON_CALL(*access, canFind(_, _)).WillByDefault(Return(true));
+
+    sp<MockServiceManager> sm = sp<NiceMock<MockServiceManager>>::make(std::move(access));
+    EXPECT_CALL(*sm, tryStartService(_, _)).Times(0);
+
+    std::vector<NamedService> out;
+    EXPECT_TRUE(sm->getServices({"lazy"}, &out).isOk());
+    ASSERT_EQ(1u, out.size());
+    EXPECT_EQ(nullptr, out[0].binder);
+}
+
+TEST(GetServices, TooManyServices) {
+    auto sm = getPermissiveServiceManager();
+
+    std::vector<NamedService> out;
+    EXPECT_FALSE(sm->getServices(std::vector<std::string>(1025, "foo"), &out).isOk());
+}
+
 TEST(ListServices, NoPermissions) {
     std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
 
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+#include <utils/Errors.h>
+
+namespace android {
+
+struct InputMessage;
+
+/*
+ * A pair of single-producer / single-consumer rings of InputMessage slots in shared memory, one
+ * for each direction of an InputChannel pair.
+ *
+ * The memory is a sealed memfd that both ends of the channel map. Each ring has a head index,
+ * written only by its producer, and a tail index, written only by its consumer. The indices are
+ * free-running and the capacity is a power of two.
+ *
+ * The peer is not trusted: every message is copied out of the ring before it is validated, and
+ * the indices written by the peer are checked against the capacity. A ring that is found to be
+ * inconsistent reports BAD_VALUE, like a malformed message on a socket.
+ */
+class InputMessageRing {
+public:
+    enum class Direction {
+        SERVER_TO_CLIENT,
+        CLIENT_TO_SERVER,
+    };
+
+    // Default number of slots in each direction.
+    static constexpr size_t DEFAULT_CAPACITY = 16;
+    // Largest number of slots in each direction.
+    static constexpr size_t MAX_CAPACITY = 256;
+
+    /* Creates the shared memory for a new channel pair. |capacity| must be a power of two no
+     * larger than MAX_CAPACITY. Returns nullptr on failure. */
+    static std::shared_ptr<InputMessageRing> create(const std::string& name, size_t capacity);
+
+    /* Maps the shared memory of an existing channel pair, for example one that was received from
+     * another process. Returns nullptr if the memory does not hold a valid ring. */
+    static std::shared_ptr<InputMessageRing> map(android::base::unique_fd fd);
+
+    ~InputMessageRing();
+
+    InputMessageRing(const InputMessageRing&) = delete;
+    InputMessageRing& operator=(const InputMessageRing&) = delete;
+
+    int getFd() const { return mFd.get(); }
+    size_t getCapacity() const { return mCapacity; }
+
+    /* Copies |msg| into the next free slot of the ring for |direction|.
+     *
+     * |outWasEmpty| is set to true if the consumer may have seen the ring empty before the
+     * message was added, in which case it has to be woken up.
+     *
+     * Returns OK on success.
+     * Returns WOULD_BLOCK if the ring is full.
+     * Returns BAD_VALUE if the ring has been corrupted.
+     */
+    status_t push(Direction direction, const InputMessage& msg, bool* outWasEmpty);
+
+    /* Copies the oldest message of the ring for |direction| into |msg| and frees its slot.
+     *
+     * Returns OK on success.
+     * Returns WOULD_BLOCK if the ring is empty.
+     * Returns BAD_VALUE if the message is invalid or the ring has been corrupted.
+     */
+    status_t pop(Direction direction, InputMessage* msg);
+
+    /* Returns true if the ring for |direction| holds at least one message. */
+    bool hasMessages(Direction direction) const;
+
+private:
+    struct SharedMemory;
+
+    InputMessageRing(android::base::unique_fd fd, void* memory, size_t size, size_t capacity);
+
+    InputMessage* getSlot(Direction direction, uint32_t index) const;
+
+    const android::base::unique_fd mFd;
+    SharedMemory* const mShared;
+    const size_t mSize;
+    // Copied out of the shared memory when the ring is mapped, so that the peer cannot change it.
+    const size_t mCapacity;
+
+    // A channel shares this object with its dups; a channel created from a parceled copy maps
+    // the ring again and gets its own. The lock keeps the rings single-producer /
+    // single-consumer when dups are used from different threads. The indices that this side
+    // writes are also kept here, so that only the indices written by the peer have to be read
+    // back and checked. Two mappings of the same side must therefore not be used at once.
+    mutable std::mutex mLock;
+    uint32_t mHead[2] GUARDED_BY(mLock);
+    uint32_t mTail[2] GUARDED_BY(mLock);
+};
+
+} // namespace android
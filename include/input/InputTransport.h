@@ -38,6 +38,7 @@
 #include <android/os/InputChannelCore.h>
 #include <binder/IBinder.h>
 #include <input/Input.h>
+#include <input/InputMessageRing.h>
 #include <input/InputVerifier.h>
 #include <sys/stat.h>
 #include <ui/Transform.h>
@@ -235,6 +236,16 @@ struct InputMessage {
  */
 class InputChannel : private android::os::InputChannelCore {
 public:
+    /* How messages travel between the two ends of a channel pair. */
+    enum class Transport {
+        // Every message is a packet on the socket.
+        SOCKET,
+        // Messages are passed through an InputMessageRing in shared memory. The socket only
+        // carries wakeups for a consumer that found the ring empty, and reports when the peer
+        // has been closed.
+        SHARED_MEMORY_RING,
+    };
+
     static std::unique_ptr<InputChannel> create(android::os::InputChannelCore&& parceledChannel);
     ~InputChannel();
 
@@ -247,10 +258,14 @@ public:
      */
     static status_t openInputChannelPair(const std::string& name,
                                          std::unique_ptr<InputChannel>& outServerChannel,
-                                         std::unique_ptr<InputChannel>& outClientChannel);
+                                         std::unique_ptr<InputChannel>& outClientChannel,
+                                         Transport transport = Transport::SOCKET);
 
     inline std::string getName() const { return name; }
     inline int getFd() const { return fd.get(); }
+    inline Transport getTransport() const {
+        return mRing != nullptr ? Transport::SHARED_MEMORY_RING : Transport::SOCKET;
+    }
 
     /* Send a message to the other endpoint.
      *
@@ -277,6 +292,32 @@ public:
      */
     status_t receiveMessage(InputMessage* msg);
 
+    /* Send up to |count| messages to the other endpoint with a single system call.
+     *
+     * Messages are sent in order, and each message is either sent completely or not at all.
+     * On return, |outSent| holds the number of messages from the front of |msgs| that were sent.
+     *
+     * Return OK if all of the messages were sent.
+     * Return WOULD_BLOCK if the channel filled up before all of the messages were sent. If the
+     * send stopped for another reason, the error is reported by the next call.
+     * Return DEAD_OBJECT if the channel's peer has been closed.
+     * Other errors probably indicate that the channel is broken.
+     */
+    status_t sendMessages(const InputMessage* msgs, size_t count, size_t* outSent);
+
+    /* Receive up to |count| messages sent by the other endpoint with a single system call.
+     *
+     * Only the messages that are already in the channel are received; this never waits for
+     * more. On return, |outReceived| holds the number of messages written to |msgs|.
+     *
+     * Return OK if at least one message was received. If an error stopped the receive after
+     * that, the error is reported by the next call.
+     * Return WOULD_BLOCK if there is no message present.
+     * Return DEAD_OBJECT if the channel's peer has been closed.
+     * Other errors probably indicate that the channel is broken.
+     */
+    status_t receiveMessages(InputMessage* msgs, size_t count, size_t* outReceived);
+
     /* Tells whether there is a message in the channel available to be received.
      *
      * This is only a performance hint and may return false negative results. Clients should not
@@ -325,9 +366,26 @@ public:
 
 private:
     static std::unique_ptr<InputChannel> create(const std::string& name,
-                                                android::base::unique_fd fd, sp<IBinder> token);
-
-    InputChannel(const std::string name, android::base::unique_fd fd, sp<IBinder> token);
+                                                android::base::unique_fd fd, sp<IBinder> token,
+                                                std::shared_ptr<InputMessageRing> ring = nullptr,
+                                                bool ringServerSide = false);
+
+    InputChannel(const std::string name, android::base::unique_fd fd, sp<IBinder> token,
+                 std::shared_ptr<InputMessageRing> ring, bool ringServerSide);
+
+    status_t sendMessageToRing(const InputMessage& msg);
+    status_t receiveMessageFromRing(InputMessage* msg);
+    // Reads all pending wakeups from the socket.
+    status_t drainWakeups();
+    void copyRingTo(android::os::InputChannelCore& outChannel) const;
+
+    // Set when the channel uses Transport::SHARED_MEMORY_RING.
+    std::shared_ptr<InputMessageRing> mRing;
+    InputMessageRing::Direction mSendDirection = InputMessageRing::Direction::SERVER_TO_CLIENT;
+    InputMessageRing::Direction mReceiveDirection = InputMessageRing::Direction::CLIENT_TO_SERVER;
+    // An error that stopped receiveMessages after some messages were received, reported by the
+    // next receive so that those messages are delivered first.
+    status_t mPendingReceiveError = OK;
 };
 
 /*
@@ -543,6 +601,16 @@ private:
     // call to consume and that still needs to be handled.
     bool mMsgDeferred;
 
+    // Messages that were read from the channel but not yet handled, starting at
+    // mReceiveBufferHead. Motion samples arrive in bursts, so the channel is drained several
+    // messages at a time. Allocated on first use.
+    std::vector<InputMessage> mReceiveBuffer;
+    size_t mReceiveBufferHead;
+    size_t mReceiveBufferCount;
+
+    // Takes the next message from mReceiveBuffer, refilling it from the channel when empty.
+    status_t receiveMessage(InputMessage* msg);
+
     // Batched motion events per device and source.
     struct Batch {
         std::vector<InputMessage> samples;
@@ -27,12 +27,16 @@
 #include <binder/Parcel.h>
 #include <binder/RecordedTransaction.h>
 #include <binder/RpcServer.h>
+#include <binder/TransactionStats.h>
 #include <binder/unique_fd.h>
 #include <pthread.h>
 
 #include <inttypes.h>
 #include <stdio.h>
 
+#include <chrono>
+#include <optional>
+
 #ifdef __linux__
 #include <linux/sched.h>
 #endif
@@ -44,8 +48,10 @@
 namespace android {
 
 using android::binder::unique_fd;
+using android::binder::debug::TransactionStats;
 
 constexpr uid_t kUidRoot = 0;
+constexpr uid_t kUidShell = 2000;
 
 // Service implementations inherit from BBinder and IBinder, and this is frozen
 // in prebuilts.
@@ -275,6 +281,8 @@ public:
     BpBinder::ObjectManager mObjects;
 
     unique_fd mRecordingFd;
+    // Set instead of mRecordingFd for RecordingFormat::COMPACT recordings.
+    std::unique_ptr<binder::debug::RecordedTransactionWriter> mRecordingWriter;
 };
 
 // ---------------------------------------------------------------------------
@@ -315,6 +323,26 @@ status_t BBinder::startRecordingTransactions(const Parcel& data) {
         if (readStatus != OK) {
             return readStatus;
         }
+        // Older clients only send the file descriptor.
+        int32_t format = static_cast<int32_t>(binder::debug::RecordingFormat::CHUNKED);
+        if (data.dataAvail() > 0 && (readStatus = data.readInt32(&format)) != OK) {
+            return readStatus;
+        }
+        switch (static_cast<binder::debug::RecordingFormat>(format)) {
+            case binder::debug::RecordingFormat::CHUNKED:
+                break;
+            case binder::debug::RecordingFormat::COMPACT:
+                e->mRecordingWriter = binder::debug::RecordedTransactionWriter::create(
+                        std::move(e->mRecordingFd));
+                if (e->mRecordingWriter == nullptr) {
+                    return UNKNOWN_ERROR;
+                }
+                break;
+            default:
+                ALOGE("Unknown Binder recording format %" PRId32, format);
+                e->mRecordingFd.reset();
+                return BAD_VALUE;
+        }
         mRecordingOn = true;
         ALOGI("Started Binder recording.");
         return NO_ERROR;
@@ -338,6 +366,8 @@ status_t BBinder::stopRecordingTransactions() {
     Extras* e = getOrCreateExtras();
     RpcMutexUniqueLock lock(e->mLock);
     if (mRecordingOn) {
+        // flushes the last block
+        e->mRecordingWriter.reset();
         e->mRecordingFd.reset();
         mRecordingOn = false;
         ALOGI("Stopped Binder recording.");
@@ -348,6 +378,36 @@ status_t BBinder::stopRecordingTransactions() {
     }
 }
 
+status_t BBinder::transactionStatsCommand(const Parcel& data) {
+    if (!kEnableKernelIpc) {
+        ALOGW("Binder transaction stats disallowed because kernel binder is not enabled");
+        return INVALID_OPERATION;
+    }
+    uid_t uid = IPCThreadState::self()->getCallingUid();
+    if (uid != kUidRoot && uid != kUidShell) {
+        ALOGE("Binder transaction stats not allowed for client %" PRIu32, uid);
+        return PERMISSION_DENIED;
+    }
+    int32_t command;
+    if (status_t status = data.readInt32(&command); status != OK) return status;
+    switch (static_cast<TransactionStats::Command>(command)) {
+        case TransactionStats::Command::START:
+            return TransactionStats::setEnabled(true);
+        case TransactionStats::Command::STOP:
+            return TransactionStats::setEnabled(false);
+        case TransactionStats::Command::RESET:
+            TransactionStats::reset();
+            return OK;
+        case TransactionStats::Command::DUMP: {
+            unique_fd fd;
+            if (status_t status = data.readUniqueFileDescriptor(&fd); status != OK) return status;
+            return TransactionStats::dumpToFd(fd);
+        }
+    }
+    ALOGE("Unknown binder transaction stats command %" PRId32, command);
+    return BAD_VALUE;
+}
+
 const String16& BBinder::getInterfaceDescriptor() const
 {
     static StaticString16 sBBinder(u"BBinder");
@@ -365,6 +425,11 @@ status_t BBinder::transact(
         reply->markSensitive();
     }
 
+    std::optional<std::chrono::steady_clock::time_point> statsStart;
+    if (TransactionStats::isEnabled()) [[unlikely]] {
+        statsStart = std::chrono::steady_clock::now();
+    }
+
     status_t err = NO_ERROR;
     switch (code) {
         case PING_TRANSACTION:
@@ -388,11 +453,22 @@ status_t BBinder::transact(
             err = setRpcClientDebug(data);
             break;
         }
+        case TRANSACTION_STATS_TRANSACTION:
+            err = transactionStatsCommand(data);
+            break;
         default:
             err = onTransact(code, data, reply, flags);
             break;
     }
 
+    if (statsStart.has_value()) [[unlikely]] {
+        TransactionStats::record(TransactionStats::Direction::INCOMING, code,
+                                 std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now() - *statsStart)
+                                         .count(),
+                                 data, reply);
+    }
+
     // In case this is being transacted on in the same process.
     if (reply != nullptr) {
         reply->setDataPosition(0);
@@ -405,7 +481,17 @@ status_t BBinder::transact(
     if (kEnableKernelIpc && mRecordingOn && code != START_RECORDING_TRANSACTION) [[unlikely]] {
         Extras* e = mExtras.load(std::memory_order_acquire);
         RpcMutexUniqueLock lock(e->mLock);
-        if (mRecordingOn) {
+        if (mRecordingOn && e->mRecordingWriter) {
+            Parcel emptyReply;
+            timespec ts;
+            timespec_get(&ts, TIME_UTC);
+            if (status_t status = e->mRecordingWriter->append(getInterfaceDescriptor(), code,
+                                                              flags, ts, data,
+                                                              reply ? *reply : emptyReply, err);
+                status != NO_ERROR) {
+                ALOGI("Failed to record transaction with error %d", status);
+            }
+        } else if (mRecordingOn) {
             Parcel emptyReply;
             timespec ts;
             timespec_get(&ts, TIME_UTC);
@@ -21,11 +21,15 @@
 
 #include <binder/IPCThreadState.h>
 #include <binder/IResultReceiver.h>
+#include <binder/RecordedTransaction.h>
 #include <binder/RpcSession.h>
 #include <binder/Stability.h>
+#include <binder/TransactionStats.h>
 
 #include <stdio.h>
 
+#include <chrono>
+
 #include "BuildFlags.h"
 #include "file.h"
 
@@ -325,12 +329,31 @@ status_t BpBinder::startRecordingBinder(const unique_fd& fd) {
     return transact(START_RECORDING_TRANSACTION, send, &reply);
 }
 
+status_t BpBinder::startRecordingBinder(const unique_fd& fd,
+                                        binder::debug::RecordingFormat format) {
+    Parcel send, reply;
+    send.writeUniqueFileDescriptor(fd);
+    send.writeInt32(static_cast<int32_t>(format));
+    return transact(START_RECORDING_TRANSACTION, send, &reply);
+}
+
 status_t BpBinder::stopRecordingBinder() {
     Parcel data, reply;
     data.markForBinder(sp<BpBinder>::fromExisting(this));
     return transact(STOP_RECORDING_TRANSACTION, data, &reply);
 }
 
+status_t BpBinder::transactionStatsCommand(binder::debug::TransactionStats::Command command,
+                                           const unique_fd& fd) {
+    Parcel data, reply;
+    data.markForBinder(sp<BpBinder>::fromExisting(this));
+    data.writeInt32(static_cast<int32_t>(command));
+    if (command == binder::debug::TransactionStats::Command::DUMP) {
+        if (status_t status = data.writeUniqueFileDescriptor(fd); status != OK) return status;
+    }
+    return transact(TRANSACTION_STATS_TRANSACTION, data, &reply);
+}
+
 status_t BpBinder::dump(int fd, const Vector<String16>& args)
 {
     Parcel send;
@@ -372,6 +395,12 @@ status_t BpBinder::transact(
             }
         }
 
+        using binder::debug::TransactionStats;
+        std::optional<std::chrono::steady_clock::time_point> statsStart;
+        if (TransactionStats::isEnabled()) [[unlikely]] {
+            statsStart = std::chrono::steady_clock::now();
+        }
+
         status_t status;
         if (isRpcBinder()) [[unlikely]] {
             status = rpcSession()->transact(sp<IBinder>::fromExisting(this), code, data, reply,
@@ -384,6 +413,13 @@ status_t BpBinder::transact(
 
             status = IPCThreadState::self()->transact(binderHandle(), code, data, reply, flags);
         }
+        if (statsStart.has_value()) [[unlikely]] {
+            TransactionStats::record(TransactionStats::Direction::OUTGOING, code,
+                                     std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                             std::chrono::steady_clock::now() - *statsStart)
+                                             .count(),
+                                     data, reply);
+        }
         if (data.dataSize() > LOG_TRANSACTIONS_OVER_SIZE) {
             RpcMutexUniqueLock _l(mLock);
             ALOGW("Large outgoing transaction of %zu bytes, interface descriptor %s, code %d",
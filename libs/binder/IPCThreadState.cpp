@@ -644,6 +644,9 @@ status_t IPCThreadState::getAndExecuteCommand()
 
         pthread_mutex_lock(&mProcess->mThreadCountLock);
         mProcess->mExecutingThreadsCount++;
+        if (cmd == BR_TRANSACTION || cmd == BR_TRANSACTION_SEC_CTX) {
+            mProcess->recordTransactionLocked();
+        }
         if (mProcess->mExecutingThreadsCount >= mProcess->mMaxThreads &&
                 mProcess->mStarvationStartTimeMs == 0) {
             mProcess->mStarvationStartTimeMs = uptimeMillis();
@@ -661,6 +664,7 @@ status_t IPCThreadState::getAndExecuteCommand()
                 ALOGE("binder thread pool (%zu threads) starved for %" PRId64 " ms",
                       mProcess->mMaxThreads, starvationTimeMs);
             }
+            mProcess->recordStarvationLocked(starvationTimeMs);
             mProcess->mStarvationStartTimeMs = 0;
         }
 
@@ -731,12 +735,14 @@ void IPCThreadState::joinThreadPool(bool isMain)
 {
     LOG_THREADPOOL("**** THREAD %p (PID %d) IS JOINING THE THREAD POOL\n", (void*)pthread_self(), getpid());
     pthread_mutex_lock(&mProcess->mThreadCountLock);
+    mProcess->accountThreadTimeLocked();
     mProcess->mCurrentThreads++;
     pthread_mutex_unlock(&mProcess->mThreadCountLock);
     mOut.writeInt32(isMain ? BC_ENTER_LOOPER : BC_REGISTER_LOOPER);
 
     mIsLooper = true;
     status_t result;
+    bool retired = false;
     do {
         processPendingDerefs();
         // now get the next command to be processed, waiting if necessary
@@ -752,6 +758,16 @@ void IPCThreadState::joinThreadPool(bool isMain)
         if(result == TIMED_OUT && !isMain) {
             break;
         }
+
+        // With an adaptive threadpool, threads started by the kernel also
+        // leave it when the load no longer needs them. Only do so once all
+        // of the commands read from the driver have been handled.
+        if (!isMain && result >= NO_ERROR && mIn.dataPosition() >= mIn.dataSize() &&
+            mProcess->retirePooledThreadIfIdle()) {
+            processPendingDerefs();
+            retired = true;
+            break;
+        }
     } while (result != -ECONNREFUSED && result != -EBADF);
 
     LOG_THREADPOOL("**** THREAD %p (PID %d) IS LEAVING THE THREAD POOL err=%d\n",
@@ -760,11 +776,16 @@ void IPCThreadState::joinThreadPool(bool isMain)
     mOut.writeInt32(BC_EXIT_LOOPER);
     mIsLooper = false;
     talkWithDriver(false);
+    if (retired) {
+        // already removed from the count by retirePooledThreadIfIdle
+        return;
+    }
     pthread_mutex_lock(&mProcess->mThreadCountLock);
     LOG_ALWAYS_FATAL_IF(mProcess->mCurrentThreads == 0,
                         "Threadpool thread count = 0. Thread cannot exist and exit in empty "
                         "threadpool\n"
                         "Misconfiguration. Increase threadpool max threads configuration\n");
+    mProcess->accountThreadTimeLocked();
     mProcess->mCurrentThreads--;
     pthread_mutex_unlock(&mProcess->mThreadCountLock);
 }
@@ -779,6 +800,7 @@ status_t IPCThreadState::setupPolling(int* fd)
     flushCommands();
     *fd = mProcess->mDriverFD;
     pthread_mutex_lock(&mProcess->mThreadCountLock);
+    mProcess->accountThreadTimeLocked();
     mProcess->mCurrentThreads++;
     pthread_mutex_unlock(&mProcess->mThreadCountLock);
     return 0;
@@ -827,6 +849,16 @@ status_t IPCThreadState::transact(int32_t handle,
 
     LOG_ONEWAY(">>>> SEND from pid %d uid %d %s", getpid(), getuid(),
         (flags & TF_ONE_WAY) == 0 ? "READ REPLY" : "ONE WAY");
+    if ((flags & TF_ONE_WAY) != 0 && mOnewayBatchDepth > 0) {
+        return queueOnewayTransaction(handle, code, data, flags);
+    }
+    if (mOnewayBatchCount > 0) {
+        // The queued transactions go first. Their errors are reported when the batch ends.
+        if (status_t batchErr = flushOnewayBatch();
+            batchErr != NO_ERROR && mOnewayBatchError == NO_ERROR) {
+            mOnewayBatchError = batchErr;
+        }
+    }
     err = writeTransactionData(BC_TRANSACTION, flags, handle, code, data, nullptr);
 
     if (err != NO_ERROR) {
@@ -884,6 +916,58 @@ status_t IPCThreadState::transact(int32_t handle,
     return err;
 }
 
+void IPCThreadState::beginOnewayBatch()
+{
+    mOnewayBatchDepth++;
+}
+
+status_t IPCThreadState::endOnewayBatch()
+{
+    LOG_ALWAYS_FATAL_IF(mOnewayBatchDepth == 0, "endOnewayBatch() without beginOnewayBatch()");
+    if (--mOnewayBatchDepth > 0) return NO_ERROR;
+
+    status_t err = flushOnewayBatch();
+    if (mOnewayBatchError != NO_ERROR) {
+        err = mOnewayBatchError;
+        mOnewayBatchError = NO_ERROR;
+    }
+    return err;
+}
+
+status_t IPCThreadState::queueOnewayTransaction(int32_t handle, uint32_t code,
+                                                const Parcel& data, uint32_t flags)
+{
+    status_t err = data.errorCheck();
+    if (err != NO_ERROR) return (mLastError = err);
+
+    // The copy holds its own references on the objects in the data, and its own fds.
+    auto copy = std::make_unique<Parcel>();
+    if (data.mDeallocZero) copy->markSensitive();
+    err = copy->appendFrom(&data, 0, data.dataSize());
+    if (err != NO_ERROR) return (mLastError = err);
+
+    err = writeTransactionData(BC_TRANSACTION, flags, handle, code, *copy, nullptr);
+    if (err != NO_ERROR) return err;
+    mOnewayBatchData.push_back(std::move(copy));
+    mOnewayBatchCount++;
+    return NO_ERROR;
+}
+
+status_t IPCThreadState::flushOnewayBatch()
+{
+    // The first talkWithDriver() writes all of the queued transactions, and the driver responds
+    // to each of them, in order. If one fails, the driver stops reading there, talkWithDriver()
+    // keeps the rest in mOut, and the next talkWithDriver() writes them.
+    status_t result = NO_ERROR;
+    for (size_t count = std::exchange(mOnewayBatchCount, 0); count > 0; count--) {
+        status_t err = waitForResponse(nullptr, nullptr);
+        if (result == NO_ERROR) result = err;
+    }
+    // If the driver couldn't be talked to, commands which point into the data may be left.
+    if (mOut.dataSize() == 0) mOnewayBatchData.clear();
+    return result;
+}
+
 void IPCThreadState::incStrongHandle(int32_t handle, BpBinder *proxy)
 {
     LOG_REMOTEREFS("IPCThreadState::incStrongHandle(%d)\n", handle);
@@ -964,7 +1048,10 @@ IPCThreadState::IPCThreadState()
         mIsFlushing(false),
         mStrictModePolicy(0),
         mLastTransactionBinderFlags(0),
-        mCallRestriction(mProcess->mCallRestriction) {
+        mCallRestriction(mProcess->mCallRestriction),
+        mOnewayBatchDepth(0),
+        mOnewayBatchCount(0),
+        mOnewayBatchError(NO_ERROR) {
     pthread_setspecific(gTLS, this);
     clearCaller();
     mHasExplicitIdentity = false;
@@ -1177,13 +1264,21 @@ status_t IPCThreadState::talkWithDriver(bool doReceive)
 
     if (err >= NO_ERROR) {
         if (bwr.write_consumed > 0) {
-            if (bwr.write_consumed < mOut.dataSize())
-                LOG_ALWAYS_FATAL("Driver did not consume write buffer. "
-                                 "err: %s consumed: %zu of %zu",
-                                 statusToString(err).c_str(),
-                                 (size_t)bwr.write_consumed,
-                                 mOut.dataSize());
-            else {
+            if (bwr.write_consumed < mOut.dataSize()) {
+                // The driver stops at a transaction that fails. Only a oneway batch queues
+                // commands after a transaction, and they are written by the next call.
+                LOG_ALWAYS_FATAL_IF(mOnewayBatchData.empty(),
+                                    "Driver did not consume write buffer. "
+                                    "err: %s consumed: %zu of %zu",
+                                    statusToString(err).c_str(),
+                                    (size_t)bwr.write_consumed,
+                                    mOut.dataSize());
+                const size_t remaining = mOut.dataSize() - bwr.write_consumed;
+                uint8_t* out = const_cast<uint8_t*>(mOut.data());
+                memmove(out, out + bwr.write_consumed, remaining);
+                mOut.setDataSize(remaining);
+                mOut.setDataPosition(remaining);
+            } else {
                 mOut.setDataSize(0);
                 processPostWriteDerefs();
             }
@@ -1371,6 +1466,8 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
             const int32_t origTransactionBinderFlags = mLastTransactionBinderFlags;
             const int32_t origWorkSource = mWorkSource;
             const bool origPropagateWorkSet = mPropagateWorkSource;
+            const size_t origOnewayBatchDepth = mOnewayBatchDepth;
+            mOnewayBatchDepth = 0;
             // Calling work source will be set by Parcel#enforceInterface. Parcel#enforceInterface
             // is only guaranteed to be called for AIDL-generated stubs so we reset the work source
             // here to never propagate it.
@@ -1461,6 +1558,7 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
             mLastTransactionBinderFlags = origTransactionBinderFlags;
             mWorkSource = origWorkSource;
             mPropagateWorkSource = origPropagateWorkSet;
+            mOnewayBatchDepth = origOnewayBatchDepth;
 
             IF_LOG_TRANSACTIONS() {
                 std::ostringstream logStream;
@@ -108,6 +108,7 @@ public:
                                         const sp<AidlRegistrationCallback>& cb) override;
 
     std::vector<IServiceManager::ServiceDebugInfo> getServiceDebugInfo() override;
+    std::vector<sp<IBinder>> getServices(const std::vector<String16>& names) override;
     // for legacy ABI
     const String16& getInterfaceDescriptor() const override {
         return mTheRealServiceManager->getInterfaceDescriptor();
@@ -626,6 +627,45 @@ std::vector<IServiceManager::ServiceDebugInfo> ServiceManagerShim::getServiceDeb
     return ret;
 }
 
+std::vector<sp<IBinder>> IServiceManager::getServices(const std::vector<String16>& names) {
+    std::vector<sp<IBinder>> ret;
+    ret.reserve(names.size());
+    for (const String16& name : names) {
+        ret.push_back(checkService(name));
+    }
+    return ret;
+}
+
+std::vector<sp<IBinder>> ServiceManagerShim::getServices(const std::vector<String16>& names) {
+    std::vector<std::string> names8;
+    names8.reserve(names.size());
+    for (const String16& name : names) {
+        names8.push_back(String8(name).c_str());
+    }
+
+    std::vector<os::NamedService> services;
+    if (Status status = mTheRealServiceManager->getServices(names8, &services); !status.isOk()) {
+        if (status.exceptionCode() == Status::EX_TRANSACTION_FAILED &&
+            status.transactionError() == UNKNOWN_TRANSACTION) {
+            // servicemanager predates batched lookups
+            return IServiceManager::getServices(names);
+        }
+        ALOGW("Failed to getServices: %s", status.toString8().c_str());
+        return std::vector<sp<IBinder>>(names.size());
+    }
+    if (services.size() != names.size()) {
+        ALOGW("getServices returned %zu services for %zu names", services.size(), names.size());
+        return std::vector<sp<IBinder>>(names.size());
+    }
+
+    std::vector<sp<IBinder>> ret;
+    ret.reserve(services.size());
+    for (auto& service : services) {
+        ret.push_back(std::move(service.binder));
+    }
+    return ret;
+}
+
 #ifndef __ANDROID__
 // ServiceManagerShim for host. Implements the old libbinder android::IServiceManager API.
 // The internal implementation of the AIDL interface android::os::IServiceManager calls into
@@ -636,6 +676,10 @@ public:
                            const RpcDelegateServiceManagerOptions& options)
           : ServiceManagerShim(impl), mOptions(options) {}
     // ServiceManagerShim::getService is based on checkService, so no need to override it.
+    // Services are looked up one at a time on the device.
+    std::vector<sp<IBinder>> getServices(const std::vector<String16>& names) override {
+        return IServiceManager::getServices(names);
+    }
     sp<IBinder> checkService(const String16& name) const override {
         return getDeviceService({String8(name).c_str()}, mOptions);
     }
@@ -41,6 +41,19 @@ ssize_t sendMessageOnSocket(const RpcTransportFd& socket, iovec* iovs, int niovs
 ssize_t receiveMessageFromSocket(const RpcTransportFd& socket, iovec* iovs, int niovs,
                                  std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds);
 
+/**
+ * Copies the data of 'iovs' into new memory which can be shared with other processes, and seals
+ * it so that its size and contents can't change anymore.
+ */
+status_t createSealedMemory(const char* name, const iovec* iovs, int niovs, unique_fd* outFd);
+
+/**
+ * Maps the first 'size' bytes of memory created by createSealedMemory, possibly in another
+ * process, for reading. Fails if the memory is smaller or could still change.
+ */
+status_t mapSealedMemory(borrowed_fd fd, size_t size, const uint8_t** outData);
+void unmapSealedMemory(const uint8_t* data, size_t size);
+
 uint64_t GetThreadId();
 
 bool report_sysprop_change();
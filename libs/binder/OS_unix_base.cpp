@@ -19,9 +19,13 @@
 #include "file.h"
 
 #include <binder/RpcTransportRaw.h>
+#include <fcntl.h>
+#include <linux/memfd.h>
 #include <log/log.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 
 using android::binder::ReadFully;
 
@@ -65,6 +69,61 @@ status_t dupFileDescriptor(int oldFd, int* newFd) {
     return OK;
 }
 
+status_t createSealedMemory(const char* name, const iovec* iovs, int niovs, unique_fd* outFd) {
+    unique_fd fd(memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    if (!fd.ok()) {
+        PLOGE("Failed createSealedMemory: memfd_create");
+        return -errno;
+    }
+    // Writing rather than mapping the memory, because F_SEAL_WRITE can't be added while there
+    // are writable shared mappings.
+    for (int i = 0; i < niovs; i++) {
+        if (!WriteFully(fd, iovs[i].iov_base, iovs[i].iov_len)) {
+            PLOGE("Failed createSealedMemory: could not write %zu bytes", iovs[i].iov_len);
+            return -errno;
+        }
+    }
+    if (TEMP_FAILURE_RETRY(fcntl(fd.get(), F_ADD_SEALS,
+                                 F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)) == -1) {
+        PLOGE("Failed createSealedMemory: could not add seals");
+        return -errno;
+    }
+    *outFd = std::move(fd);
+    return OK;
+}
+
+status_t mapSealedMemory(borrowed_fd fd, size_t size, const uint8_t** outData) {
+    // Shrinking the memory would make reading it fault, and writing it would change the data
+    // after it has been checked.
+    constexpr int kRequiredSeals = F_SEAL_SHRINK | F_SEAL_WRITE;
+    int seals = TEMP_FAILURE_RETRY(fcntl(fd.get(), F_GET_SEALS));
+    if (seals == -1 || (seals & kRequiredSeals) != kRequiredSeals) {
+        ALOGE("Failed mapSealedMemory: memory is not sealed (seals=0x%x)", seals);
+        return BAD_VALUE;
+    }
+    struct stat st;
+    if (TEMP_FAILURE_RETRY(fstat(fd.get(), &st)) == -1) {
+        PLOGE("Failed mapSealedMemory: fstat");
+        return -errno;
+    }
+    if (st.st_size < 0 || static_cast<uint64_t>(st.st_size) < size) {
+        ALOGE("Failed mapSealedMemory: memory has %jd bytes, expected %zu",
+              static_cast<intmax_t>(st.st_size), size);
+        return BAD_VALUE;
+    }
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd.get(), 0);
+    if (data == MAP_FAILED) {
+        PLOGE("Failed mapSealedMemory: mmap of %zu bytes", size);
+        return -errno;
+    }
+    *outData = static_cast<const uint8_t*>(data);
+    return OK;
+}
+
+void unmapSealedMemory(const uint8_t* data, size_t size) {
+    munmap(const_cast<uint8_t*>(data), size);
+}
+
 std::unique_ptr<RpcTransportCtxFactory> makeDefaultRpcTransportCtxFactory() {
     return RpcTransportCtxFactoryRaw::make();
 }
@@ -116,6 +116,128 @@ constexpr size_t kMaxFds = 1024;
 // Maximum size of a blob to transfer in-place.
 [[maybe_unused]] static const size_t BLOB_INPLACE_LIMIT = 16 * 1024;
 
+// Most Parcels are small and short-lived. Rather than returning their data and object buffers to
+// malloc, each thread keeps a few of them, and hands them to the next Parcel that needs a buffer
+// of the same size. sizeof(Parcel) is fixed, so the data can't be stored in the Parcel itself.
+//
+// Every buffer is allocated with malloc, whether it's cached or not, so a buffer can always be
+// passed to free() or realloc() with a size no larger than the one it was allocated with.
+class ParcelBufferCache {
+public:
+    // Buffers of up to kMaxSize bytes are rounded up to a power of two, no smaller than kMinSize,
+    // and cached.
+    static constexpr size_t kMinSize = 64;
+    static constexpr size_t kMaxSize = 4096;
+
+    // Returns the size to allocate for a buffer of at least |size| bytes.
+    static size_t roundUp(size_t size) {
+        if (size == 0 || size > kMaxSize) return size;
+        size_t rounded = kMinSize;
+        while (rounded < size) rounded *= 2;
+        return rounded;
+    }
+
+    // Like malloc(), but reuses a cached buffer if there is one.
+    static void* allocate(size_t size) {
+        size_t index = classIndex(size);
+        if (index < kNumClasses) {
+            if (ParcelBufferCache* cache = get(true /*create*/);
+                cache != nullptr && cache->mCount[index] > 0) {
+                cache->mCachedBytes -= size;
+                return cache->mBuffers[index][--cache->mCount[index]];
+            }
+        }
+        return malloc(size);
+    }
+
+    // Like free(), but caches the buffer if it's small. |size| is the size it was allocated with.
+    static void release(void* buffer, size_t size) {
+        if (buffer == nullptr) return;
+        size_t index = classIndex(size);
+        if (index < kNumClasses) {
+            if (ParcelBufferCache* cache = get(false /*create*/); cache != nullptr &&
+                cache->mCount[index] < kMaxBuffersPerClass &&
+                cache->mCachedBytes + size <= kMaxCachedBytes) {
+                cache->mCachedBytes += size;
+                cache->mBuffers[index][cache->mCount[index]++] = buffer;
+                return;
+            }
+        }
+        free(buffer);
+    }
+
+    // Like realloc(). If |zero| is set, the old buffer is zeroed before it's released.
+    static void* reallocate(void* buffer, size_t oldSize, size_t newSize, bool zero) {
+        if (newSize == 0) {
+            if (zero && buffer != nullptr) zeroMemory(static_cast<uint8_t*>(buffer), oldSize);
+            release(buffer, oldSize);
+            return nullptr;
+        }
+        if (buffer != nullptr && newSize == oldSize) return buffer;
+        if (!zero && classIndex(oldSize) == kNumClasses && classIndex(newSize) == kNumClasses) {
+            return realloc(buffer, newSize);
+        }
+        void* newBuffer = allocate(newSize);
+        if (newBuffer == nullptr) return nullptr;
+        if (buffer != nullptr) {
+            memcpy(newBuffer, buffer, std::min(oldSize, newSize));
+            if (zero) zeroMemory(static_cast<uint8_t*>(buffer), oldSize);
+            release(buffer, oldSize);
+        }
+        return newBuffer;
+    }
+
+private:
+    static constexpr size_t kNumClasses = 7; // kMinSize, 2 * kMinSize, ..., kMaxSize
+    static constexpr size_t kMaxBuffersPerClass = 4;
+    static constexpr size_t kMaxCachedBytes = 16 * 1024;
+    static_assert(kMinSize << (kNumClasses - 1) == kMaxSize);
+
+    ~ParcelBufferCache() {
+        for (size_t i = 0; i < kNumClasses; i++) {
+            for (size_t j = 0; j < mCount[i]; j++) free(mBuffers[i][j]);
+        }
+    }
+
+    // Returns kNumClasses if buffers of |size| bytes aren't cached.
+    static size_t classIndex(size_t size) {
+        if (size < kMinSize || size > kMaxSize || (size & (size - 1)) != 0) return kNumClasses;
+        size_t index = 0;
+        while ((kMinSize << index) < size) index++;
+        return index;
+    }
+
+    static ParcelBufferCache* get(bool create) {
+#ifdef BINDER_RPC_SINGLE_THREADED
+        // Parcels may still be used from several threads, for instance in the Trusty kernel, and
+        // there's no thread local storage to put the cache in.
+        (void)create;
+        return nullptr;
+#else
+        // A pthread key rather than thread_local, because Parcels are still freed from the
+        // destructors of other keys, such as the one of IPCThreadState, when the thread exits.
+        static pthread_key_t key = [] {
+            pthread_key_t key;
+            int error = pthread_key_create(&key, [](void* cache) {
+                delete static_cast<ParcelBufferCache*>(cache);
+            });
+            LOG_ALWAYS_FATAL_IF(error != 0, "pthread_key_create failed: %s", strerror(error));
+            return key;
+        }();
+        auto* cache = static_cast<ParcelBufferCache*>(pthread_getspecific(key));
+        if (cache == nullptr && create) {
+            cache = new (std::nothrow) ParcelBufferCache();
+            if (cache != nullptr) pthread_setspecific(key, cache);
+        }
+        return cache;
+#endif // BINDER_RPC_SINGLE_THREADED
+    }
+
+    void* mBuffers[kNumClasses][kMaxBuffersPerClass] = {};
+    size_t mCount[kNumClasses] = {};
+    size_t mCachedBytes = 0;
+};
+
 #if defined(__BIONIC__)
 static void FdTag(int fd, const void* old_addr, const void* new_addr) {
     if (android_fdsan_exchange_owner_tag) {
@@ -410,6 +532,7 @@ size_t Parcel::getGlobalAllocCount() {
 
 const uint8_t* Parcel::data() const
 {
+    flattenExternalSegments();
     return mData;
 }
 
@@ -516,7 +639,7 @@ status_t Parcel::appendFrom(const Parcel* parcel, size_t offset, size_t len) {
     }
 
     status_t err;
-    const uint8_t* data = parcel->mData;
+    const uint8_t* data = parcel->data();
     int startPos = mDataPos;
 
     if (len == 0) {
@@ -543,6 +666,7 @@ status_t Parcel::appendFrom(const Parcel* parcel, size_t offset, size_t len) {
             return err;
         }
     }
+    if (mDataPos < mDataSize) flattenExternalSegmentsInRange(mDataPos, len);
 
     // append data
     memcpy(mData + mDataPos, data + offset, len);
@@ -580,13 +704,17 @@ status_t Parcel::appendFrom(const Parcel* parcel, size_t offset, size_t len) {
                     return NO_MEMORY; // overflow
                 size_t newSize = ((kernelFields->mObjectsSize + numObjects) * 3) / 2;
                 if (newSize > SIZE_MAX / sizeof(binder_size_t)) return NO_MEMORY; // overflow
-                binder_size_t* objects = (binder_size_t*)realloc(kernelFields->mObjects,
-                                                                 newSize * sizeof(binder_size_t));
+                const size_t newBytes =
+                        ParcelBufferCache::roundUp(newSize * sizeof(binder_size_t));
+                binder_size_t* objects = (binder_size_t*)ParcelBufferCache::
+                        reallocate(kernelFields->mObjects,
+                                   kernelFields->mObjectsCapacity * sizeof(binder_size_t),
+                                   newBytes, false /*zero*/);
                 if (objects == (binder_size_t*)nullptr) {
                     return NO_MEMORY;
                 }
                 kernelFields->mObjects = objects;
-                kernelFields->mObjectsCapacity = newSize;
+                kernelFields->mObjectsCapacity = newBytes / sizeof(binder_size_t);
             }
 
             // append and acquire objects
@@ -1116,6 +1244,7 @@ status_t Parcel::writeUnpadded(const void* data, size_t len)
         // integer overflow
         return BAD_VALUE;
     }
+    if (mDataPos < mDataSize) flattenExternalSegmentsInRange(mDataPos, len);
 
     if (end <= mDataCapacity) {
 restart_write:
@@ -1144,6 +1273,57 @@ status_t Parcel::write(const void* data, size_t len)
     return mError;
 }
 
+status_t Parcel::writeExternal(const void* data, size_t len,
+                               std::shared_ptr<const void> keepAlive) {
+    // Smaller buffers cost less to copy than to send separately.
+    constexpr size_t kMinExternalSize = 4096;
+    // Each buffer adds up to two iovecs to the message the Parcel is sent in, and sendmsg takes at
+    // most IOV_MAX of them.
+    constexpr size_t kMaxExternalSegments = 64;
+
+    auto* rpcFields = maybeRpcFields();
+    // Only buffers appended at the end are kept separately, so that they stay sorted.
+    if (rpcFields == nullptr || len < kMinExternalSize || mDataPos < mDataSize ||
+        (rpcFields->mExternalSegments != nullptr &&
+         rpcFields->mExternalSegments->size() >= kMaxExternalSegments)) {
+        return write(data, len);
+    }
+
+    // Leaves space for the data, which is only copied if the Parcel is read before it is sent.
+    void* const d = writeInplace(len);
+    if (d == nullptr) return mError;
+
+    if (rpcFields->mExternalSegments == nullptr) {
+        rpcFields->mExternalSegments = std::make_unique<std::vector<RpcFields::ExternalSegment>>();
+    }
+    rpcFields->mExternalSegments->push_back(RpcFields::ExternalSegment{
+            .position = static_cast<size_t>(static_cast<uint8_t*>(d) - mData),
+            .data = data,
+            .size = len,
+            .keepAlive = std::move(keepAlive),
+    });
+    return NO_ERROR;
+}
+
+void Parcel::flattenExternalSegmentsSlow() const {
+    auto& segments = maybeRpcFields()->mExternalSegments;
+    for (const auto& segment : *segments) {
+        memcpy(mData + segment.position, segment.data, segment.size);
+    }
+    segments.reset();
+}
+
+void Parcel::flattenExternalSegmentsInRange(size_t pos, size_t len) const {
+    const auto* rpcFields = maybeRpcFields();
+    if (rpcFields == nullptr || rpcFields->mExternalSegments == nullptr) return;
+    for (const auto& segment : *rpcFields->mExternalSegments) {
+        if (pos < segment.position + segment.size && segment.position < pos + len) {
+            flattenExternalSegmentsSlow();
+            return;
+        }
+    }
+}
+
 void* Parcel::writeInplace(size_t len)
 {
     if (len > INT32_MAX) {
@@ -1158,6 +1338,7 @@ void* Parcel::writeInplace(size_t len)
     if (mDataPos+padded < mDataPos) {
         return nullptr;
     }
+    if (mDataPos < mDataSize) flattenExternalSegmentsInRange(mDataPos, padded);
 
     if ((mDataPos+padded) <= mDataCapacity) {
 restart_write:
@@ -1775,11 +1956,14 @@ restart_write:
         if ((kernelFields->mObjectsSize + 2) > SIZE_MAX / 3) return NO_MEMORY; // overflow
         size_t newSize = ((kernelFields->mObjectsSize + 2) * 3) / 2;
         if (newSize > SIZE_MAX / sizeof(binder_size_t)) return NO_MEMORY; // overflow
-        binder_size_t* objects =
-                (binder_size_t*)realloc(kernelFields->mObjects, newSize * sizeof(binder_size_t));
+        const size_t newBytes = ParcelBufferCache::roundUp(newSize * sizeof(binder_size_t));
+        binder_size_t* objects = (binder_size_t*)ParcelBufferCache::
+                reallocate(kernelFields->mObjects,
+                           kernelFields->mObjectsCapacity * sizeof(binder_size_t), newBytes,
+                           false /*zero*/);
         if (objects == nullptr) return NO_MEMORY;
         kernelFields->mObjects = objects;
-        kernelFields->mObjectsCapacity = newSize;
+        kernelFields->mObjectsCapacity = newBytes / sizeof(binder_size_t);
     }
 
     goto restart_write;
@@ -1877,6 +2061,7 @@ status_t Parcel::read(void* outData, size_t len) const
 
     if ((mDataPos+pad_size(len)) >= mDataPos && (mDataPos+pad_size(len)) <= mDataSize
             && len <= pad_size(len)) {
+        flattenExternalSegments();
         const auto* kernelFields = maybeKernelFields();
         if (kernelFields != nullptr && kernelFields->mObjectsSize > 0) {
             status_t err = validateReadData(mDataPos + pad_size(len));
@@ -1905,6 +2090,7 @@ const void* Parcel::readInplace(size_t len) const
 
     if ((mDataPos+pad_size(len)) >= mDataPos && (mDataPos+pad_size(len)) <= mDataSize
             && len <= pad_size(len)) {
+        flattenExternalSegments();
         const auto* kernelFields = maybeKernelFields();
         if (kernelFields != nullptr && kernelFields->mObjectsSize > 0) {
             status_t err = validateReadData(mDataPos + pad_size(len));
@@ -1953,6 +2139,7 @@ status_t Parcel::readAligned(T *pArg) const {
     static_assert(std::is_trivially_copyable_v<T>);
 
     if ((mDataPos+sizeof(T)) <= mDataSize) {
+        flattenExternalSegments();
         const auto* kernelFields = maybeKernelFields();
         if (kernelFields != nullptr && kernelFields->mObjectsSize > 0) {
             status_t err = validateReadData(mDataPos + sizeof(T));
@@ -1986,6 +2173,8 @@ status_t Parcel::writeAligned(T val) {
     static_assert(PAD_SIZE_UNSAFE(sizeof(T)) == sizeof(T));
     static_assert(std::is_trivially_copyable_v<T>);
 
+    if (mDataPos < mDataSize) flattenExternalSegmentsInRange(mDataPos, sizeof(val));
+
     if ((mDataPos+sizeof(val)) <= mDataCapacity) {
 restart_write:
         memcpy(mData + mDataPos, &val, sizeof(val));
@@ -2172,6 +2361,7 @@ status_t Parcel::readUtf8FromUtf16(std::string* str) const {
 const char* Parcel::readCString() const
 {
     if (mDataPos < mDataSize) {
+        flattenExternalSegments();
         const size_t avail = mDataSize-mDataPos;
         const char* str = reinterpret_cast<const char*>(mData+mDataPos);
         // is the string's trailing NUL within the parcel's valid bounds?
@@ -2879,10 +3069,13 @@ void Parcel::freeDataNoInit()
             if (mDeallocZero) {
                 zeroMemory(mData, mDataSize);
             }
-            free(mData);
+            ParcelBufferCache::release(mData, mDataCapacity);
         }
         auto* kernelFields = maybeKernelFields();
-        if (kernelFields && kernelFields->mObjects) free(kernelFields->mObjects);
+        if (kernelFields && kernelFields->mObjects) {
+            ParcelBufferCache::release(kernelFields->mObjects,
+                                       kernelFields->mObjectsCapacity * sizeof(binder_size_t));
+        }
     }
 }
 
@@ -2902,21 +3095,6 @@ status_t Parcel::growData(size_t len)
             : continueWrite(std::max(newSize, (size_t) 128));
 }
 
-static uint8_t* reallocZeroFree(uint8_t* data, size_t oldCapacity, size_t newCapacity, bool zero) {
-    if (!zero) {
-        return (uint8_t*)realloc(data, newCapacity);
-    }
-    uint8_t* newData = (uint8_t*)malloc(newCapacity);
-    if (!newData) {
-        return nullptr;
-    }
-
-    memcpy(newData, data, std::min(oldCapacity, newCapacity));
-    zeroMemory(data, oldCapacity);
-    free(data);
-    return newData;
-}
-
 status_t Parcel::restartWrite(size_t desired)
 {
     if (desired > INT32_MAX) {
@@ -2930,7 +3108,9 @@ status_t Parcel::restartWrite(size_t desired)
         return continueWrite(desired);
     }
 
-    uint8_t* data = reallocZeroFree(mData, mDataCapacity, desired, mDeallocZero);
+    desired = ParcelBufferCache::roundUp(desired);
+    uint8_t* data = (uint8_t*)ParcelBufferCache::reallocate(mData, mDataCapacity, desired,
+                                                            mDeallocZero);
     if (!data && desired > mDataCapacity) {
         mError = NO_MEMORY;
         return NO_MEMORY;
@@ -2958,7 +3138,8 @@ status_t Parcel::restartWrite(size_t desired)
     ALOGV("restartWrite Setting data pos of %p to %zu", this, mDataPos);
 
     if (auto* kernelFields = maybeKernelFields()) {
-        free(kernelFields->mObjects);
+        ParcelBufferCache::release(kernelFields->mObjects,
+                                   kernelFields->mObjectsCapacity * sizeof(binder_size_t));
         kernelFields->mObjects = nullptr;
         kernelFields->mObjectsSize = kernelFields->mObjectsCapacity = 0;
         kernelFields->mNextObjectHint = 0;
@@ -2968,6 +3149,7 @@ status_t Parcel::restartWrite(size_t desired)
     } else if (auto* rpcFields = maybeRpcFields()) {
         rpcFields->mObjectPositions.clear();
         rpcFields->mFds.reset();
+        rpcFields->mExternalSegments.reset();
     }
     mAllowFds = true;
 
@@ -2990,6 +3172,8 @@ status_t Parcel::continueWrite(size_t desired)
     size_t objectsSize =
             kernelFields ? kernelFields->mObjectsSize : rpcFields->mObjectPositions.size();
     if (desired < mDataSize) {
+        // Buffers written with writeExternal are kept in place so that the parcel can be truncated.
+        flattenExternalSegments();
         if (desired == 0) {
             objectsSize = 0;
         } else {
@@ -3016,7 +3200,8 @@ status_t Parcel::continueWrite(size_t desired)
 
         // If there is a different owner, we need to take
         // posession.
-        uint8_t* data = (uint8_t*)malloc(desired);
+        const size_t capacity = ParcelBufferCache::roundUp(desired);
+        uint8_t* data = (uint8_t*)ParcelBufferCache::allocate(capacity);
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
@@ -3026,7 +3211,7 @@ status_t Parcel::continueWrite(size_t desired)
         if (kernelFields && objectsSize) {
             objects = (binder_size_t*)calloc(objectsSize, sizeof(binder_size_t));
             if (!objects) {
-                free(data);
+                ParcelBufferCache::release(data, capacity);
 
                 mError = NO_MEMORY;
                 return NO_MEMORY;
@@ -3041,7 +3226,7 @@ status_t Parcel::continueWrite(size_t desired)
         }
         if (rpcFields) {
             if (status_t status = truncateRpcObjects(objectsSize); status != OK) {
-                free(data);
+                ParcelBufferCache::release(data, capacity);
                 return status;
             }
         }
@@ -3062,14 +3247,14 @@ status_t Parcel::continueWrite(size_t desired)
                kernelFields ? kernelFields->mObjectsSize : 0);
         mOwner = nullptr;
 
-        LOG_ALLOC("Parcel %p: taking ownership of %zu capacity", this, desired);
-        gParcelGlobalAllocSize += desired;
+        LOG_ALLOC("Parcel %p: taking ownership of %zu capacity", this, capacity);
+        gParcelGlobalAllocSize += capacity;
         gParcelGlobalAllocCount++;
 
         mData = data;
         mDataSize = (mDataSize < desired) ? mDataSize : desired;
         ALOGV("continueWrite Setting data size of %p to %zu", this, mDataSize);
-        mDataCapacity = desired;
+        mDataCapacity = capacity;
         if (kernelFields) {
             kernelFields->mObjects = objects;
             kernelFields->mObjectsSize = kernelFields->mObjectsCapacity = objectsSize;
@@ -3093,7 +3278,9 @@ status_t Parcel::continueWrite(size_t desired)
             }
 
             if (objectsSize == 0) {
-                free(kernelFields->mObjects);
+                ParcelBufferCache::release(kernelFields->mObjects,
+                                           kernelFields->mObjectsCapacity *
+                                                   sizeof(binder_size_t));
                 kernelFields->mObjects = nullptr;
                 kernelFields->mObjectsCapacity = 0;
             } else {
@@ -3120,14 +3307,16 @@ status_t Parcel::continueWrite(size_t desired)
 
         // We own the data, so we can just do a realloc().
         if (desired > mDataCapacity) {
-            uint8_t* data = reallocZeroFree(mData, mDataCapacity, desired, mDeallocZero);
+            const size_t capacity = ParcelBufferCache::roundUp(desired);
+            uint8_t* data = (uint8_t*)ParcelBufferCache::reallocate(mData, mDataCapacity,
+                                                                    capacity, mDeallocZero);
             if (data) {
                 LOG_ALLOC("Parcel %p: continue from %zu to %zu capacity", this, mDataCapacity,
-                        desired);
-                gParcelGlobalAllocSize += desired;
+                        capacity);
+                gParcelGlobalAllocSize += capacity;
                 gParcelGlobalAllocSize -= mDataCapacity;
                 mData = data;
-                mDataCapacity = desired;
+                mDataCapacity = capacity;
             } else {
                 mError = NO_MEMORY;
                 return NO_MEMORY;
@@ -3145,7 +3334,8 @@ status_t Parcel::continueWrite(size_t desired)
 
     } else {
         // This is the first data.  Easy!
-        uint8_t* data = (uint8_t*)malloc(desired);
+        const size_t capacity = ParcelBufferCache::roundUp(desired);
+        uint8_t* data = (uint8_t*)ParcelBufferCache::allocate(capacity);
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
@@ -3159,15 +3349,15 @@ status_t Parcel::continueWrite(size_t desired)
                   kernelFields ? kernelFields->mObjectsCapacity : 0, desired);
         }
 
-        LOG_ALLOC("Parcel %p: allocating with %zu capacity", this, desired);
-        gParcelGlobalAllocSize += desired;
+        LOG_ALLOC("Parcel %p: allocating with %zu capacity", this, capacity);
+        gParcelGlobalAllocSize += capacity;
         gParcelGlobalAllocCount++;
 
         mData = data;
         mDataSize = mDataPos = 0;
         ALOGV("continueWrite Setting data size of %p to %zu", this, mDataSize);
         ALOGV("continueWrite Setting data pos of %p to %zu", this, mDataPos);
-        mDataCapacity = desired;
+        mDataCapacity = capacity;
     }
 
     return NO_ERROR;
@@ -18,6 +18,7 @@
 
 #include <binder/ProcessState.h>
 
+#include <android-base/stringprintf.h>
 #include <android-base/strings.h>
 #include <binder/BpBinder.h>
 #include <binder/Functional.h>
@@ -28,6 +29,7 @@
 #include <utils/AndroidThreads.h>
 #include <utils/Log.h>
 #include <utils/String8.h>
+#include <utils/SystemClock.h>
 #include <utils/Thread.h>
 
 #include "Static.h"
@@ -36,6 +38,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -44,11 +47,18 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <algorithm>
 #include <mutex>
 
 #define BINDER_VM_SIZE ((1 * 1024 * 1024) - sysconf(_SC_PAGE_SIZE) * 2)
 #define DEFAULT_MAX_BINDER_THREADS 15
 #define DEFAULT_ENABLE_ONEWAY_SPAM_DETECTION 1
+// In adaptive mode, a starvation at least this long raises the thread limit.
+#define ADAPTIVE_GROW_STARVATION_MS 10
+// In adaptive mode, the peak of busy threads is tracked over windows this long.
+#define ADAPTIVE_WINDOW_MS 10000
+// In adaptive mode, threads kept on top of the recent peak of busy threads.
+#define ADAPTIVE_SPARE_THREADS 1
 
 #ifdef __ANDROID_VNDK__
 const char* kDefaultDriver = "/dev/vndbinder";
@@ -431,6 +441,154 @@ status_t ProcessState::setThreadPoolMaxThreadCount(size_t maxThreads) {
     return result;
 }
 
+status_t ProcessState::setThreadPoolAdaptive(size_t minThreads, size_t maxThreads) {
+    LOG_ALWAYS_FATAL_IF(mThreadPoolStarted, "Adaptive threadpool must be set before starting it");
+    if (minThreads > maxThreads) {
+        ALOGE("Adaptive threadpool minimum %zu is above its maximum %zu", minThreads, maxThreads);
+        return BAD_VALUE;
+    }
+    status_t result = setThreadPoolMaxThreadCount(minThreads);
+    if (result != NO_ERROR) {
+        return result;
+    }
+    pthread_mutex_lock(&mThreadCountLock);
+    mAdaptiveMinThreads = minThreads;
+    mAdaptiveMaxThreads = maxThreads;
+    mAdaptiveWindowStartMs = uptimeMillis();
+    mAdaptive = maxThreads != 0;
+    pthread_mutex_unlock(&mThreadCountLock);
+    return NO_ERROR;
+}
+
+status_t ProcessState::updateDriverMaxThreadsLocked() {
+    size_t driverMaxThreads = mMaxThreads + mRetiredThreads;
+    if (ioctl(mDriverFD, BINDER_SET_MAX_THREADS, &driverMaxThreads) == -1) {
+        status_t result = -errno;
+        ALOGE("Binder ioctl to set max threads failed: %s", strerror(-result));
+        return result;
+    }
+    return NO_ERROR;
+}
+
+void ProcessState::accountThreadTimeLocked() {
+    int64_t nowMs = uptimeMillis();
+    mThreadTimeMs += (nowMs - mThreadTimeUpdatedMs) * static_cast<int64_t>(mCurrentThreads);
+    mThreadTimeUpdatedMs = nowMs;
+}
+
+void ProcessState::rollAdaptiveWindowLocked(int64_t nowMs) {
+    int64_t elapsedMs = nowMs - mAdaptiveWindowStartMs;
+    if (elapsedMs < ADAPTIVE_WINDOW_MS) return;
+    // A whole window without any transaction has a peak of 0.
+    mAdaptivePrevPeakBusy = elapsedMs < 2 * ADAPTIVE_WINDOW_MS ? mAdaptivePeakBusy : 0;
+    mAdaptivePeakBusy = mExecutingThreadsCount;
+    mAdaptiveWindowStartMs = nowMs;
+}
+
+void ProcessState::recordTransactionLocked() {
+    ThreadPoolStats& stats = mThreadPoolStats;
+    stats.transactionCount++;
+    // mExecutingThreadsCount includes the calling thread
+    size_t others = mExecutingThreadsCount - 1;
+    stats.busyThreadHistogram[std::min(others, stats.busyThreadHistogram.size() - 1)]++;
+    stats.peakBusyThreads = std::max(stats.peakBusyThreads, mExecutingThreadsCount);
+
+    if (mAdaptiveMaxThreads != 0) {
+        rollAdaptiveWindowLocked(uptimeMillis());
+        mAdaptivePeakBusy = std::max(mAdaptivePeakBusy, mExecutingThreadsCount);
+    }
+}
+
+void ProcessState::recordStarvationLocked(int64_t starvationTimeMs) {
+    ThreadPoolStats& stats = mThreadPoolStats;
+    stats.starvationCount++;
+    stats.totalStarvationMs += starvationTimeMs;
+    stats.maxStarvationMs = std::max(stats.maxStarvationMs, starvationTimeMs);
+
+    if (mAdaptiveMaxThreads != 0 && starvationTimeMs >= ADAPTIVE_GROW_STARVATION_MS &&
+        mMaxThreads < mAdaptiveMaxThreads) {
+        mMaxThreads++;
+        if (updateDriverMaxThreadsLocked() != NO_ERROR) {
+            mMaxThreads--;
+            return;
+        }
+        ALOGV("binder thread pool starved for %" PRId64 " ms, raised to %zu threads",
+              starvationTimeMs, mMaxThreads);
+    }
+}
+
+bool ProcessState::retirePooledThreadIfIdle() {
+    if (!mAdaptive.load(std::memory_order_relaxed)) return false;
+
+    pthread_mutex_lock(&mThreadCountLock);
+    auto detachGuard = make_scope_guard([&]() { pthread_mutex_unlock(&mThreadCountLock); });
+
+    if (mAdaptiveMaxThreads == 0 || mKernelStartedThreads == 0) return false;
+
+    rollAdaptiveWindowLocked(uptimeMillis());
+    size_t peakBusy = std::max(mAdaptivePeakBusy, mAdaptivePrevPeakBusy);
+    // mCurrentThreads also counts the thread from startThreadPool
+    size_t neededThreads = std::max(peakBusy + ADAPTIVE_SPARE_THREADS, mAdaptiveMinThreads + 1);
+    if (mCurrentThreads <= neededThreads) return false;
+
+    accountThreadTimeLocked();
+    mCurrentThreads--;
+    mKernelStartedThreads--;
+    mRetiredThreads++;
+    // Let the kernel start another thread in place of this one, if the load comes back.
+    updateDriverMaxThreadsLocked();
+    ALOGV("binder thread pool shrunk to %zu threads (peak busy %zu)", mCurrentThreads, peakBusy);
+    return true;
+}
+
+ProcessState::ThreadPoolStats ProcessState::getThreadPoolStats() const {
+    pthread_mutex_lock(&mThreadCountLock);
+    auto detachGuard = make_scope_guard([&]() { pthread_mutex_unlock(&mThreadCountLock); });
+
+    int64_t nowMs = uptimeMillis();
+    int64_t threadTimeMs =
+            mThreadTimeMs + (nowMs - mThreadTimeUpdatedMs) * static_cast<int64_t>(mCurrentThreads);
+
+    ThreadPoolStats stats = mThreadPoolStats;
+    if (threadTimeMs > 0) {
+        stats.transactionsPerThreadSecond = stats.transactionCount * 1000.0 / threadTimeMs;
+    }
+    stats.currentThreads = mCurrentThreads;
+    stats.maxThreads = mMaxThreads;
+    stats.retiredThreads = mRetiredThreads;
+    stats.durationMs = nowMs - mThreadPoolStatsStartMs;
+    return stats;
+}
+
+void ProcessState::resetThreadPoolStats() {
+    pthread_mutex_lock(&mThreadCountLock);
+    mThreadPoolStats = ThreadPoolStats();
+    mThreadPoolStatsStartMs = uptimeMillis();
+    mThreadTimeMs = 0;
+    mThreadTimeUpdatedMs = mThreadPoolStatsStartMs;
+    pthread_mutex_unlock(&mThreadCountLock);
+}
+
+std::string ProcessState::ThreadPoolStats::toString() const {
+    using android::base::StringAppendF;
+
+    std::string out;
+    StringAppendF(&out, "Binder threadpool: %zu threads (%zu kernel max, %zu retired) over %" PRId64
+                  " ms\n", currentThreads, maxThreads, retiredThreads, durationMs);
+    StringAppendF(&out, "  transactions: %" PRIu64 " (%.2f/s per thread), peak busy threads: %zu\n",
+                  transactionCount, transactionsPerThreadSecond, peakBusyThreads);
+    StringAppendF(&out, "  starvation: %" PRIu64 " times, total %" PRId64 " ms, max %" PRId64
+                  " ms\n", starvationCount, totalStarvationMs, maxStarvationMs);
+    out += "  other busy threads at start:";
+    for (size_t i = 0; i < busyThreadHistogram.size(); i++) {
+        if (busyThreadHistogram[i] == 0) continue;
+        bool last = i == busyThreadHistogram.size() - 1;
+        StringAppendF(&out, " %zu%s:%" PRIu64, i, last ? "+" : "", busyThreadHistogram[i]);
+    }
+    out += "\n";
+    return out;
+}
+
 size_t ProcessState::getThreadPoolMaxTotalThreadCount() const {
     pthread_mutex_lock(&mThreadCountLock);
     auto detachGuard = make_scope_guard([&]() { pthread_mutex_unlock(&mThreadCountLock); });
@@ -561,6 +719,16 @@ ProcessState::ProcessState(const char* driver)
         mCurrentThreads(0),
         mKernelStartedThreads(0),
         mStarvationStartTimeMs(0),
+        mThreadPoolStatsStartMs(uptimeMillis()),
+        mThreadTimeMs(0),
+        mThreadTimeUpdatedMs(mThreadPoolStatsStartMs),
+        mAdaptive(false),
+        mAdaptiveMinThreads(0),
+        mAdaptiveMaxThreads(0),
+        mRetiredThreads(0),
+        mAdaptiveWindowStartMs(0),
+        mAdaptivePeakBusy(0),
+        mAdaptivePrevPeakBusy(0),
         mForked(false),
         mThreadPoolStarted(false),
         mThreadPoolSeq(1),
@@ -21,17 +21,23 @@
 #include <binder/unique_fd.h>
 
 #include <inttypes.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <algorithm>
+#include <array>
 
 using namespace android::binder::impl;
 using android::Parcel;
+using android::String16;
+using android::String8;
 using android::binder::borrowed_fd;
 using android::binder::ReadFully;
 using android::binder::unique_fd;
 using android::binder::WriteFully;
 using android::binder::debug::RecordedTransaction;
+using android::binder::debug::RecordedTransactionReader;
+using android::binder::debug::RecordedTransactionWriter;
 
 #define PADDING8(s) ((8 - (s) % 8) % 8)
 
@@ -111,6 +117,49 @@ static_assert(PADDING8(8) == 0);
 //
 // No effort is made to ensure the expected chunks are present. A single
 // End Chunk may therefore produce an empty, meaningless RecordedTransaction.
+//
+// Recordings of busy services made of such Chunks grow very large, and can
+// only be read from the start. The COMPACT format, written by
+// RecordedTransactionWriter, packs transactions into compressed Blocks instead.
+//
+// WARNING: This format is also under active development and should be
+// considered unstable.
+//
+// A COMPACT recording is a FileHeader followed by Blocks, which can each be
+// decoded on their own.
+// ┌──────────────────────┐
+// │      FileHeader      │
+// ├──────────────────────┤
+// │        Block         │
+// ├──────────────────────┤
+// │        Block         │
+// ├──────────────────────┤
+// ║         ...          ║
+// ╚══════════════════════╝
+//
+// A Block is a BlockHeader, an interface table, the records of the Block's
+// transactions, and Padding such that the Block ends on an 8-byte boundary.
+//
+// The BlockHeader holds the number of transactions in the Block and the range
+// of their timestamps. The interface table holds the name of each interface
+// used in the Block, as a varint length followed by UTF-8 bytes. Neither is
+// compressed, so that they index the recording by position, time and
+// interface without decompressing any records.
+//
+// If it makes them smaller, the records are compressed with the LZ77 codec
+// of compressRecords, which BLOCK_FLAG_COMPRESSED signals. Uncompressed, a
+// record is the following fields, each an LEB128 varint:
+//
+//   timestamp   nanoseconds since the timestamp of the previous record of
+//               the Block (or since the epoch), zigzag encoded
+//   interface   index in the interface table
+//   code, flags, status (zigzag encoded), version
+//   objectCount, followed by that many object offsets
+//   dataSize, followed by the bytes of the data Parcel
+//   replySize, followed by the bytes of the reply Parcel
+//
+// As for Chunks, the checksum in the BlockHeader makes the 64-bit wide XOR of
+// the whole Block zero.
 
 RecordedTransaction::RecordedTransaction(RecordedTransaction&& t) noexcept {
     mData = t.mData;
@@ -176,6 +225,237 @@ static_assert(sizeof(ChunkDescriptor) % 8 == 0);
 constexpr uint32_t kMaxChunkDataSize = 0xfffffff0;
 typedef uint64_t transaction_checksum_t;
 
+namespace {
+
+constexpr uint32_t kCompactFileMagic = 0x32545242; // "BRT2"
+constexpr uint32_t kCompactFileVersion = 1;
+constexpr uint32_t kBlockMagic = 0x4b4c4254;       // "TBLK"
+
+enum : uint32_t {
+    BLOCK_FLAG_COMPRESSED = 1 << 0,
+};
+
+// Blocks are written once their records reach this size.
+constexpr size_t kTargetBlockSize = 64 * 1024;
+// Keeps the size of a Block, including one last oversized record, in 32 bits.
+constexpr size_t kMaxRecordSize = kMaxChunkDataSize - 2 * kTargetBlockSize;
+
+#pragma clang diagnostic push
+#pragma clang diagnostic error "-Wpadded"
+struct FileHeader {
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint64_t reserved = 0;
+};
+
+struct BlockHeader {
+    uint32_t magic = 0;
+    uint32_t flags = 0;
+    uint32_t transactionCount = 0;
+    uint32_t interfaceCount = 0;
+    uint32_t interfaceTableSize = 0;
+    uint32_t storedRecordsSize = 0;
+    uint32_t rawRecordsSize = 0;
+    uint32_t reserved = 0;
+    int64_t minTimestampNs = 0;
+    int64_t maxTimestampNs = 0;
+    transaction_checksum_t checksum = 0;
+};
+#pragma clang diagnostic pop
+static_assert(sizeof(FileHeader) == 16);
+static_assert(sizeof(BlockHeader) == 56);
+static_assert(sizeof(BlockHeader) % 8 == 0);
+
+bool toNanoseconds(timespec ts, int64_t* out) {
+    int64_t ns;
+    return !__builtin_mul_overflow(static_cast<int64_t>(ts.tv_sec), 1000000000, &ns) &&
+            !__builtin_add_overflow(ns, static_cast<int64_t>(ts.tv_nsec), out);
+}
+
+uint64_t zigzagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t zigzagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void writeVarint(std::vector<uint8_t>* out, uint64_t value) {
+    while (value >= 0x80) {
+        out->push_back(static_cast<uint8_t>(value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out->push_back(static_cast<uint8_t>(value));
+}
+
+// Bounds-checked reads from a recording, which is not trusted.
+class Cursor {
+public:
+    Cursor(const uint8_t* data, size_t size) : mData(data), mSize(size) {}
+
+    bool readVarint(uint64_t* out) {
+        uint64_t value = 0;
+        for (size_t shift = 0; shift < 64; shift += 7) {
+            if (mPos >= mSize) return false;
+            uint8_t byte = mData[mPos++];
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                *out = value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool readVarint32(uint32_t* out) {
+        uint64_t value;
+        if (!readVarint(&value) || value > UINT32_MAX) return false;
+        *out = static_cast<uint32_t>(value);
+        return true;
+    }
+
+    bool readBytes(uint64_t size, const uint8_t** out) {
+        if (size > mSize - mPos) return false;
+        *out = mData + mPos;
+        mPos += size;
+        return true;
+    }
+
+    bool atEnd() const { return mPos == mSize; }
+
+private:
+    const uint8_t* mData;
+    size_t mSize;
+    size_t mPos = 0;
+};
+
+transaction_checksum_t checksumWords(const uint8_t* data, size_t size) {
+    const transaction_checksum_t* words = reinterpret_cast<const transaction_checksum_t*>(data);
+    transaction_checksum_t checksum = 0;
+    for (size_t i = 0; i < size / sizeof(transaction_checksum_t); i++) {
+        checksum ^= words[i];
+    }
+    return checksum;
+}
+
+// A byte-oriented LZ77 codec in the style of LZ4, small enough not to need a
+// compression library in libbinder. Parcels compress well with it, since
+// every data Parcel of an interface starts with the same header and UTF-16
+// interface token, and Parcel fields are padded with zeros.
+//
+// The compressed data is a sequence of tokens. A token is a byte holding a
+// literal length in its high nibble and a match length, minus kMinMatch, in
+// its low nibble. A nibble of 15 is followed by bytes which are added to it,
+// up to and including the first one below 255. The literals follow, then the
+// match as a 2-byte little-endian distance back into the output. The last
+// token has no match.
+constexpr size_t kMinMatch = 4;
+constexpr size_t kMaxMatchDistance = 0xffff;
+// Every input byte adds at most 255 bytes of output, through a length byte.
+constexpr uint64_t kMaxExpansion = 255;
+constexpr size_t kMatchHashBits = 12;
+
+void writeCodecLength(std::vector<uint8_t>* out, size_t length) {
+    while (length >= 255) {
+        out->push_back(255);
+        length -= 255;
+    }
+    out->push_back(static_cast<uint8_t>(length));
+}
+
+// A matchLength of 0 ends the data.
+void writeSequence(std::vector<uint8_t>* out, const uint8_t* literals, size_t literalLength,
+                   size_t matchLength, size_t distance) {
+    size_t matchCode = matchLength == 0 ? 0 : matchLength - kMinMatch;
+    out->push_back(static_cast<uint8_t>(std::min<size_t>(literalLength, 15) << 4 |
+                                        std::min<size_t>(matchCode, 15)));
+    if (literalLength >= 15) writeCodecLength(out, literalLength - 15);
+    out->insert(out->end(), literals, literals + literalLength);
+    if (matchLength == 0) return;
+    out->push_back(static_cast<uint8_t>(distance & 0xff));
+    out->push_back(static_cast<uint8_t>(distance >> 8));
+    if (matchCode >= 15) writeCodecLength(out, matchCode - 15);
+}
+
+// Appends the compressed form of data to out.
+void compressRecords(const uint8_t* data, size_t size, std::vector<uint8_t>* out) {
+    // Position + 1 of the last 4 bytes with each hash, 0 if none.
+    std::array<uint32_t, 1 << kMatchHashBits> table = {};
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + kMinMatch <= size) {
+        uint32_t sequence;
+        memcpy(&sequence, data + pos, sizeof(sequence));
+        uint32_t hash;
+        __builtin_mul_overflow(sequence, 2654435761u, &hash);
+        hash >>= 32 - kMatchHashBits;
+
+        size_t candidate = table[hash];
+        table[hash] = static_cast<uint32_t>(pos + 1);
+        if (candidate == 0 || pos - (candidate - 1) > kMaxMatchDistance ||
+            memcmp(data + candidate - 1, data + pos, kMinMatch) != 0) {
+            pos++;
+            continue;
+        }
+        size_t matchStart = candidate - 1;
+        size_t length = kMinMatch;
+        while (pos + length < size && data[matchStart + length] == data[pos + length]) {
+            length++;
+        }
+        writeSequence(out, data + anchor, pos - anchor, length, pos - matchStart);
+        pos += length;
+        anchor = pos;
+    }
+    writeSequence(out, data + anchor, size - anchor, 0, 0);
+}
+
+// Fails unless data decompresses to exactly size bytes.
+bool decompressRecords(const uint8_t* data, size_t dataSize, uint8_t* out, size_t size) {
+    size_t in = 0;
+    size_t pos = 0;
+    auto readLength = [&](size_t* length) {
+        uint8_t byte;
+        do {
+            if (in >= dataSize) return false;
+            byte = data[in++];
+            *length += byte;
+        } while (byte == 255);
+        return true;
+    };
+    while (true) {
+        if (in >= dataSize) return false;
+        uint8_t token = data[in++];
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(&literalLength)) return false;
+        if (literalLength > dataSize - in || literalLength > size - pos) return false;
+        memcpy(out + pos, data + in, literalLength);
+        in += literalLength;
+        pos += literalLength;
+        if (in == dataSize) return pos == size;
+
+        if (dataSize - in < 2) return false;
+        size_t distance = data[in] | (data[in + 1] << 8);
+        in += 2;
+        if (distance == 0 || distance > pos) return false;
+        size_t matchLength = token & 0xf;
+        if (matchLength == 15 && !readLength(&matchLength)) return false;
+        matchLength += kMinMatch;
+        if (matchLength > size - pos) return false;
+        if (distance >= matchLength) {
+            memcpy(out + pos, out + pos - distance, matchLength);
+        } else {
+            // overlapping match, repeating the last 'distance' bytes
+            for (size_t i = 0; i < matchLength; i++) {
+                out[pos + i] = out[pos + i - distance];
+            }
+        }
+        pos += matchLength;
+    }
+}
+
+} // namespace
+
 std::optional<RecordedTransaction> RecordedTransaction::fromFile(const unique_fd& fd) {
     RecordedTransaction t;
     ChunkDescriptor chunk;
@@ -426,3 +706,414 @@ const Parcel& RecordedTransaction::getDataParcel() const {
 const Parcel& RecordedTransaction::getReplyParcel() const {
     return mReplyDataOnly;
 }
+
+std::unique_ptr<RecordedTransactionWriter> RecordedTransactionWriter::create(unique_fd fd) {
+    FileHeader header = {.magic = kCompactFileMagic, .version = kCompactFileVersion};
+    if (!WriteFully(fd, &header, sizeof(FileHeader))) {
+        ALOGE("Failed to write recording header to fd %d", fd.get());
+        return nullptr;
+    }
+    // using 'new' to access a non-public constructor
+    return std::unique_ptr<RecordedTransactionWriter>(
+            new RecordedTransactionWriter(std::move(fd)));
+}
+
+RecordedTransactionWriter::RecordedTransactionWriter(unique_fd fd) : mFd(std::move(fd)) {}
+
+RecordedTransactionWriter::~RecordedTransactionWriter() {
+    if (status_t status = flush(); status != NO_ERROR) {
+        ALOGE("Failed to write last block of recording: %d", status);
+    }
+}
+
+size_t RecordedTransactionWriter::interfaceIndex(const String16& interfaceName) {
+    for (size_t i = 0; i < mInterfaceNames16.size(); i++) {
+        if (mInterfaceNames16[i] == interfaceName) return i;
+    }
+    mInterfaceNames16.push_back(interfaceName);
+    mInterfaceNames.push_back(String8(interfaceName).c_str());
+    return mInterfaceNames.size() - 1;
+}
+
+size_t RecordedTransactionWriter::interfaceIndex(const std::string& interfaceName) {
+    for (size_t i = 0; i < mInterfaceNames.size(); i++) {
+        if (mInterfaceNames[i] == interfaceName) return i;
+    }
+    mInterfaceNames16.push_back(String16(interfaceName.c_str(), interfaceName.size()));
+    mInterfaceNames.push_back(interfaceName);
+    return mInterfaceNames.size() - 1;
+}
+
+android::status_t RecordedTransactionWriter::append(const String16& interfaceName, uint32_t code,
+                                                    uint32_t flags, timespec timestamp,
+                                                    const Parcel& data, const Parcel& reply,
+                                                    status_t err) {
+    mObjectOffsets.clear();
+    if (const auto* kernelFields = data.maybeKernelFields()) {
+        mObjectOffsets.insert(mObjectOffsets.end(), kernelFields->mObjects,
+                              kernelFields->mObjects + kernelFields->mObjectsSize);
+    }
+    return appendRecord(interfaceIndex(interfaceName), code, flags, err, data.isForRpc() ? 1 : 0,
+                        timestamp, data.data(), data.dataBufferSize(), mObjectOffsets,
+                        reply.data(), reply.dataBufferSize());
+}
+
+android::status_t RecordedTransactionWriter::append(const RecordedTransaction& transaction) {
+    const Parcel& data = transaction.getDataParcel();
+    const Parcel& reply = transaction.getReplyParcel();
+    return appendRecord(interfaceIndex(transaction.getInterfaceName()), transaction.getCode(),
+                        transaction.getFlags(), transaction.getReturnedStatus(),
+                        transaction.getVersion(), transaction.getTimestamp(), data.data(),
+                        data.dataBufferSize(), transaction.getObjectOffsets(), reply.data(),
+                        reply.dataBufferSize());
+}
+
+android::status_t RecordedTransactionWriter::appendRecord(
+        size_t interfaceIndex, uint32_t code, uint32_t flags, int32_t status, uint32_t version,
+        timespec timestamp, const uint8_t* data, size_t dataSize,
+        const std::vector<uint64_t>& objectOffsets, const uint8_t* reply, size_t replySize) {
+    int64_t timestampNs;
+    int64_t timestampDeltaNs;
+    if (!toNanoseconds(timestamp, &timestampNs) ||
+        __builtin_sub_overflow(timestampNs, mPreviousTimestampNs, &timestampDeltaNs)) {
+        ALOGE("Invalid transaction timestamp.");
+        return BAD_VALUE;
+    }
+    if (dataSize > kMaxRecordSize || replySize > kMaxRecordSize - dataSize ||
+        objectOffsets.size() > (kMaxRecordSize - dataSize - replySize) / sizeof(uint64_t)) {
+        ALOGE("Transaction is too large to record.");
+        return BAD_VALUE;
+    }
+
+    writeVarint(&mRecords, zigzagEncode(timestampDeltaNs));
+    writeVarint(&mRecords, interfaceIndex);
+    writeVarint(&mRecords, code);
+    writeVarint(&mRecords, flags);
+    writeVarint(&mRecords, zigzagEncode(status));
+    writeVarint(&mRecords, version);
+    writeVarint(&mRecords, objectOffsets.size());
+    for (uint64_t offset : objectOffsets) {
+        writeVarint(&mRecords, offset);
+    }
+    writeVarint(&mRecords, dataSize);
+    mRecords.insert(mRecords.end(), data, data + dataSize);
+    writeVarint(&mRecords, replySize);
+    mRecords.insert(mRecords.end(), reply, reply + replySize);
+
+    if (mTransactionCount == 0) {
+        mMinTimestampNs = mMaxTimestampNs = timestampNs;
+    } else {
+        mMinTimestampNs = std::min(mMinTimestampNs, timestampNs);
+        mMaxTimestampNs = std::max(mMaxTimestampNs, timestampNs);
+    }
+    mPreviousTimestampNs = timestampNs;
+    mTransactionCount++;
+
+    if (mRecords.size() >= kTargetBlockSize) {
+        return flush();
+    }
+    return NO_ERROR;
+}
+
+android::status_t RecordedTransactionWriter::flush() {
+    if (mTransactionCount == 0) return NO_ERROR;
+
+    // The block is dropped if it can't be written, so that the next one starts
+    // from a clean state.
+    auto resetGuard = make_scope_guard([this] {
+        mInterfaceNames16.clear();
+        mInterfaceNames.clear();
+        mRecords.clear();
+        mTransactionCount = 0;
+        mPreviousTimestampNs = 0;
+    });
+
+    mBlock.clear();
+    mBlock.resize(sizeof(BlockHeader));
+    for (const std::string& name : mInterfaceNames) {
+        writeVarint(&mBlock, name.size());
+        mBlock.insert(mBlock.end(), name.begin(), name.end());
+    }
+    const size_t recordsStart = mBlock.size();
+
+    uint32_t flags = BLOCK_FLAG_COMPRESSED;
+    compressRecords(mRecords.data(), mRecords.size(), &mBlock);
+    if (mBlock.size() - recordsStart >= mRecords.size()) {
+        mBlock.resize(recordsStart);
+        mBlock.insert(mBlock.end(), mRecords.begin(), mRecords.end());
+        flags = 0;
+    }
+    const size_t storedRecordsSize = mBlock.size() - recordsStart;
+    mBlock.resize(mBlock.size() + PADDING8(mBlock.size()), 0);
+
+    BlockHeader header = {
+            .magic = kBlockMagic,
+            .flags = flags,
+            .transactionCount = mTransactionCount,
+            .interfaceCount = static_cast<uint32_t>(mInterfaceNames.size()),
+            .interfaceTableSize = static_cast<uint32_t>(recordsStart - sizeof(BlockHeader)),
+            .storedRecordsSize = static_cast<uint32_t>(storedRecordsSize),
+            .rawRecordsSize = static_cast<uint32_t>(mRecords.size()),
+            .minTimestampNs = mMinTimestampNs,
+            .maxTimestampNs = mMaxTimestampNs,
+    };
+    memcpy(mBlock.data(), &header, sizeof(BlockHeader));
+    header.checksum = checksumWords(mBlock.data(), mBlock.size());
+    memcpy(mBlock.data(), &header, sizeof(BlockHeader));
+
+    if (!WriteFully(mFd, mBlock.data(), mBlock.size())) {
+        ALOGE("Failed to write recording block to fd %d", mFd.get());
+        return UNKNOWN_ERROR;
+    }
+    return NO_ERROR;
+}
+
+struct RecordedTransactionReader::Block {
+    // Offset of the BlockHeader in the mapping.
+    size_t offset;
+    // Size of the whole Block, including Padding.
+    size_t size;
+    // Index in the recording of the first transaction of the Block.
+    size_t firstIndex;
+    BlockHeader header;
+    std::vector<std::string> interfaceNames;
+};
+
+std::unique_ptr<RecordedTransactionReader> RecordedTransactionReader::open(const unique_fd& fd) {
+    struct stat fileStat;
+    if (fstat(fd.get(), &fileStat) != 0) {
+        ALOGE("Unable to get file information");
+        return nullptr;
+    }
+    const size_t fileSize = fileStat.st_size;
+    if (fileSize < sizeof(FileHeader)) {
+        ALOGE("File is too small to contain a recording.");
+        return nullptr;
+    }
+    void* mapped = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd.get(), 0);
+    if (mapped == MAP_FAILED) {
+        ALOGE("Memory mapping failed for fd %d: %d %s", fd.get(), errno, strerror(errno));
+        return nullptr;
+    }
+    auto unmapGuard = make_scope_guard([mapped, fileSize] { munmap(mapped, fileSize); });
+    const uint8_t* base = static_cast<const uint8_t*>(mapped);
+
+    FileHeader fileHeader;
+    memcpy(&fileHeader, base, sizeof(FileHeader));
+    if (fileHeader.magic != kCompactFileMagic || fileHeader.version != kCompactFileVersion) {
+        ALOGE("Not a compact recording (magic 0x%" PRIx32 ", version %" PRIu32 ").",
+              fileHeader.magic, fileHeader.version);
+        return nullptr;
+    }
+
+    std::vector<Block> blocks;
+    size_t transactionCount = 0;
+    size_t offset = sizeof(FileHeader);
+    while (fileSize - offset >= sizeof(BlockHeader)) {
+        Block block = {.offset = offset, .firstIndex = transactionCount};
+        memcpy(&block.header, base + offset, sizeof(BlockHeader));
+        const BlockHeader& header = block.header;
+        if (header.magic != kBlockMagic) {
+            ALOGE("Invalid block at offset %zu, ignoring the rest of the recording.", offset);
+            break;
+        }
+        uint64_t payloadSize =
+                static_cast<uint64_t>(header.interfaceTableSize) + header.storedRecordsSize;
+        uint64_t blockSize = sizeof(BlockHeader) + payloadSize + PADDING8(payloadSize);
+        if (blockSize > fileSize - offset) {
+            ALOGW("Recording ends with a partial block at offset %zu.", offset);
+            break;
+        }
+        block.size = static_cast<size_t>(blockSize);
+
+        Cursor table(base + offset + sizeof(BlockHeader), header.interfaceTableSize);
+        bool validTable = true;
+        for (uint32_t i = 0; i < header.interfaceCount && validTable; i++) {
+            uint64_t nameSize;
+            const uint8_t* name;
+            validTable = table.readVarint(&nameSize) && table.readBytes(nameSize, &name);
+            if (validTable) {
+                block.interfaceNames.emplace_back(reinterpret_cast<const char*>(name), nameSize);
+            }
+        }
+        if (!validTable || !table.atEnd()) {
+            ALOGE("Invalid interface table at offset %zu, ignoring the rest of the recording.",
+                  offset);
+            break;
+        }
+
+        transactionCount += header.transactionCount;
+        offset += block.size;
+        blocks.push_back(std::move(block));
+    }
+
+    unmapGuard.release();
+    // using 'new' to access a non-public constructor
+    return std::unique_ptr<RecordedTransactionReader>(
+            new RecordedTransactionReader(mapped, fileSize, std::move(blocks)));
+}
+
+RecordedTransactionReader::RecordedTransactionReader(void* mapped, size_t mappedSize,
+                                                     std::vector<Block> blocks)
+      : mMapped(mapped), mMappedSize(mappedSize), mBlocks(std::move(blocks)) {}
+
+RecordedTransactionReader::~RecordedTransactionReader() {
+    munmap(mMapped, mMappedSize);
+}
+
+size_t RecordedTransactionReader::size() const {
+    return mBlocks.empty() ? 0 : mBlocks.back().firstIndex + mBlocks.back().header.transactionCount;
+}
+
+std::optional<RecordedTransaction> RecordedTransactionReader::get(size_t index) const {
+    if (index >= size()) return std::nullopt;
+    std::optional<RecordedTransaction> result;
+    status_t status = forEach(index, index + 1, Filter(),
+                              [&](size_t, const RecordedTransaction& transaction) {
+                                  RecordedTransaction copy;
+                                  copy.mData = transaction.mData;
+                                  const Parcel& data = transaction.getDataParcel();
+                                  const Parcel& reply = transaction.getReplyParcel();
+                                  copy.mSentDataOnly.setData(data.data(), data.dataSize());
+                                  copy.mReplyDataOnly.setData(reply.data(), reply.dataSize());
+                                  result.emplace(std::move(copy));
+                                  return false;
+                              });
+    if (status != NO_ERROR) return std::nullopt;
+    return result;
+}
+
+size_t RecordedTransactionReader::seek(timespec time) const {
+    size_t found = size();
+    Filter filter;
+    filter.start = time;
+    status_t status = forEach(0, size(), filter, [&](size_t index, const RecordedTransaction&) {
+        found = index;
+        return false;
+    });
+    return status == NO_ERROR ? found : size();
+}
+
+android::status_t RecordedTransactionReader::forEach(size_t begin, size_t end,
+                                                     const Filter& filter,
+                                                     const Visitor& visitor) const {
+    end = std::min(end, size());
+    if (begin >= end) return NO_ERROR;
+
+    int64_t startNs = INT64_MIN;
+    int64_t endNs = INT64_MAX;
+    if ((filter.start && !toNanoseconds(*filter.start, &startNs)) ||
+        (filter.end && !toNanoseconds(*filter.end, &endNs))) {
+        return BAD_VALUE;
+    }
+
+    // the last block starting at or before begin
+    auto block = std::upper_bound(mBlocks.begin(), mBlocks.end(), begin,
+                                  [](size_t index, const Block& b) {
+                                      return index < b.firstIndex;
+                                  });
+    for (--block; block != mBlocks.end() && block->firstIndex < end; ++block) {
+        if (block->header.maxTimestampNs < startNs || block->header.minTimestampNs > endNs) {
+            continue;
+        }
+        if (filter.interfaceName &&
+            std::find(block->interfaceNames.begin(), block->interfaceNames.end(),
+                      *filter.interfaceName) == block->interfaceNames.end()) {
+            continue;
+        }
+        bool stopped = false;
+        if (status_t status = decodeBlock(*block, begin, end, filter, visitor, &stopped);
+            status != NO_ERROR || stopped) {
+            return status;
+        }
+    }
+    return NO_ERROR;
+}
+
+android::status_t RecordedTransactionReader::decodeBlock(const Block& block, size_t begin,
+                                                         size_t end, const Filter& filter,
+                                                         const Visitor& visitor,
+                                                         bool* stopped) const {
+    const BlockHeader& header = block.header;
+    const uint8_t* blockData = static_cast<const uint8_t*>(mMapped) + block.offset;
+    if (checksumWords(blockData, block.size) != 0) {
+        ALOGE("Checksum failed for block at offset %zu.", block.offset);
+        return BAD_VALUE;
+    }
+
+    const uint8_t* records = blockData + sizeof(BlockHeader) + header.interfaceTableSize;
+    if (header.flags & BLOCK_FLAG_COMPRESSED) {
+        // Checked before sizing mScratch. The records before the last one of
+        // a block stay below kTargetBlockSize, and the last one adds at most
+        // kMaxRecordSize plus a few varints.
+        if (header.rawRecordsSize > kMaxChunkDataSize ||
+            header.rawRecordsSize > header.storedRecordsSize * kMaxExpansion) {
+            ALOGE("Invalid raw records size %" PRIu32 " for block at offset %zu.",
+                  header.rawRecordsSize, block.offset);
+            return BAD_VALUE;
+        }
+        mScratch.resize(header.rawRecordsSize);
+        if (!decompressRecords(records, header.storedRecordsSize, mScratch.data(),
+                               mScratch.size())) {
+            ALOGE("Failed to decompress block at offset %zu.", block.offset);
+            return BAD_VALUE;
+        }
+        records = mScratch.data();
+    } else if (header.rawRecordsSize != header.storedRecordsSize) {
+        ALOGE("Invalid records size for block at offset %zu.", block.offset);
+        return BAD_VALUE;
+    }
+
+    int64_t startNs = INT64_MIN;
+    int64_t endNs = INT64_MAX;
+    if (filter.start) toNanoseconds(*filter.start, &startNs);
+    if (filter.end) toNanoseconds(*filter.end, &endNs);
+
+    Cursor cursor(records, header.rawRecordsSize);
+    int64_t timestampNs = 0;
+    for (size_t i = 0; i < header.transactionCount; i++) {
+        const size_t index = block.firstIndex + i;
+        if (index >= end) return NO_ERROR;
+
+        RecordedTransaction t;
+        RecordedTransaction::TransactionHeader& th = t.mData.mHeader;
+        uint64_t timestampDelta, interface, status, objectCount, dataSize, replySize;
+        const uint8_t* data;
+        const uint8_t* reply;
+        bool valid = cursor.readVarint(&timestampDelta) && cursor.readVarint(&interface) &&
+                cursor.readVarint32(&th.code) && cursor.readVarint32(&th.flags) &&
+                cursor.readVarint(&status) && cursor.readVarint32(&th.version) &&
+                cursor.readVarint(&objectCount) && interface < block.interfaceNames.size() &&
+                !__builtin_add_overflow(timestampNs, zigzagDecode(timestampDelta), &timestampNs);
+        for (uint64_t j = 0; valid && j < objectCount; j++) {
+            uint64_t offset;
+            valid = cursor.readVarint(&offset);
+            if (valid) t.mData.mSentObjectData.push_back(offset);
+        }
+        valid = valid && cursor.readVarint(&dataSize) && cursor.readBytes(dataSize, &data) &&
+                cursor.readVarint(&replySize) && cursor.readBytes(replySize, &reply);
+        if (!valid) {
+            ALOGE("Invalid record %zu in block at offset %zu.", i, block.offset);
+            return BAD_VALUE;
+        }
+
+        if (index < begin || timestampNs < startNs || timestampNs > endNs ||
+            (filter.interfaceName && *filter.interfaceName != block.interfaceNames[interface])) {
+            continue;
+        }
+        th.statusReturned = static_cast<int32_t>(zigzagDecode(status));
+        th.timestampSeconds = timestampNs / 1000000000;
+        th.timestampNanoseconds = static_cast<int32_t>(timestampNs % 1000000000);
+        t.mData.mInterfaceName = block.interfaceNames[interface];
+        if (t.mSentDataOnly.setData(data, dataSize) != android::NO_ERROR ||
+            t.mReplyDataOnly.setData(reply, replySize) != android::NO_ERROR) {
+            ALOGE("Failed to set parcel data.");
+            return BAD_VALUE;
+        }
+        if (!visitor(index, t)) {
+            *stopped = true;
+            return NO_ERROR;
+        }
+    }
+    return NO_ERROR;
+}
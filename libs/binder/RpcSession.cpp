@@ -102,6 +102,17 @@ size_t RpcSession::getMaxOutgoingThreads() {
     return mMaxOutgoingConnections;
 }
 
+void RpcSession::setMaxPipelinedTransactions(size_t transactions) {
+    RpcMutexLockGuard _l(mMutex);
+    LOG_ALWAYS_FATAL_IF(transactions == 0, "Must allow at least one transaction per connection");
+    mMaxPipelinedTransactions = transactions;
+}
+
+size_t RpcSession::getMaxPipelinedTransactions() {
+    RpcMutexLockGuard _l(mMutex);
+    return mMaxPipelinedTransactions;
+}
+
 bool RpcSession::setProtocolVersionInternal(uint32_t version, bool checkStarted) {
     if (!RpcState::validateProtocolVersion(version)) {
         return false;
@@ -267,14 +278,15 @@ bool RpcSession::shutdownAndWait(bool wait) {
 status_t RpcSession::transact(const sp<IBinder>& binder, uint32_t code, const Parcel& data,
                               Parcel* reply, uint32_t flags) {
     ExclusiveConnection connection;
-    status_t status =
-            ExclusiveConnection::find(sp<RpcSession>::fromExisting(this),
-                                      (flags & IBinder::FLAG_ONEWAY) ? ConnectionUse::CLIENT_ASYNC
-                                                                     : ConnectionUse::CLIENT,
-                                      &connection);
+    status_t status = ExclusiveConnection::find(sp<RpcSession>::fromExisting(this),
+                                                (flags & IBinder::FLAG_ONEWAY)
+                                                        ? ConnectionUse::CLIENT_ASYNC
+                                                        : ConnectionUse::CLIENT_PIPELINED,
+                                                &connection);
     if (status != OK) return status;
     return state()->transact(connection.get(), binder, code, data,
-                             sp<RpcSession>::fromExisting(this), reply, flags);
+                             sp<RpcSession>::fromExisting(this), reply, flags,
+                             connection.isPipelined());
 }
 
 status_t RpcSession::sendDecStrong(const BpBinder* binder) {
@@ -856,6 +868,17 @@ void RpcSession::clearConnectionTid(const sp<RpcConnection>& connection) {
     }
 }
 
+void RpcSession::clearPipelinedUser(const sp<RpcConnection>& connection) {
+    RpcMutexUniqueLock _l(mMutex);
+    LOG_ALWAYS_FATAL_IF(connection->pipelinedUsers == 0, "Connection is not shared");
+    connection->pipelinedUsers--;
+    if (mConnections.mWaitingThreads > 0) {
+        _l.unlock();
+        // a connection which is still shared can only be used by some of the waiting threads
+        mAvailableConnectionCv.notify_all();
+    }
+}
+
 std::vector<uint8_t> RpcSession::getCertificate(RpcCertificateFormat format) {
     return mCtx->getCertificate(format);
 }
@@ -865,10 +888,19 @@ status_t RpcSession::ExclusiveConnection::find(const sp<RpcSession>& session, Co
     connection->mSession = session;
     connection->mConnection = nullptr;
     connection->mReentrant = false;
+    connection->mPipelined = false;
 
     uint64_t tid = binder::os::GetThreadId();
     RpcMutexUniqueLock _l(session->mMutex);
 
+    // sharing a connection relies on transaction ids, so only do it when they were negotiated
+    if (use == ConnectionUse::CLIENT_PIPELINED &&
+        (session->mMaxPipelinedTransactions <= 1 ||
+         session->mProtocolVersion.value_or(RPC_WIRE_PROTOCOL_VERSION) <
+                 RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_TRANSACTION_ID)) {
+        use = ConnectionUse::CLIENT;
+    }
+
     session->mConnections.mWaitingThreads++;
     while (true) {
         sp<RpcConnection> exclusive;
@@ -925,8 +957,23 @@ status_t RpcSession::ExclusiveConnection::find(const sp<RpcSession>& session, Co
             break;
         } else if (available != nullptr) {
             connection->mConnection = available;
-            connection->mConnection->exclusiveTid = tid;
+            if (use == ConnectionUse::CLIENT_PIPELINED) {
+                connection->mConnection->pipelinedUsers++;
+                connection->mPipelined = true;
+            } else {
+                connection->mConnection->exclusiveTid = tid;
+            }
             break;
+        } else if (use == ConnectionUse::CLIENT_PIPELINED) {
+            sp<RpcConnection> shared =
+                    findPipelinedConnection(session->mConnections.mOutgoing,
+                                            session->mMaxPipelinedTransactions);
+            if (shared != nullptr) {
+                connection->mConnection = shared;
+                connection->mConnection->pipelinedUsers++;
+                connection->mPipelined = true;
+                break;
+            }
         }
 
         if (session->mConnections.mOutgoing.size() == 0) {
@@ -967,7 +1014,8 @@ void RpcSession::ExclusiveConnection::findConnection(uint64_t tid, sp<RpcConnect
         sp<RpcConnection>& socket = sockets[(i + socketsIndexHint) % sockets.size()];
 
         // take first available connection (intuition = caching)
-        if (available && *available == nullptr && socket->exclusiveTid == std::nullopt) {
+        if (available && *available == nullptr && socket->exclusiveTid == std::nullopt &&
+            socket->pipelinedUsers == 0) {
             *available = socket;
             continue;
         }
@@ -981,7 +1029,25 @@ void RpcSession::ExclusiveConnection::findConnection(uint64_t tid, sp<RpcConnect
     }
 }
 
+sp<RpcSession::RpcConnection> RpcSession::ExclusiveConnection::findPipelinedConnection(
+        const std::vector<sp<RpcConnection>>& sockets, size_t maxUsers) {
+    // spread the callers over the connections which are already shared
+    sp<RpcConnection> shared;
+    for (const sp<RpcConnection>& socket : sockets) {
+        if (socket->pipelinedUsers == 0 || socket->pipelinedUsers >= maxUsers) continue;
+        if (shared == nullptr || socket->pipelinedUsers < shared->pipelinedUsers) {
+            shared = socket;
+        }
+    }
+    return shared;
+}
+
 RpcSession::ExclusiveConnection::~ExclusiveConnection() {
+    if (mPipelined) {
+        mSession->clearPipelinedUser(mConnection);
+        return;
+    }
+
     // reentrant use of a connection means something less deep in the call stack
     // is using this fd, and it retains the right to it. So, we don't give up
     // exclusive ownership, and no thread is freed.
@@ -992,7 +1058,8 @@ RpcSession::ExclusiveConnection::~ExclusiveConnection() {
 
 bool RpcSession::hasActiveConnection(const std::vector<sp<RpcConnection>>& connections) {
     for (const auto& connection : connections) {
-        if (connection->exclusiveTid != std::nullopt && !connection->rpcTransport->isWaiting()) {
+        if ((connection->exclusiveTid != std::nullopt || connection->pipelinedUsers != 0) &&
+            !connection->rpcTransport->isWaiting()) {
             return true;
         }
     }
@@ -24,9 +24,12 @@
 #include <binder/RpcServer.h>
 
 #include "Debug.h"
+#include "OS.h"
 #include "RpcWireFormat.h"
 #include "Utils.h"
 
+#include <cstddef>
+#include <limits>
 #include <random>
 #include <sstream>
 
@@ -69,6 +72,23 @@ static bool enableAncillaryFds(RpcSession::FileDescriptorTransportMode mode) {
 RpcState::RpcState() {}
 RpcState::~RpcState() {}
 
+size_t RpcState::shardIndexForAddress(uint64_t address) {
+    return RpcWireAddress::fromRaw(address).address % kNodeShards;
+}
+
+size_t RpcState::shardIndexForLocalBinder(const IBinder* binder) {
+    // the low bits are the same for every object
+    return reinterpret_cast<uintptr_t>(binder) / alignof(std::max_align_t) % kNodeShards;
+}
+
+void RpcState::lockAllShards() {
+    for (auto& shard : mNodeShards) shard.mutex.lock();
+}
+
+void RpcState::unlockAllShards() {
+    for (auto& shard : mNodeShards) shard.mutex.unlock();
+}
+
 status_t RpcState::onBinderLeaving(const sp<RpcSession>& session, const sp<IBinder>& binder,
                                    uint64_t* outAddress) {
     bool isRemote = binder->remoteBinder();
@@ -94,58 +114,77 @@ status_t RpcState::onBinderLeaving(const sp<RpcSession>& session, const sp<IBind
         return INVALID_OPERATION;
     }
 
-    RpcMutexLockGuard _l(mNodeMutex);
+    if (isRpc) {
+        // An RPC binder proxy already knows its address, so only its shard has
+        // to be searched.
+        uint64_t addr = binder->remoteBinder()->getPrivateAccessor().rpcAddress();
+        NodeShard& shard = shardForAddress(addr);
+        RpcMutexLockGuard _l(shard.mutex);
+        if (mTerminated) return DEAD_OBJECT;
+
+        auto it = shard.nodeForAddress.find(addr);
+        LOG_ALWAYS_FATAL_IF(it == shard.nodeForAddress.end(),
+                            "RPC binder must have known address at this point");
+        // check integrity of data structure
+        LOG_ALWAYS_FATAL_IF(binder != it->second.binder, "Address mismatch for %" PRIu64, addr);
+        it->second.timesSent++;
+        it->second.sentRef = binder; // might already be set
+        *outAddress = addr;
+        return OK;
+    }
+
+    const size_t shardIndex = shardIndexForLocalBinder(binder.get());
+    NodeShard& shard = mNodeShards[shardIndex];
+    RpcMutexLockGuard _l(shard.mutex);
     if (mTerminated) return DEAD_OBJECT;
 
-    // TODO(b/182939933): maybe move address out of BpBinder, and keep binder->address map
-    // in RpcState
-    for (auto& [addr, node] : mNodeForAddress) {
-        if (binder == node.binder) {
-            if (isRpc) {
-                // check integrity of data structure
-                uint64_t actualAddr = binder->remoteBinder()->getPrivateAccessor().rpcAddress();
-                LOG_ALWAYS_FATAL_IF(addr != actualAddr, "Address mismatch %" PRIu64 " vs %" PRIu64,
-                                    addr, actualAddr);
-            }
-            node.timesSent++;
-            node.sentRef = binder; // might already be set
-            *outAddress = addr;
-            return OK;
-        }
+    if (auto found = shard.addressForLocalBinder.find(binder.get());
+        found != shard.addressForLocalBinder.end()) {
+        auto it = shard.nodeForAddress.find(found->second);
+        LOG_ALWAYS_FATAL_IF(it == shard.nodeForAddress.end() || binder != it->second.binder,
+                            "Local binder %p has inconsistent address %" PRIu64, binder.get(),
+                            found->second);
+        it->second.timesSent++;
+        it->second.sentRef = binder; // might already be set
+        *outAddress = it->first;
+        return OK;
     }
-    LOG_ALWAYS_FATAL_IF(isRpc, "RPC binder must have known address at this point");
 
     bool forServer = session->server() != nullptr;
 
     // arbitrary limit for maximum number of nodes in a process (otherwise we
     // might run out of addresses)
-    if (mNodeForAddress.size() > 100000) {
+    if (mNodeCount > 100000) {
         return NO_MEMORY;
     }
 
     while (true) {
+        // Addresses are allocated so that the node lands in the shard of the
+        // binder, which is the shard that is searched when it is sent again.
+        uint64_t id = uint64_t(shard.nextId) * kNodeShards + shardIndex;
+        if (id > std::numeric_limits<uint32_t>::max()) {
+            shard.nextId = 0;
+            id = shardIndex;
+        }
+        shard.nextId++;
+
         RpcWireAddress address{
                 .options = RPC_WIRE_ADDRESS_OPTION_CREATED,
-                .address = mNextId,
+                .address = static_cast<uint32_t>(id),
         };
         if (forServer) {
             address.options |= RPC_WIRE_ADDRESS_OPTION_FOR_SERVER;
         }
 
-        // avoid ubsan abort
-        if (mNextId >= std::numeric_limits<uint32_t>::max()) {
-            mNextId = 0;
-        } else {
-            mNextId++;
-        }
-
-        auto&& [it, inserted] = mNodeForAddress.insert({RpcWireAddress::toRaw(address),
-                                                        BinderNode{
-                                                                .binder = binder,
-                                                                .sentRef = binder,
-                                                                .timesSent = 1,
-                                                        }});
+        auto&& [it, inserted] = shard.nodeForAddress.insert({RpcWireAddress::toRaw(address),
+                                                             BinderNode{
+                                                                     .binder = binder,
+                                                                     .sentRef = binder,
+                                                                     .timesSent = 1,
+                                                             }});
         if (inserted) {
+            shard.addressForLocalBinder[binder.get()] = it->first;
+            mNodeCount++;
             *outAddress = it->first;
             return OK;
         }
@@ -170,10 +209,11 @@ status_t RpcState::onBinderEntering(const sp<RpcSession>& session, uint64_t addr
         return BAD_VALUE;
     }
 
-    RpcMutexLockGuard _l(mNodeMutex);
+    NodeShard& shard = shardForAddress(address);
+    RpcMutexLockGuard _l(shard.mutex);
     if (mTerminated) return DEAD_OBJECT;
 
-    if (auto it = mNodeForAddress.find(address); it != mNodeForAddress.end()) {
+    if (auto it = shard.nodeForAddress.find(address); it != shard.nodeForAddress.end()) {
         *out = it->second.binder.promote();
 
         // implicitly have strong RPC refcount, since we received this binder
@@ -189,8 +229,9 @@ status_t RpcState::onBinderEntering(const sp<RpcSession>& session, uint64_t addr
         return BAD_VALUE;
     }
 
-    auto&& [it, inserted] = mNodeForAddress.insert({address, BinderNode{}});
+    auto&& [it, inserted] = shard.nodeForAddress.insert({address, BinderNode{}});
     LOG_ALWAYS_FATAL_IF(!inserted, "Failed to insert binder when creating proxy");
+    mNodeCount++;
 
     // Currently, all binders are assumed to be part of the same session (no
     // device global binders in the RPC world).
@@ -205,12 +246,13 @@ status_t RpcState::flushExcessBinderRefs(const sp<RpcSession>& session, uint64_t
     // extra reference counting packets now.
     if (binder->remoteBinder()) return OK;
 
-    RpcMutexUniqueLock _l(mNodeMutex);
+    NodeShard& shard = shardForAddress(address);
+    RpcMutexUniqueLock _l(shard.mutex);
     if (mTerminated) return DEAD_OBJECT;
 
-    auto it = mNodeForAddress.find(address);
+    auto it = shard.nodeForAddress.find(address);
 
-    LOG_ALWAYS_FATAL_IF(it == mNodeForAddress.end(), "Can't be deleted while we hold sp<>");
+    LOG_ALWAYS_FATAL_IF(it == shard.nodeForAddress.end(), "Can't be deleted while we hold sp<>");
     LOG_ALWAYS_FATAL_IF(it->second.binder != binder,
                         "Caller of flushExcessBinderRefs using inconsistent arguments");
 
@@ -233,19 +275,19 @@ status_t RpcState::flushExcessBinderRefs(const sp<RpcSession>& session, uint64_t
 }
 
 status_t RpcState::sendObituaries(const sp<RpcSession>& session) {
-    RpcMutexUniqueLock _l(mNodeMutex);
-
     // Gather strong pointers to all of the remote binders for this session so
     // we hold the strong references. remoteBinder() returns a raw pointer.
     // Send the obituaries and drop the strong pointers outside of the lock so
     // the destructors and the onBinderDied calls are not done while locked.
     std::vector<sp<IBinder>> remoteBinders;
-    for (const auto& [_, binderNode] : mNodeForAddress) {
-        if (auto binder = binderNode.binder.promote()) {
-            remoteBinders.push_back(std::move(binder));
+    for (auto& shard : mNodeShards) {
+        RpcMutexLockGuard _l(shard.mutex);
+        for (const auto& [_, binderNode] : shard.nodeForAddress) {
+            if (auto binder = binderNode.binder.promote()) {
+                remoteBinders.push_back(std::move(binder));
+            }
         }
     }
-    _l.unlock();
 
     for (const auto& binder : remoteBinders) {
         if (binder->remoteBinder() &&
@@ -257,23 +299,27 @@ status_t RpcState::sendObituaries(const sp<RpcSession>& session) {
 }
 
 size_t RpcState::countBinders() {
-    RpcMutexLockGuard _l(mNodeMutex);
-    return mNodeForAddress.size();
+    return mNodeCount;
 }
 
 void RpcState::dump() {
-    RpcMutexLockGuard _l(mNodeMutex);
+    lockAllShards();
     dumpLocked();
+    unlockAllShards();
 }
 
 void RpcState::clear() {
-    return clear(RpcMutexUniqueLock(mNodeMutex));
+    lockAllShards();
+    clearAndUnlock();
 }
 
-void RpcState::clear(RpcMutexUniqueLock nodeLock) {
+void RpcState::clearAndUnlock() {
     if (mTerminated) {
-        LOG_ALWAYS_FATAL_IF(!mNodeForAddress.empty(),
-                            "New state should be impossible after terminating!");
+        for (const auto& shard : mNodeShards) {
+            LOG_ALWAYS_FATAL_IF(!shard.nodeForAddress.empty(),
+                                "New state should be impossible after terminating!");
+        }
+        unlockAllShards();
         return;
     }
     mTerminated = true;
@@ -284,30 +330,40 @@ void RpcState::clear(RpcMutexUniqueLock nodeLock) {
     }
 
     // invariants
-    for (auto& [address, node] : mNodeForAddress) {
-        bool guaranteedHaveBinder = node.timesSent > 0;
-        if (guaranteedHaveBinder) {
-            LOG_ALWAYS_FATAL_IF(node.sentRef == nullptr,
-                                "Binder expected to be owned with address: %" PRIu64 " %s", address,
-                                node.toString().c_str());
+    for (const auto& shard : mNodeShards) {
+        for (auto& [address, node] : shard.nodeForAddress) {
+            bool guaranteedHaveBinder = node.timesSent > 0;
+            if (guaranteedHaveBinder) {
+                LOG_ALWAYS_FATAL_IF(node.sentRef == nullptr,
+                                    "Binder expected to be owned with address: %" PRIu64 " %s",
+                                    address, node.toString().c_str());
+            }
         }
     }
 
     // if the destructor of a binder object makes another RPC call, then calling
     // decStrong could deadlock. So, we must hold onto these binders until
-    // mNodeMutex is no longer taken.
-    auto temp = std::move(mNodeForAddress);
-    mNodeForAddress.clear(); // RpcState isn't reusable, but for future/explicit
+    // the shard locks are no longer taken.
+    std::array<std::map<uint64_t, BinderNode>, kNodeShards> temp;
+    for (size_t i = 0; i < kNodeShards; i++) {
+        temp[i] = std::move(mNodeShards[i].nodeForAddress);
+        // RpcState isn't reusable, but for future/explicit
+        mNodeShards[i].nodeForAddress.clear();
+        mNodeShards[i].addressForLocalBinder.clear();
+    }
+    mNodeCount = 0;
 
-    nodeLock.unlock();
-    temp.clear(); // explicit
+    unlockAllShards();
+    for (auto& nodes : temp) nodes.clear(); // explicit
 }
 
 void RpcState::dumpLocked() {
     ALOGE("DUMP OF RpcState %p", this);
-    ALOGE("DUMP OF RpcState (%zu nodes)", mNodeForAddress.size());
-    for (const auto& [address, node] : mNodeForAddress) {
-        ALOGE("- address: %" PRIu64 " %s", address, node.toString().c_str());
+    ALOGE("DUMP OF RpcState (%zu nodes)", mNodeCount.load());
+    for (const auto& shard : mNodeShards) {
+        for (const auto& [address, node] : shard.nodeForAddress) {
+            ALOGE("- address: %" PRIu64 " %s", address, node.toString().c_str());
+        }
     }
     ALOGE("END DUMP OF RpcState");
 }
@@ -524,7 +580,8 @@ status_t RpcState::getSessionId(const sp<RpcSession::RpcConnection>& connection,
 
 status_t RpcState::transact(const sp<RpcSession::RpcConnection>& connection,
                             const sp<IBinder>& binder, uint32_t code, const Parcel& data,
-                            const sp<RpcSession>& session, Parcel* reply, uint32_t flags) {
+                            const sp<RpcSession>& session, Parcel* reply, uint32_t flags,
+                            bool pipelined) {
     std::string errorMsg;
     if (status_t status = validateParcel(session, data, &errorMsg); status != OK) {
         ALOGE("Refusing to send RPC on binder %p code %" PRIu32 ": Parcel %p failed validation: %s",
@@ -534,22 +591,26 @@ status_t RpcState::transact(const sp<RpcSession::RpcConnection>& connection,
     uint64_t address;
     if (status_t status = onBinderLeaving(session, binder, &address); status != OK) return status;
 
-    return transactAddress(connection, address, code, data, session, reply, flags);
+    return transactAddress(connection, address, code, data, session, reply, flags, pipelined);
 }
 
 status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connection,
                                    uint64_t address, uint32_t code, const Parcel& data,
-                                   const sp<RpcSession>& session, Parcel* reply, uint32_t flags) {
+                                   const sp<RpcSession>& session, Parcel* reply, uint32_t flags,
+                                   bool pipelined) {
     LOG_ALWAYS_FATAL_IF(!data.isForRpc());
     LOG_ALWAYS_FATAL_IF(data.objectsCount() != 0);
+    LOG_ALWAYS_FATAL_IF(pipelined && (flags & IBinder::FLAG_ONEWAY),
+                        "Oneway transactions are never pipelined.");
 
     uint64_t asyncNumber = 0;
 
     if (address != 0) {
-        RpcMutexUniqueLock _l(mNodeMutex);
+        NodeShard& shard = shardForAddress(address);
+        RpcMutexUniqueLock _l(shard.mutex);
         if (mTerminated) return DEAD_OBJECT; // avoid fatal only, otherwise races
-        auto it = mNodeForAddress.find(address);
-        LOG_ALWAYS_FATAL_IF(it == mNodeForAddress.end(),
+        auto it = shard.nodeForAddress.find(address);
+        LOG_ALWAYS_FATAL_IF(it == shard.nodeForAddress.end(),
                             "Sending transact on unknown address %" PRIu64, address);
 
         if (flags & IBinder::FLAG_ONEWAY) {
@@ -568,9 +629,13 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
     Span<const uint32_t> objectTableSpan = Span<const uint32_t>{rpcFields->mObjectPositions.data(),
                                                                 rpcFields->mObjectPositions.size()};
 
+    OutgoingParcelData parcelData;
+    prepareParcelData(connection, session, data, &parcelData);
+
     uint32_t bodySize;
-    LOG_ALWAYS_FATAL_IF(__builtin_add_overflow(sizeof(RpcWireTransaction), data.dataSize(),
-                                               &bodySize) ||
+    LOG_ALWAYS_FATAL_IF(data.dataSize() > std::numeric_limits<uint32_t>::max() ||
+                                __builtin_add_overflow(sizeof(RpcWireTransaction),
+                                                       parcelData.inlineSize, &bodySize) ||
                                 __builtin_add_overflow(objectTableSpan.byteSize(), bodySize,
                                                        &bodySize),
                         "Too much data %zu", data.dataSize());
@@ -579,13 +644,29 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
             .bodySize = bodySize,
     };
 
+    // Other threads may be sending on a shared connection, so the whole transaction is written
+    // under the send lock. The reply may be read by any of the threads waiting on the connection,
+    // so it is registered before it can possibly arrive.
+    std::optional<RpcMutexLockGuard> sendLock;
+    uint32_t transactionId = 0;
+    if (pipelined) {
+        LOG_ALWAYS_FATAL_IF(reply == nullptr,
+                            "Reply parcel must be used for synchronous transaction.");
+        sendLock.emplace(connection->pipeline.sendMutex);
+        if (status_t status = addPipelinedWaiter(connection, reply, &transactionId); status != OK) {
+            return status;
+        }
+    }
+
     RpcWireTransaction transaction{
             .address = RpcWireAddress::fromRaw(address),
             .code = code,
             .flags = flags,
             .asyncNumber = asyncNumber,
-            // bodySize didn't overflow => this cast is safe
+            // checked above => this cast is safe
             .parcelDataSize = static_cast<uint32_t>(data.dataSize()),
+            .transactionId = transactionId,
+            .parcelDataFlags = parcelData.parcelDataFlags,
     };
 
     // Oneway calls have no sync point, so if many are sent before, whether this
@@ -595,12 +676,6 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
     constexpr size_t kWaitLogUs = 10000;
     size_t waitUs = 0;
 
-    iovec iovs[]{
-            {&command, sizeof(RpcWireHeader)},
-            {&transaction, sizeof(RpcWireTransaction)},
-            {const_cast<uint8_t*>(data.data()), data.dataSize()},
-            objectTableSpan.toIovec(),
-    };
     auto altPoll = [&] {
         if (waitUs > kWaitLogUs) {
             ALOGE("Cannot send command, trying to process pending refcounts. Waiting "
@@ -615,17 +690,29 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
             waitUs = 1;
         }
 
+        if (pipelined) return drainPipelinedCommands(connection, session);
         return drainCommands(connection, session, CommandType::CONTROL_ONLY);
     };
-    if (status_t status = rpcSend(connection, session, "transaction", iovs, countof(iovs),
-                                  std::ref(altPoll), rpcFields->mFds.get());
+    if (status_t status = rpcSendParcel(connection, session, "transaction",
+                                        {&command, sizeof(RpcWireHeader)},
+                                        {&transaction, sizeof(RpcWireTransaction)}, parcelData,
+                                        objectTableSpan.toIovec(), std::ref(altPoll));
         status != OK) {
         // rpcSend calls shutdownAndWait, so all refcounts should be reset. If we ever tolerate
         // errors here, then we may need to undo the binder-sent counts for the transaction as
         // well as for the binder objects in the Parcel
+        if (pipelined) {
+            RpcMutexLockGuard _l(connection->pipeline.mutex);
+            connection->pipeline.waiters.erase(transactionId);
+        }
         return status;
     }
 
+    if (pipelined) {
+        sendLock.reset();
+        return waitForPipelinedReply(connection, session, transactionId);
+    }
+
     if (flags & IBinder::FLAG_ONEWAY) {
         LOG_RPC_DETAIL("Oneway command, so no longer waiting on RpcTransport %p",
                        connection->rpcTransport.get());
@@ -647,6 +734,129 @@ static void cleanup_reply_data(const uint8_t* data, size_t dataSize, const binde
     (void)objectsCount;
 }
 
+static void unmap_shared_parcel_data(const uint8_t* data, size_t dataSize,
+                                     const binder_size_t* objects, size_t objectsCount) {
+    binder::os::unmapSealedMemory(data, dataSize);
+    LOG_ALWAYS_FATAL_IF(objects != nullptr);
+    (void)objectsCount;
+}
+
+void RpcState::prepareParcelData(const sp<RpcSession::RpcConnection>& connection,
+                                 const sp<RpcSession>& session, const Parcel& parcel,
+                                 OutgoingParcelData* out) {
+    auto* rpcFields = parcel.maybeRpcFields();
+    LOG_ALWAYS_FATAL_IF(rpcFields == nullptr);
+
+    // Not using data(), which copies the buffers written with writeExternal into the Parcel.
+    const size_t dataSize = parcel.dataSize();
+    out->iov = {parcel.mData, dataSize};
+    out->inlineSize = dataSize;
+    out->ancillaryFds = rpcFields->mFds.get();
+    if (rpcFields->mExternalSegments != nullptr) {
+        size_t pos = 0;
+        for (const auto& segment : *rpcFields->mExternalSegments) {
+            if (segment.position > pos) {
+                out->gatherIovs.push_back({parcel.mData + pos, segment.position - pos});
+            }
+            out->gatherIovs.push_back({const_cast<void*>(segment.data), segment.size});
+            pos = segment.position + segment.size;
+        }
+        if (dataSize > pos) out->gatherIovs.push_back({parcel.mData + pos, dataSize - pos});
+    }
+
+    const size_t threshold = connection->rpcTransport->sharedMemoryThreshold();
+    const bool unixFds = session->getFileDescriptorTransportMode() ==
+            RpcSession::FileDescriptorTransportMode::UNIX;
+    if (threshold == 0 || parcel.dataSize() < threshold || !unixFds ||
+        session->getProtocolVersion().value() <
+                RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_SHARED_MEMORY_PARCEL_DATA) {
+        return;
+    }
+    // The shared memory takes up one of the fds that can be sent with a message.
+    constexpr size_t kMaxParcelFds = 252;
+    if (rpcFields->mFds != nullptr && rpcFields->mFds->size() > kMaxParcelFds) return;
+
+    iovec* dataIovs = out->gatherIovs.empty() ? &out->iov : out->gatherIovs.data();
+    const int dataNiovs = out->gatherIovs.empty() ? 1 : static_cast<int>(out->gatherIovs.size());
+    if (status_t status = binder::os::createSealedMemory("binder rpc parcel", dataIovs, dataNiovs,
+                                                         &out->sharedMemory);
+        status != OK) {
+        ALOGW("Failed to put %zu bytes of Parcel data in shared memory, sending inline: %s",
+              parcel.dataSize(), statusToString(status).c_str());
+        return;
+    }
+
+    out->fds.emplace_back(binder::borrowed_fd(out->sharedMemory.get()));
+    if (rpcFields->mFds != nullptr) {
+        for (const auto& fd : *rpcFields->mFds) {
+            out->fds.emplace_back(
+                    binder::borrowed_fd(std::visit([](const auto& fd) { return fd.get(); }, fd)));
+        }
+    }
+    out->parcelDataFlags = RPC_PARCEL_DATA_FLAG_SHARED_MEMORY;
+    out->iov = {nullptr, 0};
+    out->gatherIovs.clear();
+    out->inlineSize = 0;
+    out->ancillaryFds = &out->fds;
+}
+
+status_t RpcState::rpcSendParcel(const sp<RpcSession::RpcConnection>& connection,
+                                 const sp<RpcSession>& session, const char* what, iovec header,
+                                 iovec body, const OutgoingParcelData& parcelData,
+                                 iovec objectTable,
+                                 const std::optional<SmallFunction<status_t()>>& altPoll) {
+    if (parcelData.gatherIovs.empty()) {
+        iovec iovs[]{header, body, parcelData.iov, objectTable};
+        return rpcSend(connection, session, what, iovs, countof(iovs), altPoll,
+                       parcelData.ancillaryFds);
+    }
+
+    std::vector<iovec> iovs;
+    iovs.reserve(parcelData.gatherIovs.size() + 3);
+    iovs.push_back(header);
+    iovs.push_back(body);
+    iovs.insert(iovs.end(), parcelData.gatherIovs.begin(), parcelData.gatherIovs.end());
+    iovs.push_back(objectTable);
+    return rpcSend(connection, session, what, iovs.data(), static_cast<int>(iovs.size()), altPoll,
+                   parcelData.ancillaryFds);
+}
+
+status_t RpcState::mapSharedParcelData(
+        const sp<RpcSession>& session, uint32_t parcelDataFlags, uint32_t parcelDataSize,
+        std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>>* ancillaryFds,
+        const uint8_t** outData) {
+    *outData = nullptr;
+    if (session->getProtocolVersion().value() <
+        RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_SHARED_MEMORY_PARCEL_DATA) {
+        return OK;
+    }
+    if ((parcelDataFlags & ~RPC_PARCEL_DATA_FLAG_SHARED_MEMORY) != 0) {
+        ALOGE("Unknown Parcel data flags 0x%" PRIx32 ". Terminating!", parcelDataFlags);
+        (void)session->shutdownAndWait(false);
+        return BAD_VALUE;
+    }
+    if ((parcelDataFlags & RPC_PARCEL_DATA_FLAG_SHARED_MEMORY) == 0) return OK;
+
+    if (ancillaryFds->empty() ||
+        !std::holds_alternative<binder::unique_fd>(ancillaryFds->front()) ||
+        parcelDataSize == 0) {
+        ALOGE("Parcel data is in shared memory, but no shared memory was received. Terminating!");
+        (void)session->shutdownAndWait(false);
+        return BAD_VALUE;
+    }
+    binder::unique_fd sharedMemory = std::move(std::get<binder::unique_fd>(ancillaryFds->front()));
+    ancillaryFds->erase(ancillaryFds->begin());
+
+    if (status_t status = binder::os::mapSealedMemory(sharedMemory, parcelDataSize, outData);
+        status != OK) {
+        ALOGE("Failed to map %" PRIu32 " bytes of Parcel data: %s. Terminating!", parcelDataSize,
+              statusToString(status).c_str());
+        (void)session->shutdownAndWait(false);
+        return status;
+    }
+    return OK;
+}
+
 status_t RpcState::waitForReply(const sp<RpcSession::RpcConnection>& connection,
                                 const sp<RpcSession>& session, Parcel* reply) {
     std::vector<std::variant<unique_fd, borrowed_fd>> ancillaryFds;
@@ -671,6 +881,19 @@ status_t RpcState::waitForReply(const sp<RpcSession::RpcConnection>& connection,
         ancillaryFds = decltype(ancillaryFds)();
     }
 
+    RpcWireReply rpcReply;
+    std::optional<CommandData> data;
+    if (status_t status = readReplyBody(connection, session, command, &rpcReply, &data);
+        status != OK)
+        return status;
+
+    return setReplyParcel(session, command, rpcReply, std::move(*data), std::move(ancillaryFds),
+                          reply);
+}
+
+status_t RpcState::readReplyBody(const sp<RpcSession::RpcConnection>& connection,
+                                 const sp<RpcSession>& session, const RpcWireHeader& command,
+                                 RpcWireReply* rpcReply, std::optional<CommandData>* data) {
     const size_t rpcReplyWireSize = RpcWireReply::wireSize(session->getProtocolVersion().value());
 
     if (command.bodySize < rpcReplyWireSize) {
@@ -680,28 +903,50 @@ status_t RpcState::waitForReply(const sp<RpcSession::RpcConnection>& connection,
         return BAD_VALUE;
     }
 
-    RpcWireReply rpcReply;
-    memset(&rpcReply, 0, sizeof(RpcWireReply)); // zero because of potential short read
+    memset(rpcReply, 0, sizeof(RpcWireReply)); // zero because of potential short read
 
-    CommandData data(command.bodySize - rpcReplyWireSize);
-    if (!data.valid()) return NO_MEMORY;
+    data->emplace(command.bodySize - rpcReplyWireSize);
+    if (!(*data)->valid()) return NO_MEMORY;
 
     iovec iovs[]{
-            {&rpcReply, rpcReplyWireSize},
-            {data.data(), data.size()},
+            {rpcReply, rpcReplyWireSize},
+            {(*data)->data(), (*data)->size()},
     };
-    if (status_t status = rpcRec(connection, session, "reply body", iovs, countof(iovs), nullptr);
-        status != OK)
-        return status;
+    return rpcRec(connection, session, "reply body", iovs, countof(iovs), nullptr);
+}
 
+status_t RpcState::setReplyParcel(
+        const sp<RpcSession>& session, const RpcWireHeader& command, const RpcWireReply& rpcReply,
+        CommandData data, std::vector<std::variant<unique_fd, borrowed_fd>>&& ancillaryFds,
+        Parcel* reply) {
     if (rpcReply.status != OK) return rpcReply.status;
 
+    const size_t rpcReplyWireSize = RpcWireReply::wireSize(session->getProtocolVersion().value());
+
+    const uint8_t* sharedParcelData;
+    if (status_t status = mapSharedParcelData(session, rpcReply.parcelDataFlags,
+                                              rpcReply.parcelDataSize, &ancillaryFds,
+                                              &sharedParcelData);
+        status != OK) {
+        return status;
+    }
+    auto unmapGuard = make_scope_guard([&] {
+        binder::os::unmapSealedMemory(sharedParcelData, rpcReply.parcelDataSize);
+    });
+    if (sharedParcelData == nullptr) unmapGuard.release();
+
     Span<const uint8_t> parcelSpan = {data.data(), data.size()};
     Span<const uint32_t> objectTableSpan;
     if (session->getProtocolVersion().value() >=
         RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_EXPLICIT_PARCEL_SIZE) {
-        std::optional<Span<const uint8_t>> objectTableBytes =
-                parcelSpan.splitOff(rpcReply.parcelDataSize);
+        std::optional<Span<const uint8_t>> objectTableBytes;
+        if (sharedParcelData != nullptr) {
+            // only the object table is in the body
+            objectTableBytes = parcelSpan;
+            parcelSpan = {sharedParcelData, rpcReply.parcelDataSize};
+        } else {
+            objectTableBytes = parcelSpan.splitOff(rpcReply.parcelDataSize);
+        }
         if (!objectTableBytes.has_value()) {
             ALOGE("Parcel size larger than available bytes: %" PRId32 " vs %zu. Terminating!",
                   rpcReply.parcelDataSize, parcelSpan.byteSize());
@@ -720,12 +965,163 @@ status_t RpcState::waitForReply(const sp<RpcSession::RpcConnection>& connection,
         objectTableSpan = *maybeSpan;
     }
 
+    unmapGuard.release();
+    if (sharedParcelData != nullptr) {
+        // 'data' only holds the object table, which the Parcel copies
+        return reply->rpcSetDataReference(session, parcelSpan.data, parcelSpan.size,
+                                          objectTableSpan.data, objectTableSpan.size,
+                                          std::move(ancillaryFds), unmap_shared_parcel_data);
+    }
     data.release();
     return reply->rpcSetDataReference(session, parcelSpan.data, parcelSpan.size,
                                       objectTableSpan.data, objectTableSpan.size,
                                       std::move(ancillaryFds), cleanup_reply_data);
 }
 
+status_t RpcState::addPipelinedWaiter(const sp<RpcSession::RpcConnection>& connection,
+                                      Parcel* reply, uint32_t* transactionIdOut) {
+    auto& pipeline = connection->pipeline;
+    RpcMutexLockGuard _l(pipeline.mutex);
+    if (pipeline.error != OK) return pipeline.error;
+
+    // Ids wrap around, but only a few transactions are in flight at once, so a free one is found
+    // right away. Zero is reserved for transactions which don't share their connection.
+    uint32_t transactionId;
+    do {
+        transactionId = pipeline.nextTransactionId;
+        if (__builtin_add_overflow(pipeline.nextTransactionId, 1, &pipeline.nextTransactionId)) {
+            pipeline.nextTransactionId = 1;
+        }
+    } while (transactionId == 0 || pipeline.waiters.count(transactionId) != 0);
+
+    pipeline.waiters[transactionId] = {.reply = reply};
+    *transactionIdOut = transactionId;
+    return OK;
+}
+
+status_t RpcState::waitForPipelinedReply(const sp<RpcSession::RpcConnection>& connection,
+                                         const sp<RpcSession>& session, uint32_t transactionId) {
+    auto& pipeline = connection->pipeline;
+    while (true) {
+        {
+            RpcMutexUniqueLock _l(pipeline.mutex);
+            while (true) {
+                auto it = pipeline.waiters.find(transactionId);
+                LOG_ALWAYS_FATAL_IF(it == pipeline.waiters.end(), "Unknown transaction %" PRIu32,
+                                    transactionId);
+                if (it->second.status.has_value()) {
+                    status_t status = *it->second.status;
+                    pipeline.waiters.erase(it);
+                    return status;
+                }
+                if (pipeline.error != OK) {
+                    pipeline.waiters.erase(it);
+                    return pipeline.error;
+                }
+                if (!pipeline.reading) break;
+                pipeline.cv.wait(_l);
+            }
+            pipeline.reading = true;
+        }
+
+        status_t status = readPipelinedCommand(connection, session);
+
+        {
+            RpcMutexLockGuard _l(pipeline.mutex);
+            pipeline.reading = false;
+            if (status != OK) pipeline.error = status;
+        }
+        // wake up the owner of the reply which was read, or another thread to keep reading
+        pipeline.cv.notify_all();
+    }
+}
+
+status_t RpcState::drainPipelinedCommands(const sp<RpcSession::RpcConnection>& connection,
+                                          const sp<RpcSession>& session) {
+    auto& pipeline = connection->pipeline;
+    {
+        RpcMutexLockGuard _l(pipeline.mutex);
+        // the thread which is reading already keeps the connection moving
+        if (pipeline.reading) return OK;
+        pipeline.reading = true;
+    }
+
+    status_t status;
+    while ((status = connection->rpcTransport->pollRead()) == OK) {
+        status = readPipelinedCommand(connection, session);
+        if (status != OK) break;
+    }
+    if (status == WOULD_BLOCK) status = OK;
+
+    {
+        RpcMutexLockGuard _l(pipeline.mutex);
+        pipeline.reading = false;
+        if (status != OK) pipeline.error = status;
+    }
+    pipeline.cv.notify_all();
+    return status;
+}
+
+status_t RpcState::readPipelinedCommand(const sp<RpcSession::RpcConnection>& connection,
+                                        const sp<RpcSession>& session) {
+    std::vector<std::variant<unique_fd, borrowed_fd>> ancillaryFds;
+    RpcWireHeader command;
+    iovec iov{&command, sizeof(command)};
+    if (status_t status = rpcRec(connection, session, "command header (for pipelined reply)",
+                                 &iov, 1,
+                                 enableAncillaryFds(session->getFileDescriptorTransportMode())
+                                         ? &ancillaryFds
+                                         : nullptr);
+        status != OK)
+        return status;
+
+    if (command.command != RPC_COMMAND_REPLY) {
+        // The other side doesn't make nested calls while executing a transaction with an id, so
+        // only refcounts are expected here.
+        status_t status = processCommand(connection, session, command, CommandType::CONTROL_ONLY,
+                                         std::move(ancillaryFds));
+        if (status == BAD_TYPE) {
+            ALOGE("Unexpected nested transaction on a shared connection. Terminating!");
+            (void)session->shutdownAndWait(false);
+            return DEAD_OBJECT;
+        }
+        return status;
+    }
+
+    RpcWireReply rpcReply;
+    std::optional<CommandData> data;
+    if (status_t status = readReplyBody(connection, session, command, &rpcReply, &data);
+        status != OK)
+        return status;
+
+    auto& pipeline = connection->pipeline;
+    Parcel* reply;
+    {
+        RpcMutexLockGuard _l(pipeline.mutex);
+        auto it = pipeline.waiters.find(rpcReply.transactionId);
+        if (it == pipeline.waiters.end() || it->second.status.has_value()) {
+            ALOGE("Reply for unknown transaction %" PRIu32 ". Terminating!",
+                  rpcReply.transactionId);
+            reply = nullptr;
+        } else {
+            reply = it->second.reply;
+        }
+    }
+    if (reply == nullptr) {
+        (void)session->shutdownAndWait(false);
+        return BAD_VALUE;
+    }
+
+    // The owner of the reply keeps waiting until its status is set, and only this thread can set
+    // it, so the parcel can be set up without holding the lock.
+    status_t replyStatus = setReplyParcel(session, command, rpcReply, std::move(*data),
+                                          std::move(ancillaryFds), reply);
+
+    RpcMutexLockGuard _l(pipeline.mutex);
+    pipeline.waiters[rpcReply.transactionId].status = replyStatus;
+    return OK;
+}
+
 status_t RpcState::sendDecStrongToTarget(const sp<RpcSession::RpcConnection>& connection,
                                          const sp<RpcSession>& session, uint64_t addr,
                                          size_t target) {
@@ -734,10 +1130,11 @@ status_t RpcState::sendDecStrongToTarget(const sp<RpcSession::RpcConnection>& co
     };
 
     {
-        RpcMutexUniqueLock _l(mNodeMutex);
+        NodeShard& shard = shardForAddress(addr);
+        RpcMutexUniqueLock _l(shard.mutex);
         if (mTerminated) return DEAD_OBJECT; // avoid fatal only, otherwise races
-        auto it = mNodeForAddress.find(addr);
-        LOG_ALWAYS_FATAL_IF(it == mNodeForAddress.end(),
+        auto it = shard.nodeForAddress.find(addr);
+        LOG_ALWAYS_FATAL_IF(it == shard.nodeForAddress.end(),
                             "Sending dec strong on unknown address %" PRIu64, addr);
 
         LOG_ALWAYS_FATAL_IF(it->second.timesRecd < target, "Can't dec count of %zu to %zu.",
@@ -750,7 +1147,7 @@ status_t RpcState::sendDecStrongToTarget(const sp<RpcSession::RpcConnection>& co
         body.amount = it->second.timesRecd - target;
         it->second.timesRecd = target;
 
-        LOG_ALWAYS_FATAL_IF(nullptr != tryEraseNode(session, std::move(_l), it),
+        LOG_ALWAYS_FATAL_IF(nullptr != tryEraseNode(session, shard, std::move(_l), it),
                             "Bad state. RpcState shouldn't own received binder");
         // LOCK ALREADY RELEASED
     }
@@ -880,6 +1277,12 @@ processTransactInternalTailCall:
 
     uint64_t addr = RpcWireAddress::toRaw(transaction->address);
     bool oneway = transaction->flags & IBinder::FLAG_ONEWAY;
+    uint32_t transactionId = 0;
+    if (!oneway &&
+        session->getProtocolVersion().value() >=
+                RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_TRANSACTION_ID) {
+        transactionId = transaction->transactionId;
+    }
 
     status_t replyStatus = OK;
     if (addr != 0) {
@@ -907,8 +1310,9 @@ processTransactInternalTailCall:
             (void)session->shutdownAndWait(false);
             replyStatus = BAD_VALUE;
         } else if (oneway) {
-            RpcMutexUniqueLock _l(mNodeMutex);
-            auto it = mNodeForAddress.find(addr);
+            NodeShard& shard = shardForAddress(addr);
+            RpcMutexUniqueLock _l(shard.mutex);
+            auto it = shard.nodeForAddress.find(addr);
             if (it->second.binder.promote() != target) {
                 ALOGE("Binder became invalid during transaction. Bad client? %" PRIu64, addr);
                 replyStatus = BAD_VALUE;
@@ -956,10 +1360,29 @@ processTransactInternalTailCall:
                                           transactionData.size() -
                                                   offsetof(RpcWireTransaction, data)};
         Span<const uint32_t> objectTableSpan;
+
+        const uint8_t* sharedParcelData;
+        if (status_t status = mapSharedParcelData(session, transaction->parcelDataFlags,
+                                                  transaction->parcelDataSize, &ancillaryFds,
+                                                  &sharedParcelData);
+            status != OK) {
+            return status;
+        }
+        auto unmapGuard = make_scope_guard([&] {
+            binder::os::unmapSealedMemory(sharedParcelData, transaction->parcelDataSize);
+        });
+        if (sharedParcelData == nullptr) unmapGuard.release();
+
         if (session->getProtocolVersion().value() >=
             RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_EXPLICIT_PARCEL_SIZE) {
-            std::optional<Span<const uint8_t>> objectTableBytes =
-                    parcelSpan.splitOff(transaction->parcelDataSize);
+            std::optional<Span<const uint8_t>> objectTableBytes;
+            if (sharedParcelData != nullptr) {
+                // only the object table is in the body
+                objectTableBytes = parcelSpan;
+                parcelSpan = {sharedParcelData, transaction->parcelDataSize};
+            } else {
+                objectTableBytes = parcelSpan.splitOff(transaction->parcelDataSize);
+            }
             if (!objectTableBytes.has_value()) {
                 ALOGE("Parcel size (%" PRId32 ") greater than available bytes (%zu). Terminating!",
                       transaction->parcelDataSize, parcelSpan.byteSize());
@@ -982,19 +1405,27 @@ processTransactInternalTailCall:
         Parcel data;
         // transaction->data is owned by this function. Parcel borrows this data and
         // only holds onto it for the duration of this function call. Parcel will be
-        // deleted before the 'transactionData' object.
+        // deleted before the 'transactionData' object. Shared memory is owned by the
+        // Parcel.
 
+        unmapGuard.release();
         replyStatus =
                 data.rpcSetDataReference(session, parcelSpan.data, parcelSpan.size,
                                          objectTableSpan.data, objectTableSpan.size,
-                                         std::move(ancillaryFds), do_nothing_to_transact_data);
+                                         std::move(ancillaryFds),
+                                         sharedParcelData != nullptr
+                                                 ? unmap_shared_parcel_data
+                                                 : do_nothing_to_transact_data);
         // Reset to avoid spurious use-after-move warning from clang-tidy.
         ancillaryFds = std::remove_reference<decltype(ancillaryFds)>::type();
 
         if (replyStatus == OK) {
             if (target) {
                 bool origAllowNested = connection->allowNested;
-                connection->allowNested = !oneway;
+                // A transaction with an id may share the connection with other transactions of
+                // the client, so whichever client thread reads a nested call could be the wrong
+                // one to execute it. Calls made while executing it use other connections.
+                connection->allowNested = !oneway && transactionId == 0;
 
                 replyStatus = target->transact(transaction->code, data, &reply, transaction->flags);
 
@@ -1056,10 +1487,11 @@ processTransactInternalTailCall:
         // downside: asynchronous transactions may drown out synchronous
         // transactions.
         {
-            RpcMutexUniqueLock _l(mNodeMutex);
-            auto it = mNodeForAddress.find(addr);
+            NodeShard& shard = shardForAddress(addr);
+            RpcMutexUniqueLock _l(shard.mutex);
+            auto it = shard.nodeForAddress.find(addr);
             // last refcount dropped after this transaction happened
-            if (it == mNodeForAddress.end()) return OK;
+            if (it == shard.nodeForAddress.end()) return OK;
 
             if (!nodeProgressAsyncNumber(&it->second)) {
                 _l.unlock();
@@ -1120,8 +1552,13 @@ processTransactInternalTailCall:
     Span<const uint32_t> objectTableSpan = Span<const uint32_t>{rpcFields->mObjectPositions.data(),
                                                                 rpcFields->mObjectPositions.size()};
 
+    OutgoingParcelData parcelData;
+    prepareParcelData(connection, session, reply, &parcelData);
+
     uint32_t bodySize;
-    LOG_ALWAYS_FATAL_IF(__builtin_add_overflow(rpcReplyWireSize, reply.dataSize(), &bodySize) ||
+    LOG_ALWAYS_FATAL_IF(reply.dataSize() > std::numeric_limits<uint32_t>::max() ||
+                                __builtin_add_overflow(rpcReplyWireSize, parcelData.inlineSize,
+                                                       &bodySize) ||
                                 __builtin_add_overflow(objectTableSpan.byteSize(), bodySize,
                                                        &bodySize),
                         "Too much data for reply %zu", reply.dataSize());
@@ -1133,18 +1570,15 @@ processTransactInternalTailCall:
             .status = replyStatus,
             // NOTE: Not necessarily written to socket depending on session
             // version.
-            // NOTE: bodySize didn't overflow => this cast is safe
+            // NOTE: checked above => this cast is safe
             .parcelDataSize = static_cast<uint32_t>(reply.dataSize()),
-            .reserved = {0, 0, 0},
-    };
-    iovec iovs[]{
-            {&cmdReply, sizeof(RpcWireHeader)},
-            {&rpcReply, rpcReplyWireSize},
-            {const_cast<uint8_t*>(reply.data()), reply.dataSize()},
-            objectTableSpan.toIovec(),
+            .transactionId = transactionId,
+            .parcelDataFlags = parcelData.parcelDataFlags,
+            .reserved = 0,
     };
-    return rpcSend(connection, session, "reply", iovs, countof(iovs), std::nullopt,
-                   rpcFields->mFds.get());
+    return rpcSendParcel(connection, session, "reply", {&cmdReply, sizeof(RpcWireHeader)},
+                         {&rpcReply, rpcReplyWireSize}, parcelData, objectTableSpan.toIovec(),
+                         std::nullopt);
 }
 
 status_t RpcState::processDecStrong(const sp<RpcSession::RpcConnection>& connection,
@@ -1165,9 +1599,10 @@ status_t RpcState::processDecStrong(const sp<RpcSession::RpcConnection>& connect
         return status;
 
     uint64_t addr = RpcWireAddress::toRaw(body.address);
-    RpcMutexUniqueLock _l(mNodeMutex);
-    auto it = mNodeForAddress.find(addr);
-    if (it == mNodeForAddress.end()) {
+    NodeShard& shard = shardForAddress(addr);
+    RpcMutexUniqueLock _l(shard.mutex);
+    auto it = shard.nodeForAddress.find(addr);
+    if (it == shard.nodeForAddress.end()) {
         ALOGE("Unknown binder address %" PRIu64 " for dec strong.", addr);
         return OK;
     }
@@ -1195,7 +1630,7 @@ status_t RpcState::processDecStrong(const sp<RpcSession::RpcConnection>& connect
                    it->second.timesSent);
 
     it->second.timesSent -= body.amount;
-    sp<IBinder> tempHold = tryEraseNode(session, std::move(_l), it);
+    sp<IBinder> tempHold = tryEraseNode(session, shard, std::move(_l), it);
     // LOCK ALREADY RELEASED
     tempHold = nullptr; // destructor may make binder calls on this session
 
@@ -1263,7 +1698,8 @@ status_t RpcState::validateParcel(const sp<RpcSession>& session, const Parcel& p
     return OK;
 }
 
-sp<IBinder> RpcState::tryEraseNode(const sp<RpcSession>& session, RpcMutexUniqueLock nodeLock,
+sp<IBinder> RpcState::tryEraseNode(const sp<RpcSession>& session, NodeShard& shard,
+                                   RpcMutexUniqueLock nodeLock,
                                    std::map<uint64_t, BinderNode>::iterator& it) {
     bool shouldShutdown = false;
 
@@ -1275,20 +1711,31 @@ sp<IBinder> RpcState::tryEraseNode(const sp<RpcSession>& session, RpcMutexUnique
         if (it->second.timesRecd == 0) {
             LOG_ALWAYS_FATAL_IF(!it->second.asyncTodo.empty(),
                                 "Can't delete binder w/ pending async transactions");
-            mNodeForAddress.erase(it);
+            if (auto found = shard.addressForLocalBinder.find(it->second.binder.unsafe_get());
+                found != shard.addressForLocalBinder.end() && found->second == it->first) {
+                shard.addressForLocalBinder.erase(found);
+            }
+            shard.nodeForAddress.erase(it);
 
-            if (mNodeForAddress.size() == 0) {
+            if (--mNodeCount == 0) {
                 shouldShutdown = true;
             }
         }
     }
+    nodeLock.unlock(); // explicit
 
     // If we shutdown, prevent RpcState from being re-used. This prevents another
-    // thread from getting the root object again.
+    // thread from getting the root object again. Other shards may have gained
+    // a binder while no lock was held, so this is checked again with all of
+    // them locked.
     if (shouldShutdown) {
-        clear(std::move(nodeLock));
-    } else {
-        nodeLock.unlock(); // explicit
+        lockAllShards();
+        if (mNodeCount == 0) {
+            clearAndUnlock();
+        } else {
+            unlockAllShards();
+            shouldShutdown = false;
+        }
     }
     // LOCK IS RELEASED
 
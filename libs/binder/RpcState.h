@@ -22,15 +22,19 @@
 #include <binder/RpcThreads.h>
 #include <binder/unique_fd.h>
 
+#include <array>
+#include <atomic>
 #include <map>
 #include <optional>
 #include <queue>
+#include <unordered_map>
 
 #include <sys/uio.h>
 
 namespace android {
 
 struct RpcWireHeader;
+struct RpcWireReply;
 
 /**
  * Log a lot more information about RPC calls, when debugging issues. Usually,
@@ -82,13 +86,16 @@ public:
                                         const sp<RpcSession>& session,
                                         std::vector<uint8_t>* sessionIdOut);
 
+    // If 'pipelined' is set, 'connection' may be shared with other threads making synchronous
+    // transactions at the same time (see RpcSession::setMaxPipelinedTransactions).
     [[nodiscard]] status_t transact(const sp<RpcSession::RpcConnection>& connection,
                                     const sp<IBinder>& address, uint32_t code, const Parcel& data,
-                                    const sp<RpcSession>& session, Parcel* reply, uint32_t flags);
+                                    const sp<RpcSession>& session, Parcel* reply, uint32_t flags,
+                                    bool pipelined = false);
     [[nodiscard]] status_t transactAddress(const sp<RpcSession::RpcConnection>& connection,
                                            uint64_t address, uint32_t code, const Parcel& data,
                                            const sp<RpcSession>& session, Parcel* reply,
-                                           uint32_t flags);
+                                           uint32_t flags, bool pipelined = false);
 
     /**
      * The ownership model here carries an implicit strong refcount whenever a
@@ -171,7 +178,8 @@ public:
     void clear();
 
 private:
-    void clear(RpcMutexUniqueLock nodeLock);
+    // Must be called with every shard locked, and unlocks them.
+    void clearAndUnlock();
     void dumpLocked();
 
     // Alternative to std::vector<uint8_t> that doesn't abort on allocation failure and caps
@@ -188,6 +196,35 @@ private:
         size_t mSize;
     };
 
+    // How the data of an outgoing Parcel is sent: either inline after the wire struct, or in
+    // sealed shared memory that is sent as the first ancillary fd.
+    struct OutgoingParcelData {
+        uint32_t parcelDataFlags = 0;
+        // The inline data, if it is in a single buffer. Otherwise, it is gathered from the
+        // Parcel and from the buffers written with Parcel::writeExternal, in |gatherIovs|.
+        iovec iov = {nullptr, 0};
+        std::vector<iovec> gatherIovs;
+        size_t inlineSize = 0;
+        binder::unique_fd sharedMemory;
+        std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>> fds;
+        const std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>>* ancillaryFds =
+                nullptr;
+    };
+    void prepareParcelData(const sp<RpcSession::RpcConnection>& connection,
+                           const sp<RpcSession>& session, const Parcel& parcel,
+                           OutgoingParcelData* out);
+    // Sends |header| and |body|, then the data of the Parcel and its object table.
+    [[nodiscard]] status_t rpcSendParcel(
+            const sp<RpcSession::RpcConnection>& connection, const sp<RpcSession>& session,
+            const char* what, iovec header, iovec body, const OutgoingParcelData& parcelData,
+            iovec objectTable, const std::optional<SmallFunction<status_t()>>& altPoll);
+    // Maps the data of an incoming Parcel if it was sent in shared memory, and removes the shared
+    // memory from |ancillaryFds|. |outData| is nullptr if the data is inline.
+    [[nodiscard]] status_t mapSharedParcelData(
+            const sp<RpcSession>& session, uint32_t parcelDataFlags, uint32_t parcelDataSize,
+            std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>>* ancillaryFds,
+            const uint8_t** outData);
+
     [[nodiscard]] status_t rpcSend(
             const sp<RpcSession::RpcConnection>& connection, const sp<RpcSession>& session,
             const char* what, iovec* iovs, int niovs,
@@ -202,6 +239,27 @@ private:
 
     [[nodiscard]] status_t waitForReply(const sp<RpcSession::RpcConnection>& connection,
                                         const sp<RpcSession>& session, Parcel* reply);
+    [[nodiscard]] status_t readReplyBody(const sp<RpcSession::RpcConnection>& connection,
+                                         const sp<RpcSession>& session,
+                                         const RpcWireHeader& command, RpcWireReply* rpcReply,
+                                         std::optional<CommandData>* data);
+    [[nodiscard]] status_t setReplyParcel(
+            const sp<RpcSession>& session, const RpcWireHeader& command,
+            const RpcWireReply& rpcReply, CommandData data,
+            std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>>&& ancillaryFds,
+            Parcel* reply);
+
+    // On a shared connection, one of the threads waiting for a reply at a time reads from the
+    // connection, and hands the replies it reads to the threads they belong to.
+    [[nodiscard]] status_t addPipelinedWaiter(const sp<RpcSession::RpcConnection>& connection,
+                                              Parcel* reply, uint32_t* transactionIdOut);
+    [[nodiscard]] status_t waitForPipelinedReply(const sp<RpcSession::RpcConnection>& connection,
+                                                 const sp<RpcSession>& session,
+                                                 uint32_t transactionId);
+    [[nodiscard]] status_t drainPipelinedCommands(const sp<RpcSession::RpcConnection>& connection,
+                                                  const sp<RpcSession>& session);
+    [[nodiscard]] status_t readPipelinedCommand(const sp<RpcSession::RpcConnection>& connection,
+                                                const sp<RpcSession>& session);
     [[nodiscard]] status_t processCommand(
             const sp<RpcSession::RpcConnection>& connection, const sp<RpcSession>& session,
             const RpcWireHeader& command, CommandType type,
@@ -284,18 +342,46 @@ private:
     // this introduces the posssibility that another thread calls
     // getRootBinder and thinks it is valid, rather than immediately getting
     // an error.
-    sp<IBinder> tryEraseNode(const sp<RpcSession>& session, RpcMutexUniqueLock nodeLock,
+    struct NodeShard;
+    sp<IBinder> tryEraseNode(const sp<RpcSession>& session, NodeShard& shard,
+                             RpcMutexUniqueLock nodeLock,
                              std::map<uint64_t, BinderNode>::iterator& it);
 
     // true - success
     // false - session shutdown, halt
     [[nodiscard]] bool nodeProgressAsyncNumber(BinderNode* node);
 
-    RpcMutex mNodeMutex;
+    // Binders known by both sides of a session are spread over shards by
+    // address, each with its own lock, so that threads working on different
+    // binders don't contend with each other.
+#ifdef BINDER_RPC_SINGLE_THREADED
+    static constexpr size_t kNodeShards = 1;
+#else
+    static constexpr size_t kNodeShards = 16;
+#endif
+    struct NodeShard {
+        RpcMutex mutex;
+        std::map<uint64_t, BinderNode> nodeForAddress;
+        // Addresses of the local binders in nodeForAddress. The address of a
+        // local binder is allocated in the shard of the binder object, so
+        // that it can be found when the binder is sent again.
+        std::unordered_map<const IBinder*, uint64_t> addressForLocalBinder;
+        // next address to allocate in this shard
+        uint32_t nextId = 0;
+    };
+    static size_t shardIndexForAddress(uint64_t address);
+    static size_t shardIndexForLocalBinder(const IBinder* binder);
+    NodeShard& shardForAddress(uint64_t address) {
+        return mNodeShards[shardIndexForAddress(address)];
+    }
+    // Locks every shard, always in the same order.
+    void lockAllShards();
+    void unlockAllShards();
+
+    std::array<NodeShard, kNodeShards> mNodeShards;
+    // Only written with every shard locked, so it can be read with any of them.
     bool mTerminated = false;
-    uint32_t mNextId = 0;
-    // binders known by both sides of a session
-    std::map<uint64_t, BinderNode> mNodeForAddress;
+    std::atomic<size_t> mNodeCount = 0;
 };
 
 } // namespace android
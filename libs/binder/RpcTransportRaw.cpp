@@ -37,7 +37,8 @@ using android::binder::unique_fd;
 // RpcTransport with TLS disabled.
 class RpcTransportRaw : public RpcTransport {
 public:
-    explicit RpcTransportRaw(android::RpcTransportFd socket) : mSocket(std::move(socket)) {}
+    RpcTransportRaw(android::RpcTransportFd socket, size_t sharedMemoryThreshold)
+          : mSocket(std::move(socket)), mSharedMemoryThreshold(sharedMemoryThreshold) {}
     status_t pollRead(void) override {
         uint8_t buf;
         ssize_t ret = TEMP_FAILURE_RETRY(
@@ -85,26 +86,34 @@ public:
 
     bool isWaiting() override { return mSocket.isInPollingState(); }
 
+    size_t sharedMemoryThreshold() const override { return mSharedMemoryThreshold; }
+
 private:
     android::RpcTransportFd mSocket;
+    const size_t mSharedMemoryThreshold;
 };
 
 // RpcTransportCtx with TLS disabled.
 class RpcTransportCtxRaw : public RpcTransportCtx {
 public:
+    explicit RpcTransportCtxRaw(size_t sharedMemoryThreshold)
+          : mSharedMemoryThreshold(sharedMemoryThreshold) {}
     std::unique_ptr<RpcTransport> newTransport(android::RpcTransportFd socket,
                                                FdTrigger*) const override {
-        return std::make_unique<RpcTransportRaw>(std::move(socket));
+        return std::make_unique<RpcTransportRaw>(std::move(socket), mSharedMemoryThreshold);
     }
     std::vector<uint8_t> getCertificate(RpcCertificateFormat) const override { return {}; }
+
+private:
+    const size_t mSharedMemoryThreshold;
 };
 
 std::unique_ptr<RpcTransportCtx> RpcTransportCtxFactoryRaw::newServerCtx() const {
-    return std::make_unique<RpcTransportCtxRaw>();
+    return std::make_unique<RpcTransportCtxRaw>(mSharedMemoryThreshold);
 }
 
 std::unique_ptr<RpcTransportCtx> RpcTransportCtxFactoryRaw::newClientCtx() const {
-    return std::make_unique<RpcTransportCtxRaw>();
+    return std::make_unique<RpcTransportCtxRaw>(mSharedMemoryThreshold);
 }
 
 const char *RpcTransportCtxFactoryRaw::toCString() const {
@@ -112,7 +121,13 @@ const char *RpcTransportCtxFactoryRaw::toCString() const {
 }
 
 std::unique_ptr<RpcTransportCtxFactory> RpcTransportCtxFactoryRaw::make() {
-    return std::unique_ptr<RpcTransportCtxFactoryRaw>(new RpcTransportCtxFactoryRaw());
+    return make(0 /*sharedMemoryThreshold*/);
+}
+
+std::unique_ptr<RpcTransportCtxFactory> RpcTransportCtxFactoryRaw::make(
+        size_t sharedMemoryThreshold) {
+    return std::unique_ptr<RpcTransportCtxFactoryRaw>(
+            new RpcTransportCtxFactoryRaw(sharedMemoryThreshold));
 }
 
 } // namespace android
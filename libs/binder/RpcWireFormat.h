@@ -107,6 +107,19 @@ enum : uint32_t {
     RPC_SPECIAL_TRANSACT_GET_SESSION_ID = 2,
 };
 
+/**
+ * Flags for the Parcel data of an RpcWireTransaction or RpcWireReply. Only set starting at
+ * RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_SHARED_MEMORY_PARCEL_DATA.
+ */
+enum : uint32_t {
+    /**
+     * The Parcel data doesn't follow the header, only the object table does. The data is in
+     * sealed shared memory, sent as the first of the file descriptors of the command, before
+     * those of the Parcel.
+     */
+    RPC_PARCEL_DATA_FLAG_SHARED_MEMORY = 1 << 0,
+};
+
 // serialization is like:
 // |RpcWireHeader|struct desginated by 'command'| (over and over again)
 //
@@ -139,7 +152,15 @@ struct RpcWireTransaction {
     // The size of the Parcel data directly following RpcWireTransaction.
     uint32_t parcelDataSize;
 
-    uint32_t reserved[3];
+    // Non-zero for a synchronous transaction which shares its connection with other in-flight
+    // transactions. The reply carries the same id. Only set starting at
+    // RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_TRANSACTION_ID.
+    uint32_t transactionId;
+
+    // RPC_PARCEL_DATA_FLAG_*
+    uint32_t parcelDataFlags;
+
+    uint32_t reserved;
 
     uint8_t data[];
 };
@@ -153,7 +174,13 @@ struct RpcWireReply {
     // The size of the Parcel data directly following RpcWireReply.
     uint32_t parcelDataSize;
 
-    uint32_t reserved[3];
+    // RpcWireTransaction::transactionId of the transaction this replies to.
+    uint32_t transactionId;
+
+    // RPC_PARCEL_DATA_FLAG_*
+    uint32_t parcelDataFlags;
+
+    uint32_t reserved;
 
     // Byte size of RpcWireReply in the wire protocol.
     static size_t wireSize(uint32_t protocolVersion) {
@@ -0,0 +1,368 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "TransactionStats"
+
+#include <binder/TransactionStats.h>
+
+#include <binder/IBinder.h>
+#include <binder/Parcel.h>
+#include <utils/String8.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "Utils.h"
+#include "file.h"
+
+namespace android::binder::debug {
+
+std::atomic<bool> TransactionStats::sEnabled = false;
+
+#ifndef BINDER_RPC_SINGLE_THREADED
+
+namespace {
+
+// Bucket i counts latencies below 2^i us, down to 2^(i-1) us. The last one also counts all
+// longer latencies.
+constexpr size_t kNumLatencyBuckets = 24;
+// Bucket i counts transactions below kMinSizeBucket << i bytes, the last one also all larger ones.
+constexpr size_t kNumSizeBuckets = 16;
+constexpr uint64_t kMinSizeBucket = 64;
+// Different interfaces and codes counted by each thread. Later ones are dropped.
+constexpr size_t kEntriesPerThread = 256;
+
+size_t bucketFor(uint64_t value, size_t numBuckets) {
+    const size_t bits = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    return std::min(bits, numBuckets - 1);
+}
+
+// Counters are only written by the thread that owns them, so they don't need atomic
+// read-modify-write operations, only atomic loads and stores for the threads that dump them.
+void add(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+struct Entry {
+    Entry(TransactionStats::Direction direction, uint32_t code, std::u16string_view descriptor,
+          size_t hash)
+          : direction(direction), code(code), descriptor(descriptor), hash(hash) {}
+
+    const TransactionStats::Direction direction;
+    const uint32_t code;
+    const std::u16string descriptor;
+    const size_t hash;
+
+    std::atomic<uint64_t> count = 0;
+    std::atomic<uint64_t> totalLatencyNs = 0;
+    std::atomic<uint64_t> maxLatencyNs = 0;
+    std::atomic<uint64_t> totalBytes = 0;
+    std::atomic<uint64_t> latencyBuckets[kNumLatencyBuckets] = {};
+    std::atomic<uint64_t> sizeBuckets[kNumSizeBuckets] = {};
+};
+
+// The counts of one thread. Tables are never freed, a table of an exited thread is reused by the
+// next new thread, so that its counts aren't lost.
+struct ThreadTable {
+    std::atomic<bool> inUse = false;
+    // The reset generation the counts belong to. The owner clears them when it is behind.
+    std::atomic<uint64_t> generation = 0;
+    std::atomic<uint64_t> dropped = 0;
+    // An open addressing hash table. Entries are published with a release store once their keys
+    // are set, and stay in place when the counts are reset.
+    std::atomic<Entry*> entries[kEntriesPerThread] = {};
+
+    void clear(uint64_t newGeneration) {
+        dropped.store(0, std::memory_order_relaxed);
+        for (auto& slot : entries) {
+            Entry* entry = slot.load(std::memory_order_relaxed);
+            if (entry == nullptr) continue;
+            entry->count.store(0, std::memory_order_relaxed);
+            entry->totalLatencyNs.store(0, std::memory_order_relaxed);
+            entry->maxLatencyNs.store(0, std::memory_order_relaxed);
+            entry->totalBytes.store(0, std::memory_order_relaxed);
+            for (auto& bucket : entry->latencyBuckets) bucket.store(0, std::memory_order_relaxed);
+            for (auto& bucket : entry->sizeBuckets) bucket.store(0, std::memory_order_relaxed);
+        }
+        generation.store(newGeneration, std::memory_order_release);
+    }
+
+    Entry* findOrAdd(TransactionStats::Direction direction, uint32_t code,
+                     std::u16string_view descriptor, size_t hash) {
+        for (size_t i = 0; i < kEntriesPerThread; i++) {
+            auto& slot = entries[(hash + i) % kEntriesPerThread];
+            Entry* entry = slot.load(std::memory_order_relaxed);
+            if (entry == nullptr) {
+                entry = new (std::nothrow) Entry(direction, code, descriptor, hash);
+                if (entry != nullptr) slot.store(entry, std::memory_order_release);
+                return entry;
+            }
+            if (entry->hash == hash && entry->code == code && entry->direction == direction &&
+                entry->descriptor == descriptor) {
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadTable*> tables; // guarded by mutex
+    std::atomic<uint64_t> generation = 0;
+};
+
+Registry& registry() {
+    static Registry* registry = new Registry();
+    return *registry;
+}
+
+ThreadTable* threadTable() {
+    // A pthread key rather than thread_local, because transactions are still sent from the
+    // destructors of other keys, such as the one of IPCThreadState, when the thread exits.
+    static pthread_key_t key = [] {
+        pthread_key_t key;
+        int error = pthread_key_create(&key, [](void* table) {
+            static_cast<ThreadTable*>(table)->inUse.store(false, std::memory_order_release);
+        });
+        LOG_ALWAYS_FATAL_IF(error != 0, "pthread_key_create failed: %s", strerror(error));
+        return key;
+    }();
+    if (auto* table = static_cast<ThreadTable*>(pthread_getspecific(key)); table != nullptr) {
+        return table;
+    }
+
+    Registry& r = registry();
+    std::lock_guard lock(r.mutex);
+    ThreadTable* table = nullptr;
+    for (ThreadTable* candidate : r.tables) {
+        bool expected = false;
+        if (candidate->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            table = candidate;
+            break;
+        }
+    }
+    if (table == nullptr) {
+        table = new (std::nothrow) ThreadTable();
+        if (table == nullptr) return nullptr;
+        table->inUse.store(true, std::memory_order_relaxed);
+        r.tables.push_back(table);
+    }
+    pthread_setspecific(key, table);
+    return table;
+}
+
+// The interface token written by Parcel::writeInterfaceToken, if |data| starts with one.
+std::u16string_view interfaceToken(const Parcel& data, uint32_t code) {
+    if (code < IBinder::FIRST_CALL_TRANSACTION || code > IBinder::LAST_CALL_TRANSACTION) {
+        return {};
+    }
+    // Parcels for kernel binder start with the strict mode policy, work source and header.
+    const size_t start = data.isForRpc() ? 0 : 3 * sizeof(int32_t);
+    const size_t pos = data.dataPosition();
+    data.setDataPosition(start);
+    size_t len = 0;
+    const char16_t* token = data.readString16Inplace(&len);
+    data.setDataPosition(pos);
+    return token == nullptr ? std::u16string_view() : std::u16string_view(token, len);
+}
+
+// The bucket which contains the |percentile| of |buckets|.
+template <size_t N>
+size_t percentileBucket(const uint64_t (&buckets)[N], uint64_t count, uint64_t percentile) {
+    const uint64_t target = (count * percentile + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < N; i++) {
+        seen += buckets[i];
+        if (seen >= target) return i;
+    }
+    return N - 1;
+}
+
+std::string formatLatencyBucket(size_t bucket) {
+    if (bucket == kNumLatencyBuckets - 1) return ">" + std::to_string(1ull << (bucket - 1)) + "us";
+    return "<" + std::to_string(1ull << bucket) + "us";
+}
+
+std::string formatSizeBucket(size_t bucket) {
+    if (bucket == kNumSizeBuckets - 1) {
+        return ">" + std::to_string(kMinSizeBucket << (bucket - 1)) + "B";
+    }
+    return "<" + std::to_string(kMinSizeBucket << bucket) + "B";
+}
+
+} // namespace
+
+status_t TransactionStats::setEnabled(bool enabled) {
+    sEnabled.store(enabled, std::memory_order_relaxed);
+    ALOGI("%s binder transaction stats.", enabled ? "Started" : "Stopped");
+    return OK;
+}
+
+void TransactionStats::reset() {
+    // Tables are cleared by their owners, the next time they count a transaction. Until then,
+    // they are skipped by dump().
+    registry().generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void TransactionStats::record(Direction direction, uint32_t code, int64_t latencyNs,
+                              const Parcel& data, const Parcel* reply) {
+    ThreadTable* table = threadTable();
+    if (table == nullptr) return;
+    const uint64_t generation = registry().generation.load(std::memory_order_acquire);
+    if (table->generation.load(std::memory_order_relaxed) != generation) table->clear(generation);
+
+    const std::u16string_view descriptor = interfaceToken(data, code);
+    const size_t hash = std::hash<std::u16string_view>()(descriptor) ^
+            (static_cast<size_t>(code) * 31 + static_cast<size_t>(direction));
+    Entry* entry = table->findOrAdd(direction, code, descriptor, hash);
+    if (entry == nullptr) {
+        add(table->dropped, 1);
+        return;
+    }
+
+    const uint64_t latency = latencyNs < 0 ? 0 : static_cast<uint64_t>(latencyNs);
+    const uint64_t bytes = data.dataSize() + (reply != nullptr ? reply->dataSize() : 0);
+    add(entry->count, 1);
+    add(entry->totalLatencyNs, latency);
+    if (latency > entry->maxLatencyNs.load(std::memory_order_relaxed)) {
+        entry->maxLatencyNs.store(latency, std::memory_order_relaxed);
+    }
+    add(entry->totalBytes, bytes);
+    add(entry->latencyBuckets[bucketFor(latency / 1000, kNumLatencyBuckets)], 1);
+    add(entry->sizeBuckets[bucketFor(bytes / kMinSizeBucket, kNumSizeBuckets)], 1);
+}
+
+std::string TransactionStats::dump() {
+    struct Totals {
+        uint64_t count = 0;
+        uint64_t totalLatencyNs = 0;
+        uint64_t maxLatencyNs = 0;
+        uint64_t totalBytes = 0;
+        uint64_t latencyBuckets[kNumLatencyBuckets] = {};
+        uint64_t sizeBuckets[kNumSizeBuckets] = {};
+    };
+    using Key = std::tuple<Direction, std::u16string, uint32_t>;
+    std::map<Key, Totals> totals;
+    uint64_t dropped = 0;
+    size_t numTables = 0;
+    {
+        Registry& r = registry();
+        std::lock_guard lock(r.mutex);
+        const uint64_t generation = r.generation.load(std::memory_order_acquire);
+        numTables = r.tables.size();
+        for (const ThreadTable* table : r.tables) {
+            if (table->generation.load(std::memory_order_acquire) != generation) continue;
+            dropped += table->dropped.load(std::memory_order_relaxed);
+            for (const auto& slot : table->entries) {
+                const Entry* entry = slot.load(std::memory_order_acquire);
+                if (entry == nullptr) continue;
+                const uint64_t count = entry->count.load(std::memory_order_relaxed);
+                if (count == 0) continue;
+                Totals& t = totals[Key(entry->direction, entry->descriptor, entry->code)];
+                t.count += count;
+                t.totalLatencyNs += entry->totalLatencyNs.load(std::memory_order_relaxed);
+                t.maxLatencyNs = std::max(t.maxLatencyNs,
+                                          entry->maxLatencyNs.load(std::memory_order_relaxed));
+                t.totalBytes += entry->totalBytes.load(std::memory_order_relaxed);
+                for (size_t i = 0; i < kNumLatencyBuckets; i++) {
+                    t.latencyBuckets[i] +=
+                            entry->latencyBuckets[i].load(std::memory_order_relaxed);
+                }
+                for (size_t i = 0; i < kNumSizeBuckets; i++) {
+                    t.sizeBuckets[i] += entry->sizeBuckets[i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+    std::vector<std::pair<const Key*, const Totals*>> sorted;
+    sorted.reserve(totals.size());
+    for (const auto& [key, t] : totals) sorted.emplace_back(&key, &t);
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        return a.second->totalLatencyNs > b.second->totalLatencyNs;
+    });
+
+    char line[256];
+    snprintf(line, sizeof(line),
+             "Binder transaction stats (%s, %zu threads, %" PRIu64 " transactions dropped):\n",
+             isEnabled() ? "enabled" : "disabled", numTables, dropped);
+    std::string out = line;
+    for (const auto& [key, t] : sorted) {
+        const auto& [direction, descriptor, code] = *key;
+        out += direction == Direction::INCOMING ? "  incoming " : "  outgoing ";
+        out += descriptor.empty() ? "<no interface>"
+                                  : String8(descriptor.data(), descriptor.size()).c_str();
+        snprintf(line, sizeof(line),
+                 " code %" PRIu32 ": count=%" PRIu64 " total=%" PRIu64 "us mean=%" PRIu64
+                 "us max=%" PRIu64 "us",
+                 code, t->count, t->totalLatencyNs / 1000, t->totalLatencyNs / 1000 / t->count,
+                 t->maxLatencyNs / 1000);
+        out += line;
+        out += " p50" + formatLatencyBucket(percentileBucket(t->latencyBuckets, t->count, 50));
+        out += " p90" + formatLatencyBucket(percentileBucket(t->latencyBuckets, t->count, 90));
+        out += " p99" + formatLatencyBucket(percentileBucket(t->latencyBuckets, t->count, 99));
+        snprintf(line, sizeof(line), " meanSize=%" PRIu64 "B", t->totalBytes / t->count);
+        out += line;
+        out += " sizeP50" + formatSizeBucket(percentileBucket(t->sizeBuckets, t->count, 50));
+        out += " sizeP99" + formatSizeBucket(percentileBucket(t->sizeBuckets, t->count, 99));
+        out += "\n";
+    }
+    return out;
+}
+
+status_t TransactionStats::dumpToFd(borrowed_fd fd) {
+    const std::string stats = dump();
+    if (!WriteFully(fd, stats.data(), stats.size())) {
+        PLOGE("Failed to write binder transaction stats");
+        return -errno;
+    }
+    return OK;
+}
+
+#else // BINDER_RPC_SINGLE_THREADED
+
+// There's no thread local storage for the counts.
+
+status_t TransactionStats::setEnabled(bool enabled) {
+    return enabled ? INVALID_OPERATION : OK;
+}
+
+void TransactionStats::reset() {}
+
+void TransactionStats::record(Direction, uint32_t, int64_t, const Parcel&, const Parcel*) {}
+
+std::string TransactionStats::dump() {
+    return "Binder transaction stats are not supported in this build.\n";
+}
+
+status_t TransactionStats::dumpToFd(borrowed_fd) {
+    return INVALID_OPERATION;
+}
+
+#endif // BINDER_RPC_SINGLE_THREADED
+
+} // namespace android::binder::debug
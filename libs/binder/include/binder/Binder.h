@@ -127,6 +127,7 @@ private:
     void removeRpcServerLink(const sp<RpcServerLink>& link);
     [[nodiscard]] status_t startRecordingTransactions(const Parcel& data);
     [[nodiscard]] status_t stopRecordingTransactions();
+    [[nodiscard]] status_t transactionStatsCommand(const Parcel& data);
 
     std::atomic<Extras*> mExtras;
 
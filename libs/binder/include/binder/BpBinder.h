@@ -18,6 +18,7 @@
 
 #include <binder/IBinder.h>
 #include <binder/RpcThreads.h>
+#include <binder/TransactionStats.h>
 #include <binder/unique_fd.h>
 
 #include <map>
@@ -33,6 +34,9 @@ class RpcState;
 namespace internal {
 class Stability;
 }
+namespace binder::debug {
+enum class RecordingFormat : int32_t;
+}
 class ProcessState;
 
 using binder_proxy_limit_callback = void(*)(int);
@@ -95,9 +99,17 @@ public:
     // Start recording transactions to the unique_fd.
     // See RecordedTransaction.h for more details.
     status_t startRecordingBinder(const binder::unique_fd& fd);
+    // Like the above, in the given format.
+    status_t startRecordingBinder(const binder::unique_fd& fd,
+                                  binder::debug::RecordingFormat format);
     // Stop the current recording.
     status_t stopRecordingBinder();
 
+    // Runs a command on the transaction stats of the process that hosts this binder. |fd| is
+    // only used by TransactionStats::Command::DUMP, which writes the stats to it.
+    status_t transactionStatsCommand(binder::debug::TransactionStats::Command command,
+                                     const binder::unique_fd& fd = binder::unique_fd());
+
     class ObjectManager {
     public:
         ObjectManager();
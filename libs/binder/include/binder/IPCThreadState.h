@@ -21,6 +21,9 @@
 #include <binder/ProcessState.h>
 #include <utils/Vector.h>
 
+#include <memory>
+#include <vector>
+
 #if defined(_WIN32)
 typedef  int  uid_t;
 #endif
@@ -167,6 +170,20 @@ public:
                                          uint32_t code, const Parcel& data,
                                          Parcel* reply, uint32_t flags);
 
+            // Oneway transactions that this thread makes between beginOnewayBatch() and the
+            // matching endOnewayBatch() are queued, and written to the driver together when the
+            // outermost batch ends, instead of with one ioctl each. They are delivered in the
+            // order they were made, and before any synchronous transaction that this thread makes
+            // later, which sends the queued ones first. Incoming transactions that this thread
+            // serves in the meantime are not batched.
+            //
+            // transact() returns OK for a queued transaction. endOnewayBatch() returns the first
+            // error of the transactions of the batch.
+            //
+            // See also ScopedOnewayBatch.
+            void                beginOnewayBatch();
+            status_t            endOnewayBatch();
+
             void                incStrongHandle(int32_t handle, BpBinder *proxy);
             void                decStrongHandle(int32_t handle);
             void                incWeakHandle(int32_t handle, BpBinder *proxy);
@@ -222,6 +239,9 @@ private:
                                                      uint32_t code,
                                                      const Parcel& data,
                                                      status_t* statusBuffer);
+            status_t            queueOnewayTransaction(int32_t handle, uint32_t code,
+                                                       const Parcel& data, uint32_t flags);
+            status_t            flushOnewayBatch();
             status_t            getAndExecuteCommand();
             status_t            executeCommand(int32_t command);
             void                processPendingDerefs();
@@ -258,6 +278,31 @@ private:
             int32_t             mStrictModePolicy;
             int32_t             mLastTransactionBinderFlags;
             CallRestriction     mCallRestriction;
+            // Number of open oneway batches.
+            size_t              mOnewayBatchDepth;
+            // Number of queued oneway transactions whose response hasn't been read yet.
+            size_t              mOnewayBatchCount;
+            // First error of the current batch that was already reported by the driver.
+            status_t            mOnewayBatchError;
+            // The driver reads the data of a queued transaction only when it's written, so it's
+            // kept here until then.
+            std::vector<std::unique_ptr<Parcel>> mOnewayBatchData;
+};
+
+/**
+ * Batches the oneway transactions of the current thread while it's in scope. See
+ * IPCThreadState::beginOnewayBatch().
+ */
+class ScopedOnewayBatch {
+public:
+    ScopedOnewayBatch() : mState(IPCThreadState::self()) { mState->beginOnewayBatch(); }
+    ~ScopedOnewayBatch() { (void)mState->endOnewayBatch(); }
+
+    ScopedOnewayBatch(const ScopedOnewayBatch&) = delete;
+    ScopedOnewayBatch& operator=(const ScopedOnewayBatch&) = delete;
+
+private:
+    IPCThreadState* const mState;
 };
 
 } // namespace android
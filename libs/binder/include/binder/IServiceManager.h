@@ -147,6 +147,15 @@ public:
         int pid;
     };
     virtual std::vector<ServiceDebugInfo> getServiceDebugInfo() = 0;
+
+    /**
+     * Retrieve several existing services in a single call, non-blocking.
+     *
+     * Returns an entry for each of the names, in the same order, which is nullptr if the
+     * service is not registered. This is how a process should look up many services at once,
+     * for instance at boot.
+     */
+    virtual std::vector<sp<IBinder>> getServices(const std::vector<String16>& names);
 };
 
 sp<IServiceManager> defaultServiceManager();
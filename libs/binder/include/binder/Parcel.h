@@ -19,6 +19,7 @@
 #include <array>
 #include <limits>
 #include <map> // for legacy reasons
+#include <memory>
 #include <optional>
 #include <string>
 #include <type_traits>
@@ -57,6 +58,7 @@ namespace binder {
 class Status;
 namespace debug {
 class RecordedTransaction;
+class RecordedTransactionWriter;
 }
 }
 
@@ -168,6 +170,12 @@ public:
     void                setError(status_t err);
     
     status_t            write(const void* data, size_t len);
+    // Writes the same bytes as write(), but a Parcel for RPC binder doesn't copy large buffers:
+    // it keeps a reference to |data|, and the bytes are sent from there. |keepAlive| is held
+    // until then, and the bytes must not change until the Parcel is sent or freed. They are only
+    // copied into the Parcel if it is read or overwritten before that.
+    status_t            writeExternal(const void* data, size_t len,
+                                      std::shared_ptr<const void> keepAlive);
     void*               writeInplace(size_t len);
     status_t            writeUnpadded(const void* data, size_t len);
     status_t            writeInt32(int32_t val);
@@ -1324,6 +1332,18 @@ private:
         //
         // Boxed to save space. Lazy allocated.
         std::unique_ptr<std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>>> mFds;
+
+        // Buffers written with writeExternal, which haven't been copied into the space that is
+        // left for them in the parcel data yet. Sorted by position.
+        //
+        // Boxed to save space. Lazy allocated.
+        struct ExternalSegment {
+            size_t position;
+            const void* data;
+            size_t size;
+            std::shared_ptr<const void> keepAlive;
+        };
+        mutable std::unique_ptr<std::vector<ExternalSegment>> mExternalSegments;
     };
     std::variant<KernelFields, RpcFields> mVariantFields;
 
@@ -1336,6 +1356,18 @@ private:
     RpcFields* maybeRpcFields() { return std::get_if<RpcFields>(&mVariantFields); }
     const RpcFields* maybeRpcFields() const { return std::get_if<RpcFields>(&mVariantFields); }
 
+    // Copies the buffers written with writeExternal into the parcel data, if they haven't been
+    // sent, so that it can be read. Only needed for reads of a Parcel that is being written.
+    void flattenExternalSegments() const {
+        if (const auto* rpcFields = maybeRpcFields();
+            rpcFields != nullptr && rpcFields->mExternalSegments != nullptr) {
+            flattenExternalSegmentsSlow();
+        }
+    }
+    void flattenExternalSegmentsSlow() const;
+    // Same, if [pos, pos + len) overlaps any of the buffers, before it is overwritten.
+    void flattenExternalSegmentsInRange(size_t pos, size_t len) const;
+
     bool                mAllowFds;
 
     // if this parcelable is involved in a secure transaction, force the
@@ -1449,6 +1481,7 @@ private:
 
     // Needed so that we can save object metadata to the disk
     friend class android::binder::debug::RecordedTransaction;
+    friend class android::binder::debug::RecordedTransactionWriter;
 };
 
 // ---------------------------------------------------------------------------
@@ -22,7 +22,10 @@
 
 #include <pthread.h>
 
+#include <array>
+#include <atomic>
 #include <mutex>
+#include <string>
 
 // ---------------------------------------------------------------------------
 namespace android {
@@ -74,6 +77,18 @@ public:
     // are all called, then up to 5 threads can be started.
     void startThreadPool();
 
+    // Like setThreadPoolMaxThreadCount, but the threadpool is sized from the
+    // load it sees instead of being fixed. It starts with 'minThreads' kernel
+    // threads. Whenever incoming transactions had to queue because every
+    // thread was busy, the limit is raised by one, up to 'maxThreads'. Kernel
+    // started threads that are not needed to cover the recent peak of busy
+    // threads leave the threadpool once they finish a command, down to
+    // 'minThreads'.
+    //
+    // This should be called instead of setThreadPoolMaxThreadCount, before
+    // startThreadPool.
+    status_t setThreadPoolAdaptive(size_t minThreads, size_t maxThreads);
+
     [[nodiscard]] bool becomeContextManager();
 
     sp<IBinder> getStrongProxyForHandle(int32_t handle);
@@ -126,6 +141,37 @@ public:
      */
     bool isThreadPoolStarted() const;
 
+    /**
+     * Counters for the threadpool of this process, since it was created or
+     * since the last call to resetThreadPoolStats.
+     */
+    struct ThreadPoolStats {
+        // Incoming transactions, indexed by the number of other threads that
+        // were busy when each of them started. The last bucket also counts
+        // larger numbers.
+        std::array<uint64_t, 16> busyThreadHistogram = {};
+        uint64_t transactionCount = 0;
+        size_t peakBusyThreads = 0;
+        // Number of times every thread of the threadpool was busy, and how long
+        // that lasted. Incoming transactions wait in the driver meanwhile, so
+        // the longest of these bounds the queueing delay they saw.
+        uint64_t starvationCount = 0;
+        int64_t totalStarvationMs = 0;
+        int64_t maxStarvationMs = 0;
+        // Incoming transactions per second of threadpool thread lifetime.
+        double transactionsPerThreadSecond = 0;
+        // The current state of the threadpool. 'maxThreads' is the number of
+        // threads the kernel may start, which changes in adaptive mode.
+        size_t currentThreads = 0;
+        size_t maxThreads = 0;
+        size_t retiredThreads = 0;
+        int64_t durationMs = 0;
+
+        std::string toString() const;
+    };
+    ThreadPoolStats getThreadPoolStats() const;
+    void resetThreadPoolStats();
+
     enum class DriverFeature {
         ONEWAY_SPAM_DETECTION,
         EXTENDED_ERROR,
@@ -150,6 +196,17 @@ private:
     ProcessState& operator=(const ProcessState& o);
     String8 makeBinderThreadName();
 
+    // These are called by IPCThreadState with mThreadCountLock held.
+    void accountThreadTimeLocked();
+    void recordTransactionLocked();
+    void recordStarvationLocked(int64_t starvationTimeMs);
+    void rollAdaptiveWindowLocked(int64_t nowMs);
+    status_t updateDriverMaxThreadsLocked();
+    // Called by a kernel started thread after each command. Returns true,
+    // having already removed the thread from mCurrentThreads, if the thread
+    // should leave the threadpool.
+    bool retirePooledThreadIfIdle();
+
     struct handle_entry {
         IBinder* binder;
         RefBase::weakref_type* refs;
@@ -178,6 +235,28 @@ private:
     // Time when thread pool was emptied
     int64_t mStarvationStartTimeMs;
 
+    // Counters reported by getThreadPoolStats.
+    ThreadPoolStats mThreadPoolStats;
+    int64_t mThreadPoolStatsStartMs;
+    // Sum over threadpool threads of the time they spent in the threadpool, and
+    // when it was last brought up to date.
+    int64_t mThreadTimeMs;
+    int64_t mThreadTimeUpdatedMs;
+
+    // Adaptive mode, see setThreadPoolAdaptive. Disabled while
+    // mAdaptiveMaxThreads is 0. mAdaptive mirrors that, so that threads can
+    // skip mThreadCountLock after each command when it's off.
+    std::atomic_bool mAdaptive;
+    size_t mAdaptiveMinThreads;
+    size_t mAdaptiveMaxThreads;
+    // The driver never forgets a thread it asked for, so its limit is kept at
+    // mMaxThreads plus the kernel started threads that have left.
+    size_t mRetiredThreads;
+    // Peak busy threads in the current and in the previous window.
+    int64_t mAdaptiveWindowStartMs;
+    size_t mAdaptivePeakBusy;
+    size_t mAdaptivePrevPeakBusy;
+
     mutable std::mutex mLock; // protects everything below.
 
     Vector<handle_entry> mHandleToObject;
@@ -18,16 +18,31 @@
 
 #include <binder/Parcel.h>
 #include <binder/unique_fd.h>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
 
 namespace android {
 
 namespace binder::debug {
 
 // Warning: Transactions are sequentially recorded to the file descriptor in a
-// non-stable format. A detailed description of the recording format can be found in
+// non-stable format. A detailed description of the recording formats can be found in
 // RecordedTransaction.cpp.
 
+enum class RecordingFormat : int32_t {
+    // One chunked record per transaction, read back with RecordedTransaction::fromFile.
+    CHUNKED = 0,
+    // Compressed blocks of transactions, written with RecordedTransactionWriter and read
+    // back with RecordedTransactionReader.
+    COMPACT = 1,
+};
+
+class RecordedTransactionReader;
+
 class RecordedTransaction {
 public:
     // Filled with the first transaction from fd.
@@ -53,6 +68,8 @@ public:
     const std::vector<uint64_t>& getObjectOffsets() const;
 
 private:
+    friend class RecordedTransactionReader;
+
     RecordedTransaction() = default;
 
     android::status_t writeChunk(const binder::borrowed_fd, uint32_t chunkType, size_t byteCount,
@@ -83,6 +100,106 @@ private:
     Parcel mReplyDataOnly;
 };
 
+// Records transactions in the COMPACT format. Transactions are buffered into
+// blocks, which are compressed and written to the file descriptor once they
+// are full, so that recording costs one write per block rather than several
+// per transaction. Not thread-safe.
+class RecordedTransactionWriter {
+public:
+    // Writes the file header to fd. Returns nullptr on failure.
+    static std::unique_ptr<RecordedTransactionWriter> create(binder::unique_fd fd);
+    // Flushes the current block.
+    ~RecordedTransactionWriter();
+
+    [[nodiscard]] status_t append(const String16& interfaceName, uint32_t code, uint32_t flags,
+                                  timespec timestamp, const Parcel& data, const Parcel& reply,
+                                  status_t err);
+    [[nodiscard]] status_t append(const RecordedTransaction& transaction);
+
+    // Writes out the transactions appended since the last block was written.
+    [[nodiscard]] status_t flush();
+
+private:
+    explicit RecordedTransactionWriter(binder::unique_fd fd);
+
+    status_t appendRecord(size_t interfaceIndex, uint32_t code, uint32_t flags, int32_t status,
+                          uint32_t version, timespec timestamp, const uint8_t* data,
+                          size_t dataSize, const std::vector<uint64_t>& objectOffsets,
+                          const uint8_t* reply, size_t replySize);
+    size_t interfaceIndex(const String16& interfaceName);
+    size_t interfaceIndex(const std::string& interfaceName);
+
+    binder::unique_fd mFd;
+    // Interface names used by the current block, kept in both encodings so that
+    // the hot path can look them up without conversion.
+    std::vector<String16> mInterfaceNames16;
+    std::vector<std::string> mInterfaceNames;
+    std::vector<uint8_t> mRecords;
+    uint32_t mTransactionCount = 0;
+    int64_t mMinTimestampNs = 0;
+    int64_t mMaxTimestampNs = 0;
+    int64_t mPreviousTimestampNs = 0;
+    // Reused between transactions and blocks to avoid allocations.
+    std::vector<uint64_t> mObjectOffsets;
+    std::vector<uint8_t> mBlock;
+};
+
+// Reads a COMPACT recording through a memory mapping of the whole file.
+//
+// Opening a recording only reads the block headers and their interface tables,
+// which index the recording by position, by time and by interface. Blocks that
+// cannot match a query are skipped without being decompressed. Not thread-safe.
+class RecordedTransactionReader {
+public:
+    // Returns nullptr if fd does not hold a COMPACT recording. A block that was
+    // cut short, for instance because the recording process died, ends the
+    // recording.
+    static std::unique_ptr<RecordedTransactionReader> open(const binder::unique_fd& fd);
+    ~RecordedTransactionReader();
+
+    RecordedTransactionReader(const RecordedTransactionReader&) = delete;
+    RecordedTransactionReader& operator=(const RecordedTransactionReader&) = delete;
+
+    // Number of transactions in the recording.
+    size_t size() const;
+
+    // Decodes the transaction at index. Prefer forEach to walk through the
+    // recording, since this decodes the whole block holding the transaction.
+    std::optional<RecordedTransaction> get(size_t index) const;
+
+    struct Filter {
+        // Only transactions on this interface.
+        std::optional<std::string> interfaceName;
+        // Only transactions recorded in [start, end].
+        std::optional<timespec> start;
+        std::optional<timespec> end;
+    };
+
+    // Index of the first transaction recorded at or after time, or size() if
+    // there is none.
+    size_t seek(timespec time) const;
+
+    // Calls visitor, in recording order, with each transaction in [begin, end)
+    // that matches filter, until it returns false. Returns BAD_VALUE if a block
+    // is corrupt.
+    using Visitor = std::function<bool(size_t index, const RecordedTransaction& transaction)>;
+    [[nodiscard]] status_t forEach(size_t begin, size_t end, const Filter& filter,
+                                   const Visitor& visitor) const;
+
+private:
+    struct Block;
+
+    RecordedTransactionReader(void* mapped, size_t mappedSize, std::vector<Block> blocks);
+
+    status_t decodeBlock(const Block& block, size_t begin, size_t end, const Filter& filter,
+                         const Visitor& visitor, bool* stopped) const;
+
+    void* mMapped;
+    size_t mMappedSize;
+    std::vector<Block> mBlocks;
+    mutable std::vector<uint8_t> mScratch;
+};
+
 } // namespace binder::debug
 
 } // namespace android
@@ -46,6 +46,25 @@ constexpr uint32_t RPC_WIRE_PROTOCOL_VERSION = 1;
 // * RpcWireTransaction and RpcWireReplyV1 include the parcel data size.
 constexpr uint32_t RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_EXPLICIT_PARCEL_SIZE = 1;
 
+// Starting with this version:
+//
+// * RpcWireTransaction and RpcWireReply carry a transaction id, so that several synchronous
+//   transactions can share a connection (see RpcSession::setMaxPipelinedTransactions).
+//
+// Until RPC_WIRE_PROTOCOL_VERSION reaches it, this is only negotiated by sessions using
+// RPC_WIRE_PROTOCOL_VERSION_EXPERIMENTAL.
+constexpr uint32_t RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_TRANSACTION_ID = 2;
+
+// Starting with this version:
+//
+// * The Parcel data of RpcWireTransaction and RpcWireReply may be sent in shared memory, when
+//   file descriptors are sent with FileDescriptorTransportMode::UNIX (see
+//   RpcTransportCtxFactoryRaw::make).
+//
+// Like RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_TRANSACTION_ID, this is only negotiated by
+// sessions using RPC_WIRE_PROTOCOL_VERSION_EXPERIMENTAL for now.
+constexpr uint32_t RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_SHARED_MEMORY_PARCEL_DATA = 2;
+
 /**
  * This represents a session (group of connections) between a client
  * and a server. Multiple connections are needed for multiple parallel "binder"
@@ -93,6 +112,24 @@ public:
     void setMaxOutgoingConnections(size_t connections);
     size_t getMaxOutgoingThreads();
 
+    /**
+     * Set the maximum number of synchronous transactions which may be in flight on one outgoing
+     * connection at the same time. By default, this is 1: a synchronous transaction holds its
+     * connection until the reply arrives, so callers wait once every outgoing connection is
+     * busy.
+     *
+     * Larger values only take effect if the negotiated protocol version is at least
+     * RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_TRANSACTION_ID. Synchronous transactions are
+     * then sent with an id, and once every outgoing connection is busy, further callers share
+     * the connection with the fewest callers instead of waiting. Replies are matched to callers
+     * by id. Transactions sharing a connection are still executed in order by the thread serving
+     * it on the other side. While executing them, the other side can't make nested calls on the
+     * calling thread, so calls back into this process go to its incoming threads instead (see
+     * setMaxIncomingThreads).
+     */
+    void setMaxPipelinedTransactions(size_t transactions);
+    size_t getMaxPipelinedTransactions();
+
     /**
      * By default, the minimum of the supported versions of the client and the
      * server will be used. Usually, this API should only be used for debugging.
@@ -258,6 +295,33 @@ private:
         std::optional<uint64_t> exclusiveTid;
 
         bool allowNested = false;
+
+        // Number of threads sharing this connection for synchronous transactions, see
+        // setMaxPipelinedTransactions. While this is non-zero, exclusiveTid is not set, and the
+        // connection is not handed out for exclusive use.
+        size_t pipelinedUsers = 0;
+
+        // Used by RpcState while the connection is shared.
+        struct Pipeline {
+            // held while writing a transaction, so that transactions aren't interleaved
+            RpcMutex sendMutex;
+
+            RpcMutex mutex; // for all below
+            RpcConditionVariable cv;
+            uint32_t nextTransactionId = 1;
+            // whether one of the waiting threads is reading from the connection
+            bool reading = false;
+            // set once reading from the connection has failed
+            status_t error = OK;
+
+            struct Waiter {
+                Parcel* reply = nullptr;
+                // set once the reply has been read
+                std::optional<status_t> status;
+            };
+            // transactions which have been sent and not yet returned, by id
+            std::map<uint32_t, Waiter> waiters;
+        } pipeline;
     };
 
     [[nodiscard]] status_t readId();
@@ -302,6 +366,7 @@ private:
             std::unique_ptr<RpcTransport> rpcTransport);
     [[nodiscard]] bool removeIncomingConnection(const sp<RpcConnection>& connection);
     void clearConnectionTid(const sp<RpcConnection>& connection);
+    void clearPipelinedUser(const sp<RpcConnection>& connection);
 
     [[nodiscard]] status_t initShutdownTrigger();
 
@@ -314,6 +379,8 @@ private:
         CLIENT,
         CLIENT_ASYNC,
         CLIENT_REFCOUNT,
+        // synchronous transaction which may share a connection, see setMaxPipelinedTransactions
+        CLIENT_PIPELINED,
     };
 
     // Object representing exclusive access to a connection.
@@ -324,12 +391,17 @@ private:
 
         ~ExclusiveConnection();
         const sp<RpcConnection>& get() { return mConnection; }
+        // whether the connection may be shared with other threads making synchronous
+        // transactions, despite the name of this class
+        bool isPipelined() const { return mPipelined; }
 
     private:
         static void findConnection(uint64_t tid, sp<RpcConnection>* exclusive,
                                    sp<RpcConnection>* available,
                                    std::vector<sp<RpcConnection>>& sockets,
                                    size_t socketsIndexHint);
+        static sp<RpcConnection> findPipelinedConnection(
+                const std::vector<sp<RpcConnection>>& sockets, size_t maxUsers);
 
         sp<RpcSession> mSession; // avoid deallocation
         sp<RpcConnection> mConnection;
@@ -338,6 +410,8 @@ private:
         // thread guarantees we won't write in the middle of a message, the way
         // the wire protocol is constructed guarantees this is safe).
         bool mReentrant = false;
+
+        bool mPipelined = false;
     };
 
     const std::unique_ptr<RpcTransportCtx> mCtx;
@@ -375,6 +449,7 @@ private:
     bool mStartedSetup = false;
     size_t mMaxIncomingThreads = 0;
     size_t mMaxOutgoingConnections = kDefaultMaxOutgoingConnections;
+    size_t mMaxPipelinedTransactions = 1;
     std::optional<uint32_t> mProtocolVersion;
     FileDescriptorTransportMode mFileDescriptorTransportMode = FileDescriptorTransportMode::NONE;
 
@@ -103,6 +103,12 @@ public:
      */
     [[nodiscard]] virtual bool isWaiting() = 0;
 
+    /**
+     * Parcels with at least this many bytes of data may be sent in shared memory rather than
+     * through the transport. Zero if they never are.
+     */
+    virtual size_t sharedMemoryThreshold() const { return 0; }
+
 private:
     // limit the classes which can implement RpcTransport. Being able to change this
     // interface is important to allow development of RPC binder. In the past, we
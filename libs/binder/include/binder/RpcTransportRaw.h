@@ -30,12 +30,22 @@ class RpcTransportCtxFactoryRaw : public RpcTransportCtxFactory {
 public:
     static std::unique_ptr<RpcTransportCtxFactory> make();
 
+    // Like make(), but Parcels with at least |sharedMemoryThreshold| bytes of data are sent in
+    // shared memory, which the receiver maps instead of reading the data from the socket. This
+    // only happens for sessions which send file descriptors with
+    // RpcSession::FileDescriptorTransportMode::UNIX and which negotiated at least
+    // RPC_WIRE_PROTOCOL_VERSION_RPC_HEADER_FEATURE_SHARED_MEMORY_PARCEL_DATA. Zero disables it.
+    static std::unique_ptr<RpcTransportCtxFactory> make(size_t sharedMemoryThreshold);
+
     std::unique_ptr<RpcTransportCtx> newServerCtx() const override;
     std::unique_ptr<RpcTransportCtx> newClientCtx() const override;
     const char* toCString() const override;
 
 private:
-    RpcTransportCtxFactoryRaw() = default;
+    explicit RpcTransportCtxFactoryRaw(size_t sharedMemoryThreshold)
+          : mSharedMemoryThreshold(sharedMemoryThreshold) {}
+
+    const size_t mSharedMemoryThreshold;
 };
 
 } // namespace android
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <binder/unique_fd.h>
+#include <utils/Errors.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace android {
+
+class Parcel;
+
+namespace binder::debug {
+
+// Latency and size histograms of the transactions of this process, per interface and
+// transaction code, for finding slow methods without tracing.
+//
+// Off by default. While on, each transaction is counted in buckets owned by the thread that
+// sent or handled it, so no locks are taken and threads don't write to the same cache lines.
+// The interface of a transaction is taken from the interface token at the start of its data,
+// so transactions which don't start with one are counted without an interface.
+//
+// Controlled in another process with BpBinder::transactionStatsCommand, for instance with
+// `dumpsys --binder-stats`.
+class TransactionStats {
+public:
+    enum class Command : int32_t {
+        START = 0,
+        STOP = 1,
+        // Clears the stats collected so far.
+        RESET = 2,
+        // Writes the stats as text to a file descriptor.
+        DUMP = 3,
+    };
+
+    enum class Direction : uint8_t {
+        // Handled by a BBinder in this process.
+        INCOMING = 0,
+        // Sent through a BpBinder from this process.
+        OUTGOING = 1,
+    };
+
+    static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+    // Fails with INVALID_OPERATION if this build of libbinder can't collect stats.
+    [[nodiscard]] static status_t setEnabled(bool enabled);
+    static void reset();
+
+    // Counts a transaction which took |latencyNs|. The size is that of |data| and |reply|.
+    static void record(Direction direction, uint32_t code, int64_t latencyNs, const Parcel& data,
+                       const Parcel* reply);
+
+    // One line per interface and code, the slowest in total first.
+    static std::string dump();
+    [[nodiscard]] static status_t dumpToFd(borrowed_fd fd);
+
+private:
+    static std::atomic<bool> sEnabled;
+};
+
+} // namespace binder::debug
+
+} // namespace android
@@ -26,6 +26,7 @@
 #include <utils/CallStack.h>
 
 #include <malloc.h>
+#include <unistd.h>
 #include <functional>
 #include <vector>
 
@@ -212,16 +213,29 @@ TEST(BinderAllocation, InterfaceDescriptorTransaction) {
 TEST(BinderAllocation, SmallTransaction) {
     String16 empty_descriptor = String16("");
     sp<IServiceManager> manager = defaultServiceManager();
+    manager->checkService(empty_descriptor); // first call may alloc
 
-    size_t mallocs = 0;
-    const auto on_malloc = OnMalloc([&](size_t bytes) {
-        mallocs++;
-        // Parcel should allocate a small amount by default
-        EXPECT_EQ(bytes, 128);
-    });
+    // the buffer of the first Parcel is reused
+    const auto m = ScopeDisallowMalloc();
+    manager->checkService(empty_descriptor);
     manager->checkService(empty_descriptor);
+}
 
-    EXPECT_EQ(mallocs, 1);
+TEST(BinderAllocation, ParcelReusesBuffers) {
+    const String16 str(u"a string which is long enough to make the Parcel grow");
+    auto writeParcel = [&str] {
+        Parcel p;
+        p.writeInt32(1);
+        p.writeFileDescriptor(STDIN_FILENO);
+        p.writeString16(str);
+        imaginary_use = p.data();
+    };
+    writeParcel(); // first call may alloc
+
+    const auto m = ScopeDisallowMalloc();
+    for (size_t i = 0; i < 10; i++) {
+        writeParcel();
+    }
 }
 
 TEST(RpcBinderAllocation, SetupRpcServer) {
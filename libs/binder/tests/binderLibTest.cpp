@@ -27,6 +27,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <android-base/file.h>
 #include <android-base/properties.h>
 #include <android-base/result-gmock.h>
 #include <android-base/strings.h>
@@ -59,6 +60,7 @@ using android::base::testing::HasValue;
 using android::base::testing::Ok;
 using android::binder::unique_fd;
 using testing::ExplainMatchResult;
+using testing::HasSubstr;
 using testing::Matcher;
 using testing::Not;
 using testing::WithParamInterface;
@@ -85,6 +87,9 @@ static constexpr int kSchedPolicy = SCHED_RR;
 static constexpr int kSchedPriority = 7;
 static constexpr int kSchedPriorityMore = 8;
 static constexpr int kKernelThreads = 17; // anything different than the default
+// Kernel thread limits of the servers from addAdaptiveServer
+static constexpr int kAdaptiveMinThreads = 1;
+static constexpr int kAdaptiveMaxThreads = 6;
 
 static String16 binderLibTestServiceName = String16("test.binderLib");
 
@@ -125,10 +130,19 @@ enum BinderLibTestTranscationCode {
     BINDER_LIB_TEST_LOCK_UNLOCK,
     BINDER_LIB_TEST_PROCESS_LOCK,
     BINDER_LIB_TEST_UNLOCK_AFTER_MS,
-    BINDER_LIB_TEST_PROCESS_TEMPORARY_LOCK
+    BINDER_LIB_TEST_PROCESS_TEMPORARY_LOCK,
+    BINDER_LIB_TEST_GET_THREAD_POOL_STATS,
+    BINDER_LIB_TEST_ADD_ADAPTIVE_SERVER,
 };
 
-pid_t start_server_process(int arg2, bool usePoll = false)
+// How a server process started by start_server_process serves transactions.
+enum class ServerMode {
+    THREAD_POOL,
+    POLL,
+    ADAPTIVE_THREAD_POOL,
+};
+
+pid_t start_server_process(int arg2, ServerMode mode = ServerMode::THREAD_POOL)
 {
     int ret;
     pid_t pid;
@@ -136,13 +150,13 @@ pid_t start_server_process(int arg2, bool usePoll = false)
     int pipefd[2];
     char stri[16];
     char strpipefd1[16];
-    char usepoll[2];
+    char strmode[2];
     char *childargv[] = {
         binderservername,
         binderserverarg,
         stri,
         strpipefd1,
-        usepoll,
+        strmode,
         binderserversuffix,
         nullptr
     };
@@ -153,7 +167,7 @@ pid_t start_server_process(int arg2, bool usePoll = false)
 
     snprintf(stri, sizeof(stri), "%d", arg2);
     snprintf(strpipefd1, sizeof(strpipefd1), "%d", pipefd[1]);
-    snprintf(usepoll, sizeof(usepoll), "%d", usePoll ? 1 : 0);
+    snprintf(strmode, sizeof(strmode), "%d", static_cast<int>(mode));
 
     pid = fork();
     if (pid == -1)
@@ -282,6 +296,11 @@ class BinderLibTest : public ::testing::Test {
             return addServerEtc(idPtr, BINDER_LIB_TEST_ADD_POLL_SERVER);
         }
 
+        sp<IBinder> addAdaptiveServer(int32_t *idPtr = nullptr)
+        {
+            return addServerEtc(idPtr, BINDER_LIB_TEST_ADD_ADAPTIVE_SERVER);
+        }
+
         void waitForReadData(int fd, int timeout_ms) {
             int ret;
             pollfd pfd = pollfd();
@@ -1010,6 +1029,94 @@ TEST_F(BinderLibTest, OnewayQueueing)
     EXPECT_THAT(callBack2->getResult(), StatusEq(NO_ERROR));
 }
 
+TEST_F(BinderLibTest, OnewayBatch)
+{
+    sp<IBinder> pollServer = addPollServer();
+    sp<BinderLibTestCallBack> callBack = new BinderLibTestCallBack();
+    sp<BinderLibTestCallBack> callBack2 = new BinderLibTestCallBack();
+
+    IPCThreadState::self()->beginOnewayBatch();
+    {
+        // The Parcels are gone by the time the batch is sent.
+        Parcel data, data2;
+        data.writeStrongBinder(callBack);
+        data.writeInt32(500000); // delay in us before calling back
+        data2.writeStrongBinder(callBack2);
+        data2.writeInt32(0); // delay in us
+
+        EXPECT_THAT(pollServer->transact(BINDER_LIB_TEST_DELAYED_CALL_BACK, data, nullptr,
+                                         TF_ONE_WAY),
+                    StatusEq(NO_ERROR));
+        EXPECT_THAT(pollServer->transact(BINDER_LIB_TEST_DELAYED_CALL_BACK, data2, nullptr,
+                                         TF_ONE_WAY),
+                    StatusEq(NO_ERROR));
+    }
+    EXPECT_THAT(IPCThreadState::self()->endOnewayBatch(), StatusEq(NO_ERROR));
+
+    // As in OnewayQueueing, the server checks that the transactions arrive in order.
+    EXPECT_THAT(callBack->waitEvent(2), StatusEq(NO_ERROR));
+    EXPECT_THAT(callBack->getResult(), StatusEq(NO_ERROR));
+
+    EXPECT_THAT(callBack2->waitEvent(2), StatusEq(NO_ERROR));
+    EXPECT_THAT(callBack2->getResult(), StatusEq(NO_ERROR));
+}
+
+TEST_F(BinderLibTest, OnewayBatchWithDeadBinder)
+{
+    sp<IBinder> pollServer = addPollServer();
+    sp<IBinder> target = addServer();
+    ASSERT_TRUE(target != nullptr);
+    sp<IBinder> watcher = addServer();
+    ASSERT_TRUE(watcher != nullptr);
+
+    // Another process waits for the target to die, so that this process still sends
+    // transactions to it, and the driver fails them.
+    sp<BinderLibTestCallBack> deathCallBack = new BinderLibTestCallBack();
+    {
+        Parcel data, reply;
+        data.writeStrongBinder(target);
+        data.writeStrongBinder(deathCallBack);
+        EXPECT_THAT(watcher->transact(BINDER_LIB_TEST_LINK_DEATH_TRANSACTION, data, &reply,
+                                      TF_ONE_WAY),
+                    StatusEq(NO_ERROR));
+    }
+    {
+        Parcel data, reply;
+        EXPECT_THAT(target->transact(BINDER_LIB_TEST_EXIT_TRANSACTION, data, &reply, TF_ONE_WAY),
+                    StatusEq(NO_ERROR));
+    }
+    EXPECT_THAT(deathCallBack->waitEvent(5), StatusEq(NO_ERROR));
+    EXPECT_THAT(deathCallBack->getResult(), StatusEq(NO_ERROR));
+
+    sp<BinderLibTestCallBack> callBack = new BinderLibTestCallBack();
+    sp<BinderLibTestCallBack> callBack2 = new BinderLibTestCallBack();
+    IPCThreadState::self()->beginOnewayBatch();
+    {
+        Parcel data, data2, deadData;
+        data.writeStrongBinder(callBack);
+        data.writeInt32(0); // delay in us
+        data2.writeStrongBinder(callBack2);
+        data2.writeInt32(0); // delay in us
+
+        EXPECT_THAT(pollServer->transact(BINDER_LIB_TEST_DELAYED_CALL_BACK, data, nullptr,
+                                         TF_ONE_WAY),
+                    StatusEq(NO_ERROR));
+        EXPECT_THAT(target->transact(BINDER_LIB_TEST_NOP_TRANSACTION, deadData, nullptr,
+                                     TF_ONE_WAY),
+                    StatusEq(NO_ERROR));
+        EXPECT_THAT(pollServer->transact(BINDER_LIB_TEST_DELAYED_CALL_BACK, data2, nullptr,
+                                         TF_ONE_WAY),
+                    StatusEq(NO_ERROR));
+    }
+    // The driver stops reading the batch at the dead binder, and the rest is still sent.
+    EXPECT_THAT(IPCThreadState::self()->endOnewayBatch(), StatusEq(DEAD_OBJECT));
+
+    EXPECT_THAT(callBack->waitEvent(2), StatusEq(NO_ERROR));
+    EXPECT_THAT(callBack->getResult(), StatusEq(NO_ERROR));
+    EXPECT_THAT(callBack2->waitEvent(2), StatusEq(NO_ERROR));
+    EXPECT_THAT(callBack2->getResult(), StatusEq(NO_ERROR));
+}
+
 TEST_F(BinderLibTest, WorkSourceUnsetByDefault)
 {
     status_t ret;
@@ -1411,6 +1518,135 @@ TEST_F(BinderLibTest, ThreadPoolStarted) {
     EXPECT_TRUE(reply.readBool());
 }
 
+TEST_F(BinderLibTest, ThreadPoolStats) {
+    Parcel data, reply;
+    sp<IBinder> server = addServer();
+    ASSERT_TRUE(server != nullptr);
+
+    EXPECT_THAT(server->transact(BINDER_LIB_TEST_GET_THREAD_POOL_STATS, data, &reply),
+                StatusEq(NO_ERROR));
+    uint64_t before = reply.readUint64();
+
+    constexpr size_t kTransactions = 10;
+    for (size_t i = 0; i < kTransactions; i++) {
+        EXPECT_THAT(server->transact(BINDER_LIB_TEST_NOP_TRANSACTION, data, &reply),
+                    StatusEq(NO_ERROR));
+    }
+
+    EXPECT_THAT(server->transact(BINDER_LIB_TEST_GET_THREAD_POOL_STATS, data, &reply),
+                StatusEq(NO_ERROR));
+    uint64_t after = reply.readUint64();
+    uint64_t histogramTotal = reply.readUint64();
+    uint64_t peakBusyThreads = reply.readUint64();
+    uint64_t currentThreads = reply.readUint64();
+    // the stats transactions count too
+    EXPECT_GE(after, before + kTransactions + 1);
+    EXPECT_EQ(histogramTotal, after);
+    EXPECT_GE(peakBusyThreads, 1u);
+    EXPECT_GE(currentThreads, peakBusyThreads);
+}
+
+TEST_F(BinderLibTest, TransactionStats) {
+    using binder::debug::TransactionStats;
+    sp<IBinder> server = addServer();
+    ASSERT_TRUE(server != nullptr);
+    BpBinder* remote = server->remoteBinder();
+    ASSERT_TRUE(remote != nullptr);
+
+    EXPECT_THAT(remote->transactionStatsCommand(TransactionStats::Command::RESET),
+                StatusEq(NO_ERROR));
+    EXPECT_THAT(remote->transactionStatsCommand(TransactionStats::Command::START),
+                StatusEq(NO_ERROR));
+    constexpr size_t kTransactions = 3;
+    for (size_t i = 0; i < kTransactions; i++) {
+        Parcel data, reply;
+        data.writeInterfaceToken(String16("android.binder.ITransactionStatsTest"));
+        EXPECT_THAT(server->transact(BINDER_LIB_TEST_NOP_TRANSACTION, data, &reply),
+                    StatusEq(NO_ERROR));
+    }
+    EXPECT_THAT(remote->transactionStatsCommand(TransactionStats::Command::STOP),
+                StatusEq(NO_ERROR));
+
+    unique_fd readEnd, writeEnd;
+    ASSERT_TRUE(android::base::Pipe(&readEnd, &writeEnd));
+    EXPECT_THAT(remote->transactionStatsCommand(TransactionStats::Command::DUMP, writeEnd),
+                StatusEq(NO_ERROR));
+    writeEnd.reset();
+    std::string stats;
+    ASSERT_TRUE(android::base::ReadFdToString(readEnd, &stats));
+    EXPECT_THAT(stats,
+                HasSubstr("incoming android.binder.ITransactionStatsTest code " +
+                          std::to_string(BINDER_LIB_TEST_NOP_TRANSACTION) +
+                          ": count=" + std::to_string(kTransactions) + " "))
+            << stats;
+}
+
+TEST_F(BinderLibTest, ThreadPoolAdaptive) {
+    sp<IBinder> server = addAdaptiveServer();
+    ASSERT_TRUE(server != nullptr);
+
+    struct Stats {
+        uint64_t currentThreads;
+        uint64_t maxThreads;
+        uint64_t retiredThreads;
+    };
+    auto getStats = [&]() {
+        Parcel data, reply;
+        EXPECT_THAT(server->transact(BINDER_LIB_TEST_GET_THREAD_POOL_STATS, data, &reply),
+                    StatusEq(NO_ERROR));
+        reply.readUint64(); // transactionCount
+        reply.readUint64(); // histogram total
+        reply.readUint64(); // peakBusyThreads
+        Stats stats;
+        stats.currentThreads = reply.readUint64();
+        stats.maxThreads = reply.readUint64();
+        stats.retiredThreads = reply.readUint64();
+        return stats;
+    };
+    auto runInParallel = [&](int count, uint32_t code) {
+        std::vector<std::thread> ts;
+        for (int i = 0; i < count; i++) {
+            ts.push_back(std::thread([&] {
+                Parcel data, reply;
+                EXPECT_THAT(server->transact(code, data, &reply), StatusEq(NO_ERROR));
+            }));
+        }
+        for (auto& t : ts) {
+            t.join();
+        }
+    };
+
+    const Stats initial = getStats();
+    EXPECT_EQ(static_cast<uint64_t>(kAdaptiveMinThreads), initial.maxThreads);
+
+    // Each round keeps every thread blocked on the server's lock for 100 ms. That starves the
+    // threadpool, which raises its limit by one.
+    for (int round = 0; round < kAdaptiveMaxThreads; round++) {
+        Parcel data, reply;
+        data.writeInt32(100);
+        EXPECT_THAT(server->transact(BINDER_LIB_TEST_PROCESS_TEMPORARY_LOCK, data, &reply),
+                    StatusEq(NO_ERROR));
+        runInParallel(kAdaptiveMaxThreads + 2, BINDER_LIB_TEST_LOCK_UNLOCK);
+    }
+    const Stats grown = getStats();
+    EXPECT_EQ(static_cast<uint64_t>(kAdaptiveMaxThreads), grown.maxThreads);
+    EXPECT_GT(grown.currentThreads, initial.currentThreads);
+
+    // With only three calls at a time, the extra threads leave once the peak of the load above
+    // has aged out of both 10 s windows. Parallel calls make sure kernel started threads, which
+    // are the ones that can leave, serve some of them.
+    Stats shrunk = grown;
+    const auto deadline = std::chrono::steady_clock::now() + 40s;
+    while (shrunk.retiredThreads == grown.retiredThreads &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(200ms);
+        runInParallel(3, BINDER_LIB_TEST_NOP_TRANSACTION_WAIT);
+        shrunk = getStats();
+    }
+    EXPECT_GT(shrunk.retiredThreads, grown.retiredThreads);
+    EXPECT_LT(shrunk.currentThreads, grown.currentThreads);
+}
+
 size_t epochMillis() {
     using std::chrono::duration_cast;
     using std::chrono::milliseconds;
@@ -1620,6 +1856,7 @@ public:
                 return NO_ERROR;
             }
             case BINDER_LIB_TEST_ADD_POLL_SERVER:
+            case BINDER_LIB_TEST_ADD_ADAPTIVE_SERVER:
             case BINDER_LIB_TEST_ADD_SERVER: {
                 int ret;
                 int serverid;
@@ -1633,10 +1870,14 @@ public:
                 } else {
                     serverid = m_nextServerId++;
                     m_serverStartRequested = true;
-                    bool usePoll = code == BINDER_LIB_TEST_ADD_POLL_SERVER;
+                    ServerMode mode = code == BINDER_LIB_TEST_ADD_POLL_SERVER
+                            ? ServerMode::POLL
+                            : code == BINDER_LIB_TEST_ADD_ADAPTIVE_SERVER
+                            ? ServerMode::ADAPTIVE_THREAD_POOL
+                            : ServerMode::THREAD_POOL;
 
                     pthread_mutex_unlock(&m_serverWaitMutex);
-                    ret = start_server_process(serverid, usePoll);
+                    ret = start_server_process(serverid, mode);
                     pthread_mutex_lock(&m_serverWaitMutex);
                 }
                 if (ret > 0) {
@@ -1912,6 +2153,18 @@ public:
                 reply->writeBool(ProcessState::self()->isThreadPoolStarted());
                 return NO_ERROR;
             }
+            case BINDER_LIB_TEST_GET_THREAD_POOL_STATS: {
+                ProcessState::ThreadPoolStats stats = ProcessState::self()->getThreadPoolStats();
+                uint64_t histogramTotal = 0;
+                for (uint64_t count : stats.busyThreadHistogram) histogramTotal += count;
+                reply->writeUint64(stats.transactionCount);
+                reply->writeUint64(histogramTotal);
+                reply->writeUint64(stats.peakBusyThreads);
+                reply->writeUint64(stats.currentThreads);
+                reply->writeUint64(stats.maxThreads);
+                reply->writeUint64(stats.retiredThreads);
+                return NO_ERROR;
+            }
             case BINDER_LIB_TEST_PROCESS_LOCK: {
                 m_blockMutex.lock();
                 return NO_ERROR;
@@ -1957,7 +2210,7 @@ private:
     std::mutex m_blockMutex;
 };
 
-int run_server(int index, int readypipefd, bool usePoll)
+int run_server(int index, int readypipefd, ServerMode mode)
 {
     binderLibTestServiceName += String16(binderserversuffix);
 
@@ -2015,7 +2268,7 @@ int run_server(int index, int readypipefd, bool usePoll)
     if (ret)
         return 1;
     //printf("%s: joinThreadPool\n", __func__);
-    if (usePoll) {
+    if (mode == ServerMode::POLL) {
         int fd;
         struct epoll_event ev;
         int epoll_fd;
@@ -2059,7 +2312,11 @@ int run_server(int index, int readypipefd, bool usePoll)
              }
         }
     } else {
-        ProcessState::self()->setThreadPoolMaxThreadCount(kKernelThreads);
+        if (mode == ServerMode::ADAPTIVE_THREAD_POOL) {
+            ProcessState::self()->setThreadPoolAdaptive(kAdaptiveMinThreads, kAdaptiveMaxThreads);
+        } else {
+            ProcessState::self()->setThreadPoolMaxThreadCount(kKernelThreads);
+        }
         ProcessState::self()->startThreadPool();
         IPCThreadState::self()->joinThreadPool();
     }
@@ -2076,7 +2333,7 @@ int main(int argc, char** argv) {
 
     if (argc == 6 && !strcmp(argv[1], binderserverarg)) {
         binderserversuffix = argv[5];
-        return run_server(atoi(argv[2]), atoi(argv[3]), atoi(argv[4]) == 1);
+        return run_server(atoi(argv[2]), atoi(argv[3]), static_cast<ServerMode>(atoi(argv[4])));
     }
     binderserversuffix = new char[16];
     snprintf(binderserversuffix, 16, "%d", getpid());
@@ -169,4 +169,24 @@ BENCHMARK(BM_CharVector)->Apply(VectorArgs);
 BENCHMARK(BM_Int32Vector)->Apply(VectorArgs);
 BENCHMARK(BM_Int64Vector)->Apply(VectorArgs);
 
+/*
+  A new Parcel for each write, as for most transactions. Small Parcels reuse the buffers of the
+  Parcels that were freed before them.
+*/
+static void BM_ParcelCreateWriteDestroy(benchmark::State& state) {
+    const size_t bytes = state.range(0);
+
+    std::vector<uint8_t> v(bytes);
+    while (state.KeepRunning()) {
+        android::Parcel p;
+        p.writeInt32(1);
+        p.writeByteVector(v);
+
+        benchmark::DoNotOptimize(p.data());
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK(BM_ParcelCreateWriteDestroy)->Arg(16)->Arg(256)->Arg(1024)->Arg(4000)->Arg(16384);
+
 BENCHMARK_MAIN();
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <binder/RecordedTransaction.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Usage: atest binderRecordedTransactionBenchmark
+//
+// Measures what recording costs a transaction in each format, excluding the
+// storage, by recording to /dev/null.
+
+using android::Parcel;
+using android::String16;
+using android::binder::unique_fd;
+using android::binder::debug::RecordedTransaction;
+using android::binder::debug::RecordedTransactionWriter;
+
+static void makeTransaction(size_t payloadSize, Parcel* data, Parcel* reply) {
+    data->writeInterfaceToken(String16("android.os.IBenchmarkInterface"));
+    data->writeByteVector(std::vector<uint8_t>(payloadSize, 0xaa));
+    reply->writeInt32(0);
+}
+
+static void BM_RecordChunked(benchmark::State& state) {
+    unique_fd fd(open("/dev/null", O_WRONLY | O_CLOEXEC));
+    String16 interfaceName("android.os.IBenchmarkInterface");
+    Parcel data, reply;
+    makeTransaction(state.range(0), &data, &reply);
+
+    while (state.KeepRunning()) {
+        timespec ts;
+        timespec_get(&ts, TIME_UTC);
+        auto transaction =
+                RecordedTransaction::fromDetails(interfaceName, 1, 0, ts, data, reply, 0);
+        if (transaction->dumpToFile(fd) != android::NO_ERROR) {
+            state.SkipWithError("Failed to record transaction");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * data.dataSize());
+}
+BENCHMARK(BM_RecordChunked)->Arg(64)->Arg(1024)->Arg(16 * 1024);
+
+static void BM_RecordCompact(benchmark::State& state) {
+    auto writer =
+            RecordedTransactionWriter::create(unique_fd(open("/dev/null", O_WRONLY | O_CLOEXEC)));
+    String16 interfaceName("android.os.IBenchmarkInterface");
+    Parcel data, reply;
+    makeTransaction(state.range(0), &data, &reply);
+
+    while (state.KeepRunning()) {
+        timespec ts;
+        timespec_get(&ts, TIME_UTC);
+        if (writer->append(interfaceName, 1, 0, ts, data, reply, 0) != android::NO_ERROR) {
+            state.SkipWithError("Failed to record transaction");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * data.dataSize());
+}
+BENCHMARK(BM_RecordCompact)->Arg(64)->Arg(1024)->Arg(16 * 1024);
+
+BENCHMARK_MAIN();
@@ -138,3 +138,155 @@ TEST(BinderRecordedTransaction, PayloadsExceedPageBoundaries) {
         EXPECT_EQ(retrievedTransaction->getReplyParcel().readInt32(), 99);
     }
 }
+
+using android::binder::debug::RecordedTransactionReader;
+using android::binder::debug::RecordedTransactionWriter;
+
+// Writes 'count' transactions one second apart, alternating between two
+// interfaces, in the compact format.
+static unique_fd writeCompactRecording(size_t count, size_t payloadSize) {
+    auto file = std::tmpfile();
+    unique_fd fd(fcntl(fileno(file), F_DUPFD, 1));
+    auto writer = RecordedTransactionWriter::create(unique_fd(dup(fd.get())));
+    EXPECT_NE(writer, nullptr);
+
+    std::vector<uint8_t> payload(payloadSize, 0xaa);
+    for (size_t i = 0; i < count; i++) {
+        android::String16 interfaceName(i % 2 == 0 ? "EvenInterface" : "OddInterface");
+        Parcel d;
+        d.writeInt32(static_cast<int32_t>(i));
+        d.writeByteVector(payload);
+        Parcel r;
+        r.writeInt32(99);
+        timespec ts = {static_cast<time_t>(1000 + i), 567890};
+        EXPECT_EQ(android::NO_ERROR, writer->append(interfaceName, 1, 42, ts, d, r, 0));
+    }
+    writer.reset();
+    return fd;
+}
+
+TEST(BinderRecordedTransaction, CompactRoundTrip) {
+    // spans several blocks
+    constexpr size_t kCount = 200;
+    constexpr size_t kPayloadSize = 1000;
+    unique_fd fd = writeCompactRecording(kCount, kPayloadSize);
+
+    auto reader = RecordedTransactionReader::open(fd);
+    ASSERT_NE(reader, nullptr);
+    ASSERT_EQ(reader->size(), kCount);
+
+    size_t expected = 0;
+    status_t status =
+            reader->forEach(0, reader->size(), {},
+                            [&](size_t index, const RecordedTransaction& transaction) {
+                                EXPECT_EQ(index, expected);
+                                EXPECT_EQ(transaction.getInterfaceName(),
+                                          index % 2 == 0 ? "EvenInterface" : "OddInterface");
+                                EXPECT_EQ(transaction.getCode(), 1);
+                                EXPECT_EQ(transaction.getFlags(), 42);
+                                EXPECT_EQ(transaction.getTimestamp().tv_sec,
+                                          static_cast<time_t>(1000 + index));
+                                EXPECT_EQ(transaction.getTimestamp().tv_nsec, 567890);
+                                EXPECT_EQ(transaction.getDataParcel().readInt32(),
+                                          static_cast<int32_t>(index));
+                                std::optional<std::vector<uint8_t>> payload;
+                                EXPECT_EQ(transaction.getDataParcel().readByteVector(&payload),
+                                          android::OK);
+                                EXPECT_EQ(payload->size(), kPayloadSize);
+                                EXPECT_EQ(transaction.getReplyParcel().readInt32(), 99);
+                                expected++;
+                                return true;
+                            });
+    EXPECT_EQ(status, android::NO_ERROR);
+    EXPECT_EQ(expected, kCount);
+
+    auto transaction = reader->get(kCount - 1);
+    ASSERT_TRUE(transaction.has_value());
+    EXPECT_EQ(transaction->getDataParcel().readInt32(), static_cast<int32_t>(kCount - 1));
+    EXPECT_FALSE(reader->get(kCount).has_value());
+
+    // the chunked reader does not accept the compact format
+    lseek(fd.get(), 0, SEEK_SET);
+    EXPECT_FALSE(RecordedTransaction::fromFile(fd).has_value());
+}
+
+TEST(BinderRecordedTransaction, CompactSeekAndFilter) {
+    constexpr size_t kCount = 200;
+    unique_fd fd = writeCompactRecording(kCount, 1000);
+    auto reader = RecordedTransactionReader::open(fd);
+    ASSERT_NE(reader, nullptr);
+
+    EXPECT_EQ(reader->seek({1000, 0}), 0);
+    EXPECT_EQ(reader->seek({1150, 0}), 150);
+    EXPECT_EQ(reader->seek({1150, 567891}), 151);
+    EXPECT_EQ(reader->seek({5000, 0}), kCount);
+
+    RecordedTransactionReader::Filter filter;
+    filter.interfaceName = "OddInterface";
+    filter.start = timespec{1100, 0};
+    filter.end = timespec{1120, 0};
+    std::vector<size_t> indices;
+    status_t status = reader->forEach(0, reader->size(), filter,
+                                      [&](size_t index, const RecordedTransaction& transaction) {
+                                          EXPECT_EQ(transaction.getInterfaceName(),
+                                                    "OddInterface");
+                                          indices.push_back(index);
+                                          return true;
+                                      });
+    EXPECT_EQ(status, android::NO_ERROR);
+    std::vector<size_t> expected;
+    for (size_t i = 101; i < 120; i += 2) expected.push_back(i);
+    EXPECT_EQ(indices, expected);
+
+    // a subrange, stopping early
+    indices.clear();
+    status = reader->forEach(50, 60, {}, [&](size_t index, const RecordedTransaction&) {
+        indices.push_back(index);
+        return index < 55;
+    });
+    EXPECT_EQ(status, android::NO_ERROR);
+    EXPECT_EQ(indices, (std::vector<size_t>{50, 51, 52, 53, 54, 55}));
+}
+
+TEST(BinderRecordedTransaction, CompactChecksum) {
+    unique_fd fd = writeCompactRecording(10, 100);
+
+    // corrupt the records of the only block
+    lseek(fd.get(), 100, SEEK_SET);
+    uint32_t badData = 0xffffffff;
+    write(fd.get(), &badData, sizeof(uint32_t));
+
+    auto reader = RecordedTransactionReader::open(fd);
+    ASSERT_NE(reader, nullptr);
+    EXPECT_EQ(reader->size(), 10);
+    status_t status = reader->forEach(0, reader->size(), {},
+                                      [](size_t, const RecordedTransaction&) { return true; });
+    EXPECT_EQ(status, android::BAD_VALUE);
+    EXPECT_FALSE(reader->get(0).has_value());
+}
+
+TEST(BinderRecordedTransaction, CompactRawRecordsSize) {
+    unique_fd fd = writeCompactRecording(10, 100);
+
+    // claim a huge decompressed size for the only block, keeping its checksum
+    // valid, since the header word holding rawRecordsSize is XORed into it
+    constexpr off_t kRawRecordsSizeOffset = 16 + 24;
+    constexpr off_t kChecksumOffset = 16 + 48;
+    uint32_t rawRecordsSize;
+    uint64_t checksum;
+    ASSERT_EQ(pread(fd.get(), &rawRecordsSize, sizeof(rawRecordsSize), kRawRecordsSizeOffset),
+              sizeof(rawRecordsSize));
+    ASSERT_EQ(pread(fd.get(), &checksum, sizeof(checksum), kChecksumOffset), sizeof(checksum));
+    uint32_t badSize = 0xffffffff;
+    checksum ^= rawRecordsSize ^ badSize;
+    ASSERT_EQ(pwrite(fd.get(), &badSize, sizeof(badSize), kRawRecordsSizeOffset), sizeof(badSize));
+    ASSERT_EQ(pwrite(fd.get(), &checksum, sizeof(checksum), kChecksumOffset), sizeof(checksum));
+
+    auto reader = RecordedTransactionReader::open(fd);
+    ASSERT_NE(reader, nullptr);
+    EXPECT_EQ(reader->size(), 10);
+    status_t status = reader->forEach(0, reader->size(), {},
+                                      [](size_t, const RecordedTransaction&) { return true; });
+    EXPECT_EQ(status, android::BAD_VALUE);
+    EXPECT_FALSE(reader->get(0).has_value());
+}
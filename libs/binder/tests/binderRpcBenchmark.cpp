@@ -45,6 +45,7 @@ using android::interface_cast;
 using android::IPCThreadState;
 using android::IServiceManager;
 using android::OK;
+using android::Parcel;
 using android::ProcessState;
 using android::RpcAuthPreSigned;
 using android::RpcCertificateFormat;
@@ -55,6 +56,7 @@ using android::RpcSession;
 using android::RpcTransportCtxFactory;
 using android::RpcTransportCtxFactoryRaw;
 using android::RpcTransportCtxFactoryTls;
+using android::RPC_WIRE_PROTOCOL_VERSION_EXPERIMENTAL;
 using android::sp;
 using android::status_t;
 using android::statusToString;
@@ -145,6 +147,23 @@ static sp<IBinder> gRpcBinder;
 // Skip certificate validation to simplify the setup process.
 static sp<RpcSession> gSessionTls = RpcSession::make(makeFactoryTls());
 static sp<IBinder> gRpcTlsBinder;
+// Many threads calling through a session with few connections, with and without sharing the
+// connections between calls in flight.
+static constexpr size_t kFewConnections = 2;
+static constexpr size_t kManyCallers = 16;
+static sp<RpcSession> gSessionFewConnections = RpcSession::make();
+static sp<IBinder> gRpcFewConnectionsBinder;
+static sp<RpcSession> gSessionPipelined = RpcSession::make();
+static sp<IBinder> gRpcPipelinedBinder;
+// Many threads calling through a session with a connection for each of them.
+static sp<RpcSession> gSessionManyConnections = RpcSession::make();
+static sp<IBinder> gRpcManyConnectionsBinder;
+
+// Parcels from this size on are sent in shared memory.
+static constexpr size_t kSharedMemoryThreshold = 64 * 1024;
+static sp<RpcSession> gSessionSharedMemory =
+        RpcSession::make(RpcTransportCtxFactoryRaw::make(kSharedMemoryThreshold));
+static sp<IBinder> gRpcSharedMemoryBinder;
 #ifdef __BIONIC__
 static const String16 kKernelBinderInstance = String16(u"binderRpcBenchmark-control");
 static sp<IBinder> gKernelBinder;
@@ -250,6 +269,40 @@ BENCHMARK(BM_throughputForTransportAndBytes)
         ->ArgsProduct({kTransportList,
                        {64, 1024, 2048, 4096, 8182, 16364, 32728, 65535, 65536, 65537}});
 
+// Sends repeatBytes by hand, so that the payload can be written with Parcel::writeExternal, which
+// sends it from the caller's buffer, rather than copied into the Parcel as AIDL does.
+void BM_repeatBytesExternal(benchmark::State& state) {
+    const bool external = state.range(0) != 0;
+    sp<IBinder> binder = gRpcBinder;
+
+    auto bytes = std::make_shared<std::vector<uint8_t>>(state.range(1));
+    for (size_t i = 0; i < bytes->size(); i++) {
+        (*bytes)[i] = i % 256;
+    }
+
+    while (state.KeepRunning()) {
+        Parcel data;
+        data.markForBinder(binder);
+        CHECK_EQ(OK, data.writeInterfaceToken(IBinderRpcBenchmark::descriptor));
+        CHECK_EQ(OK, data.writeInt32(static_cast<int32_t>(bytes->size())));
+        if (external) {
+            CHECK_EQ(OK, data.writeExternal(bytes->data(), bytes->size(), bytes));
+        } else {
+            CHECK_EQ(OK, data.write(bytes->data(), bytes->size()));
+        }
+        Parcel reply;
+        CHECK_EQ(OK,
+                 binder->transact(IBinderRpcBenchmark::TRANSACTION_repeatBytes, data, &reply));
+        Status ret;
+        CHECK_EQ(OK, ret.readFromParcel(reply));
+        CHECK(ret.isOk()) << ret;
+    }
+
+    state.SetBytesProcessed(state.iterations() * bytes->size() * 2);
+    state.SetLabel(external ? "rpc_external" : "rpc_copied");
+}
+BENCHMARK(BM_repeatBytesExternal)->ArgsProduct({{0, 1}, {4096, 16384, 65536}});
+
 void BM_collectProxies(benchmark::State& state) {
     sp<IBinder> binder = getBinderForOptions(state);
     sp<IBinderRpcBenchmark> iface = interface_cast<IBinderRpcBenchmark>(binder);
@@ -301,6 +354,84 @@ void BM_repeatBinder(benchmark::State& state) {
 }
 BENCHMARK(BM_repeatBinder)->ArgsProduct({kTransportList});
 
+void BM_manyCallersFewConnections(benchmark::State& state) {
+    bool pipelined = state.range(0);
+    sp<IBinder> binder = pipelined ? gRpcPipelinedBinder : gRpcFewConnectionsBinder;
+    if (binder == nullptr) {
+        state.SkipWithError("Sharing connections needs the experimental protocol version");
+        return;
+    }
+    sp<IBinderRpcBenchmark> iface = interface_cast<IBinderRpcBenchmark>(binder);
+    CHECK(iface != nullptr);
+
+    std::vector<uint8_t> bytes = std::vector<uint8_t>(state.range(1));
+
+    while (state.KeepRunning()) {
+        std::vector<uint8_t> out;
+        Status ret = iface->repeatBytes(bytes, &out);
+        CHECK(ret.isOk()) << ret;
+    }
+
+    state.SetLabel(pipelined ? "rpc_pipelined" : "rpc");
+}
+BENCHMARK(BM_manyCallersFewConnections)
+        ->ArgsProduct({{false, true}, {64, 4096}})
+        ->Threads(kManyCallers)
+        ->UseRealTime();
+
+// Many threads each sending back proxies that they hold, from a large set of
+// them, so that the node table is shared by all of the threads.
+void BM_manyCallersManyProxies(benchmark::State& state) {
+    sp<IBinderRpcBenchmark> iface = interface_cast<IBinderRpcBenchmark>(gRpcManyConnectionsBinder);
+    CHECK(iface != nullptr);
+
+    std::vector<sp<IBinder>> proxies(state.range(0));
+    for (auto& proxy : proxies) {
+        Status ret = iface->gimmeBinder(&proxy);
+        CHECK(ret.isOk()) << ret;
+    }
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        sp<IBinder> out;
+        Status ret = iface->repeatBinder(proxies[i++ % proxies.size()], &out);
+        CHECK(ret.isOk()) << ret;
+    }
+
+    state.SetLabel("rpc");
+}
+BENCHMARK(BM_manyCallersManyProxies)
+        ->Arg(100)
+        ->Arg(1000)
+        ->Arg(10000)
+        ->ThreadRange(1, kManyCallers)
+        ->UseRealTime();
+
+// Payloads this large can't be sent inline at all.
+void BM_throughputSharedMemory(benchmark::State& state) {
+    if (gRpcSharedMemoryBinder == nullptr) {
+        state.SkipWithError("Shared memory needs the experimental protocol version");
+        return;
+    }
+    sp<IBinderRpcBenchmark> iface = interface_cast<IBinderRpcBenchmark>(gRpcSharedMemoryBinder);
+    CHECK(iface != nullptr);
+
+    std::vector<uint8_t> bytes = std::vector<uint8_t>(state.range(0));
+    for (size_t i = 0; i < bytes.size(); i++) {
+        bytes[i] = i % 256;
+    }
+
+    while (state.KeepRunning()) {
+        std::vector<uint8_t> out;
+        Status ret = iface->repeatBytes(bytes, &out);
+        CHECK(ret.isOk()) << ret;
+    }
+
+    state.SetBytesProcessed(state.iterations() * bytes.size() * 2);
+    state.SetLabel("rpc_shared_memory");
+}
+BENCHMARK(BM_throughputSharedMemory)->Arg(65536)->Arg(1 << 20)->Arg(4 << 20)->Arg(16 << 20);
+
 void forkRpcServer(const char* addr, const sp<RpcServer>& server) {
     if (0 == fork()) {
         prctl(PR_SET_PDEATHSIG, SIGHUP); // racey, okay
@@ -356,6 +487,53 @@ int main(int argc, char** argv) {
     setupClient(gSessionTls, tlsAddr.c_str());
     gRpcTlsBinder = gSessionTls->getRootObject();
 
+    std::string fewAddr = tmp + "/binderRpcFewConnectionsBenchmark";
+    (void)unlink(fewAddr.c_str());
+    sp<RpcServer> fewServer = RpcServer::make(RpcTransportCtxFactoryRaw::make());
+    fewServer->setMaxThreads(kFewConnections);
+    forkRpcServer(fewAddr.c_str(), fewServer);
+    gSessionFewConnections->setMaxOutgoingConnections(kFewConnections);
+    setupClient(gSessionFewConnections, fewAddr.c_str());
+    gRpcFewConnectionsBinder = gSessionFewConnections->getRootObject();
+
+    std::string manyAddr = tmp + "/binderRpcManyConnectionsBenchmark";
+    (void)unlink(manyAddr.c_str());
+    sp<RpcServer> manyServer = RpcServer::make(RpcTransportCtxFactoryRaw::make());
+    manyServer->setMaxThreads(kManyCallers);
+    forkRpcServer(manyAddr.c_str(), manyServer);
+    setupClient(gSessionManyConnections, manyAddr.c_str());
+    gRpcManyConnectionsBinder = gSessionManyConnections->getRootObject();
+
+    // Transaction ids are only available with the experimental protocol version, which may not
+    // be allowed in this configuration, in which case that variant of the benchmark is skipped.
+    sp<RpcServer> pipelinedServer = RpcServer::make(RpcTransportCtxFactoryRaw::make());
+    if (pipelinedServer->setProtocolVersion(RPC_WIRE_PROTOCOL_VERSION_EXPERIMENTAL) &&
+        gSessionPipelined->setProtocolVersion(RPC_WIRE_PROTOCOL_VERSION_EXPERIMENTAL)) {
+        std::string pipelinedAddr = tmp + "/binderRpcPipelinedBenchmark";
+        (void)unlink(pipelinedAddr.c_str());
+        pipelinedServer->setMaxThreads(kFewConnections);
+        forkRpcServer(pipelinedAddr.c_str(), pipelinedServer);
+        gSessionPipelined->setMaxOutgoingConnections(kFewConnections);
+        gSessionPipelined->setMaxPipelinedTransactions(kManyCallers / kFewConnections);
+        setupClient(gSessionPipelined, pipelinedAddr.c_str());
+        gRpcPipelinedBinder = gSessionPipelined->getRootObject();
+    }
+
+    sp<RpcServer> sharedMemoryServer =
+            RpcServer::make(RpcTransportCtxFactoryRaw::make(kSharedMemoryThreshold));
+    if (sharedMemoryServer->setProtocolVersion(RPC_WIRE_PROTOCOL_VERSION_EXPERIMENTAL) &&
+        gSessionSharedMemory->setProtocolVersion(RPC_WIRE_PROTOCOL_VERSION_EXPERIMENTAL)) {
+        std::string sharedMemoryAddr = tmp + "/binderRpcSharedMemoryBenchmark";
+        (void)unlink(sharedMemoryAddr.c_str());
+        sharedMemoryServer->setSupportedFileDescriptorTransportModes(
+                {RpcSession::FileDescriptorTransportMode::UNIX});
+        forkRpcServer(sharedMemoryAddr.c_str(), sharedMemoryServer);
+        gSessionSharedMemory->setFileDescriptorTransportMode(
+                RpcSession::FileDescriptorTransportMode::UNIX);
+        setupClient(gSessionSharedMemory, sharedMemoryAddr.c_str());
+        gRpcSharedMemoryBinder = gSessionSharedMemory->getRootObject();
+    }
+
     ::benchmark::RunSpecifiedBenchmarks();
     return 0;
 }
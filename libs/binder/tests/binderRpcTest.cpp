@@ -363,6 +363,7 @@ std::unique_ptr<ProcessSession> BinderRpc::createRpcTestSocketServerProcessEtc(
         LOG_ALWAYS_FATAL_IF(!session->setProtocolVersion(clientVersion));
         session->setMaxIncomingThreads(numIncoming);
         session->setMaxOutgoingConnections(options.numOutgoingConnections);
+        session->setMaxPipelinedTransactions(options.numPipelinedTransactions);
         session->setFileDescriptorTransportMode(options.clientFileDescriptorTransportMode);
 
         switch (socketType) {
@@ -528,6 +529,42 @@ TEST_P(BinderRpc, ThreadingStressTest) {
     for (auto& t : threads) t.join();
 }
 
+TEST_P(BinderRpc, ThreadingStressTestPipelined) {
+    if (clientOrServerSingleThreaded()) {
+        GTEST_SKIP() << "This test requires multiple threads";
+    }
+
+    constexpr size_t kNumClientThreads = 10;
+    constexpr size_t kNumServerThreads = 5;
+    constexpr size_t kNumOutgoingConnections = 2;
+    constexpr size_t kNumCalls = 50;
+
+    // Connections are only shared if the protocol version supports it, but either way, every
+    // call has to get its own reply.
+    auto proc = createRpcTestSocketServerProcess(
+            {.numThreads = kNumServerThreads,
+             .numOutgoingConnections = kNumOutgoingConnections,
+             .numPipelinedTransactions = kNumClientThreads / kNumOutgoingConnections});
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < kNumClientThreads; i++) {
+        threads.push_back(std::thread([&, i] {
+            for (size_t j = 0; j < kNumCalls; j++) {
+                std::string value = std::to_string(i * kNumCalls + j);
+                std::string out;
+                EXPECT_OK(proc.rootIface->doubleString(value, &out));
+                EXPECT_EQ(value + value, out);
+
+                sp<IBinder> binder;
+                EXPECT_OK(proc.rootIface->repeatBinder(proc.rootBinder, &binder));
+                EXPECT_EQ(proc.rootBinder, binder);
+            }
+        }));
+    }
+
+    for (auto& t : threads) t.join();
+}
+
 static void saturateThreadPool(size_t threadCount, const sp<IBinderRpcTest>& iface) {
     std::vector<std::thread> threads;
     for (size_t i = 0; i < threadCount; i++) {
@@ -1473,6 +1510,148 @@ INSTANTIATE_TEST_CASE_P(BinderRpc, BinderRpcServerOnly,
                                            ::testing::ValuesIn(testVersions())),
                         BinderRpcServerOnly::PrintTestParam);
 
+TEST(BinderRpc, SharedMemoryParcelData) {
+    if constexpr (!kEnableRpcThreads) {
+        GTEST_SKIP() << "Test skipped because threads were disabled at build time";
+    }
+
+    class EchoBytes : public BBinder {
+        status_t onTransact(uint32_t, const Parcel& data, Parcel* reply, uint32_t) override {
+            std::vector<uint8_t> bytes;
+            if (status_t status = data.readByteVector(&bytes); status != OK) return status;
+            return reply->writeByteVector(bytes);
+        }
+    };
+
+    constexpr size_t kThreshold = 64 * 1024;
+    // Far larger than what can be received inline.
+    constexpr size_t kSize = 4 * 1024 * 1024;
+
+    auto server = RpcServer::make(RpcTransportCtxFactoryRaw::make(kThreshold));
+    auto session = RpcSession::make(RpcTransportCtxFactoryRaw::make(kThreshold));
+    if (!server->setProtocolVersion(RPC_WIRE_PROTOCOL_VERSION_EXPERIMENTAL) ||
+        !session->setProtocolVersion(RPC_WIRE_PROTOCOL_VERSION_EXPERIMENTAL)) {
+        GTEST_SKIP() << "Shared memory needs the experimental protocol version";
+    }
+    server->setSupportedFileDescriptorTransportModes(
+            {RpcSession::FileDescriptorTransportMode::UNIX});
+    server->setRootObject(sp<EchoBytes>::make());
+    auto addr = allocateSocketAddress();
+    ASSERT_EQ(OK, server->setupUnixDomainServer(addr.c_str()));
+    std::thread([server] { server->join(); }).detach();
+
+    session->setFileDescriptorTransportMode(RpcSession::FileDescriptorTransportMode::UNIX);
+    ASSERT_EQ(OK, session->setupUnixDomainClient(addr.c_str()));
+    auto binder = session->getRootObject();
+    ASSERT_NE(nullptr, binder);
+
+    for (size_t size : {size_t(16), kThreshold, kSize}) {
+        std::vector<uint8_t> bytes(size);
+        for (size_t i = 0; i < bytes.size(); i++) {
+            bytes[i] = i % 251;
+        }
+        Parcel data;
+        data.markForBinder(binder);
+        ASSERT_EQ(OK, data.writeByteVector(bytes));
+        Parcel reply;
+        ASSERT_EQ(OK, binder->transact(IBinder::FIRST_CALL_TRANSACTION, data, &reply)) << size;
+        std::vector<uint8_t> out;
+        ASSERT_EQ(OK, reply.readByteVector(&out));
+        EXPECT_EQ(bytes, out) << size;
+    }
+
+    EXPECT_TRUE(session->shutdownAndWait(true));
+    EXPECT_TRUE(server->shutdown());
+}
+
+TEST(BinderRpc, ExternalParcelData) {
+    if constexpr (!kEnableRpcThreads) {
+        GTEST_SKIP() << "Test skipped because threads were disabled at build time";
+    }
+
+    // Replies with the bytes between two markers, also written with writeExternal.
+    class EchoExternal : public BBinder {
+        status_t onTransact(uint32_t, const Parcel& data, Parcel* reply, uint32_t) override {
+            int32_t size;
+            if (status_t status = data.readInt32(&size); status != OK) return status;
+            const void* bytes = data.readInplace(size);
+            if (bytes == nullptr) return BAD_VALUE;
+            auto copy = std::make_shared<std::vector<uint8_t>>(static_cast<const uint8_t*>(bytes),
+                                                               static_cast<const uint8_t*>(bytes) +
+                                                                       size);
+            if (status_t status = reply->writeInt32(size); status != OK) return status;
+            if (status_t status = reply->writeExternal(copy->data(), copy->size(), copy);
+                status != OK) {
+                return status;
+            }
+            return reply->writeInt32(data.readInt32());
+        }
+    };
+
+    constexpr size_t kThreshold = 64 * 1024;
+
+    auto server = RpcServer::make(RpcTransportCtxFactoryRaw::make(kThreshold));
+    auto session = RpcSession::make(RpcTransportCtxFactoryRaw::make(kThreshold));
+    server->setSupportedFileDescriptorTransportModes(
+            {RpcSession::FileDescriptorTransportMode::UNIX});
+    server->setRootObject(sp<EchoExternal>::make());
+    auto addr = allocateSocketAddress();
+    ASSERT_EQ(OK, server->setupUnixDomainServer(addr.c_str()));
+    std::thread([server] { server->join(); }).detach();
+
+    session->setFileDescriptorTransportMode(RpcSession::FileDescriptorTransportMode::UNIX);
+    ASSERT_EQ(OK, session->setupUnixDomainClient(addr.c_str()));
+    auto binder = session->getRootObject();
+    ASSERT_NE(nullptr, binder);
+
+    // Inline, copied, gathered into the message, and gathered into shared memory, if supported.
+    for (size_t size : {size_t(16), size_t(4097), 4 * kThreshold}) {
+        auto bytes = std::make_shared<std::vector<uint8_t>>(size);
+        for (size_t i = 0; i < bytes->size(); i++) {
+            (*bytes)[i] = i % 251;
+        }
+        Parcel data;
+        data.markForBinder(binder);
+        ASSERT_EQ(OK, data.writeInt32(size));
+        ASSERT_EQ(OK, data.writeExternal(bytes->data(), bytes->size(), bytes));
+        ASSERT_EQ(OK, data.writeInt32(42));
+        Parcel reply;
+        ASSERT_EQ(OK, binder->transact(IBinder::FIRST_CALL_TRANSACTION, data, &reply)) << size;
+
+        EXPECT_EQ(static_cast<int32_t>(size), reply.readInt32());
+        const void* out = reply.readInplace(size);
+        ASSERT_NE(nullptr, out);
+        EXPECT_EQ(0, memcmp(bytes->data(), out, size)) << size;
+        EXPECT_EQ(42, reply.readInt32());
+    }
+
+    EXPECT_TRUE(session->shutdownAndWait(true));
+    EXPECT_TRUE(server->shutdown());
+}
+
+TEST(BinderRpc, ExternalParcelDataReadBeforeSend) {
+    auto session = RpcSession::make();
+    Parcel parcel;
+    parcel.markForRpc(session);
+
+    auto bytes = std::make_shared<std::vector<uint8_t>>(16 * 1024, 0xab);
+    ASSERT_EQ(OK, parcel.writeInt32(1));
+    ASSERT_EQ(OK, parcel.writeExternal(bytes->data(), bytes->size(), bytes));
+    ASSERT_EQ(OK, parcel.writeInt32(2));
+
+    // Overwriting the start of the buffer copies it into the Parcel first.
+    parcel.setDataPosition(sizeof(int32_t));
+    ASSERT_EQ(OK, parcel.writeInt32(0x01010101));
+
+    parcel.setDataPosition(0);
+    EXPECT_EQ(1, parcel.readInt32());
+    EXPECT_EQ(0x01010101, parcel.readInt32());
+    const uint8_t* out = static_cast<const uint8_t*>(parcel.readInplace(bytes->size() - 4));
+    ASSERT_NE(nullptr, out);
+    EXPECT_EQ(0, memcmp(bytes->data() + 4, out, bytes->size() - 4));
+    EXPECT_EQ(2, parcel.readInt32());
+}
+
 class RpcTransportTestUtils {
 public:
     // Only parameterized only server version because `RpcSession` is bypassed
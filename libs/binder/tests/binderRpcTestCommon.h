@@ -145,6 +145,7 @@ struct BinderRpcOptions {
     // options can all be specified per session
     std::vector<size_t> numIncomingConnectionsBySession = {};
     size_t numOutgoingConnections = SIZE_MAX;
+    size_t numPipelinedTransactions = 1;
     RpcSession::FileDescriptorTransportMode clientFileDescriptorTransportMode =
             RpcSession::FileDescriptorTransportMode::NONE;
     std::vector<RpcSession::FileDescriptorTransportMode>
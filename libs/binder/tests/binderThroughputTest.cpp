@@ -8,6 +8,7 @@
 #include <cstdio>
 
 #include <iostream>
+#include <optional>
 #include <vector>
 #include <tuple>
 
@@ -194,6 +195,7 @@ void worker_fx(int num,
                int iterations,
                int payload_size,
                bool cs_pair,
+               int oneway_batch,
                Pipe p)
 {
     // Create BinderWorkerService and for go.
@@ -227,7 +229,42 @@ void worker_fx(int num,
     chrono::time_point<chrono::high_resolution_clock> start, end;
 
     // Skip the benchmark if server of a cs_pair.
-    if (!(cs_pair && num < server_count)) {
+    if (!(cs_pair && num < server_count) && oneway_batch > 0) {
+        // Each sample is a batch of oneway transactions, followed by a synchronous one, so that
+        // the server's async buffer doesn't fill up.
+        for (int i = 0; i < iterations; i += oneway_batch) {
+            Parcel data, reply;
+            int target = cs_pair ? num % server_count : rand() % workers.size();
+            int sz = payload_size;
+
+            while (sz >= sizeof(uint32_t)) {
+                data.writeInt32(0);
+                sz -= sizeof(uint32_t);
+            }
+            status_t ret = NO_ERROR;
+            start = chrono::high_resolution_clock::now();
+            {
+                std::optional<ScopedOnewayBatch> batch;
+                if (oneway_batch > 1) batch.emplace();
+                for (int j = 0; j < oneway_batch && ret == NO_ERROR; j++) {
+                    ret = workers[target]->transact(BINDER_NOP, data, nullptr,
+                                                    IBinder::FLAG_ONEWAY);
+                }
+            }
+            if (ret == NO_ERROR) {
+                ret = workers[target]->transact(BINDER_NOP, data, &reply);
+            }
+            end = chrono::high_resolution_clock::now();
+
+            uint64_t cur_time = uint64_t(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+            results.add_time(cur_time);
+
+            if (ret != NO_ERROR) {
+               cout << "thread " << num << " failed " << ret << "i : " << i << endl;
+               exit(EXIT_FAILURE);
+            }
+        }
+    } else if (!(cs_pair && num < server_count)) {
         for (int i = 0; i < iterations; i++) {
             Parcel data, reply;
             int target = cs_pair ? num % server_count : rand() % workers.size();
@@ -262,7 +299,8 @@ void worker_fx(int num,
     exit(EXIT_SUCCESS);
 }
 
-Pipe make_worker(int num, int iterations, int worker_count, int payload_size, bool cs_pair)
+Pipe make_worker(int num, int iterations, int worker_count, int payload_size, bool cs_pair,
+                 int oneway_batch)
 {
     auto pipe_pair = Pipe::createPipePair();
     pid_t pid = fork();
@@ -271,7 +309,7 @@ Pipe make_worker(int num, int iterations, int worker_count, int payload_size, bo
         return std::move(get<0>(pipe_pair));
     } else {
         /* child */
-        worker_fx(num, worker_count, iterations, payload_size, cs_pair,
+        worker_fx(num, worker_count, iterations, payload_size, cs_pair, oneway_batch,
                   std::move(get<1>(pipe_pair)));
         /* never get here */
         return std::move(get<0>(pipe_pair));
@@ -293,16 +331,18 @@ void signal_all(vector<Pipe>& v)
     }
 }
 
-void run_main(int iterations,
-              int workers,
-              int payload_size,
-              int cs_pair,
-              bool training_round=false)
+// Returns the number of iterations per second.
+double run_main(int iterations,
+                int workers,
+                int payload_size,
+                int cs_pair,
+                int oneway_batch,
+                bool training_round=false)
 {
     vector<Pipe> pipes;
     // Create all the workers and wait for them to spawn.
     for (int i = 0; i < workers; i++) {
-        pipes.push_back(make_worker(i, iterations, workers, payload_size, cs_pair));
+        pipes.push_back(make_worker(i, iterations, workers, payload_size, cs_pair, oneway_batch));
     }
     wait_all(pipes);
     // All workers have now been spawned and added themselves to service
@@ -351,6 +391,7 @@ void run_main(int iterations,
     } else {
         tot_results.dump();
     }
+    return iterations_per_sec;
 }
 
 int main(int argc, char *argv[])
@@ -358,6 +399,7 @@ int main(int argc, char *argv[])
     int workers = 2;
     int iterations = 10000;
     int payload_size = 0;
+    int oneway_batch = 0;
     bool cs_pair = false;
     bool training_round = false;
     int max_time_us;
@@ -366,6 +408,8 @@ int main(int argc, char *argv[])
     for (int i = 1; i < argc; i++) {
         if (string(argv[i]) == "--help") {
             cout << "Usage: binderThroughputTest [OPTIONS]" << endl;
+            cout << "\t-b N    : Send oneway transactions in batches of N, and compare with"
+                    " sending them one by one." << endl;
             cout << "\t-i N    : Specify number of iterations." << endl;
             cout << "\t-m N    : Specify expected max latency in microseconds." << endl;
             cout << "\t-p      : Split workers into client/server pairs." << endl;
@@ -383,6 +427,19 @@ int main(int argc, char *argv[])
             i++;
             continue;
         }
+        if (string(argv[i]) == "-b") {
+            if (i + 1 == argc) {
+                cout << "-b requires an argument\n" << endl;
+                exit(EXIT_FAILURE);
+            }
+            oneway_batch = atoi(argv[i+1]);
+            if (oneway_batch <= 0) {
+                cout << "Batch size -b must be positive." << endl;
+                exit(EXIT_FAILURE);
+            }
+            i++;
+            continue;
+        }
         if (string(argv[i]) == "-i") {
             if (i + 1 == argc) {
                 cout << "-i requires an argument\n" << endl;
@@ -434,10 +491,19 @@ int main(int argc, char *argv[])
 
     if (training_round) {
         cout << "Start training round" << endl;
-        run_main(iterations, workers, payload_size, cs_pair, training_round=true);
+        run_main(iterations, workers, payload_size, cs_pair, oneway_batch, training_round=true);
         cout << "Completed training round" << endl << endl;
     }
 
-    run_main(iterations, workers, payload_size, cs_pair);
+    if (oneway_batch > 0) {
+        cout << "Oneway transactions, one by one" << endl;
+        double unbatched = run_main(iterations, workers, payload_size, cs_pair, 1);
+        cout << endl << "Oneway transactions, in batches of " << oneway_batch << endl;
+        double batched = run_main(iterations, workers, payload_size, cs_pair, oneway_batch);
+        cout << endl << "batching speedup: " << batched / unbatched << "x" << endl;
+        return 0;
+    }
+
+    run_main(iterations, workers, payload_size, cs_pair, oneway_batch);
     return 0;
 }
@@ -31,6 +31,15 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
 
     auto transaction = android::binder::debug::RecordedTransaction::fromFile(fd);
 
+    // the same bytes as a compact recording
+    if (auto reader = android::binder::debug::RecordedTransactionReader::open(fd)) {
+        auto forEachStatus [[maybe_unused]] =
+                reader->forEach(0, reader->size(), {},
+                                [](size_t, const android::binder::debug::RecordedTransaction&) {
+                                    return true;
+                                });
+    }
+
     std::fclose(intermediateFile);
 
     if (transaction.has_value()) {
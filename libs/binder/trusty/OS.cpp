@@ -72,6 +72,16 @@ status_t dupFileDescriptor(int oldFd, int* newFd) {
     return OK;
 }
 
+status_t createSealedMemory(const char*, const iovec*, int, unique_fd*) {
+    return INVALID_OPERATION;
+}
+
+status_t mapSealedMemory(borrowed_fd, size_t, const uint8_t**) {
+    return INVALID_OPERATION;
+}
+
+void unmapSealedMemory(const uint8_t*, size_t) {}
+
 std::unique_ptr<RpcTransportCtxFactory> makeDefaultRpcTransportCtxFactory() {
     return RpcTransportCtxFactoryTipcTrusty::make();
 }
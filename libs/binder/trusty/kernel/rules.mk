@@ -35,6 +35,7 @@ MODULE_SRCS := \
 	$(LIBBINDER_DIR)/Parcel.cpp \
 	$(LIBBINDER_DIR)/Stability.cpp \
 	$(LIBBINDER_DIR)/Status.cpp \
+	$(LIBBINDER_DIR)/TransactionStats.cpp \
 	$(LIBBINDER_DIR)/Utils.cpp \
 	$(LIBUTILS_BINDER_DIR)/Errors.cpp \
 	$(LIBUTILS_BINDER_DIR)/RefBase.cpp \
@@ -42,6 +42,7 @@ MODULE_SRCS := \
 	$(LIBBINDER_DIR)/RpcState.cpp \
 	$(LIBBINDER_DIR)/Stability.cpp \
 	$(LIBBINDER_DIR)/Status.cpp \
+	$(LIBBINDER_DIR)/TransactionStats.cpp \
 	$(LIBBINDER_DIR)/Utils.cpp \
 	$(LIBBINDER_DIR)/file.cpp \
 	$(LIBUTILS_BINDER_DIR)/Errors.cpp \
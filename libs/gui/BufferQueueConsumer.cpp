@@ -407,7 +407,7 @@ status_t BufferQueueConsumer::attachBuffer(int* outSlot,
         mCore->mFreeSlots.erase(slot);
     } else if (!mCore->mFreeBuffers.empty()) {
         found = mCore->mFreeBuffers.front();
-        mCore->mFreeBuffers.remove(found);
+        mCore->mFreeBuffers.pop_front();
     }
     if (found == BufferQueueCore::INVALID_BUFFER_SLOT) {
         BQ_LOGE("attachBuffer: could not find free buffer slot");
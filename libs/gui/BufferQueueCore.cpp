@@ -376,13 +376,9 @@ void BufferQueueCore::validateConsistencyLocked() const {
     int allocatedSlots = 0;
     for (int slot = 0; slot < BufferQueueDefs::NUM_BUFFER_SLOTS; ++slot) {
         bool isInFreeSlots = mFreeSlots.count(slot) != 0;
-        bool isInFreeBuffers =
-                std::find(mFreeBuffers.cbegin(), mFreeBuffers.cend(), slot) !=
-                mFreeBuffers.cend();
+        bool isInFreeBuffers = mFreeBuffers.count(slot) != 0;
         bool isInActiveBuffers = mActiveBuffers.count(slot) != 0;
-        bool isInUnusedSlots =
-                std::find(mUnusedSlots.cbegin(), mUnusedSlots.cend(), slot) !=
-                mUnusedSlots.cend();
+        bool isInUnusedSlots = mUnusedSlots.count(slot) != 0;
 
         if (isInFreeSlots || isInFreeBuffers || isInActiveBuffers) {
             allocatedSlots++;
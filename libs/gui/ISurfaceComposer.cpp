@@ -37,6 +37,8 @@
 #include <ui/HdrCapabilities.h>
 #include <utils/Log.h>
 
+#include <mutex>
+
 // ---------------------------------------------------------------------------
 
 using namespace aidl::android::hardware::graphics;
@@ -72,9 +74,10 @@ public:
 
         frameTimelineInfo.writeToParcel(&data);
 
+        const layer_state_t::Encoding encoding = getLayerStateEncoding();
         SAFE_PARCEL(data.writeUint32, static_cast<uint32_t>(state.size()));
         for (const auto& s : state) {
-            SAFE_PARCEL(s.write, data);
+            SAFE_PARCEL(s.write, data, encoding);
         }
 
         SAFE_PARCEL(data.writeUint32, static_cast<uint32_t>(displays.size()));
@@ -107,14 +110,36 @@ public:
             SAFE_PARCEL(data.writeUint64, mergedTransactionId);
         }
 
+        const uint32_t code = encoding == layer_state_t::Encoding::COMPACT
+                ? BnSurfaceComposer::SET_TRANSACTION_STATE_COMPACT
+                : BnSurfaceComposer::SET_TRANSACTION_STATE;
         if (flags & ISurfaceComposer::eOneWay) {
-            return remote()->transact(BnSurfaceComposer::SET_TRANSACTION_STATE,
-                    data, &reply, IBinder::FLAG_ONEWAY);
+            return remote()->transact(code, data, &reply, IBinder::FLAG_ONEWAY);
         } else {
-            return remote()->transact(BnSurfaceComposer::SET_TRANSACTION_STATE,
-                    data, &reply);
+            return remote()->transact(code, data, &reply);
         }
     }
+
+private:
+    // Older SurfaceFlingers only read full layer states, and a one way SET_TRANSACTION_STATE
+    // can't tell that the code was unknown, so ask once before the first transaction.
+    layer_state_t::Encoding getLayerStateEncoding() {
+        std::call_once(mLayerStateEncodingOnce, [this]() {
+            Parcel data, reply;
+            data.writeInterfaceToken(ISurfaceComposer::getInterfaceDescriptor());
+            uint32_t encoding = 0;
+            if (remote()->transact(BnSurfaceComposer::GET_LAYER_STATE_ENCODING, data, &reply) ==
+                        NO_ERROR &&
+                reply.readUint32(&encoding) == NO_ERROR &&
+                encoding == static_cast<uint32_t>(layer_state_t::Encoding::COMPACT)) {
+                mLayerStateEncoding = layer_state_t::Encoding::COMPACT;
+            }
+        });
+        return mLayerStateEncoding;
+    }
+
+    std::once_flag mLayerStateEncodingOnce;
+    layer_state_t::Encoding mLayerStateEncoding = layer_state_t::Encoding::FULL;
 };
 
 // Out-of-line virtual method definition to trigger vtable emission in this
@@ -129,19 +154,23 @@ status_t BnSurfaceComposer::onTransact(
     uint32_t code, const Parcel& data, Parcel* reply, uint32_t flags)
 {
     switch (code) {
-        case SET_TRANSACTION_STATE: {
+        case SET_TRANSACTION_STATE:
+        case SET_TRANSACTION_STATE_COMPACT: {
             CHECK_INTERFACE(ISurfaceComposer, data, reply);
 
             FrameTimelineInfo frameTimelineInfo;
             frameTimelineInfo.readFromParcel(&data);
 
+            const layer_state_t::Encoding encoding = code == SET_TRANSACTION_STATE_COMPACT
+                    ? layer_state_t::Encoding::COMPACT
+                    : layer_state_t::Encoding::FULL;
             uint32_t count = 0;
             SAFE_PARCEL_READ_SIZE(data.readUint32, &count, data.dataSize());
             Vector<ComposerState> state;
             state.setCapacity(count);
             for (size_t i = 0; i < count; i++) {
                 ComposerState s;
-                SAFE_PARCEL(s.read, data);
+                SAFE_PARCEL(s.read, data, encoding);
                 state.add(s);
             }
 
@@ -202,6 +231,12 @@ status_t BnSurfaceComposer::onTransact(
                                        isAutoTimestamp, uncacheBuffers, hasListenerCallbacks,
                                        listenerCallbacks, transactionId, mergedTransactions);
         }
+        case GET_LAYER_STATE_ENCODING: {
+            CHECK_INTERFACE(ISurfaceComposer, data, reply);
+            SAFE_PARCEL(reply->writeUint32,
+                        static_cast<uint32_t>(layer_state_t::Encoding::COMPACT));
+            return NO_ERROR;
+        }
         case GET_SCHEDULING_POLICY: {
             gui::SchedulingPolicy policy;
             const auto status = gui::getSchedulingPolicy(&policy);
@@ -17,9 +17,15 @@
 #ifndef ANDROID_GUI_BUFFERQUEUEPRODUCER_H
 #define ANDROID_GUI_BUFFERQUEUEPRODUCER_H
 
+#include <gui/BufferItem.h>
 #include <gui/BufferQueueDefs.h>
 
+#include <gui/IConsumerListener.h>
 #include <gui/IGraphicBufferProducer.h>
+#include <ui/FenceTime.h>
+
+#include <optional>
+#include <vector>
 
 namespace android {
 
@@ -46,6 +52,10 @@ public:
     // flags indicating that previously-returned buffers are no longer valid.
     virtual status_t requestBuffer(int slot, sp<GraphicBuffer>* buf);
 
+    // See IGraphicBufferProducer::requestBuffers. Takes mCore->mMutex once for the batch.
+    status_t requestBuffers(const std::vector<int32_t>& slots,
+                            std::vector<RequestBufferOutput>* outputs) override;
+
     // see IGraphicsBufferProducer::setMaxDequeuedBufferCount
     virtual status_t setMaxDequeuedBufferCount(int maxDequeuedBuffers);
 
@@ -92,6 +102,11 @@ public:
                                    uint64_t* outBufferAge,
                                    FrameEventHistoryDelta* outTimestamps) override;
 
+    // See IGraphicBufferProducer::dequeueBuffers. Consecutive buffers are dequeued under one
+    // mCore->mMutex, until one of them needs to be allocated.
+    status_t dequeueBuffers(const std::vector<DequeueBufferInput>& inputs,
+                            std::vector<DequeueBufferOutput>* outputs) override;
+
     // See IGraphicBufferProducer::detachBuffer
     virtual status_t detachBuffer(int slot);
 
@@ -120,6 +135,11 @@ public:
     virtual status_t queueBuffer(int slot,
             const QueueBufferInput& input, QueueBufferOutput* output);
 
+    // See IGraphicBufferProducer::queueBuffers. All the buffers are queued under one
+    // mCore->mMutex, then their consumer callbacks are made in order.
+    status_t queueBuffers(const std::vector<QueueBufferInput>& inputs,
+                          std::vector<QueueBufferOutput>* outputs) override;
+
     // cancelBuffer returns a dequeued buffer to the BufferQueue, but doesn't
     // queue it for use by the consumer.
     //
@@ -127,6 +147,10 @@ public:
     // will usually be the one obtained from dequeueBuffer.
     virtual status_t cancelBuffer(int slot, const sp<Fence>& fence);
 
+    // See IGraphicBufferProducer::cancelBuffers. Takes mCore->mMutex once for the batch.
+    status_t cancelBuffers(const std::vector<CancelBufferInput>& inputs,
+                           std::vector<status_t>* results) override;
+
     // Query native window attributes.  The "what" values are enumerated in
     // window.h (e.g. NATIVE_WINDOW_FORMAT).
     virtual int query(int what, int* outValue);
@@ -240,6 +264,62 @@ private:
     status_t waitForFreeSlotThenRelock(FreeSlotCaller caller, std::unique_lock<std::mutex>& lock,
             int* found) const;
 
+    // The single buffer operations are split around mCore->mMutex so that the batched ones can
+    // run the locked part of several buffers under one lock.
+    status_t requestBufferLocked(int slot, sp<GraphicBuffer>* buf);
+    status_t cancelBufferLocked(int slot, const sp<Fence>& fence,
+                                std::optional<uint64_t>* outCancelledBufferId);
+
+    // A dequeue between dequeueBufferLocked, which picks the slot, and finishDequeue, which
+    // allocates the buffer if needed and makes the callbacks without mCore->mMutex.
+    struct DequeueState {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        PixelFormat format = 0;
+        uint64_t usage = 0;
+
+        int slot = BufferItem::INVALID_BUFFER_SLOT;
+        sp<Fence> fence;
+        status_t flags = NO_ERROR;
+        uint64_t bufferAge = 0;
+        EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+        EGLSyncKHR eglFence = EGL_NO_SYNC_KHR;
+        bool attachedByConsumer = false;
+        sp<IConsumerListener> listener;
+        bool callOnFrameDequeued = false;
+        uint64_t bufferId = 0; // Only used if callOnFrameDequeued == true
+    };
+    status_t dequeueBufferLocked(std::unique_lock<std::mutex>& lock, DequeueState* state);
+    status_t finishDequeue(DequeueState* state, int* outSlot, sp<Fence>* outFence,
+                           uint64_t* outBufferAge, FrameEventHistoryDelta* outTimestamps);
+
+    // A queue between prepareQueue, which checks the input, queueBufferLocked, and finishQueue,
+    // which makes the consumer callbacks without mCore->mMutex.
+    struct QueueState {
+        int64_t requestedPresentTimestamp = 0;
+        bool isAutoTimestamp = false;
+        android_dataspace dataSpace = HAL_DATASPACE_UNKNOWN;
+        Rect crop = Rect::EMPTY_RECT;
+        int scalingMode = 0;
+        uint32_t transform = 0;
+        uint32_t stickyTransform = 0;
+        sp<Fence> acquireFence;
+        std::shared_ptr<FenceTime> acquireFenceTime;
+        bool getFrameTimestamps = false;
+
+        BufferItem item;
+        uint64_t currentFrameNumber = 0;
+        sp<IConsumerListener> frameAvailableListener;
+        sp<IConsumerListener> frameReplacedListener;
+        int callbackTicket = 0;
+        int connectedApi = 0;
+        sp<Fence> lastQueuedFence;
+    };
+    status_t prepareQueue(const QueueBufferInput& input, QueueState* state);
+    status_t queueBufferLocked(int slot, const QueueBufferInput& input, QueueState* state,
+                               QueueBufferOutput* output);
+    void finishQueue(QueueState* state, QueueBufferOutput* output);
+
     sp<BufferQueueCore> mCore;
 
     // This references mCore->mSlots. Lock mCore->mMutex while accessing.
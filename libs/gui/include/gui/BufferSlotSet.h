@@ -0,0 +1,169 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_GUI_BUFFERSLOTSET_H
+#define ANDROID_GUI_BUFFERSLOTSET_H
+
+#include <ui/BufferQueueDefs.h>
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+namespace android {
+
+// Containers of buffer slot numbers for BufferQueueCore. The slots are the fixed universe
+// [0, NUM_BUFFER_SLOTS), so membership fits in one 64 bit word, and nothing is allocated when
+// slots move between the free, active and unused lists on every dequeue and release.
+static_assert(BufferQueueDefs::NUM_BUFFER_SLOTS <= 64);
+
+// An ordered set of slots, iterated lowest first like the std::set<int> it replaces.
+class BufferSlotSet {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = int;
+
+        const_iterator() = default;
+        explicit const_iterator(uint64_t bits) : mBits(bits) {}
+
+        int operator*() const { return std::countr_zero(mBits); }
+        const_iterator& operator++() {
+            mBits &= mBits - 1;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+        bool operator==(const const_iterator& other) const { return mBits == other.mBits; }
+        bool operator!=(const const_iterator& other) const { return mBits != other.mBits; }
+
+    private:
+        // The slots not visited yet.
+        uint64_t mBits = 0;
+    };
+
+    const_iterator begin() const { return const_iterator(mBits); }
+    const_iterator end() const { return const_iterator(); }
+
+    bool empty() const { return mBits == 0; }
+    size_t size() const { return static_cast<size_t>(std::popcount(mBits)); }
+    size_t count(int slot) const { return (mBits >> slot) & 1; }
+
+    void insert(int slot) { mBits |= bit(slot); }
+    void erase(int slot) { mBits &= ~bit(slot); }
+    void erase(const_iterator it) { erase(*it); }
+    void clear() { mBits = 0; }
+
+private:
+    static uint64_t bit(int slot) { return uint64_t{1} << slot; }
+
+    uint64_t mBits = 0;
+};
+
+// A double ended queue of distinct slots, for the lists whose order decides which slot is
+// reused next. The order lives in a ring of slot numbers, and a BufferSlotSet answers count.
+class BufferSlotQueue {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = int;
+
+        const_iterator() = default;
+        const_iterator(const BufferSlotQueue* queue, size_t index)
+              : mQueue(queue), mIndex(index) {}
+
+        int operator*() const { return mQueue->at(mIndex); }
+        const_iterator& operator++() {
+            mIndex++;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+        bool operator==(const const_iterator& other) const { return mIndex == other.mIndex; }
+        bool operator!=(const const_iterator& other) const { return mIndex != other.mIndex; }
+
+    private:
+        const BufferSlotQueue* mQueue = nullptr;
+        // Position from the front of the queue.
+        size_t mIndex = 0;
+    };
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, mSize); }
+
+    bool empty() const { return mSize == 0; }
+    size_t size() const { return mSize; }
+    size_t count(int slot) const { return mMembers.count(slot); }
+
+    int front() const { return at(0); }
+    int back() const { return at(mSize - 1); }
+
+    void push_front(int slot) {
+        mHead = (mHead + kCapacity - 1) % kCapacity;
+        mRing[mHead] = static_cast<int8_t>(slot);
+        mSize++;
+        mMembers.insert(slot);
+    }
+    void push_back(int slot) {
+        mRing[(mHead + mSize) % kCapacity] = static_cast<int8_t>(slot);
+        mSize++;
+        mMembers.insert(slot);
+    }
+    void pop_front() {
+        mMembers.erase(front());
+        mHead = (mHead + 1) % kCapacity;
+        mSize--;
+    }
+    void pop_back() {
+        mMembers.erase(back());
+        mSize--;
+    }
+
+    void clear() {
+        mHead = 0;
+        mSize = 0;
+        mMembers.clear();
+    }
+
+private:
+    static constexpr size_t kCapacity = BufferQueueDefs::NUM_BUFFER_SLOTS;
+
+    int at(size_t index) const { return mRing[(mHead + index) % kCapacity]; }
+
+    int8_t mRing[kCapacity] = {};
+    size_t mHead = 0;
+    size_t mSize = 0;
+    BufferSlotSet mMembers;
+};
+
+} // namespace android
+
+#endif
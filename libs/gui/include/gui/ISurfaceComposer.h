@@ -200,6 +200,10 @@ public:
         CLEAR_BOOT_DISPLAY_MODE,       // Deprecated. Autogenerated by .aidl now.
         SET_OVERRIDE_FRAME_RATE,       // Deprecated. Autogenerated by .aidl now.
         GET_SCHEDULING_POLICY,
+        // Replies with the most compact layer_state_t::Encoding this SurfaceFlinger reads.
+        GET_LAYER_STATE_ENCODING,
+        // SET_TRANSACTION_STATE with layer_state_t::Encoding::COMPACT layer states.
+        SET_TRANSACTION_STATE_COMPACT,
         // Always append new enum to the end.
     };
 
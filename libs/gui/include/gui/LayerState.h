@@ -218,11 +218,20 @@ struct layer_state_t {
         eExtendedRangeBrightnessChanged = 0x10000'00000000,
     };
 
+    // How write and read lay out the fields. FULL writes every field and is understood by every
+    // peer. COMPACT only writes the fields flagged in |what|, and must only be sent to peers which
+    // advertise it, see ISurfaceComposer. A COMPACT read leaves the unflagged fields as they were,
+    // so read into a default constructed state.
+    enum class Encoding : uint32_t {
+        FULL = 0,
+        COMPACT = 1,
+    };
+
     layer_state_t();
 
     void merge(const layer_state_t& other);
-    status_t write(Parcel& output) const;
-    status_t read(const Parcel& input);
+    status_t write(Parcel& output, Encoding encoding = Encoding::FULL) const;
+    status_t read(const Parcel& input, Encoding encoding = Encoding::FULL);
     // Compares two layer_state_t structs and returns a set of change flags describing all the
     // states that are different.
     uint64_t diff(const layer_state_t& other) const;
@@ -410,13 +419,19 @@ struct layer_state_t {
 
     TrustedPresentationThresholds trustedPresentationThresholds;
     TrustedPresentationListener trustedPresentationListener;
+
+private:
+    status_t writeCompact(Parcel& output) const;
+    status_t readCompact(const Parcel& input);
 };
 
 class ComposerState {
 public:
     layer_state_t state;
-    status_t write(Parcel& output) const;
-    status_t read(const Parcel& input);
+    status_t write(Parcel& output,
+                   layer_state_t::Encoding encoding = layer_state_t::Encoding::FULL) const;
+    status_t read(const Parcel& input,
+                  layer_state_t::Encoding encoding = layer_state_t::Encoding::FULL);
 };
 
 struct DisplayState {
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MockConsumer.h"
+
+#include <gui/BufferItem.h>
+#include <gui/BufferQueue.h>
+#include <gui/IProducerListener.h>
+#include <system/window.h>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+
+namespace android {
+namespace {
+
+const IGraphicBufferProducer::QueueBufferInput kQueueInput(0, false, HAL_DATASPACE_UNKNOWN,
+                                                           Rect(0, 0, 1, 1),
+                                                           NATIVE_WINDOW_SCALING_MODE_FREEZE, 0,
+                                                           Fence::NO_FENCE);
+
+// A connected queue whose buffers are already allocated, so the loops below only measure the
+// slot bookkeeping of BufferQueueCore and not gralloc.
+class Queue {
+public:
+    explicit Queue(int maxDequeuedBuffers) {
+        BufferQueue::createBufferQueue(&mProducer, &mConsumer);
+        mConsumer->consumerConnect(sp<MockConsumer>::make(), false);
+        IGraphicBufferProducer::QueueBufferOutput output;
+        mProducer->connect(sp<StubProducerListener>::make(), NATIVE_WINDOW_API_CPU, false,
+                           &output);
+        mProducer->setMaxDequeuedBufferCount(maxDequeuedBuffers);
+        mProducer->allowAllocation(true);
+        mProducer->allocateBuffers(1, 1, HAL_PIXEL_FORMAT_RGBA_8888, GRALLOC_USAGE_SW_READ_OFTEN);
+    }
+
+    bool produce() {
+        int slot;
+        sp<Fence> fence;
+        const status_t result =
+                mProducer->dequeueBuffer(&slot, &fence, 1, 1, HAL_PIXEL_FORMAT_RGBA_8888,
+                                         GRALLOC_USAGE_SW_READ_OFTEN, nullptr, nullptr);
+        if (result < 0) {
+            return false;
+        }
+        if (result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+            sp<GraphicBuffer> buffer;
+            mProducer->requestBuffer(slot, &buffer);
+        }
+        IGraphicBufferProducer::QueueBufferOutput output;
+        return mProducer->queueBuffer(slot, kQueueInput, &output) == OK;
+    }
+
+    bool consume() {
+        BufferItem item;
+        if (mConsumer->acquireBuffer(&item, 0) != OK) {
+            return false;
+        }
+        return mConsumer->releaseHelper(item.mSlot, item.mFrameNumber, Fence::NO_FENCE) == OK;
+    }
+
+    const sp<IGraphicBufferProducer>& producer() const { return mProducer; }
+
+private:
+    sp<IGraphicBufferProducer> mProducer;
+    sp<IGraphicBufferConsumer> mConsumer;
+};
+
+// One frame at a time from the same thread, the cost of a frame without contention.
+void BM_DequeueQueueAcquireRelease(benchmark::State& state) {
+    Queue queue(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        if (!queue.produce() || !queue.consume()) {
+            state.SkipWithError("BufferQueue failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DequeueQueueAcquireRelease)->Arg(2)->Arg(8)->Arg(32);
+
+// A producer thread feeding the benchmark thread, like an app rendering to a consumer in
+// another thread. The producer blocks in dequeueBuffer while every buffer is queued.
+void BM_ProducerConsumerThroughput(benchmark::State& state) {
+    constexpr int kFrames = 1000;
+    Queue queue(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        std::atomic<bool> failed = false;
+        std::thread producer([&queue, &failed]() {
+            for (int i = 0; i < kFrames; i++) {
+                if (!queue.produce()) {
+                    failed = true;
+                    return;
+                }
+            }
+        });
+        int consumed = 0;
+        while (consumed < kFrames && !failed) {
+            if (queue.consume()) {
+                consumed++;
+            }
+        }
+        producer.join();
+        if (failed) {
+            state.SkipWithError("BufferQueue failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kFrames);
+}
+BENCHMARK(BM_ProducerConsumerThroughput)->Arg(2)->Arg(8)->Arg(32)->UseRealTime();
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
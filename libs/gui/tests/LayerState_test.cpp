@@ -0,0 +1,112 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <binder/Parcel.h>
+
+#include <gui/LayerState.h>
+
+namespace android {
+
+namespace test {
+
+using Encoding = layer_state_t::Encoding;
+
+TEST(LayerState, CompactParcellingOnlyWritesChangedFields) {
+    layer_state_t s;
+    s.layerId = 42;
+    s.what = layer_state_t::ePositionChanged | layer_state_t::eAlphaChanged |
+            layer_state_t::eCornerRadiusChanged | layer_state_t::eBlurRegionsChanged;
+    s.x = 12.f;
+    s.y = 34.f;
+    s.color.a = 0.5f;
+    s.cornerRadius = 8.f;
+    s.blurRegions.push_back(BlurRegion{.blurRadius = 3, .left = 1, .top = 2, .right = 3,
+                                       .bottom = 4});
+    // Not flagged, so not sent.
+    s.z = 7;
+    s.crop = Rect(0, 0, 10, 10);
+
+    Parcel compact;
+    ASSERT_EQ(OK, s.write(compact, Encoding::COMPACT));
+    Parcel full;
+    ASSERT_EQ(OK, s.write(full));
+    EXPECT_LT(compact.dataSize(), full.dataSize() / 4);
+
+    compact.setDataPosition(0);
+    layer_state_t s2;
+    ASSERT_EQ(OK, s2.read(compact, Encoding::COMPACT));
+    EXPECT_EQ(compact.dataSize(), compact.dataPosition());
+    EXPECT_EQ(42, s2.layerId);
+    EXPECT_EQ(s.what, s2.what);
+    EXPECT_EQ(12.f, s2.x);
+    EXPECT_EQ(34.f, s2.y);
+    EXPECT_EQ(0.5f, s2.color.a);
+    EXPECT_EQ(8.f, s2.cornerRadius);
+    ASSERT_EQ(1u, s2.blurRegions.size());
+    EXPECT_EQ(3u, s2.blurRegions[0].blurRadius);
+    EXPECT_EQ(4, s2.blurRegions[0].bottom);
+
+    const layer_state_t defaults;
+    EXPECT_EQ(defaults.z, s2.z);
+    EXPECT_EQ(defaults.crop, s2.crop);
+}
+
+TEST(LayerState, CompactAndFullParcellingAgreeOnChangedFields) {
+    layer_state_t s;
+    s.what = layer_state_t::eLayerChanged | layer_state_t::eFlagsChanged |
+            layer_state_t::eMatrixChanged | layer_state_t::eCropChanged |
+            layer_state_t::eColorChanged | layer_state_t::eRenderBorderChanged |
+            layer_state_t::eFrameRateChanged | layer_state_t::eExtendedRangeBrightnessChanged |
+            layer_state_t::eCachingHintChanged | layer_state_t::eProducerDisconnect;
+    s.z = -3;
+    s.flags = layer_state_t::eLayerHidden;
+    s.mask = layer_state_t::eLayerHidden | layer_state_t::eLayerOpaque;
+    s.matrix.dsdx = 2.f;
+    s.crop = Rect(1, 2, 3, 4);
+    s.color.rgb = half3(0.25f, 0.5f, 0.75f);
+    s.borderEnabled = true;
+    s.borderWidth = 2.f;
+    s.frameRate = 60.f;
+    s.frameRateCompatibility = ANATIVEWINDOW_FRAME_RATE_EXACT;
+    s.currentHdrSdrRatio = 2.f;
+    s.desiredHdrSdrRatio = 4.f;
+    s.cachingHint = gui::CachingHint::Disabled;
+
+    for (const Encoding encoding : {Encoding::FULL, Encoding::COMPACT}) {
+        Parcel p;
+        ASSERT_EQ(OK, s.write(p, encoding));
+        p.setDataPosition(0);
+        layer_state_t s2;
+        ASSERT_EQ(OK, s2.read(p, encoding));
+        EXPECT_EQ(s.what, s2.what);
+        EXPECT_EQ(s.z, s2.z);
+        EXPECT_EQ(s.flags, s2.flags);
+        EXPECT_EQ(s.mask, s2.mask);
+        EXPECT_EQ(s.crop, s2.crop);
+        EXPECT_EQ(s.color, s2.color);
+        EXPECT_EQ(s.borderWidth, s2.borderWidth);
+        EXPECT_EQ(s.frameRateCompatibility, s2.frameRateCompatibility);
+        EXPECT_EQ(s.currentHdrSdrRatio, s2.currentHdrSdrRatio);
+        EXPECT_EQ(s.desiredHdrSdrRatio, s2.desiredHdrSdrRatio);
+        EXPECT_EQ(s.cachingHint, s2.cachingHint);
+    }
+}
+
+} // namespace test
+
+} // namespace android
@@ -0,0 +1,241 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "InputMessageRing"
+
+#include <input/InputMessageRing.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+
+#include <input/InputTransport.h>
+#include <log/log.h>
+
+namespace android {
+
+namespace {
+
+constexpr uint32_t RING_MAGIC = 0x494d5231; // "IMR1"
+
+// The shared memory must not be resized by the peer after it has been mapped, otherwise accessing
+// it could fault.
+constexpr int REQUIRED_SEALS = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+
+bool isValidCapacity(size_t capacity) {
+    return capacity > 0 && capacity <= InputMessageRing::MAX_CAPACITY &&
+            (capacity & (capacity - 1)) == 0;
+}
+
+// The indices are free-running and wrap around. libinput is built with the integer sanitizer, so
+// the wrapping has to be explicit.
+uint32_t wrappingAdd(uint32_t a, uint32_t b) {
+    uint32_t result;
+    __builtin_add_overflow(a, b, &result);
+    return result;
+}
+
+uint32_t wrappingSub(uint32_t a, uint32_t b) {
+    uint32_t result;
+    __builtin_sub_overflow(a, b, &result);
+    return result;
+}
+
+size_t directionIndex(InputMessageRing::Direction direction) {
+    return direction == InputMessageRing::Direction::SERVER_TO_CLIENT ? 0 : 1;
+}
+
+} // namespace
+
+// Layout of the shared memory. Each index is on its own cache line, so that the producer and the
+// consumer of a ring do not contend on the same line. The slots follow the header, first those of
+// the server to client ring, then those of the client to server ring.
+struct InputMessageRing::SharedMemory {
+    struct alignas(64) Index {
+        std::atomic<uint32_t> value;
+    };
+    struct Ring {
+        Index head;
+        Index tail;
+    };
+
+    alignas(64) uint32_t magic;
+    uint32_t capacity;
+    Ring rings[2];
+
+    static_assert(std::atomic<uint32_t>::is_always_lock_free,
+                  "indices are shared between processes and must be lock free");
+
+    static size_t sizeFor(size_t capacity) {
+        return sizeof(SharedMemory) + 2 * capacity * sizeof(InputMessage);
+    }
+};
+
+std::shared_ptr<InputMessageRing> InputMessageRing::create(const std::string& name,
+                                                           size_t capacity) {
+    if (!isValidCapacity(capacity)) {
+        ALOGE("Invalid capacity %zu for ring '%s'", capacity, name.c_str());
+        return nullptr;
+    }
+    android::base::unique_fd fd(memfd_create(name.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    if (!fd.ok()) {
+        ALOGE("memfd_create(%s) failed: %s", name.c_str(), strerror(errno));
+        return nullptr;
+    }
+    const size_t size = SharedMemory::sizeFor(capacity);
+    if (ftruncate(fd.get(), size) == -1) {
+        ALOGE("ftruncate(%s, %zu) failed: %s", name.c_str(), size, strerror(errno));
+        return nullptr;
+    }
+    if (fcntl(fd.get(), F_ADD_SEALS, REQUIRED_SEALS) == -1) {
+        ALOGE("Sealing ring '%s' failed: %s", name.c_str(), strerror(errno));
+        return nullptr;
+    }
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (memory == MAP_FAILED) {
+        ALOGE("mmap of ring '%s' failed: %s", name.c_str(), strerror(errno));
+        return nullptr;
+    }
+
+    // The memory of a new memfd is zeroed, so only the header needs to be filled in.
+    SharedMemory* shared = static_cast<SharedMemory*>(memory);
+    shared->magic = RING_MAGIC;
+    shared->capacity = capacity;
+    // using 'new' to access a non-public constructor
+    return std::shared_ptr<InputMessageRing>(
+            new InputMessageRing(std::move(fd), memory, size, capacity));
+}
+
+std::shared_ptr<InputMessageRing> InputMessageRing::map(android::base::unique_fd fd) {
+    const int seals = fcntl(fd.get(), F_GET_SEALS);
+    if (seals == -1 || (seals & REQUIRED_SEALS) != REQUIRED_SEALS) {
+        ALOGE("Ring memory is not sealed (seals=0x%x): %s", seals, strerror(errno));
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd.get(), &st) == -1 || size_t(st.st_size) < sizeof(SharedMemory)) {
+        ALOGE("Ring memory is too small");
+        return nullptr;
+    }
+    const size_t size = st.st_size;
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (memory == MAP_FAILED) {
+        ALOGE("mmap of ring failed: %s", strerror(errno));
+        return nullptr;
+    }
+
+    const SharedMemory* shared = static_cast<const SharedMemory*>(memory);
+    const size_t capacity = shared->capacity;
+    if (shared->magic != RING_MAGIC || !isValidCapacity(capacity) ||
+        SharedMemory::sizeFor(capacity) != size) {
+        ALOGE("Invalid ring header: magic=0x%" PRIx32 " capacity=%zu size=%zu", shared->magic,
+              capacity, size);
+        munmap(memory, size);
+        return nullptr;
+    }
+    // using 'new' to access a non-public constructor
+    return std::shared_ptr<InputMessageRing>(
+            new InputMessageRing(std::move(fd), memory, size, capacity));
+}
+
+InputMessageRing::InputMessageRing(android::base::unique_fd fd, void* memory, size_t size,
+                                   size_t capacity)
+      : mFd(std::move(fd)),
+        mShared(static_cast<SharedMemory*>(memory)),
+        mSize(size),
+        mCapacity(capacity) {
+    std::scoped_lock lock(mLock);
+    for (size_t i = 0; i < 2; i++) {
+        mHead[i] = mShared->rings[i].head.value.load();
+        mTail[i] = mShared->rings[i].tail.value.load();
+    }
+}
+
+InputMessageRing::~InputMessageRing() {
+    munmap(mShared, mSize);
+}
+
+InputMessage* InputMessageRing::getSlot(Direction direction, uint32_t index) const {
+    InputMessage* slots = reinterpret_cast<InputMessage*>(mShared + 1);
+    return &slots[directionIndex(direction) * mCapacity + (index & (mCapacity - 1))];
+}
+
+status_t InputMessageRing::push(Direction direction, const InputMessage& msg, bool* outWasEmpty) {
+    const size_t d = directionIndex(direction);
+    SharedMemory::Ring& ring = mShared->rings[d];
+    std::scoped_lock lock(mLock);
+
+    const uint32_t head = mHead[d];
+    const uint32_t used = wrappingSub(head, ring.tail.value.load());
+    if (used > mCapacity) {
+        ALOGE("Ring is corrupted: head=%" PRIu32 " used=%" PRIu32, head, used);
+        return BAD_VALUE;
+    }
+    if (used == mCapacity) {
+        return WOULD_BLOCK;
+    }
+
+    memcpy(getSlot(direction, head), &msg, msg.size());
+    mHead[d] = wrappingAdd(head, 1);
+    ring.head.value.store(mHead[d]);
+
+    // Both this load and the consumer's store of the tail are sequentially consistent with the
+    // stores of the head, so either the consumer sees the new message before it stops, or this
+    // sees that the consumer has taken everything before it and may be waiting for a wakeup.
+    *outWasEmpty = ring.tail.value.load() == head;
+    return OK;
+}
+
+status_t InputMessageRing::pop(Direction direction, InputMessage* msg) {
+    const size_t d = directionIndex(direction);
+    SharedMemory::Ring& ring = mShared->rings[d];
+    std::scoped_lock lock(mLock);
+
+    const uint32_t tail = mTail[d];
+    const uint32_t available = wrappingSub(ring.head.value.load(), tail);
+    if (available > mCapacity) {
+        ALOGE("Ring is corrupted: tail=%" PRIu32 " available=%" PRIu32, tail, available);
+        return BAD_VALUE;
+    }
+    if (available == 0) {
+        return WOULD_BLOCK;
+    }
+
+    // The slot can still be written by the peer, so the message is only checked once it has been
+    // copied out.
+    memcpy(msg, getSlot(direction, tail), sizeof(InputMessage));
+    mTail[d] = wrappingAdd(tail, 1);
+    ring.tail.value.store(mTail[d]);
+
+    if (!msg->isValid(msg->size())) {
+        return BAD_VALUE;
+    }
+    return OK;
+}
+
+bool InputMessageRing::hasMessages(Direction direction) const {
+    const size_t d = directionIndex(direction);
+    std::scoped_lock lock(mLock);
+    return mShared->rings[d].head.value.load() != mTail[d];
+}
+
+} // namespace android
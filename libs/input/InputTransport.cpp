@@ -123,6 +123,9 @@ namespace android {
 // behind processing touches.
 static const size_t SOCKET_BUFFER_SIZE = 32 * 1024;
 
+// Maximum number of messages read from the channel by a single system call in InputConsumer.
+static const size_t CONSUMER_RECEIVE_BATCH_SIZE = 8;
+
 // Nanoseconds per milliseconds.
 static const nsecs_t NANOS_PER_MS = 1000000;
 
@@ -399,7 +402,9 @@ void InputMessage::getSanitizedCopy(InputMessage* msg) const {
 // --- InputChannel ---
 
 std::unique_ptr<InputChannel> InputChannel::create(const std::string& name,
-                                                   android::base::unique_fd fd, sp<IBinder> token) {
+                                                   android::base::unique_fd fd, sp<IBinder> token,
+                                                   std::shared_ptr<InputMessageRing> ring,
+                                                   bool ringServerSide) {
     const int result = fcntl(fd, F_SETFL, O_NONBLOCK);
     if (result != 0) {
         LOG_ALWAYS_FATAL("channel '%s' ~ Could not make socket non-blocking: %s", name.c_str(),
@@ -407,19 +412,35 @@ std::unique_ptr<InputChannel> InputChannel::create(const std::string& name,
         return nullptr;
     }
     // using 'new' to access a non-public constructor
-    return std::unique_ptr<InputChannel>(new InputChannel(name, std::move(fd), token));
+    return std::unique_ptr<InputChannel>(
+            new InputChannel(name, std::move(fd), token, std::move(ring), ringServerSide));
 }
 
 std::unique_ptr<InputChannel> InputChannel::create(
         android::os::InputChannelCore&& parceledChannel) {
+    std::shared_ptr<InputMessageRing> ring;
+    if (parceledChannel.messageRing) {
+        ring = InputMessageRing::map(parceledChannel.messageRing->release());
+        if (ring == nullptr) {
+            ALOGE("channel '%s' ~ Could not map the message ring", parceledChannel.name.c_str());
+            return nullptr;
+        }
+    }
     return InputChannel::create(parceledChannel.name, parceledChannel.fd.release(),
-                                parceledChannel.token);
+                                parceledChannel.token, std::move(ring),
+                                parceledChannel.messageRingServerSide);
 }
 
-InputChannel::InputChannel(const std::string name, android::base::unique_fd fd, sp<IBinder> token) {
+InputChannel::InputChannel(const std::string name, android::base::unique_fd fd, sp<IBinder> token,
+                           std::shared_ptr<InputMessageRing> ring, bool ringServerSide)
+      : mRing(std::move(ring)) {
     this->name = std::move(name);
     this->fd.reset(std::move(fd));
     this->token = std::move(token);
+    if (!ringServerSide) {
+        mSendDirection = InputMessageRing::Direction::CLIENT_TO_SERVER;
+        mReceiveDirection = InputMessageRing::Direction::SERVER_TO_CLIENT;
+    }
     ALOGD_IF(DEBUG_CHANNEL_LIFECYCLE, "Input channel constructed: name='%s', fd=%d",
              getName().c_str(), getFd());
 }
@@ -431,7 +452,18 @@ InputChannel::~InputChannel() {
 
 status_t InputChannel::openInputChannelPair(const std::string& name,
                                             std::unique_ptr<InputChannel>& outServerChannel,
-                                            std::unique_ptr<InputChannel>& outClientChannel) {
+                                            std::unique_ptr<InputChannel>& outClientChannel,
+                                            Transport transport) {
+    std::shared_ptr<InputMessageRing> ring;
+    if (transport == Transport::SHARED_MEMORY_RING) {
+        ring = InputMessageRing::create(name, InputMessageRing::DEFAULT_CAPACITY);
+        if (ring == nullptr) {
+            outServerChannel.reset();
+            outClientChannel.reset();
+            return NO_MEMORY;
+        }
+    }
+
     int sockets[2];
     if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sockets)) {
         status_t result = -errno;
@@ -452,11 +484,13 @@ status_t InputChannel::openInputChannelPair(const std::string& name,
 
     std::string serverChannelName = name + " (server)";
     android::base::unique_fd serverFd(sockets[0]);
-    outServerChannel = InputChannel::create(serverChannelName, std::move(serverFd), token);
+    outServerChannel = InputChannel::create(serverChannelName, std::move(serverFd), token, ring,
+                                            /*ringServerSide=*/true);
 
     std::string clientChannelName = name + " (client)";
     android::base::unique_fd clientFd(sockets[1]);
-    outClientChannel = InputChannel::create(clientChannelName, std::move(clientFd), token);
+    outClientChannel = InputChannel::create(clientChannelName, std::move(clientFd), token, ring,
+                                            /*ringServerSide=*/false);
     return OK;
 }
 
@@ -468,6 +502,9 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
     const size_t msgLength = msg->size();
     InputMessage cleanMsg;
     msg->getSanitizedCopy(&cleanMsg);
+    if (mRing != nullptr) {
+        return sendMessageToRing(cleanMsg);
+    }
     ssize_t nWrite;
     do {
         nWrite = ::send(getFd(), &cleanMsg, msgLength, MSG_DONTWAIT | MSG_NOSIGNAL);
@@ -500,6 +537,12 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
 }
 
 status_t InputChannel::receiveMessage(InputMessage* msg) {
+    if (mPendingReceiveError != OK) {
+        return std::exchange(mPendingReceiveError, OK);
+    }
+    if (mRing != nullptr) {
+        return receiveMessageFromRing(msg);
+    }
     ssize_t nRead;
     do {
         nRead = ::recv(getFd(), msg, sizeof(InputMessage), MSG_DONTWAIT);
@@ -541,7 +584,263 @@ status_t InputChannel::receiveMessage(InputMessage* msg) {
     return OK;
 }
 
+status_t InputChannel::sendMessages(const InputMessage* msgs, size_t count, size_t* outSent) {
+    *outSent = 0;
+    if (count == 0) {
+        return OK;
+    }
+    ATRACE_NAME_IF(ATRACE_ENABLED(),
+                   StringPrintf("sendMessages(inputChannel=%s, count=%zu)", name.c_str(), count));
+    if (mRing != nullptr) {
+        // Each message is a copy into shared memory, and at most one wakeup is sent for all of
+        // them, so there is no system call to batch.
+        for (size_t i = 0; i < count; i++) {
+            InputMessage cleanMsg;
+            msgs[i].getSanitizedCopy(&cleanMsg);
+            const status_t status = sendMessageToRing(cleanMsg);
+            if (status != OK) {
+                return status;
+            }
+            *outSent = i + 1;
+        }
+        return OK;
+    }
+    std::vector<InputMessage> cleanMsgs(count);
+    std::vector<iovec> iovecs(count);
+    std::vector<mmsghdr> headers(count);
+    for (size_t i = 0; i < count; i++) {
+        msgs[i].getSanitizedCopy(&cleanMsgs[i]);
+        iovecs[i] = {.iov_base = &cleanMsgs[i], .iov_len = msgs[i].size()};
+        headers[i] = {};
+        headers[i].msg_hdr.msg_iov = &iovecs[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int nSent;
+    do {
+        nSent = ::sendmmsg(getFd(), headers.data(), count, MSG_DONTWAIT | MSG_NOSIGNAL);
+    } while (nSent == -1 && errno == EINTR);
+
+    if (nSent < 0) {
+        int error = errno;
+        ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ error sending %zu messages, %s",
+                 name.c_str(), count, strerror(error));
+        if (error == EAGAIN || error == EWOULDBLOCK) {
+            return WOULD_BLOCK;
+        }
+        if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED || error == ECONNRESET) {
+            return DEAD_OBJECT;
+        }
+        return -error;
+    }
+
+    for (int i = 0; i < nSent; i++) {
+        if (headers[i].msg_len != iovecs[i].iov_len) {
+            ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                     "channel '%s' ~ error sending message type %s, send was incomplete",
+                     name.c_str(), ftl::enum_string(msgs[i].header.type).c_str());
+            *outSent = i;
+            return DEAD_OBJECT;
+        }
+    }
+    *outSent = nSent;
+
+    ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ sent %d of %zu messages", name.c_str(),
+             nSent, count);
+    return size_t(nSent) == count ? OK : WOULD_BLOCK;
+}
+
+status_t InputChannel::receiveMessages(InputMessage* msgs, size_t count, size_t* outReceived) {
+    *outReceived = 0;
+    if (count == 0) {
+        return OK;
+    }
+    if (mPendingReceiveError != OK) {
+        return std::exchange(mPendingReceiveError, OK);
+    }
+    if (mRing != nullptr) {
+        for (size_t i = 0; i < count; i++) {
+            const status_t status = receiveMessageFromRing(&msgs[i]);
+            if (status != OK) {
+                if (i == 0) {
+                    return status;
+                }
+                // Like a short read from the socket, running out of messages after the first one
+                // is not an error. Any other error is reported by the next call.
+                if (status != WOULD_BLOCK) {
+                    mPendingReceiveError = status;
+                }
+                return OK;
+            }
+            *outReceived = i + 1;
+        }
+        return OK;
+    }
+    std::vector<iovec> iovecs(count);
+    std::vector<mmsghdr> headers(count);
+    for (size_t i = 0; i < count; i++) {
+        iovecs[i] = {.iov_base = &msgs[i], .iov_len = sizeof(InputMessage)};
+        headers[i] = {};
+        headers[i].msg_hdr.msg_iov = &iovecs[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int nRead;
+    do {
+        nRead = ::recvmmsg(getFd(), headers.data(), count, MSG_DONTWAIT, /*timeout=*/nullptr);
+    } while (nRead == -1 && errno == EINTR);
+
+    if (nRead < 0) {
+        int error = errno;
+        ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ receive messages failed, errno=%d",
+                 name.c_str(), errno);
+        if (error == EAGAIN || error == EWOULDBLOCK) {
+            return WOULD_BLOCK;
+        }
+        if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED) {
+            return DEAD_OBJECT;
+        }
+        return -error;
+    }
+
+    for (int i = 0; i < nRead; i++) {
+        if (headers[i].msg_len == 0) { // check for EOF
+            ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                     "channel '%s' ~ receive message failed because peer was closed",
+                     name.c_str());
+            *outReceived = i;
+            return i > 0 ? OK : DEAD_OBJECT;
+        }
+        if (!msgs[i].isValid(headers[i].msg_len)) {
+            ALOGE("channel '%s' ~ received invalid message of size %u", name.c_str(),
+                  headers[i].msg_len);
+            // The messages before the invalid one are delivered first. The ones after it are
+            // dropped along with it.
+            *outReceived = i;
+            if (i == 0) {
+                return BAD_VALUE;
+            }
+            mPendingReceiveError = BAD_VALUE;
+            return OK;
+        }
+    }
+    *outReceived = nRead;
+
+    ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ received %d messages", name.c_str(), nRead);
+    if (ATRACE_ENABLED()) {
+        std::string message =
+                StringPrintf("receiveMessages(inputChannel=%s, count=%d, firstSeq=0x%" PRIx32 ")",
+                             name.c_str(), nRead, msgs[0].header.seq);
+        ATRACE_NAME(message.c_str());
+    }
+    return OK;
+}
+
+status_t InputChannel::sendMessageToRing(const InputMessage& msg) {
+    bool wasEmpty = false;
+    status_t status = mRing->push(mSendDirection, msg, &wasEmpty);
+    if (status == WOULD_BLOCK) {
+        // The ring is full. Check for a dead peer, which would otherwise never free any slots.
+        struct pollfd pfds = {.fd = fd.get(), .events = 0};
+        if (::poll(&pfds, /*nfds=*/1, /*timeout=*/0) > 0 && (pfds.revents & POLLHUP) != 0) {
+            return DEAD_OBJECT;
+        }
+        return WOULD_BLOCK;
+    }
+    if (status != OK) {
+        ALOGE("channel '%s' ~ could not write to the message ring, status=%s", name.c_str(),
+              statusToString(status).c_str());
+        return status;
+    }
+    if (!wasEmpty) {
+        // The consumer has not seen the ring empty since the last wakeup, so it is still going to
+        // read this message.
+        ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ sent message of type %s", name.c_str(),
+                 ftl::enum_string(msg.header.type).c_str());
+        return OK;
+    }
+
+    const uint8_t wakeup = 0;
+    ssize_t nWrite;
+    do {
+        nWrite = ::send(getFd(), &wakeup, sizeof(wakeup), MSG_DONTWAIT | MSG_NOSIGNAL);
+    } while (nWrite == -1 && errno == EINTR);
+    if (nWrite < 0) {
+        const int error = errno;
+        if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED || error == ECONNRESET) {
+            return DEAD_OBJECT;
+        }
+        // If the socket is full of wakeups, the consumer is going to wake up anyway.
+        if (error != EAGAIN && error != EWOULDBLOCK) {
+            return -error;
+        }
+    }
+    ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ sent message of type %s", name.c_str(),
+             ftl::enum_string(msg.header.type).c_str());
+    return OK;
+}
+
+status_t InputChannel::receiveMessageFromRing(InputMessage* msg) {
+    status_t status = mRing->pop(mReceiveDirection, msg);
+    if (status == WOULD_BLOCK) {
+        // Consume the wakeups before looking at the ring again, so that a message that arrives in
+        // between comes with a new wakeup rather than being missed.
+        const status_t wakeupStatus = drainWakeups();
+        status = mRing->pop(mReceiveDirection, msg);
+        if (status == WOULD_BLOCK && wakeupStatus != OK) {
+            return wakeupStatus;
+        }
+    }
+    if (status == BAD_VALUE) {
+        ALOGE("channel '%s' ~ received invalid message from the message ring", name.c_str());
+        return BAD_VALUE;
+    }
+    if (status != OK) {
+        return status;
+    }
+
+    ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ received message of type %s", name.c_str(),
+             ftl::enum_string(msg->header.type).c_str());
+    if (ATRACE_ENABLED()) {
+        std::string message = StringPrintf("receiveMessage(inputChannel=%s, seq=0x%" PRIx32
+                                           ", type=0x%" PRIx32 ")",
+                                           name.c_str(), msg->header.seq, msg->header.type);
+        ATRACE_NAME(message.c_str());
+    }
+    return OK;
+}
+
+status_t InputChannel::drainWakeups() {
+    uint8_t buffer[16];
+    while (true) {
+        const ssize_t nRead = ::recv(getFd(), buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (nRead > 0) {
+            continue;
+        }
+        if (nRead == 0) { // check for EOF
+            ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                     "channel '%s' ~ receive message failed because peer was closed",
+                     name.c_str());
+            return DEAD_OBJECT;
+        }
+        const int error = errno;
+        if (error == EINTR) {
+            continue;
+        }
+        if (error == EAGAIN || error == EWOULDBLOCK) {
+            return OK;
+        }
+        if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED) {
+            return DEAD_OBJECT;
+        }
+        return -error;
+    }
+}
+
 bool InputChannel::probablyHasInput() const {
+    if (mRing != nullptr && mRing->hasMessages(mReceiveDirection)) {
+        return true;
+    }
     struct pollfd pfds = {.fd = fd.get(), .events = POLLIN};
     if (::poll(&pfds, /*nfds=*/1, /*timeout=*/0) <= 0) {
         // This can be a false negative because EINTR and ENOMEM are not handled. The latter should
@@ -561,6 +860,9 @@ void InputChannel::waitForMessage(std::chrono::milliseconds timeout) const {
     if (timeout < 0ms) {
         LOG(FATAL) << "Timeout cannot be negative, received " << timeout.count();
     }
+    if (mRing != nullptr && mRing->hasMessages(mReceiveDirection)) {
+        return;
+    }
     struct pollfd pfds = {.fd = fd.get(), .events = POLLIN};
     int ret;
     std::chrono::time_point<std::chrono::steady_clock> stopTime =
@@ -575,22 +877,34 @@ void InputChannel::waitForMessage(std::chrono::milliseconds timeout) const {
 
 std::unique_ptr<InputChannel> InputChannel::dup() const {
     base::unique_fd newFd(dupChannelFd(fd.get()));
-    return InputChannel::create(getName(), std::move(newFd), getConnectionToken());
+    return InputChannel::create(getName(), std::move(newFd), getConnectionToken(), mRing,
+                                mSendDirection == InputMessageRing::Direction::SERVER_TO_CLIENT);
 }
 
 void InputChannel::copyTo(android::os::InputChannelCore& outChannel) const {
     outChannel.name = getName();
     outChannel.fd.reset(dupChannelFd(fd.get()));
     outChannel.token = getConnectionToken();
+    copyRingTo(outChannel);
 }
 
 void InputChannel::moveChannel(std::unique_ptr<InputChannel> from,
                                android::os::InputChannelCore& outChannel) {
+    from->copyRingTo(outChannel);
     outChannel.name = from->getName();
     outChannel.fd = android::os::ParcelFileDescriptor(std::move(from->fd));
     outChannel.token = from->getConnectionToken();
 }
 
+void InputChannel::copyRingTo(android::os::InputChannelCore& outChannel) const {
+    outChannel.messageRing.reset();
+    if (mRing != nullptr) {
+        outChannel.messageRing.emplace(dupChannelFd(mRing->getFd()));
+    }
+    outChannel.messageRingServerSide =
+            mSendDirection == InputMessageRing::Direction::SERVER_TO_CLIENT;
+}
+
 sp<IBinder> InputChannel::getConnectionToken() const {
     return token;
 }
@@ -845,7 +1159,11 @@ InputConsumer::InputConsumer(const std::shared_ptr<InputChannel>& channel)
 
 InputConsumer::InputConsumer(const std::shared_ptr<InputChannel>& channel,
                              bool enableTouchResampling)
-      : mResampleTouch(enableTouchResampling), mChannel(channel), mMsgDeferred(false) {}
+      : mResampleTouch(enableTouchResampling),
+        mChannel(channel),
+        mMsgDeferred(false),
+        mReceiveBufferHead(0),
+        mReceiveBufferCount(0) {}
 
 InputConsumer::~InputConsumer() {
 }
@@ -872,7 +1190,7 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
             mMsgDeferred = false;
         } else {
             // Receive a fresh message.
-            status_t result = mChannel->receiveMessage(&mMsg);
+            status_t result = receiveMessage(&mMsg);
             if (result == OK) {
                 const auto [_, inserted] =
                         mConsumeTimes.emplace(mMsg.header.seq, systemTime(SYSTEM_TIME_MONOTONIC));
@@ -1027,6 +1345,28 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
     return OK;
 }
 
+status_t InputConsumer::receiveMessage(InputMessage* msg) {
+    if (mReceiveBufferCount == 0) {
+        if (mReceiveBuffer.empty()) {
+            mReceiveBuffer.resize(CONSUMER_RECEIVE_BATCH_SIZE);
+        }
+        size_t received;
+        status_t result =
+                mChannel->receiveMessages(mReceiveBuffer.data(), mReceiveBuffer.size(), &received);
+        if (result != OK) {
+            return result;
+        }
+        mReceiveBufferHead = 0;
+        mReceiveBufferCount = received;
+    }
+    // Only the valid part of a message is copied, as when it is read from the socket.
+    const InputMessage& next = mReceiveBuffer[mReceiveBufferHead];
+    memcpy(msg, &next, next.size());
+    mReceiveBufferHead++;
+    mReceiveBufferCount--;
+    return OK;
+}
+
 status_t InputConsumer::consumeBatch(InputEventFactoryInterface* factory,
         nsecs_t frameTime, uint32_t* outSeq, InputEvent** outEvent) {
     status_t result;
@@ -1441,7 +1781,7 @@ int32_t InputConsumer::getPendingBatchSource() const {
 }
 
 bool InputConsumer::probablyHasInput() const {
-    return hasPendingBatch() || mChannel->probablyHasInput();
+    return hasPendingBatch() || mReceiveBufferCount > 0 || mChannel->probablyHasInput();
 }
 
 ssize_t InputConsumer::findBatch(int32_t deviceId, int32_t source) const {
@@ -1561,6 +1901,7 @@ std::string InputConsumer::dump() const {
     if (mMsgDeferred) {
         out = out + "mMsg : " + ftl::enum_string(mMsg.header.type) + "\n";
     }
+    out += StringPrintf("Received messages pending: %zu\n", mReceiveBufferCount);
     out += "Batches:\n";
     for (const Batch& batch : mBatches) {
         out += "    Batch:\n";
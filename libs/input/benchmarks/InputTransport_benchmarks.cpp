@@ -0,0 +1,156 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/logging.h>
+#include <attestation/HmacKeyManager.h>
+#include <input/InputTransport.h>
+
+#include <memory>
+#include <vector>
+
+namespace android {
+
+namespace {
+
+constexpr int32_t DEVICE_ID = 1;
+
+// Interval between samples of a 1kHz stylus.
+constexpr nsecs_t SAMPLE_INTERVAL = 1'000'000;
+
+std::pair<std::unique_ptr<InputChannel>, std::unique_ptr<InputChannel>> openChannels() {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("benchmark", serverChannel, clientChannel);
+    LOG_IF(FATAL, result != OK) << "Could not open the channel pair: " << result;
+    return {std::move(serverChannel), std::move(clientChannel)};
+}
+
+InputMessage createMotionMessage(uint32_t seq) {
+    InputMessage msg = {};
+    msg.header.type = InputMessage::Type::MOTION;
+    msg.header.seq = seq;
+    msg.body.motion.action = AMOTION_EVENT_ACTION_MOVE;
+    msg.body.motion.pointerCount = 1;
+    msg.body.motion.pointers[0].properties.clear();
+    msg.body.motion.pointers[0].properties.toolType = ToolType::STYLUS;
+    msg.body.motion.pointers[0].coords.clear();
+    msg.body.motion.pointers[0].coords.setAxisValue(AMOTION_EVENT_AXIS_X, seq);
+    msg.body.motion.pointers[0].coords.setAxisValue(AMOTION_EVENT_AXIS_Y, seq);
+    return msg;
+}
+
+/**
+ * Moves state.range(0) messages across a channel, either with one system call per message or
+ * with the batched sendMessages / receiveMessages calls.
+ */
+void benchmarkChannelThroughput(benchmark::State& state, bool batched) {
+    auto [serverChannel, clientChannel] = openChannels();
+    const size_t count = state.range(0);
+    std::vector<InputMessage> sent;
+    for (size_t i = 0; i < count; i++) {
+        sent.push_back(createMotionMessage(i + 1));
+    }
+    std::vector<InputMessage> received(count);
+
+    for (auto _ : state) {
+        if (batched) {
+            size_t numSent, numReceived;
+            serverChannel->sendMessages(sent.data(), count, &numSent);
+            clientChannel->receiveMessages(received.data(), count, &numReceived);
+            LOG_IF(FATAL, numSent != count || numReceived != count)
+                    << "Sent " << numSent << " and received " << numReceived << " of " << count;
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                serverChannel->sendMessage(&sent[i]);
+            }
+            for (size_t i = 0; i < count; i++) {
+                clientChannel->receiveMessage(&received[i]);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+void benchmarkChannelOneMessagePerCall(benchmark::State& state) {
+    benchmarkChannelThroughput(state, /*batched=*/false);
+}
+
+void benchmarkChannelBatched(benchmark::State& state) {
+    benchmarkChannelThroughput(state, /*batched=*/true);
+}
+
+/**
+ * A frame's worth of 1kHz stylus samples published one at a time, consumed as a single batch,
+ * then finished. Covers the publisher, the consumer, and the finished signals on the way back.
+ */
+void benchmarkPublishAndConsumeMotionBurst(benchmark::State& state) {
+    auto [serverChannel, clientChannel] = openChannels();
+    InputPublisher publisher(std::move(serverChannel));
+    InputConsumer consumer(std::move(clientChannel), /*enableTouchResampling=*/false);
+    PreallocatedInputEventFactory factory;
+    const size_t samplesPerFrame = state.range(0);
+
+    PointerProperties properties;
+    properties.clear();
+    properties.toolType = ToolType::STYLUS;
+    PointerCoords coords;
+    coords.clear();
+    ui::Transform identity;
+
+    uint32_t seq = 0;
+    nsecs_t eventTime = 0;
+    for (auto _ : state) {
+        for (size_t i = 0; i < samplesPerFrame; i++) {
+            eventTime += SAMPLE_INTERVAL;
+            coords.setAxisValue(AMOTION_EVENT_AXIS_X, i);
+            coords.setAxisValue(AMOTION_EVENT_AXIS_Y, i);
+            publisher.publishMotionEvent(++seq, InputEvent::nextId(), DEVICE_ID,
+                                         AINPUT_SOURCE_STYLUS, ADISPLAY_ID_DEFAULT, INVALID_HMAC,
+                                         AMOTION_EVENT_ACTION_MOVE, /*actionButton=*/0,
+                                         /*flags=*/0, /*edgeFlags=*/0, AMETA_NONE,
+                                         /*buttonState=*/0, MotionClassification::NONE, identity,
+                                         /*xPrecision=*/0, /*yPrecision=*/0,
+                                         AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                                         AMOTION_EVENT_INVALID_CURSOR_POSITION, identity,
+                                         /*downTime=*/0, eventTime, /*pointerCount=*/1,
+                                         &properties, &coords);
+        }
+
+        uint32_t consumeSeq;
+        InputEvent* event;
+        status_t result = consumer.consume(&factory, /*consumeBatches=*/true, /*frameTime=*/-1,
+                                           &consumeSeq, &event);
+        LOG_IF(FATAL, result != OK) << "Failed to consume the batch: " << result;
+        consumer.sendFinishedSignal(consumeSeq, /*handled=*/true);
+
+        // Drain the finished signals, one for every sample in the batch.
+        while (publisher.receiveConsumerResponse().ok()) {
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * samplesPerFrame);
+}
+
+} // namespace
+
+BENCHMARK(benchmarkChannelOneMessagePerCall)->Arg(1)->Arg(4)->Arg(8)->Arg(16);
+BENCHMARK(benchmarkChannelBatched)->Arg(1)->Arg(4)->Arg(8)->Arg(16);
+BENCHMARK(benchmarkPublishAndConsumeMotionBurst)->Arg(1)->Arg(8)->Arg(16);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -21,6 +21,9 @@
 #include <unistd.h>
 #include <time.h>
 #include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 
 #include <binder/Binder.h>
 #include <binder/Parcel.h>
@@ -228,6 +231,271 @@ TEST_F(InputChannelTest, SendAndReceive_MotionClassification) {
     }
 }
 
+TEST_F(InputChannelTest, SendAndReceiveMessages_InBatches) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result = InputChannel::openInputChannelPair("channel name",
+            serverChannel, clientChannel);
+    ASSERT_EQ(OK, result)
+            << "should have successfully opened a channel pair";
+
+    // Mix messages of different sizes, so that message boundaries are checked.
+    std::array<InputMessage, 5> serverMsgs = {};
+    for (size_t i = 0; i < serverMsgs.size(); i++) {
+        InputMessage& msg = serverMsgs[i];
+        msg.header.seq = i + 1;
+        if (i % 2 == 0) {
+            msg.header.type = InputMessage::Type::MOTION;
+            msg.body.motion.pointerCount = i + 1;
+            msg.body.motion.action = AMOTION_EVENT_ACTION_MOVE;
+        } else {
+            msg.header.type = InputMessage::Type::KEY;
+            msg.body.key.action = AKEY_EVENT_ACTION_DOWN;
+        }
+    }
+
+    size_t sent = 0;
+    EXPECT_EQ(OK, serverChannel->sendMessages(serverMsgs.data(), serverMsgs.size(), &sent));
+    EXPECT_EQ(serverMsgs.size(), sent);
+
+    // Receive into a buffer that is too small to hold all of the messages at once.
+    std::array<InputMessage, 3> clientMsgs;
+    size_t received = 0;
+    EXPECT_EQ(OK, clientChannel->receiveMessages(clientMsgs.data(), clientMsgs.size(), &received));
+    ASSERT_EQ(3u, received);
+    for (size_t i = 0; i < received; i++) {
+        EXPECT_EQ(serverMsgs[i].header.type, clientMsgs[i].header.type);
+        EXPECT_EQ(serverMsgs[i].header.seq, clientMsgs[i].header.seq);
+    }
+    EXPECT_EQ(3u, clientMsgs[2].body.motion.pointerCount);
+
+    EXPECT_EQ(OK, clientChannel->receiveMessages(clientMsgs.data(), clientMsgs.size(), &received));
+    ASSERT_EQ(2u, received);
+    EXPECT_EQ(4u, clientMsgs[0].header.seq);
+    EXPECT_EQ(5u, clientMsgs[1].header.seq);
+    EXPECT_EQ(5u, clientMsgs[1].body.motion.pointerCount);
+
+    EXPECT_EQ(WOULD_BLOCK,
+              clientChannel->receiveMessages(clientMsgs.data(), clientMsgs.size(), &received));
+    EXPECT_EQ(0u, received);
+}
+
+TEST_F(InputChannelTest, SendMessages_WhenChannelFills_ReportsMessagesSent) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result = InputChannel::openInputChannelPair("channel name",
+            serverChannel, clientChannel);
+    ASSERT_EQ(OK, result)
+            << "should have successfully opened a channel pair";
+
+    std::vector<InputMessage> msgs(256);
+    for (size_t i = 0; i < msgs.size(); i++) {
+        msgs[i].header.type = InputMessage::Type::MOTION;
+        msgs[i].header.seq = i + 1;
+        msgs[i].body.motion.pointerCount = MAX_POINTERS;
+    }
+
+    size_t sent = 0;
+    EXPECT_EQ(WOULD_BLOCK, serverChannel->sendMessages(msgs.data(), msgs.size(), &sent));
+    ASSERT_GT(sent, 0u);
+    ASSERT_LT(sent, msgs.size());
+
+    // Everything that was reported as sent can be received, in order.
+    InputMessage msg;
+    for (size_t i = 0; i < sent; i++) {
+        ASSERT_EQ(OK, clientChannel->receiveMessage(&msg));
+        EXPECT_EQ(i + 1, msg.header.seq);
+    }
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&msg));
+}
+
+TEST_F(InputChannelTest, ReceiveMessages_WhenPeerClosed_ReturnsAnError) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result = InputChannel::openInputChannelPair("channel name",
+            serverChannel, clientChannel);
+    ASSERT_EQ(OK, result)
+            << "should have successfully opened a channel pair";
+
+    serverChannel.reset(); // close server channel
+
+    std::array<InputMessage, 2> msgs;
+    size_t received = 0;
+    EXPECT_EQ(DEAD_OBJECT, clientChannel->receiveMessages(msgs.data(), msgs.size(), &received));
+    EXPECT_EQ(0u, received);
+}
+
+TEST_F(InputChannelTest, ReceiveMessages_WhenInvalidMessageFollows_DeliversEarlierMessages) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result = InputChannel::openInputChannelPair("channel name",
+            serverChannel, clientChannel);
+    ASSERT_EQ(OK, result)
+            << "should have successfully opened a channel pair";
+
+    InputMessage serverMsg = {};
+    serverMsg.header.type = InputMessage::Type::KEY;
+    serverMsg.header.seq = 1;
+    serverMsg.body.key.action = AKEY_EVENT_ACTION_DOWN;
+    ASSERT_EQ(OK, serverChannel->sendMessage(&serverMsg));
+    // A packet too short to hold a message header.
+    const uint32_t garbage = 0xdeadbeef;
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(garbage)),
+              ::send(serverChannel->getFd(), &garbage, sizeof(garbage), MSG_DONTWAIT));
+
+    std::array<InputMessage, 2> msgs;
+    size_t received = 0;
+    EXPECT_EQ(OK, clientChannel->receiveMessages(msgs.data(), msgs.size(), &received));
+    ASSERT_EQ(1u, received);
+    EXPECT_EQ(InputMessage::Type::KEY, msgs[0].header.type);
+    EXPECT_EQ(1u, msgs[0].header.seq);
+
+    EXPECT_EQ(BAD_VALUE, clientChannel->receiveMessages(msgs.data(), msgs.size(), &received));
+    EXPECT_EQ(0u, received);
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessages(msgs.data(), msgs.size(), &received));
+}
+
+TEST_F(InputChannelTest, RingTransport_SendAndReceiveInBothDirections) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel,
+                                               InputChannel::Transport::SHARED_MEMORY_RING);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+    EXPECT_EQ(InputChannel::Transport::SHARED_MEMORY_RING, serverChannel->getTransport());
+    EXPECT_EQ(InputChannel::Transport::SHARED_MEMORY_RING, clientChannel->getTransport());
+
+    InputMessage serverMsg = {};
+    serverMsg.header.type = InputMessage::Type::KEY;
+    serverMsg.header.seq = 1;
+    serverMsg.body.key.action = AKEY_EVENT_ACTION_DOWN;
+    ASSERT_EQ(OK, serverChannel->sendMessage(&serverMsg));
+
+    // The server should not read its own message back.
+    InputMessage msg;
+    EXPECT_EQ(WOULD_BLOCK, serverChannel->receiveMessage(&msg));
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&msg));
+    EXPECT_EQ(InputMessage::Type::KEY, msg.header.type);
+    EXPECT_EQ(1u, msg.header.seq);
+    EXPECT_EQ(AKEY_EVENT_ACTION_DOWN, msg.body.key.action);
+
+    InputMessage clientReply = {};
+    clientReply.header.type = InputMessage::Type::FINISHED;
+    clientReply.header.seq = 1;
+    clientReply.body.finished.handled = true;
+    ASSERT_EQ(OK, clientChannel->sendMessage(&clientReply));
+    ASSERT_EQ(OK, serverChannel->receiveMessage(&msg));
+    EXPECT_EQ(InputMessage::Type::FINISHED, msg.header.type);
+    EXPECT_TRUE(msg.body.finished.handled);
+    EXPECT_EQ(WOULD_BLOCK, serverChannel->receiveMessage(&msg));
+}
+
+TEST_F(InputChannelTest, RingTransport_WhenRingFills_ReturnsWouldBlock) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel,
+                                               InputChannel::Transport::SHARED_MEMORY_RING);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+
+    std::vector<InputMessage> msgs(InputMessageRing::DEFAULT_CAPACITY + 1);
+    for (size_t i = 0; i < msgs.size(); i++) {
+        msgs[i].header.type = InputMessage::Type::MOTION;
+        msgs[i].header.seq = i + 1;
+        msgs[i].body.motion.pointerCount = 1;
+    }
+    size_t sent = 0;
+    EXPECT_EQ(WOULD_BLOCK, serverChannel->sendMessages(msgs.data(), msgs.size(), &sent));
+    ASSERT_EQ(InputMessageRing::DEFAULT_CAPACITY, sent);
+
+    // Receiving a message frees a slot.
+    InputMessage msg;
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&msg));
+    EXPECT_EQ(1u, msg.header.seq);
+    ASSERT_EQ(OK, serverChannel->sendMessage(&msgs.back()));
+
+    std::vector<InputMessage> received(msgs.size());
+    size_t receivedCount = 0;
+    ASSERT_EQ(OK,
+              clientChannel->receiveMessages(received.data(), received.size(), &receivedCount));
+    ASSERT_EQ(InputMessageRing::DEFAULT_CAPACITY, receivedCount);
+    for (size_t i = 0; i < receivedCount; i++) {
+        EXPECT_EQ(i + 2, received[i].header.seq);
+    }
+}
+
+TEST_F(InputChannelTest, RingTransport_WakesUpReceiverUntilRingIsDrained) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel,
+                                               InputChannel::Transport::SHARED_MEMORY_RING);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+
+    InputMessage msg = {};
+    msg.header.type = InputMessage::Type::FOCUS;
+    ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+    ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+
+    // The socket is readable, so a looper polling it wakes up for the messages.
+    struct pollfd pfd = {.fd = clientChannel->getFd(), .events = POLLIN};
+    ASSERT_EQ(1, ::poll(&pfd, /*nfds=*/1, /*timeout=*/0));
+    EXPECT_TRUE(clientChannel->probablyHasInput());
+
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&msg));
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&msg));
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&msg));
+
+    // Once the ring has been found empty, the wakeups are consumed as well.
+    EXPECT_FALSE(clientChannel->probablyHasInput());
+    EXPECT_EQ(0, ::poll(&pfd, /*nfds=*/1, /*timeout=*/0));
+}
+
+TEST_F(InputChannelTest, RingTransport_WhenPeerClosed_ReceivesPendingMessagesFirst) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel,
+                                               InputChannel::Transport::SHARED_MEMORY_RING);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+
+    InputMessage msg = {};
+    msg.header.type = InputMessage::Type::FOCUS;
+    ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+    serverChannel.reset(); // close server channel
+
+    EXPECT_EQ(OK, clientChannel->receiveMessage(&msg));
+    EXPECT_EQ(DEAD_OBJECT, clientChannel->receiveMessage(&msg));
+    EXPECT_EQ(DEAD_OBJECT, clientChannel->sendMessage(&msg));
+}
+
+TEST_F(InputChannelTest, RingTransport_ParceledChannelMapsTheSameRing) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel,
+                                               InputChannel::Transport::SHARED_MEMORY_RING);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+
+    android::os::InputChannelCore parceledChannel;
+    InputChannel::moveChannel(std::move(clientChannel), parceledChannel);
+    ASSERT_TRUE(parceledChannel.messageRing.has_value());
+    EXPECT_FALSE(parceledChannel.messageRingServerSide);
+    std::unique_ptr<InputChannel> receivedChannel =
+            InputChannel::create(std::move(parceledChannel));
+    ASSERT_NE(nullptr, receivedChannel);
+
+    InputMessage msg = {};
+    msg.header.type = InputMessage::Type::FOCUS;
+    msg.header.seq = 7;
+    ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+    ASSERT_EQ(OK, receivedChannel->receiveMessage(&msg));
+    EXPECT_EQ(7u, msg.header.seq);
+
+    msg.header.type = InputMessage::Type::FINISHED;
+    ASSERT_EQ(OK, receivedChannel->sendMessage(&msg));
+    ASSERT_EQ(OK, serverChannel->receiveMessage(&msg));
+    EXPECT_EQ(InputMessage::Type::FINISHED, msg.header.type);
+}
+
+TEST_F(InputChannelTest, RingTransport_RejectsUnsealedMemory) {
+    base::unique_fd fd(memfd_create("unsealed", MFD_CLOEXEC));
+    ASSERT_TRUE(fd.ok());
+    ASSERT_EQ(0, ftruncate(fd.get(), 1 << 20));
+    EXPECT_EQ(nullptr, InputMessageRing::map(std::move(fd)));
+}
+
 TEST_F(InputChannelTest, DuplicateChannelAndAssertEqual) {
     std::unique_ptr<InputChannel> serverChannel, clientChannel;
 
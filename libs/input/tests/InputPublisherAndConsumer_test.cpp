@@ -577,6 +577,33 @@ TEST_F(InputPublisherAndConsumerTest, SendTimeline) {
     ASSERT_EQ(graphicsTimeline, timeline.graphicsTimeline);
 }
 
+TEST_F(InputPublisherAndConsumerTest, ConsumeFromReceivedMessages_ReportsPendingInput) {
+    // Both events are read from the channel together, and the second one stays with the consumer.
+    ASSERT_EQ(OK,
+              mPublisher->publishFocusEvent(/*seq=*/1, InputEvent::nextId(), /*hasFocus=*/true));
+    ASSERT_EQ(OK,
+              mPublisher->publishFocusEvent(/*seq=*/2, InputEvent::nextId(), /*hasFocus=*/false));
+
+    uint32_t consumeSeq;
+    InputEvent* event;
+    ASSERT_EQ(OK,
+              mConsumer->consume(&mEventFactory, /*consumeBatches=*/true, -1, &consumeSeq, &event));
+    EXPECT_EQ(1u, consumeSeq);
+    EXPECT_FALSE(mConsumer->getChannel()->probablyHasInput());
+    EXPECT_TRUE(mConsumer->probablyHasInput())
+            << "should report the message that was received but not consumed yet";
+
+    ASSERT_EQ(OK,
+              mConsumer->consume(&mEventFactory, /*consumeBatches=*/true, -1, &consumeSeq, &event));
+    EXPECT_EQ(2u, consumeSeq);
+    ASSERT_EQ(InputEventType::FOCUS, event->getType());
+    EXPECT_FALSE(static_cast<FocusEvent*>(event)->getHasFocus());
+    EXPECT_FALSE(mConsumer->probablyHasInput());
+
+    ASSERT_EQ(WOULD_BLOCK,
+              mConsumer->consume(&mEventFactory, /*consumeBatches=*/true, -1, &consumeSeq, &event));
+}
+
 TEST_F(InputPublisherAndConsumerTest, PublishKeyEvent_EndToEnd) {
     ASSERT_NO_FATAL_FAILURE(publishAndConsumeKeyEvent());
 }
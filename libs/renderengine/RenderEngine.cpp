@@ -21,6 +21,7 @@
 #include "renderengine/ExternalTexture.h"
 #include "threaded/RenderEngineThreaded.h"
 
+#include "skia/SkiaCpuRenderEngine.h"
 #include "skia/SkiaGLRenderEngine.h"
 #include "skia/SkiaVkRenderEngine.h"
 
@@ -40,6 +41,11 @@ std::unique_ptr<RenderEngine> RenderEngine::create(const RenderEngineCreationArg
                 return renderengine::threaded::RenderEngineThreaded::create([args]() {
                     return android::renderengine::skia::SkiaVkRenderEngine::create(args);
                 });
+            case GraphicsApi::CPU:
+                ALOGD("Threaded RenderEngine with SkiaCpu Backend");
+                return renderengine::threaded::RenderEngineThreaded::create([args]() {
+                    return android::renderengine::skia::SkiaCpuRenderEngine::create(args);
+                });
         }
     }
 
@@ -50,6 +56,9 @@ std::unique_ptr<RenderEngine> RenderEngine::create(const RenderEngineCreationArg
         case GraphicsApi::VK:
             ALOGD("RenderEngine with SkiaVK Backend");
             return renderengine::skia::SkiaVkRenderEngine::create(args);
+        case GraphicsApi::CPU:
+            ALOGD("RenderEngine with SkiaCpu Backend");
+            return renderengine::skia::SkiaCpuRenderEngine::create(args);
     }
 }
 
@@ -79,6 +79,14 @@ static std::unique_ptr<RenderEngine> createRenderEngine(RenderEngine::Threaded t
     return RenderEngine::create(args);
 }
 
+// The raster backend draws into CPU mappings of the buffers, so they need CPU usage on top of the
+// GPU usage every buffer gets.
+static uint64_t backendUsage(RenderEngine::GraphicsApi graphicsApi) {
+    return graphicsApi == RenderEngine::GraphicsApi::CPU
+            ? GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN
+            : 0;
+}
+
 static std::shared_ptr<ExternalTexture> allocateBuffer(RenderEngine& re, uint32_t width,
                                                        uint32_t height,
                                                        uint64_t extraUsageFlags = 0,
@@ -142,9 +150,10 @@ static std::shared_ptr<ExternalTexture> copyBuffer(RenderEngine& re,
  * outside of the for loop is excluded from the timing measurements.
  */
 static void benchDrawLayers(RenderEngine& re, const std::vector<LayerSettings>& layers,
-                            benchmark::State& benchState, const char* saveFileName) {
+                            benchmark::State& benchState, const char* saveFileName,
+                            uint64_t extraUsageFlags = 0) {
     auto [width, height] = getDisplaySize();
-    auto outputBuffer = allocateBuffer(re, width, height);
+    auto outputBuffer = allocateBuffer(re, width, height, extraUsageFlags);
 
     const Rect displayRect(0, 0, static_cast<int32_t>(width), static_cast<int32_t>(height));
     DisplaySettings display{
@@ -162,7 +171,8 @@ static void benchDrawLayers(RenderEngine& re, const std::vector<LayerSettings>&
 
     if (renderenginebench::save() && saveFileName) {
         // Copy to a CPU-accessible buffer so we can encode it.
-        outputBuffer = copyBuffer(re, outputBuffer, GRALLOC_USAGE_SW_READ_OFTEN, "to_encode");
+        outputBuffer = copyBuffer(re, outputBuffer,
+                                  GRALLOC_USAGE_SW_READ_OFTEN | extraUsageFlags, "to_encode");
 
         std::string outFile = base::GetExecutableDirectory();
         outFile.append("/");
@@ -179,20 +189,22 @@ static void benchDrawLayers(RenderEngine& re, const std::vector<LayerSettings>&
 template <class... Args>
 void BM_blur(benchmark::State& benchState, Args&&... args) {
     auto args_tuple = std::make_tuple(std::move(args)...);
+    const auto graphicsApi = static_cast<RenderEngine::GraphicsApi>(std::get<1>(args_tuple));
     auto re = createRenderEngine(static_cast<RenderEngine::Threaded>(std::get<0>(args_tuple)),
-                                 static_cast<RenderEngine::GraphicsApi>(std::get<1>(args_tuple)));
+                                 graphicsApi);
+    const uint64_t usage = backendUsage(graphicsApi);
 
     // Initially use cpu access so we can decode into it with AImageDecoder.
     auto [width, height] = getDisplaySize();
-    auto srcBuffer =
-            allocateBuffer(*re, width, height, GRALLOC_USAGE_SW_WRITE_OFTEN, "decoded_source");
+    auto srcBuffer = allocateBuffer(*re, width, height, GRALLOC_USAGE_SW_WRITE_OFTEN | usage,
+                                    "decoded_source");
     {
         std::string srcImage = base::GetExecutableDirectory();
         srcImage.append("/resources/homescreen.png");
         renderenginebench::decode(srcImage.c_str(), srcBuffer->getBuffer());
 
         // Now copy into GPU-only buffer for more realistic timing.
-        srcBuffer = copyBuffer(*re, srcBuffer, 0, "source");
+        srcBuffer = copyBuffer(*re, srcBuffer, usage, "source");
     }
 
     const FloatRect layerRect(0, 0, width, height);
@@ -221,8 +233,10 @@ void BM_blur(benchmark::State& benchState, Args&&... args) {
     };
 
     auto layers = std::vector<LayerSettings>{layer, blurLayer};
-    benchDrawLayers(*re, layers, benchState, "blurred");
+    benchDrawLayers(*re, layers, benchState, "blurred", usage);
 }
 
 BENCHMARK_CAPTURE(BM_blur, SkiaGLThreaded, RenderEngine::Threaded::YES,
                   RenderEngine::GraphicsApi::GL);
+BENCHMARK_CAPTURE(BM_blur, SkiaCpuThreaded, RenderEngine::Threaded::YES,
+                  RenderEngine::GraphicsApi::CPU);
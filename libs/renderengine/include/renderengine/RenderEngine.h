@@ -54,6 +54,13 @@
  */
 #define PROPERTY_SKIA_ATRACE_ENABLED "debug.renderengine.skia_atrace_enabled"
 
+/**
+ * Path of a file in which RenderEngine records the layer permutations it draws, so that priming
+ * the shader cache at the next boot draws exactly those instead of a fixed list. No recording
+ * when unset.
+ */
+#define PROPERTY_RENDERENGINE_RECORDED_PRIME_CACHE "debug.renderengine.recorded_prime_cache"
+
 struct ANativeWindowBuffer;
 
 namespace android {
@@ -100,6 +107,9 @@ public:
     enum class GraphicsApi {
         GL,
         VK,
+        // Skia's raster backend, drawing into CPU mappings of the buffers. For composition tests
+        // and benchmarks on machines without a GPU.
+        CPU,
     };
 
     static std::unique_ptr<RenderEngine> create(const RenderEngineCreationArgs& args);
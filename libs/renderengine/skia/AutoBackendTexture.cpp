@@ -21,6 +21,7 @@
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
 #include <SkImage.h>
+#include <SkPixmap.h>
 #include <include/gpu/ganesh/SkImageGanesh.h>
 #include <include/gpu/ganesh/SkSurfaceGanesh.h>
 #include <include/gpu/ganesh/gl/GrGLBackendSurface.h>
@@ -44,6 +45,22 @@ AutoBackendTexture::AutoBackendTexture(GrDirectContext* context, AHardwareBuffer
     bool createProtectedImage = 0 != (desc.usage & AHARDWAREBUFFER_USAGE_PROTECTED_CONTENT);
     GrBackendFormat backendFormat;
 
+    if (context == nullptr) {
+        mColorType = GrAHardwareBufferUtils::GetSkColorTypeFromBufferFormat(desc.format);
+        LOG_ALWAYS_FATAL_IF(createProtectedImage, "Protected buffers can't be mapped by the CPU");
+        LOG_ALWAYS_FATAL_IF(!(desc.usage & AHARDWAREBUFFER_USAGE_CPU_READ_MASK) ||
+                                    (isOutputBuffer &&
+                                     !(desc.usage & AHARDWAREBUFFER_USAGE_CPU_WRITE_MASK)),
+                            "Buffer [%p] isn't CPU %s", buffer,
+                            isOutputBuffer ? "writeable" : "readable");
+        mCpuBuffer = buffer;
+        AHardwareBuffer_acquire(mCpuBuffer);
+        mWidth = static_cast<int>(desc.width);
+        mHeight = static_cast<int>(desc.height);
+        mRowBytes = desc.stride * SkColorTypeBytesPerPixel(mColorType);
+        return;
+    }
+
     GrBackendApi backend = context->backend();
     if (backend == GrBackendApi::kOpenGL) {
         backendFormat =
@@ -94,6 +111,9 @@ AutoBackendTexture::~AutoBackendTexture() {
         mDeleteProc(mImageCtx);
         mBackendTexture = {};
     }
+    if (mCpuBuffer != nullptr) {
+        AHardwareBuffer_release(mCpuBuffer);
+    }
 }
 
 void AutoBackendTexture::unref(bool releaseLocalResources) {
@@ -122,6 +142,36 @@ void AutoBackendTexture::releaseImageProc(SkImages::ReleaseContext releaseContex
     textureRelease->unref(false);
 }
 
+// The raster backend's counterparts of the procs above, which also unmap the buffer.
+void AutoBackendTexture::releaseRasterSurfaceProc(void* /*pixels*/, void* releaseContext) {
+    AutoBackendTexture* textureRelease = reinterpret_cast<AutoBackendTexture*>(releaseContext);
+    AHardwareBuffer_unlock(textureRelease->mCpuBuffer, nullptr);
+    textureRelease->unref(false);
+}
+
+void AutoBackendTexture::releaseRasterImageProc(const void* /*pixels*/,
+                                                SkImages::ReleaseContext releaseContext) {
+    AutoBackendTexture* textureRelease = reinterpret_cast<AutoBackendTexture*>(releaseContext);
+    AHardwareBuffer_unlock(textureRelease->mCpuBuffer, nullptr);
+    textureRelease->unref(false);
+}
+
+// Maps the buffer for the lifetime of one SkImage or SkSurface, which unmaps it in its release
+// proc. Unlike the GPU wrappers, these aren't cached, so the buffer stays mapped only while the
+// caller holds the wrapper.
+void* AutoBackendTexture::lockPixels() {
+    const uint64_t usage = mIsOutputBuffer
+            ? AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN
+            : AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN;
+    void* pixels = nullptr;
+    const int err = AHardwareBuffer_lock(mCpuBuffer, usage, -1 /* fence */, nullptr, &pixels);
+    if (err != 0 || pixels == nullptr) {
+        LOG_ALWAYS_FATAL("Unable to map buffer [%p] for the CPU: %d. [%d,%d] colorType %i",
+                         mCpuBuffer, err, mWidth, mHeight, mColorType);
+    }
+    return pixels;
+}
+
 void logFatalTexture(const char* msg, const GrBackendTexture& tex, ui::Dataspace dataspace,
                      SkColorType colorType) {
     switch (tex.backend()) {
@@ -173,6 +223,24 @@ sk_sp<SkImage> AutoBackendTexture::makeImage(ui::Dataspace dataspace, SkAlphaTyp
         }
     }
 
+    if (mCpuBuffer != nullptr) {
+        // Not kept in mImage, so that the buffer is unmapped as soon as the caller drops it.
+        const SkPixmap pixmap(SkImageInfo::Make(mWidth, mHeight, colorType, alphaType,
+                                                toSkColorSpace(dataspace)),
+                              lockPixels(), mRowBytes);
+        sk_sp<SkImage> image = SkImages::RasterFromPixmap(pixmap, releaseRasterImageProc, this);
+        if (!image.get()) {
+            AHardwareBuffer_unlock(mCpuBuffer, nullptr);
+            LOG_ALWAYS_FATAL("Unable to generate raster SkImage. [%d,%d] dataspace:%d "
+                             "colorType %i",
+                             mWidth, mHeight, static_cast<int32_t>(dataspace), colorType);
+        }
+        // The following ref will be counteracted by releaseProc, when SkImage is discarded.
+        ref();
+        mDataspace = dataspace;
+        return image;
+    }
+
     sk_sp<SkImage> image =
             SkImages::BorrowTextureFrom(context, mBackendTexture, kTopLeft_GrSurfaceOrigin,
                                         colorType, alphaType, toSkColorSpace(dataspace),
@@ -194,11 +262,29 @@ sk_sp<SkSurface> AutoBackendTexture::getOrCreateSurface(ui::Dataspace dataspace,
                                                         GrDirectContext* context) {
     ATRACE_CALL();
     LOG_ALWAYS_FATAL_IF(!mIsOutputBuffer, "You can't generate a SkSurface for a read-only texture");
+    if (mCpuBuffer != nullptr) {
+        // Not kept in mSurface, so that the buffer is unmapped, and the CPU caches are flushed,
+        // as soon as the caller drops it.
+        const SkImageInfo info = SkImageInfo::Make(mWidth, mHeight, mColorType,
+                                                   kPremul_SkAlphaType, toSkColorSpace(dataspace));
+        sk_sp<SkSurface> surface = SkSurfaces::WrapPixels(info, lockPixels(), mRowBytes,
+                                                          releaseRasterSurfaceProc, this, nullptr);
+        if (!surface.get()) {
+            AHardwareBuffer_unlock(mCpuBuffer, nullptr);
+            LOG_ALWAYS_FATAL("Unable to generate raster SkSurface. [%d,%d] dataspace:%d "
+                             "colorType %i",
+                             mWidth, mHeight, static_cast<int32_t>(dataspace), mColorType);
+        }
+        // The following ref will be counteracted by releaseProc, when SkSurface is discarded.
+        ref();
+        mDataspace = dataspace;
+        return surface;
+    }
+
     if (!mSurface.get() || mDataspace != dataspace) {
         sk_sp<SkSurface> surface =
-                SkSurfaces::WrapBackendTexture(context, mBackendTexture,
-                                               kTopLeft_GrSurfaceOrigin, 0, mColorType,
-                                               toSkColorSpace(dataspace), nullptr,
+                SkSurfaces::WrapBackendTexture(context, mBackendTexture, kTopLeft_GrSurfaceOrigin,
+                                               0, mColorType, toSkColorSpace(dataspace), nullptr,
                                                releaseSurfaceProc, this);
         if (surface.get()) {
             // The following ref will be counteracted by releaseProc, when SkSurface is discarded.
@@ -36,6 +36,10 @@ namespace skia {
  * AutoBackendTexture manages GPU image lifetime. It is a ref-counted object
  * that keeps GPU resources alive until the last SkImage or SkSurface object using them is
  * destroyed.
+ *
+ * Without a GrDirectContext the buffer is instead mapped for CPU access for as long as an
+ * SkImage or SkSurface wraps it, and drawn by Skia's raster backend. Those wrappers aren't
+ * cached, so that the mapping ends when the caller drops them.
  */
 class AutoBackendTexture {
 public:
@@ -146,6 +150,15 @@ private:
     static void releaseSurfaceProc(SkSurface::ReleaseContext releaseContext);
     static void releaseImageProc(SkImages::ReleaseContext releaseContext);
 
+    // CPU mapping for the raster backend, which uses these instead of mBackendTexture.
+    void* lockPixels();
+    static void releaseRasterSurfaceProc(void* pixels, void* releaseContext);
+    static void releaseRasterImageProc(const void* pixels, SkImages::ReleaseContext releaseContext);
+    AHardwareBuffer* mCpuBuffer = nullptr;
+    int mWidth = 0;
+    int mHeight = 0;
+    size_t mRowBytes = 0;
+
     int mUsageCount = 0;
 
     const bool mIsOutputBuffer;
@@ -0,0 +1,441 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "RenderEngine"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "RecordedPrimeCache.h"
+
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+#include <log/log.h>
+#include <renderengine/impl/ExternalTexture.h>
+#include <ui/GraphicBuffer.h>
+#include <utils/Timers.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <map>
+#include <type_traits>
+
+#include "SkiaRenderEngine.h"
+#include "debug/CommonPool.h"
+
+namespace android::renderengine::skia {
+
+namespace {
+
+using Permutation = RecordedPrimeCache::Permutation;
+
+static_assert(std::is_trivially_copyable_v<Permutation> && sizeof(Permutation) % 4 == 0 &&
+                      sizeof(Permutation) == 6 * sizeof(int32_t) + 16,
+              "Permutation bytes are its key and file format, so it can't have implicit padding");
+
+// File layout: a Header, then Header::count entries of a Permutation and its uint64_t draw count.
+// A file with another magic, version or entry size, e.g. from before an OTA, is ignored.
+struct Header {
+    uint32_t magic = kMagic;
+    uint32_t version = kVersion;
+    uint32_t permutationSize = sizeof(Permutation);
+    uint32_t count = 0;
+
+    static constexpr uint32_t kMagic = 0x43505252; // "RRPC"
+    static constexpr uint32_t kVersion = 1;
+};
+
+// Bounds the memory and the file if something keeps producing new permutations.
+constexpr size_t kMaxPermutations = 256;
+// Without new permutations, the draw counts are saved this often, so that the order of the next
+// priming reflects recent use.
+constexpr uint64_t kSaveIntervalDraws = 100000;
+
+// Replay values. Like in Cache.cpp, only what they turn on matters, not the values themselves.
+constexpr int32_t kReplaySize = 128;
+// clang-format off
+const auto kReplayScale = mat4(0.7f, 0.f,  0.f, 0.f,
+                               0.f,  1.1f, 0.f, 0.f,
+                               0.f,  0.f,  1.f, 0.f,
+                               3.f,  2.f,  0.f, 1.f);
+const auto kReplayRotation = mat4(1.1f, -0.1f, 0.f, 0.f,
+                                  0.1f,  1.1f, 0.f, 0.f,
+                                  0.f,   0.f,  1.f, 0.f,
+                                  2.f,   2.f,  0.f, 1.f);
+// clang-format on
+const auto kReplayColorTransform = mat4::scale(vec4(0.9f, 0.8f, 0.7f, 1.f));
+
+Permutation::Transform classifyTransform(const mat4& transform) {
+    const bool axisAligned = transform[0][1] == 0.f && transform[1][0] == 0.f &&
+            transform[0][3] == 0.f && transform[1][3] == 0.f && transform[3][3] == 1.f;
+    if (!axisAligned) {
+        return Permutation::Transform::OTHER;
+    }
+    return transform[0][0] == 1.f && transform[1][1] == 1.f ? Permutation::Transform::TRANSLATE
+                                                            : Permutation::Transform::SCALE;
+}
+
+Permutation::Dimming classifyDimming(float layerDimmingRatio) {
+    if (std::abs(1.f - layerDimmingRatio) < 0.001f) {
+        return Permutation::Dimming::NONE;
+    }
+    return layerDimmingRatio <= SkiaRenderEngine::kDimmingThreshold
+            ? Permutation::Dimming::DITHERED
+            : Permutation::Dimming::DIMMED;
+}
+
+std::shared_ptr<ExternalTexture> makeTexture(SkiaRenderEngine* renderengine,
+                                             const sp<GraphicBuffer>& buffer, uint32_t usage) {
+    if (!buffer || buffer->initCheck() != OK) {
+        return nullptr;
+    }
+    return std::make_shared<impl::ExternalTexture>(buffer, *renderengine, usage);
+}
+
+} // namespace
+
+size_t RecordedPrimeCache::PermutationHasher::operator()(const Permutation& permutation) const {
+    // FNV-1a over the bytes, which are all meaningful.
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&permutation);
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < sizeof(Permutation); i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3;
+    }
+    return static_cast<size_t>(hash);
+}
+
+RecordedPrimeCache::RecordedPrimeCache(std::string path) : mPath(std::move(path)) {
+    load();
+}
+
+void RecordedPrimeCache::record(const DisplaySettings& display, const LayerSettings& layer,
+                                PixelFormat outputPixelFormat, float layerDimmingRatio) {
+    Permutation permutation;
+    permutation.outputDataspace = static_cast<int32_t>(display.outputDataspace);
+    permutation.outputPixelFormat = outputPixelFormat;
+    permutation.dimmingStage = static_cast<int32_t>(display.dimmingStage);
+    permutation.renderIntent = static_cast<int32_t>(display.renderIntent);
+    permutation.displayColorTransform =
+            display.colorTransform != mat4() && !display.deviceHandlesColorTransform;
+
+    permutation.sourceDataspace = static_cast<int32_t>(layer.sourceDataspace);
+    if (const auto& buffer = layer.source.buffer; buffer.buffer) {
+        permutation.sourcePixelFormat = buffer.buffer->getPixelFormat();
+        permutation.isOpaque = buffer.isOpaque;
+        permutation.usePremultipliedAlpha = buffer.usePremultipliedAlpha;
+        permutation.useTextureFiltering = buffer.useTextureFiltering;
+    }
+    permutation.dimming = static_cast<uint8_t>(classifyDimming(layerDimmingRatio));
+    permutation.transform =
+            static_cast<uint8_t>(classifyTransform(layer.geometry.positionTransform));
+    permutation.translucent = layer.alpha < 1.f;
+    const vec2& radius = layer.geometry.roundedCornersRadius;
+    permutation.roundedCorners = radius.x > 0.f && radius.y > 0.f;
+    permutation.shadow = layer.shadow.length > 0.f;
+    permutation.blur = layer.backgroundBlurRadius > 0 || !layer.blurRegions.empty();
+    permutation.colorTransform = layer.colorTransform != mat4();
+    permutation.stretch = layer.stretchEffect.hasEffect();
+    permutation.disableBlending = layer.disableBlending;
+    permutation.skipContentDraw = layer.skipContentDraw;
+
+    uint64_t generation;
+    Snapshot snapshot;
+    {
+        std::lock_guard lock(mMutex);
+        if (!mRecording) {
+            return;
+        }
+        bool added = false;
+        if (auto it = mCounts.find(permutation); it != mCounts.end()) {
+            it->second++;
+        } else if (mCounts.size() < kMaxPermutations) {
+            mCounts.emplace(permutation, 1);
+            added = true;
+        }
+        if (++mUnsavedDraws < kSaveIntervalDraws && !added) {
+            return;
+        }
+        mUnsavedDraws = 0;
+        snapshot = snapshotLocked(&generation);
+    }
+
+    // Write the snapshot on another thread, so that composition never waits for the disk.
+    CommonPool::post([path = mPath, file = mFile, generation, snapshot = std::move(snapshot)]() {
+        ATRACE_NAME("RecordedPrimeCache::save");
+        write(path, *file, generation, snapshot);
+    });
+}
+
+RecordedPrimeCache::Snapshot RecordedPrimeCache::snapshotLocked(uint64_t* generation) {
+    *generation = ++mGeneration;
+    return Snapshot(mCounts.begin(), mCounts.end());
+}
+
+void RecordedPrimeCache::setRecording(bool recording) {
+    std::lock_guard lock(mMutex);
+    mRecording = recording;
+}
+
+RecordedPrimeCache::Snapshot RecordedPrimeCache::permutations() const {
+    Snapshot permutations;
+    {
+        std::lock_guard lock(mMutex);
+        permutations.assign(mCounts.begin(), mCounts.end());
+    }
+    std::stable_sort(permutations.begin(), permutations.end(),
+                     [](const auto& a, const auto& b) { return a.second > b.second; });
+    return permutations;
+}
+
+bool RecordedPrimeCache::save() {
+    uint64_t generation;
+    Snapshot snapshot;
+    {
+        std::lock_guard lock(mMutex);
+        snapshot = snapshotLocked(&generation);
+        mUnsavedDraws = 0;
+    }
+    return write(mPath, *mFile, generation, snapshot);
+}
+
+bool RecordedPrimeCache::write(const std::string& path, FileState& file, uint64_t generation,
+                               const Snapshot& snapshot) {
+    // Writes also share the temporary file, so they must not overlap.
+    std::lock_guard lock(file.mutex);
+    if (generation <= file.writtenGeneration) {
+        return true;
+    }
+
+    Header header;
+    header.count = static_cast<uint32_t>(snapshot.size());
+    std::string contents(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& [permutation, count] : snapshot) {
+        contents.append(reinterpret_cast<const char*>(&permutation), sizeof(permutation));
+        contents.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    }
+
+    // Write and rename, so that a crash or reboot mid-write never leaves a truncated file.
+    const std::string tmpPath = path + ".tmp";
+    if (!base::WriteStringToFile(contents, tmpPath) ||
+        std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ALOGW("Failed to save the recorded prime cache to %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    file.writtenGeneration = generation;
+    return true;
+}
+
+void RecordedPrimeCache::load() {
+    std::string contents;
+    if (!base::ReadFileToString(mPath, &contents)) {
+        return;
+    }
+    constexpr size_t kEntrySize = sizeof(Permutation) + sizeof(uint64_t);
+    Header header;
+    if (contents.size() < sizeof(header)) {
+        ALOGW("Ignoring truncated recorded prime cache %s", mPath.c_str());
+        return;
+    }
+    std::memcpy(&header, contents.data(), sizeof(header));
+    if (header.magic != Header::kMagic || header.version != Header::kVersion ||
+        header.permutationSize != sizeof(Permutation) || header.count > kMaxPermutations ||
+        contents.size() != sizeof(header) + header.count * kEntrySize) {
+        ALOGW("Ignoring incompatible recorded prime cache %s", mPath.c_str());
+        return;
+    }
+
+    std::lock_guard lock(mMutex);
+    const char* entry = contents.data() + sizeof(header);
+    for (uint32_t i = 0; i < header.count; i++, entry += kEntrySize) {
+        Permutation permutation;
+        uint64_t count;
+        std::memcpy(&permutation, entry, sizeof(permutation));
+        std::memcpy(&count, entry + sizeof(permutation), sizeof(count));
+        mCounts[permutation] += count;
+    }
+    ALOGD("Loaded %zu recorded prime cache permutations from %s", mCounts.size(), mPath.c_str());
+}
+
+bool RecordedPrimeCache::prime(SkiaRenderEngine* renderengine) {
+    const auto recorded = permutations();
+    if (recorded.empty()) {
+        return false;
+    }
+    ATRACE_CALL();
+    const int previousCount = renderengine->reportShadersCompiled();
+    const nsecs_t timeBefore = systemTime();
+
+    // Allocating a buffer for every format is a round trip to the allocator each, and doesn't
+    // need the GPU context, so allocate them all in parallel before drawing.
+    std::map<PixelFormat, std::future<sp<GraphicBuffer>>> pendingDst;
+    std::map<PixelFormat, std::future<sp<GraphicBuffer>>> pendingSrc;
+    const auto allocate = [](PixelFormat format, uint64_t usage, const char* name) {
+        return std::async(std::launch::async, [=]() {
+            return sp<GraphicBuffer>::make(kReplaySize, kReplaySize, format, 1, usage, name);
+        });
+    };
+    for (const auto& [permutation, count] : recorded) {
+        if (!pendingDst.count(permutation.outputPixelFormat)) {
+            pendingDst.emplace(permutation.outputPixelFormat,
+                               allocate(permutation.outputPixelFormat,
+                                        GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_TEXTURE,
+                                        "recordedPrimeCache_dst"));
+        }
+        if (permutation.sourcePixelFormat != Permutation::kNoBuffer &&
+            !pendingSrc.count(permutation.sourcePixelFormat)) {
+            pendingSrc.emplace(permutation.sourcePixelFormat,
+                               allocate(permutation.sourcePixelFormat, GRALLOC_USAGE_HW_TEXTURE,
+                                        "recordedPrimeCache_src"));
+        }
+    }
+    // The textures themselves are mapped into the GPU context, so on this thread.
+    std::map<PixelFormat, std::shared_ptr<ExternalTexture>> dstTextures;
+    for (auto& [format, buffer] : pendingDst) {
+        dstTextures[format] = makeTexture(renderengine, buffer.get(),
+                                          impl::ExternalTexture::Usage::WRITEABLE);
+    }
+    std::map<PixelFormat, std::shared_ptr<ExternalTexture>> srcTextures;
+    for (auto& [format, buffer] : pendingSrc) {
+        srcTextures[format] = makeTexture(renderengine, buffer.get(),
+                                          impl::ExternalTexture::Usage::READABLE);
+    }
+
+    const Rect displayRect(0, 0, kReplaySize, kReplaySize);
+    const FloatRect rect(0, 0, kReplaySize, kReplaySize);
+    std::shared_ptr<ExternalTexture> lastDst;
+    DisplaySettings lastDisplay;
+    for (const auto& [permutation, count] : recorded) {
+        const auto& dst = dstTextures[permutation.outputPixelFormat];
+        std::shared_ptr<ExternalTexture> src;
+        if (permutation.sourcePixelFormat != Permutation::kNoBuffer) {
+            src = srcTextures[permutation.sourcePixelFormat];
+        }
+        // The allocator doesn't support the format. Neither did RenderEngine then, most likely.
+        if (!dst || (permutation.sourcePixelFormat != Permutation::kNoBuffer && !src) ||
+            (permutation.blur && !renderengine->supportsBackgroundBlur())) {
+            continue;
+        }
+
+        DisplaySettings display;
+        display.physicalDisplay = displayRect;
+        display.clip = displayRect;
+        display.maxLuminance = 500;
+        display.outputDataspace = static_cast<ui::Dataspace>(permutation.outputDataspace);
+        if (permutation.displayColorTransform) {
+            display.colorTransform = kReplayColorTransform;
+        }
+        display.dimmingStage =
+                static_cast<aidl::android::hardware::graphics::composer3::DimmingStage>(
+                        permutation.dimmingStage);
+        display.renderIntent =
+                static_cast<aidl::android::hardware::graphics::composer3::RenderIntent>(
+                        permutation.renderIntent);
+
+        LayerSettings layer;
+        layer.geometry.boundaries = rect;
+        switch (static_cast<Permutation::Transform>(permutation.transform)) {
+            case Permutation::Transform::TRANSLATE:
+                break;
+            case Permutation::Transform::SCALE:
+                layer.geometry.positionTransform = kReplayScale;
+                break;
+            case Permutation::Transform::OTHER:
+                layer.geometry.positionTransform = kReplayRotation;
+                break;
+        }
+        if (permutation.roundedCorners) {
+            layer.geometry.roundedCornersRadius = {20.f, 20.f};
+            layer.geometry.roundedCornersCrop = rect;
+        }
+        if (src) {
+            layer.source.buffer.buffer = src;
+            layer.source.buffer.isOpaque = permutation.isOpaque;
+            layer.source.buffer.usePremultipliedAlpha = permutation.usePremultipliedAlpha;
+            layer.source.buffer.useTextureFiltering = permutation.useTextureFiltering;
+        } else {
+            layer.source.solidColor = half3(0.1f, 0.2f, 0.3f);
+        }
+        layer.alpha = permutation.translucent ? 0.5f : 1.f;
+        layer.sourceDataspace = static_cast<ui::Dataspace>(permutation.sourceDataspace);
+        if (permutation.colorTransform) {
+            layer.colorTransform = kReplayColorTransform;
+        }
+        layer.disableBlending = permutation.disableBlending;
+        layer.skipContentDraw = permutation.skipContentDraw;
+        if (permutation.shadow) {
+            layer.shadow = ShadowSettings{
+                    .boundaries = rect,
+                    .ambientColor = vec4(0, 0, 0, 0.00935997f),
+                    .spotColor = vec4(0, 0, 0, 0.0455841f),
+                    .lightPos = vec3(500.f, -1500.f, 1500.f),
+                    .lightRadius = 2500.0f,
+                    .length = 15.f,
+            };
+        }
+        if (permutation.blur) {
+            layer.backgroundBlurRadius = 30;
+        }
+        if (permutation.stretch) {
+            layer.stretchEffect.width = rect.getWidth();
+            layer.stretchEffect.height = rect.getHeight();
+            layer.stretchEffect.vectorX = 0.5f;
+            layer.stretchEffect.vectorY = 0.5f;
+            layer.stretchEffect.maxAmountX = 0.5f;
+            layer.stretchEffect.maxAmountY = 0.5f;
+            layer.stretchEffect.mappedChildBounds = rect;
+        }
+        // A single layer is dimmed by its white point over the display's target luminance.
+        // DIMMED stays above SkiaRenderEngine::kDimmingThreshold so it isn't dithered.
+        switch (static_cast<Permutation::Dimming>(permutation.dimming)) {
+            case Permutation::Dimming::NONE:
+                break;
+            case Permutation::Dimming::DIMMED:
+                display.targetLuminanceNits = 1000.f;
+                layer.whitePointNits = 950.f;
+                break;
+            case Permutation::Dimming::DITHERED:
+                display.targetLuminanceNits = 1000.f;
+                layer.whitePointNits = 100.f;
+                break;
+        }
+
+        renderengine->drawLayers(display, std::vector<LayerSettings>{layer}, dst,
+                                 base::unique_fd());
+        lastDst = dst;
+        lastDisplay = display;
+    }
+
+    if (lastDst) {
+        // draw one final layer synchronously to force GL submit
+        LayerSettings layer{
+                .source = PixelSource{.solidColor = half3(0.f, 0.f, 0.f)},
+        };
+        renderengine->drawLayers(lastDisplay, std::vector<LayerSettings>{layer}, lastDst,
+                                 base::unique_fd())
+                .get();
+    }
+
+    const float compileTimeMs = static_cast<float>(systemTime() - timeBefore) / 1.0E6;
+    ALOGD("Recorded prime cache generated %d shaders for %zu permutations in %f ms\n",
+          renderengine->reportShadersCompiled() - previousCount, recorded.size(), compileTimeMs);
+    return true;
+}
+
+} // namespace android::renderengine::skia
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+#include <renderengine/DisplaySettings.h>
+#include <renderengine/LayerSettings.h>
+#include <ui/PixelFormat.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace android::renderengine::skia {
+
+class SkiaRenderEngine;
+
+// Records which layer permutations RenderEngine actually draws, and how often, in a file that
+// survives reboots. primeCache then draws exactly those permutations, most frequent first, instead
+// of the fixed list in Cache, so it compiles the shaders this device needs and no others.
+//
+// A permutation is what decides which shaders Skia generates for a layer, e.g. the dataspaces,
+// the pixel format, rounded corners or dimming, and not values like its size or color that only
+// become uniforms. Permutations are stored by their content, so every distinct one is counted
+// once however many layers and frames draw it.
+class RecordedPrimeCache {
+public:
+    struct Permutation {
+        int32_t outputDataspace = 0;
+        int32_t outputPixelFormat = 0;
+        int32_t dimmingStage = 0;
+        int32_t renderIntent = 0;
+        int32_t sourceDataspace = 0;
+        // kNoBuffer for solid color layers.
+        int32_t sourcePixelFormat = kNoBuffer;
+        uint8_t displayColorTransform = 0;
+        uint8_t dimming = 0; // Dimming
+        uint8_t transform = 0; // Transform
+        uint8_t translucent = 0;
+        uint8_t isOpaque = 0;
+        uint8_t usePremultipliedAlpha = 0;
+        uint8_t useTextureFiltering = 0;
+        uint8_t roundedCorners = 0;
+        uint8_t shadow = 0;
+        uint8_t blur = 0;
+        uint8_t colorTransform = 0;
+        uint8_t stretch = 0;
+        uint8_t disableBlending = 0;
+        uint8_t skipContentDraw = 0;
+        // Keeps the size a multiple of 4 with no implicit padding, as the bytes are the key.
+        uint8_t reserved[2] = {};
+
+        static constexpr int32_t kNoBuffer = -1;
+
+        enum class Dimming : uint8_t { NONE, DIMMED, DITHERED };
+        enum class Transform : uint8_t { TRANSLATE, SCALE, OTHER };
+
+        bool operator==(const Permutation&) const = default;
+    };
+
+    // Loads the permutations that earlier runs recorded in path, if any.
+    explicit RecordedPrimeCache(std::string path);
+
+    // Counts one draw of layer, which RenderEngine dims by layerDimmingRatio. Called for every
+    // layer of every drawLayers, so this is a hash lookup, and the file is only rewritten in the
+    // background when a new permutation shows up or after many draws.
+    void record(const DisplaySettings& display, const LayerSettings& layer,
+                PixelFormat outputPixelFormat, float layerDimmingRatio);
+
+    // Priming draws aren't what the device composes, so they must not be recorded.
+    void setRecording(bool recording);
+
+    // Draws each recorded permutation once, most frequently drawn first. Returns false, without
+    // drawing, if nothing has been recorded yet.
+    bool prime(SkiaRenderEngine* renderengine);
+
+    // The recorded permutations and their draw counts, most frequently drawn first.
+    std::vector<std::pair<Permutation, uint64_t>> permutations() const;
+
+    // Writes the recorded permutations to the file now.
+    bool save();
+
+private:
+    struct PermutationHasher {
+        size_t operator()(const Permutation& permutation) const;
+    };
+
+    // Snapshots are written in the background, possibly out of order, so each carries a
+    // generation and an older one never overwrites a newer one. Shared with pending writes, which
+    // can outlive this object.
+    struct FileState {
+        std::mutex mutex;
+        uint64_t writtenGeneration GUARDED_BY(mutex) = 0;
+    };
+    using Snapshot = std::vector<std::pair<Permutation, uint64_t>>;
+
+    void load();
+    Snapshot snapshotLocked(uint64_t* generation) REQUIRES(mMutex);
+    static bool write(const std::string& path, FileState& file, uint64_t generation,
+                      const Snapshot& snapshot);
+
+    const std::string mPath;
+    const std::shared_ptr<FileState> mFile = std::make_shared<FileState>();
+
+    mutable std::mutex mMutex;
+    std::unordered_map<Permutation, uint64_t, PermutationHasher> mCounts GUARDED_BY(mMutex);
+    bool mRecording GUARDED_BY(mMutex) = true;
+    // Draws recorded since the file was last written.
+    uint64_t mUnsavedDraws GUARDED_BY(mMutex) = 0;
+    uint64_t mGeneration GUARDED_BY(mMutex) = 0;
+};
+
+} // namespace android::renderengine::skia
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "RenderEngine"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "SkiaCpuRenderEngine.h"
+
+#include <android-base/stringprintf.h>
+#include <sync/sync.h>
+#include <utils/Trace.h>
+
+#include <memory>
+#include <string>
+
+#include "log/log_main.h"
+
+namespace android {
+namespace renderengine {
+namespace skia {
+
+using base::StringAppendF;
+
+std::unique_ptr<SkiaCpuRenderEngine> SkiaCpuRenderEngine::create(
+        const RenderEngineCreationArgs& args) {
+    // No ensureGrContextsCreated(): the raster backend runs without a GrDirectContext.
+    return std::unique_ptr<SkiaCpuRenderEngine>(new SkiaCpuRenderEngine(args));
+}
+
+SkiaCpuRenderEngine::SkiaCpuRenderEngine(const RenderEngineCreationArgs& args)
+      : SkiaRenderEngine(args.threaded, static_cast<PixelFormat>(args.pixelFormat),
+                         args.supportsBackgroundBlur) {}
+
+SkiaCpuRenderEngine::~SkiaCpuRenderEngine() {
+    finishRenderingAndAbandonContext();
+}
+
+SkiaRenderEngine::Contexts SkiaCpuRenderEngine::createDirectContexts(
+        const GrContextOptions& /*options*/) {
+    return {};
+}
+
+bool SkiaCpuRenderEngine::supportsProtectedContentImpl() const {
+    // Protected buffers can't be mapped by the CPU.
+    return false;
+}
+
+bool SkiaCpuRenderEngine::useProtectedContextImpl(GrProtected) {
+    return false;
+}
+
+void SkiaCpuRenderEngine::waitFence(GrDirectContext*, base::borrowed_fd fenceFd) {
+    if (fenceFd.get() < 0) return;
+
+    ATRACE_NAME("SkiaCpuRenderEngine::waitFence");
+    sync_wait(fenceFd.get(), -1);
+}
+
+base::unique_fd SkiaCpuRenderEngine::flushAndSubmit(GrDirectContext*) {
+    // Raster drawing has already finished, so there is nothing left for a fence to track.
+    return base::unique_fd();
+}
+
+int SkiaCpuRenderEngine::getContextPriority() {
+    return 0;
+}
+
+void SkiaCpuRenderEngine::appendBackendSpecificInfoToDump(std::string& result) {
+    StringAppendF(&result, "\n ------------RE CPU (Skia raster)------------\n");
+}
+
+} // namespace skia
+} // namespace renderengine
+} // namespace android
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SF_SKIACPURENDERENGINE_H_
+#define SF_SKIACPURENDERENGINE_H_
+
+#include "SkiaRenderEngine.h"
+
+namespace android {
+namespace renderengine {
+namespace skia {
+
+// Draws with Skia's raster backend into CPU mappings of the buffers, for composition tests and
+// benchmarks on machines without a GPU. It has no GrDirectContext, so SkiaRenderEngine wraps the
+// buffers as raster SkSurfaces and SkImages instead of GPU textures, and all drawing is done by
+// the time drawLayers returns.
+class SkiaCpuRenderEngine : public SkiaRenderEngine {
+public:
+    static std::unique_ptr<SkiaCpuRenderEngine> create(const RenderEngineCreationArgs& args);
+    ~SkiaCpuRenderEngine() override;
+
+    int getContextPriority() override;
+
+protected:
+    // Implementations of abstract SkiaRenderEngine functions specific to
+    // rendering backend
+    SkiaRenderEngine::Contexts createDirectContexts(const GrContextOptions& options) override;
+    bool supportsProtectedContentImpl() const override;
+    bool useProtectedContextImpl(GrProtected isProtected) override;
+    void waitFence(GrDirectContext* grContext, base::borrowed_fd fenceFd) override;
+    base::unique_fd flushAndSubmit(GrDirectContext* context) override;
+    void appendBackendSpecificInfoToDump(std::string& result) override;
+
+private:
+    SkiaCpuRenderEngine(const RenderEngineCreationArgs& args);
+};
+
+} // namespace skia
+} // namespace renderengine
+} // namespace android
+
+#endif
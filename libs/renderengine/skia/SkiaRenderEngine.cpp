@@ -52,6 +52,7 @@
 #include <SkString.h>
 #include <SkSurface.h>
 #include <SkTileMode.h>
+#include <android-base/properties.h>
 #include <android-base/stringprintf.h>
 #include <common/FlagManager.h>
 #include <gui/FenceMonitor.h>
@@ -245,7 +246,21 @@ namespace skia {
 using base::StringAppendF;
 
 std::future<void> SkiaRenderEngine::primeCache(bool shouldPrimeUltraHDR) {
-    Cache::primeShaderCache(this, shouldPrimeUltraHDR);
+    // Without a GrDirectContext there are no shaders to compile ahead of time.
+    if (!mGrContext) {
+        return {};
+    }
+    if (!mRecordedPrimeCache) {
+        Cache::primeShaderCache(this, shouldPrimeUltraHDR);
+        return {};
+    }
+    // The priming draws must not count as what the device composes. Until something has been
+    // recorded, e.g. on the first boot, fall back to the fixed list.
+    mRecordedPrimeCache->setRecording(false);
+    if (!mRecordedPrimeCache->prime(this)) {
+        Cache::primeShaderCache(this, shouldPrimeUltraHDR);
+    }
+    mRecordedPrimeCache->setRecording(true);
     return {};
 }
 
@@ -278,6 +293,10 @@ SkiaRenderEngine::SkiaRenderEngine(Threaded threaded, PixelFormat pixelFormat,
         mBlurFilter = new KawaseBlurFilter();
     }
     mCapture = std::make_unique<SkiaCapture>();
+    if (const std::string path = base::GetProperty(PROPERTY_RENDERENGINE_RECORDED_PRIME_CACHE, "");
+        !path.empty()) {
+        mRecordedPrimeCache = std::make_unique<RecordedPrimeCache>(path);
+    }
 }
 
 SkiaRenderEngine::~SkiaRenderEngine() { }
@@ -665,11 +684,14 @@ void SkiaRenderEngine::drawLayersInternal(
         return;
     }
 
-    validateOutputBufferUsage(buffer->getBuffer());
-
+    // A null GrDirectContext means the raster backend, which draws into CPU mappings of the
+    // buffers, and AutoBackendTexture checks their CPU usage instead.
     auto grContext = getActiveGrContext();
-    LOG_ALWAYS_FATAL_IF(grContext->abandoned(), "GrContext is abandoned/device lost at start of %s",
-                        __func__);
+    if (grContext) {
+        validateOutputBufferUsage(buffer->getBuffer());
+        LOG_ALWAYS_FATAL_IF(grContext->abandoned(),
+                            "GrContext is abandoned/device lost at start of %s", __func__);
+    }
 
     // any AutoBackendTexture deletions will now be deferred until cleanupPostRender is called
     DeferTextureCleanup dtc(mTextureCleanupMgr);
@@ -899,6 +921,11 @@ void SkiaRenderEngine::drawLayersInternal(
                 ? displayDimmingRatio
                 : (layer.whitePointNits / maxLayerWhitePoint) * displayDimmingRatio;
 
+        if (mRecordedPrimeCache) {
+            mRecordedPrimeCache->record(display, layer, buffer->getPixelFormat(),
+                                        layerDimmingRatio);
+        }
+
         const bool dimInLinearSpace = display.dimmingStage !=
                 aidl::android::hardware::graphics::composer3::DimmingStage::GAMMA_OETF;
 
@@ -941,7 +968,9 @@ void SkiaRenderEngine::drawLayersInternal(
         SkPaint paint;
         if (layer.source.buffer.buffer) {
             ATRACE_NAME("DrawImage");
-            validateInputBufferUsage(layer.source.buffer.buffer->getBuffer());
+            if (grContext) {
+                validateInputBufferUsage(layer.source.buffer.buffer->getBuffer());
+            }
             const auto& item = layer.source.buffer;
             auto imageTextureRef = getOrCreateBackendTexture(item.buffer->getBuffer(), false);
 
@@ -1020,8 +1049,7 @@ void SkiaRenderEngine::drawLayersInternal(
                                                   .outputDataSpace = display.outputDataspace,
                                                   .fakeOutputDataspace = fakeDataspace}));
 
-            // Turn on dithering when dimming beyond this (arbitrary) threshold...
-            static constexpr float kDimmingThreshold = 0.9f;
+            // Turn on dithering when dimming beyond kDimmingThreshold (arbitrary)...
             // ...or we're rendering an HDR layer down to an 8-bit target
             // Most HDR standards require at least 10-bits of color depth for source content, so we
             // can just extract the transfer function rather than dig into precise gralloc layout.
@@ -1160,6 +1188,12 @@ void SkiaRenderEngine::drawLayersInternal(
     }
 
     auto drawFence = sp<Fence>::make(flushAndSubmit(grContext));
+    if (!grContext) {
+        // The raster backend returns no fence, so the output buffer must be unmapped, which
+        // flushes the CPU caches, before it's handed back.
+        activeSurface = nullptr;
+        dstSurface = nullptr;
+    }
 
     if (ATRACE_ENABLED()) {
         static gui::FenceMonitor sMonitor("RE Completion");
@@ -1168,12 +1202,16 @@ void SkiaRenderEngine::drawLayersInternal(
     resultPromise->set_value(std::move(drawFence));
 }
 
+// The raster backend has no texture limits of its own, so it reports a common GPU limit rather
+// than letting SurfaceFlinger size layers that the GPU backends couldn't draw.
+static constexpr size_t kMaxRasterDimension = 16384;
+
 size_t SkiaRenderEngine::getMaxTextureSize() const {
-    return mGrContext->maxTextureSize();
+    return mGrContext ? mGrContext->maxTextureSize() : kMaxRasterDimension;
 }
 
 size_t SkiaRenderEngine::getMaxViewportDims() const {
-    return mGrContext->maxRenderTargetSize();
+    return mGrContext ? mGrContext->maxRenderTargetSize() : kMaxRasterDimension;
 }
 
 void SkiaRenderEngine::drawShadow(SkCanvas* canvas,
@@ -1199,6 +1237,9 @@ void SkiaRenderEngine::onActiveDisplaySizeChanged(ui::Size size) {
     const int maxResourceBytes = size.width * size.height * SURFACE_SIZE_MULTIPLIER;
 
     // start by resizing the current context
+    if (!getActiveGrContext()) {
+        return;
+    }
     getActiveGrContext()->setResourceCacheLimit(maxResourceBytes);
 
     // if it is possible to switch contexts then we will resize the other context
@@ -1245,7 +1286,9 @@ void SkiaRenderEngine::dump(std::string& result) {
                 {"skia", "Other"},
         };
         SkiaMemoryReporter gpuReporter(gpuResourceMap, true);
-        mGrContext->dumpMemoryStatistics(&gpuReporter);
+        if (mGrContext) {
+            mGrContext->dumpMemoryStatistics(&gpuReporter);
+        }
         StringAppendF(&result, "Skia's GPU Caches: ");
         gpuReporter.logTotals(result);
         gpuReporter.logOutput(result);
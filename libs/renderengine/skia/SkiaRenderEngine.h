@@ -33,6 +33,7 @@
 
 #include "AutoBackendTexture.h"
 #include "GrContextOptions.h"
+#include "RecordedPrimeCache.h"
 #include "SkImageInfo.h"
 #include "SkiaRenderEngine.h"
 #include "android-base/macros.h"
@@ -77,6 +78,9 @@ public:
         return supportsProtectedContentImpl();
     }
     void ensureGrContextsCreated();
+
+    // Layers dimmed to this ratio or below are drawn with dithering.
+    static constexpr float kDimmingThreshold = 0.9f;
 protected:
     // This is so backends can stop the generic rendering state first before
     // cleaning up backend-specific state
@@ -180,6 +184,10 @@ private:
     // Object to capture commands send to Skia.
     std::unique_ptr<SkiaCapture> mCapture;
 
+    // Set when PROPERTY_RENDERENGINE_RECORDED_PRIME_CACHE names a file, in which case primeCache
+    // draws the recorded permutations instead of Cache's fixed list.
+    std::unique_ptr<RecordedPrimeCache> mRecordedPrimeCache;
+
     // Mutex guarding rendering operations, so that internal state related to
     // rendering that is potentially modified by multiple threads is guaranteed thread-safe.
     mutable std::mutex mRenderingMutex;
@@ -665,6 +665,7 @@ static void sSetupVulkanInterface() {
 bool RenderEngine::canSupport(GraphicsApi graphicsApi) {
     switch (graphicsApi) {
         case GraphicsApi::GL:
+        case GraphicsApi::CPU:
             return true;
         case GraphicsApi::VK: {
             if (!sVulkanInterface.initialized) {
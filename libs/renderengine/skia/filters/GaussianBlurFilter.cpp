@@ -52,8 +52,10 @@ sk_sp<SkImage> GaussianBlurFilter::generate(GrRecordingContext* context, const u
 
     // Create a surface with the scaled dimensions
     SkImageInfo scaledInfo = input->imageInfo().makeWH(scaledWidth, scaledHeight);
-    sk_sp<SkSurface> surface = SkSurfaces::RenderTarget(context,
-                                                        skgpu::Budgeted::kNo, scaledInfo);
+    // Without a GPU context, blur on the CPU for the raster backend.
+    sk_sp<SkSurface> surface = context
+            ? SkSurfaces::RenderTarget(context, skgpu::Budgeted::kNo, scaledInfo)
+            : SkSurfaces::Raster(scaledInfo);
 
     // Prepare the blur filter parameters
     const float sigmaScale = blurRadius * kInputScale * BLUR_SIGMA_SCALE;
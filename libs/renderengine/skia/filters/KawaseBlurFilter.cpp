@@ -78,7 +78,6 @@ sk_sp<SkImage> KawaseBlurFilter::generate(GrRecordingContext* context,
                                           const uint32_t blurRadius,
                                           const sk_sp<SkImage> input,
                                           const SkRect& blurRect) const {
-    LOG_ALWAYS_FATAL_IF(context == nullptr, "%s: Needs GPU context", __func__);
     LOG_ALWAYS_FATAL_IF(input == nullptr, "%s: Invalid input image", __func__);
 
     if (blurRadius == 0) {
@@ -112,9 +111,12 @@ sk_sp<SkImage> KawaseBlurFilter::generate(GrRecordingContext* context,
     constexpr int kSampleCount = 1;
     constexpr bool kMipmapped = false;
     constexpr SkSurfaceProps* kProps = nullptr;
-    sk_sp<SkSurface> surface = SkSurfaces::RenderTarget(context, skgpu::Budgeted::kNo, scaledInfo,
-                                                        kSampleCount, kTopLeft_GrSurfaceOrigin,
-                                                        kProps, kMipmapped, input->isProtected());
+    // Without a GPU context, blur on the CPU for the raster backend.
+    sk_sp<SkSurface> surface = context
+            ? SkSurfaces::RenderTarget(context, skgpu::Budgeted::kNo, scaledInfo, kSampleCount,
+                                       kTopLeft_GrSurfaceOrigin, kProps, kMipmapped,
+                                       input->isProtected())
+            : SkSurfaces::Raster(scaledInfo);
     LOG_ALWAYS_FATAL_IF(!surface, "%s: Failed to create surface for blurring!", __func__);
     sk_sp<SkImage> tmpBlur = makeImage(surface.get(), &blurBuilder);
 
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "RecordedPrimeCacheTest"
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include "../skia/RecordedPrimeCache.h"
+
+namespace android::renderengine::skia {
+
+class RecordedPrimeCacheTest : public ::testing::Test {
+protected:
+    std::string path() const { return std::string(mDir.path) + "/prime_cache"; }
+
+    void record(RecordedPrimeCache& cache, const LayerSettings& layer) {
+        cache.record(mDisplay, layer, PIXEL_FORMAT_RGBA_8888, 1.f);
+    }
+
+    TemporaryDir mDir;
+    const DisplaySettings mDisplay{.outputDataspace = ui::Dataspace::SRGB};
+};
+
+TEST_F(RecordedPrimeCacheTest, countsPermutationsMostFrequentFirst) {
+    RecordedPrimeCache cache(path());
+    EXPECT_TRUE(cache.permutations().empty());
+
+    LayerSettings rounded;
+    rounded.geometry.roundedCornersRadius = {10.f, 10.f};
+    record(cache, rounded);
+
+    // Differs from the first only in values that don't change the shaders.
+    LayerSettings solid{.alpha = 1.f};
+    for (float x : {0.f, 10.f, 20.f}) {
+        solid.geometry.boundaries = FloatRect(x, 0.f, x + 10.f, 10.f);
+        solid.source.solidColor = half3(x / 20.f, 0.f, 0.f);
+        record(cache, solid);
+    }
+
+    cache.setRecording(false);
+    LayerSettings shadow;
+    shadow.shadow.length = 15.f;
+    record(cache, shadow);
+
+    const auto permutations = cache.permutations();
+    ASSERT_EQ(2u, permutations.size());
+    EXPECT_EQ(3u, permutations[0].second);
+    EXPECT_FALSE(permutations[0].first.roundedCorners);
+    EXPECT_FALSE(permutations[0].first.translucent);
+    EXPECT_EQ(1u, permutations[1].second);
+    EXPECT_TRUE(permutations[1].first.roundedCorners);
+    EXPECT_TRUE(permutations[1].first.translucent);
+    EXPECT_EQ(RecordedPrimeCache::Permutation::kNoBuffer,
+              permutations[1].first.sourcePixelFormat);
+}
+
+TEST_F(RecordedPrimeCacheTest, dithersOnlyBelowTheDimmingThreshold) {
+    using Dimming = RecordedPrimeCache::Permutation::Dimming;
+    RecordedPrimeCache cache(path());
+    const LayerSettings layer{.alpha = 1.f};
+    cache.record(mDisplay, layer, PIXEL_FORMAT_RGBA_8888, 0.95f);
+    cache.record(mDisplay, layer, PIXEL_FORMAT_RGBA_8888, 0.95f);
+    cache.record(mDisplay, layer, PIXEL_FORMAT_RGBA_8888, 0.5f);
+
+    const auto permutations = cache.permutations();
+    ASSERT_EQ(2u, permutations.size());
+    EXPECT_EQ(static_cast<uint8_t>(Dimming::DIMMED), permutations[0].first.dimming);
+    EXPECT_EQ(static_cast<uint8_t>(Dimming::DITHERED), permutations[1].first.dimming);
+}
+
+TEST_F(RecordedPrimeCacheTest, reloadsSavedPermutations) {
+    RecordedPrimeCache cache(path());
+    LayerSettings stretched;
+    stretched.stretchEffect.vectorX = 0.5f;
+    record(cache, stretched);
+    record(cache, stretched);
+    record(cache, LayerSettings{.alpha = 1.f});
+    ASSERT_TRUE(cache.save());
+
+    RecordedPrimeCache reloaded(path());
+    EXPECT_EQ(cache.permutations(), reloaded.permutations());
+    EXPECT_TRUE(reloaded.permutations()[0].first.stretch);
+}
+
+TEST_F(RecordedPrimeCacheTest, ignoresIncompatibleFile) {
+    ASSERT_TRUE(base::WriteStringToFile("not a prime cache", path()));
+    RecordedPrimeCache cache(path());
+    EXPECT_TRUE(cache.permutations().empty());
+}
+
+} // namespace android::renderengine::skia
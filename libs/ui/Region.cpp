@@ -27,6 +27,7 @@
 #include <ui/Rect.h>
 #include <ui/Region.h>
 #include <ui/RegionHelper.h>
+#include <ui/RegionSpanOps.h>
 
 // ----------------------------------------------------------------------------
 
@@ -296,10 +297,7 @@ bool Region::hasSameRects(const Region& other) const {
 
     if (thisRectCount != otherRectCount) return false;
 
-    for (size_t i = 0; i < thisRectCount; i++) {
-        if (thisRects[i] != otherRects[i]) return false;
-    }
-    return true;
+    return region_span_ops::equal(thisRects, otherRects, thisRectCount);
 }
 
 // ----------------------------------------------------------------------------
@@ -532,18 +530,12 @@ void Region::rasterizer::flushSpan()
 {
     bool merge = false;
     if (tail-head == ssize_t(span.size())) {
+        // the new span can be folded into the previous one if it is
+        // adjacent to it and all its rects have the same horizontal extents
         Rect const* p = span.data();
         Rect const* q = head;
         if (p->top == q->bottom) {
-            merge = true;
-            while (q != tail) {
-                if ((p->left != q->left) || (p->right != q->right)) {
-                    merge = false;
-                    break;
-                }
-                p++;
-                q++;
-            }
+            merge = region_span_ops::sameColumns(p, q, span.size());
         }
     }
     if (merge) {
@@ -799,13 +791,7 @@ void Region::translate(Region& reg, int dx, int dy)
 #if defined(VALIDATE_REGIONS)
         validate(reg, "translate (before)");
 #endif
-        size_t count = reg.mStorage.size();
-        Rect* rects = reg.mStorage.data();
-        while (count) {
-            rects->offsetBy(dx, dy);
-            rects++;
-            count--;
-        }
+        region_span_ops::offset(reg.mStorage.data(), reg.mStorage.size(), dx, dy);
 #if defined(VALIDATE_REGIONS)
         validate(reg, "translate (after)");
 #endif
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <ui/Rect.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define REGION_SPAN_OPS_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define REGION_SPAN_OPS_SSE2 1
+#endif
+
+namespace android {
+namespace region_span_ops {
+
+// Span kernels used by Region's rasterizer and translate(). A Rect is four packed int32_t
+// (left, top, right, bottom), so a whole Rect fits into a single 128-bit lane. Every kernel
+// has a scalar reference version that is used on targets without NEON or SSE2, and which the
+// tests use to check the vectorized paths.
+
+static_assert(sizeof(Rect) == 4 * sizeof(int32_t), "Rect must be four packed int32_t");
+
+// Returns true if the first |count| Rects of |a| and |b| have the same horizontal extents.
+// This is the test the rasterizer uses to decide whether a band can be coalesced with the
+// band directly above it.
+inline bool sameColumnsScalar(const Rect* a, const Rect* b, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (a[i].left != b[i].left || a[i].right != b[i].right) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Offsets the |count| Rects starting at |rects| by (dx, dy).
+inline void offsetScalar(Rect* rects, size_t count, int32_t dx, int32_t dy) {
+    for (size_t i = 0; i < count; i++) {
+        rects[i].offsetBy(dx, dy);
+    }
+}
+
+// Returns true if the |count| Rects of |a| and |b| are identical.
+inline bool equalScalar(const Rect* a, const Rect* b, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#if defined(REGION_SPAN_OPS_NEON)
+
+inline bool isZero(uint32x4_t v) {
+#if defined(__aarch64__)
+    return vmaxvq_u32(v) == 0;
+#else
+    const uint32x2_t folded = vorr_u32(vget_low_u32(v), vget_high_u32(v));
+    return (vget_lane_u32(folded, 0) | vget_lane_u32(folded, 1)) == 0;
+#endif
+}
+
+inline bool sameColumns(const Rect* a, const Rect* b, size_t count) {
+    // Only left (lane 0) and right (lane 2) take part in the comparison.
+    static const uint32_t kMask[4] = {~0u, 0u, ~0u, 0u};
+    const uint32x4_t mask = vld1q_u32(kMask);
+    const uint32_t* pa = reinterpret_cast<const uint32_t*>(a);
+    const uint32_t* pb = reinterpret_cast<const uint32_t*>(b);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const uint32x4_t d0 = veorq_u32(vld1q_u32(pa + 4 * i), vld1q_u32(pb + 4 * i));
+        const uint32x4_t d1 = veorq_u32(vld1q_u32(pa + 4 * i + 4), vld1q_u32(pb + 4 * i + 4));
+        if (!isZero(vandq_u32(vorrq_u32(d0, d1), mask))) {
+            return false;
+        }
+    }
+    if (i < count) {
+        const uint32x4_t d = veorq_u32(vld1q_u32(pa + 4 * i), vld1q_u32(pb + 4 * i));
+        return isZero(vandq_u32(d, mask));
+    }
+    return true;
+}
+
+inline void offset(Rect* rects, size_t count, int32_t dx, int32_t dy) {
+    const int32_t delta[4] = {dx, dy, dx, dy};
+    const int32x4_t d = vld1q_s32(delta);
+    int32_t* p = reinterpret_cast<int32_t*>(rects);
+    for (size_t i = 0; i < count; i++) {
+        vst1q_s32(p + 4 * i, vaddq_s32(vld1q_s32(p + 4 * i), d));
+    }
+}
+
+inline bool equal(const Rect* a, const Rect* b, size_t count) {
+    const uint32_t* pa = reinterpret_cast<const uint32_t*>(a);
+    const uint32_t* pb = reinterpret_cast<const uint32_t*>(b);
+    for (size_t i = 0; i < count; i++) {
+        if (!isZero(veorq_u32(vld1q_u32(pa + 4 * i), vld1q_u32(pb + 4 * i)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#elif defined(REGION_SPAN_OPS_SSE2)
+
+inline bool isZero(__m128i v) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi32(v, _mm_setzero_si128())) == 0xFFFF;
+}
+
+inline bool sameColumns(const Rect* a, const Rect* b, size_t count) {
+    // Only left (lane 0) and right (lane 2) take part in the comparison.
+    const __m128i mask = _mm_set_epi32(0, -1, 0, -1);
+    const __m128i* pa = reinterpret_cast<const __m128i*>(a);
+    const __m128i* pb = reinterpret_cast<const __m128i*>(b);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m128i d0 = _mm_xor_si128(_mm_loadu_si128(pa + i), _mm_loadu_si128(pb + i));
+        const __m128i d1 =
+                _mm_xor_si128(_mm_loadu_si128(pa + i + 1), _mm_loadu_si128(pb + i + 1));
+        if (!isZero(_mm_and_si128(_mm_or_si128(d0, d1), mask))) {
+            return false;
+        }
+    }
+    if (i < count) {
+        const __m128i d = _mm_xor_si128(_mm_loadu_si128(pa + i), _mm_loadu_si128(pb + i));
+        return isZero(_mm_and_si128(d, mask));
+    }
+    return true;
+}
+
+inline void offset(Rect* rects, size_t count, int32_t dx, int32_t dy) {
+    const __m128i d = _mm_set_epi32(dy, dx, dy, dx);
+    __m128i* p = reinterpret_cast<__m128i*>(rects);
+    for (size_t i = 0; i < count; i++) {
+        _mm_storeu_si128(p + i, _mm_add_epi32(_mm_loadu_si128(p + i), d));
+    }
+}
+
+inline bool equal(const Rect* a, const Rect* b, size_t count) {
+    const __m128i* pa = reinterpret_cast<const __m128i*>(a);
+    const __m128i* pb = reinterpret_cast<const __m128i*>(b);
+    for (size_t i = 0; i < count; i++) {
+        if (!isZero(_mm_xor_si128(_mm_loadu_si128(pa + i), _mm_loadu_si128(pb + i)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#else
+
+inline bool sameColumns(const Rect* a, const Rect* b, size_t count) {
+    return sameColumnsScalar(a, b, count);
+}
+
+inline void offset(Rect* rects, size_t count, int32_t dx, int32_t dy) {
+    offsetScalar(rects, count, dx, dy);
+}
+
+inline bool equal(const Rect* a, const Rect* b, size_t count) {
+    return equalScalar(a, b, count);
+}
+
+#endif
+
+} // namespace region_span_ops
+} // namespace android
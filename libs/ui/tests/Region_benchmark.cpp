@@ -0,0 +1,114 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+#include <ui/RegionSpanOps.h>
+
+namespace android {
+namespace {
+
+constexpr int kDisplayWidth = 2560;
+constexpr int kDisplayHeight = 1600;
+
+// Models a multi-window layer stack: a mix of freeform windows, split-screen tasks and
+// status/navigation bars, listed front to back.
+std::vector<Rect> makeLayerStack(int layerCount) {
+    srandom(42);
+    std::vector<Rect> layers;
+    layers.emplace_back(0, 0, kDisplayWidth, 80);
+    layers.emplace_back(0, kDisplayHeight - 120, kDisplayWidth, kDisplayHeight);
+    while (static_cast<int>(layers.size()) < layerCount) {
+        const int l = random() % (kDisplayWidth - 200);
+        const int t = random() % (kDisplayHeight - 200);
+        const int w = 200 + random() % (kDisplayWidth - l - 199);
+        const int h = 200 + random() % (kDisplayHeight - t - 199);
+        layers.emplace_back(l, t, l + w, t + h);
+    }
+    return layers;
+}
+
+// Computes visible and covered regions for every layer, which is what SurfaceFlinger does
+// for each display on every frame that has geometry changes.
+void BM_VisibleRegions(benchmark::State& state) {
+    const std::vector<Rect> layers = makeLayerStack(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        Region aboveOpaqueLayers;
+        Region dirty;
+        for (const Rect& bounds : layers) {
+            Region visible = Region(bounds).subtract(aboveOpaqueLayers);
+            dirty.orSelf(visible);
+            aboveOpaqueLayers.orSelf(bounds);
+            benchmark::DoNotOptimize(visible);
+        }
+        benchmark::DoNotOptimize(dirty);
+    }
+}
+BENCHMARK(BM_VisibleRegions)->Arg(8)->Arg(32)->Arg(64)->Arg(128);
+
+Region makeFragmentedRegion(int layerCount) {
+    Region region;
+    for (const Rect& bounds : makeLayerStack(layerCount)) {
+        region.xorSelf(bounds);
+    }
+    return region;
+}
+
+void BM_Translate(benchmark::State& state) {
+    Region region = makeFragmentedRegion(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        region.translateSelf(1, -1);
+        benchmark::DoNotOptimize(region);
+    }
+}
+BENCHMARK(BM_Translate)->Arg(8)->Arg(32)->Arg(64);
+
+template <bool (*SameColumns)(const Rect*, const Rect*, size_t)>
+void BM_SameColumns(benchmark::State& state) {
+    const Region region = makeFragmentedRegion(static_cast<int>(state.range(0)));
+    size_t count;
+    const Rect* rects = region.getArray(&count);
+    const std::vector<Rect> copy(rects, rects + count);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(SameColumns(rects, copy.data(), count));
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK_TEMPLATE(BM_SameColumns, region_span_ops::sameColumnsScalar)->Arg(8)->Arg(64);
+BENCHMARK_TEMPLATE(BM_SameColumns, region_span_ops::sameColumns)->Arg(8)->Arg(64);
+
+template <bool (*Equal)(const Rect*, const Rect*, size_t)>
+void BM_Equal(benchmark::State& state) {
+    const Region region = makeFragmentedRegion(static_cast<int>(state.range(0)));
+    size_t count;
+    const Rect* rects = region.getArray(&count);
+    const std::vector<Rect> copy(rects, rects + count);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Equal(rects, copy.data(), count));
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK_TEMPLATE(BM_Equal, region_span_ops::equalScalar)->Arg(8)->Arg(64);
+BENCHMARK_TEMPLATE(BM_Equal, region_span_ops::equal)->Arg(8)->Arg(64);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -17,8 +17,11 @@
 #define LOG_TAG "RegionTest"
 
 #include <stdlib.h>
+#include <algorithm>
+#include <vector>
 #include <ui/Region.h>
 #include <ui/Rect.h>
+#include <ui/RegionSpanOps.h>
 #include <gtest/gtest.h>
 
 namespace android {
@@ -152,6 +155,85 @@ TEST_F(RegionTest, Random_TJunction) {
     }
 }
 
+// Builds the visible regions of a stack of |layerCount| overlapping windows on a small display,
+// front to back, the way SurfaceFlinger computes visible regions.
+static std::vector<Region> buildLayerStack(int layerCount, int width, int height) {
+    std::vector<Region> visibleRegions;
+    Region aboveOpaqueLayers;
+    for (int i = 0; i < layerCount; i++) {
+        const int l = random() % width;
+        const int t = random() % height;
+        const Rect bounds(l, t, l + 1 + random() % (width - l), t + 1 + random() % (height - t));
+        Region visible = Region(bounds).subtract(aboveOpaqueLayers);
+        if (random() % 3) {
+            aboveOpaqueLayers.orSelf(bounds);
+        }
+        visibleRegions.push_back(visible);
+    }
+    return visibleRegions;
+}
+
+TEST_F(RegionTest, SpanOps_MatchScalar) {
+    srandom(4321);
+
+    for (int iter = 0; iter < 50; iter++) {
+        const std::vector<Region> regions = buildLayerStack(32, 64, 64);
+        for (const Region& a : regions) {
+            for (const Region& b : regions) {
+                size_t aCount, bCount;
+                const Rect* aRects = a.getArray(&aCount);
+                const Rect* bRects = b.getArray(&bCount);
+                const size_t count = std::min(aCount, bCount);
+                EXPECT_EQ(region_span_ops::sameColumnsScalar(aRects, bRects, count),
+                          region_span_ops::sameColumns(aRects, bRects, count));
+                EXPECT_EQ(region_span_ops::equalScalar(aRects, bRects, count),
+                          region_span_ops::equal(aRects, bRects, count));
+            }
+
+            Region translated(a);
+            translated.translateSelf(7, -3);
+            size_t count;
+            const Rect* rects = a.getArray(&count);
+            std::vector<Rect> expected(rects, rects + count);
+            region_span_ops::offsetScalar(expected.data(), expected.size(), 7, -3);
+            size_t translatedCount;
+            const Rect* translatedRects = translated.getArray(&translatedCount);
+            ASSERT_EQ(count, translatedCount);
+            EXPECT_TRUE(region_span_ops::equalScalar(expected.data(), translatedRects, count));
+        }
+    }
+}
+
+TEST_F(RegionTest, LayerStack_BooleanOpsMatchPixels) {
+    constexpr int kSize = 32;
+    srandom(1234);
+
+    for (int iter = 0; iter < 20; iter++) {
+        const std::vector<Region> regions = buildLayerStack(24, kSize, kSize);
+        for (size_t i = 1; i < regions.size(); i++) {
+            const Region& a = regions[i - 1];
+            const Region& b = regions[i];
+            const Region merged = a.merge(b);
+            const Region intersected = a.intersect(b);
+            const Region subtracted = a.subtract(b);
+            const Region exclusive = a.mergeExclusive(b);
+            for (int y = 0; y < kSize; y++) {
+                for (int x = 0; x < kSize; x++) {
+                    const bool inA = a.contains(x, y);
+                    const bool inB = b.contains(x, y);
+                    ASSERT_EQ(inA || inB, merged.contains(x, y));
+                    ASSERT_EQ(inA && inB, intersected.contains(x, y));
+                    ASSERT_EQ(inA && !inB, subtracted.contains(x, y));
+                    ASSERT_EQ(inA != inB, exclusive.contains(x, y));
+                }
+            }
+            // Results are canonical: coalesced bands must leave nothing to merge.
+            EXPECT_TRUE(merged.hasSameRects(b.merge(a)));
+            EXPECT_TRUE(intersected.hasSameRects(b.intersect(a)));
+        }
+    }
+}
+
 TEST_F(RegionTest, EqualsToSelf) {
     Region touchableRegion;
     touchableRegion.orSelf(Rect(0, 0, 100, 100));
@@ -18,6 +18,14 @@
 #include <vector>
 #include <ultrahdr/gainmapmath.h>
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define USE_SIMD_ROW_KERNELS 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define USE_SIMD_ROW_KERNELS 1
+#endif
+
 namespace android::ultrahdr {
 
 static const std::vector<float> kPqOETF = [] {
@@ -772,4 +780,289 @@ uint64_t colorToRgbaF16(Color e_gamma) {
        | (((uint64_t) floatToHalf(1.0f)) << 48);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Row kernels
+
+#if USE_SIMD_ROW_KERNELS
+// Minimal four lane float vector used by the row kernels, so that every kernel has a single
+// implementation for NEON and SSE2.
+#if defined(__aarch64__)
+typedef float32x4_t vfloat;
+static inline vfloat vLoad(const float* p) { return vld1q_f32(p); }
+static inline void vStore(float* p, vfloat v) { vst1q_f32(p, v); }
+static inline vfloat vSet(float value) { return vdupq_n_f32(value); }
+static inline vfloat vAdd(vfloat a, vfloat b) { return vaddq_f32(a, b); }
+static inline vfloat vSub(vfloat a, vfloat b) { return vsubq_f32(a, b); }
+static inline vfloat vMul(vfloat a, vfloat b) { return vmulq_f32(a, b); }
+static inline vfloat vDiv(vfloat a, vfloat b) { return vdivq_f32(a, b); }
+static inline vfloat vMin(vfloat a, vfloat b) { return vminq_f32(a, b); }
+static inline vfloat vMax(vfloat a, vfloat b) { return vmaxq_f32(a, b); }
+static inline void vStoreRgba1010102(uint32_t* p, vfloat r, vfloat g, vfloat b) {
+  const uint32x4_t mask = vdupq_n_u32(0x3ff);
+  const vfloat scale = vdupq_n_f32(1023.0f);
+  uint32x4_t rgba = vandq_u32(vreinterpretq_u32_s32(vcvtq_s32_f32(vmulq_f32(r, scale))), mask);
+  rgba = vorrq_u32(rgba, vshlq_n_u32(vandq_u32(vreinterpretq_u32_s32(
+                                                       vcvtq_s32_f32(vmulq_f32(g, scale))),
+                                               mask),
+                                     10));
+  rgba = vorrq_u32(rgba, vshlq_n_u32(vandq_u32(vreinterpretq_u32_s32(
+                                                       vcvtq_s32_f32(vmulq_f32(b, scale))),
+                                               mask),
+                                     20));
+  vst1q_u32(p, vorrq_u32(rgba, vdupq_n_u32(0x3u << 30)));
+}
+#else
+typedef __m128 vfloat;
+static inline vfloat vLoad(const float* p) { return _mm_loadu_ps(p); }
+static inline void vStore(float* p, vfloat v) { _mm_storeu_ps(p, v); }
+static inline vfloat vSet(float value) { return _mm_set1_ps(value); }
+static inline vfloat vAdd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+static inline vfloat vSub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+static inline vfloat vMul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+static inline vfloat vDiv(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+static inline vfloat vMin(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+static inline vfloat vMax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+static inline void vStoreRgba1010102(uint32_t* p, vfloat r, vfloat g, vfloat b) {
+  const __m128i mask = _mm_set1_epi32(0x3ff);
+  const vfloat scale = _mm_set1_ps(1023.0f);
+  __m128i rgba = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(r, scale)), mask);
+  rgba = _mm_or_si128(rgba,
+                      _mm_slli_epi32(_mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(g, scale)), mask),
+                                     10));
+  rgba = _mm_or_si128(rgba,
+                      _mm_slli_epi32(_mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(b, scale)), mask),
+                                     20));
+  rgba = _mm_or_si128(rgba, _mm_set1_epi32(static_cast<int>(0x3u << 30)));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(p), rgba);
+}
+#endif
+
+static inline vfloat vClampPixel(vfloat v) {
+  return vMin(vMax(v, vSet(0.0f)), vSet(kMaxPixelFloat));
+}
+#endif // USE_SIMD_ROW_KERNELS
+
+YuvToRgbCoeffs getYuvToRgbCoeffs(ultrahdr_color_gamut gamut) {
+  switch (gamut) {
+    case ULTRAHDR_COLORGAMUT_P3:
+      return { kP3Cr, kP3GCb, kP3GCr, kP3Cb };
+    case ULTRAHDR_COLORGAMUT_BT2100:
+      return { kBt2100Cr, kBt2100GCb, kBt2100GCr, kBt2100Cb };
+    case ULTRAHDR_COLORGAMUT_BT709:
+    case ULTRAHDR_COLORGAMUT_UNSPECIFIED:
+    default:
+      return { kSrgbCr, kSrgbGCb, kSrgbGCr, kSrgbCb };
+  }
+}
+
+LuminanceCoeffs getLuminanceCoeffs(ultrahdr_color_gamut gamut) {
+  switch (gamut) {
+    case ULTRAHDR_COLORGAMUT_P3:
+      return { kP3R, kP3G, kP3B };
+    case ULTRAHDR_COLORGAMUT_BT2100:
+      return { kBt2100R, kBt2100G, kBt2100B };
+    case ULTRAHDR_COLORGAMUT_BT709:
+    case ULTRAHDR_COLORGAMUT_UNSPECIFIED:
+    default:
+      return { kSrgbR, kSrgbG, kSrgbB };
+  }
+}
+
+template <Color (*getPixel)(jr_uncompressed_ptr, size_t, size_t)>
+static void samplePixelsRow(jr_uncompressed_ptr image, size_t map_scale_factor, size_t y,
+                            size_t count, float* y_out, float* u_out, float* v_out) {
+  const float weight = static_cast<float>(map_scale_factor * map_scale_factor);
+  for (size_t x = 0; x < count; ++x) {
+    Color e = {{{ 0.0f, 0.0f, 0.0f }}};
+    for (size_t dy = 0; dy < map_scale_factor; ++dy) {
+      for (size_t dx = 0; dx < map_scale_factor; ++dx) {
+        e += getPixel(image, x * map_scale_factor + dx, y * map_scale_factor + dy);
+      }
+    }
+    e = e / weight;
+    y_out[x] = e.y;
+    u_out[x] = e.u;
+    v_out[x] = e.v;
+  }
+}
+
+void sampleYuv420Row(jr_uncompressed_ptr image, size_t map_scale_factor, size_t y, size_t count,
+                     float* y_out, float* u_out, float* v_out) {
+  samplePixelsRow<getYuv420Pixel>(image, map_scale_factor, y, count, y_out, u_out, v_out);
+}
+
+void sampleP010Row(jr_uncompressed_ptr image, size_t map_scale_factor, size_t y, size_t count,
+                   float* y_out, float* u_out, float* v_out) {
+  samplePixelsRow<getP010Pixel>(image, map_scale_factor, y, count, y_out, u_out, v_out);
+}
+
+void getYuv420Row(jr_uncompressed_ptr image, size_t y, size_t count, float* y_out, float* u_out,
+                  float* v_out) {
+  const uint8_t* luma_data = reinterpret_cast<uint8_t*>(image->data) + y * image->luma_stride;
+  const uint8_t* chroma_data = reinterpret_cast<uint8_t*>(image->chroma_data);
+  const size_t chroma_stride = image->chroma_stride;
+  const uint8_t* u_data = chroma_data + (y / 2) * chroma_stride;
+  const uint8_t* v_data = u_data + chroma_stride * (image->height / 2);
+  for (size_t x = 0; x < count; ++x) {
+    y_out[x] = static_cast<float>(luma_data[x]) / 255.0f;
+    u_out[x] = (static_cast<float>(u_data[x / 2]) - 128.0f) / 255.0f;
+    v_out[x] = (static_cast<float>(v_data[x / 2]) - 128.0f) / 255.0f;
+  }
+}
+
+void yuvToRgbRow(const YuvToRgbCoeffs& coeffs, float* c0, float* c1, float* c2, size_t count) {
+  size_t x = 0;
+#if USE_SIMD_ROW_KERNELS
+  const vfloat rCr = vSet(coeffs.rCr), gCb = vSet(coeffs.gCb), gCr = vSet(coeffs.gCr),
+               bCb = vSet(coeffs.bCb);
+  for (; x + 4 <= count; x += 4) {
+    const vfloat y = vLoad(c0 + x), u = vLoad(c1 + x), v = vLoad(c2 + x);
+    vStore(c0 + x, vClampPixel(vAdd(y, vMul(rCr, v))));
+    vStore(c1 + x, vClampPixel(vSub(vSub(y, vMul(gCb, u)), vMul(gCr, v))));
+    vStore(c2 + x, vClampPixel(vAdd(y, vMul(bCb, u))));
+  }
+#endif
+  for (; x < count; ++x) {
+    const float y = c0[x], u = c1[x], v = c2[x];
+    c0[x] = clampPixelFloat(y + coeffs.rCr * v);
+    c1[x] = clampPixelFloat(y - coeffs.gCb * u - coeffs.gCr * v);
+    c2[x] = clampPixelFloat(y + coeffs.bCb * u);
+  }
+}
+
+void luminanceRow(const LuminanceCoeffs& coeffs, const float* r, const float* g, const float* b,
+                  float scale, float* out, size_t count) {
+  size_t x = 0;
+#if USE_SIMD_ROW_KERNELS
+  const vfloat cr = vSet(coeffs.r), cg = vSet(coeffs.g), cb = vSet(coeffs.b), s = vSet(scale);
+  for (; x + 4 <= count; x += 4) {
+    const vfloat y = vAdd(vAdd(vMul(cr, vLoad(r + x)), vMul(cg, vLoad(g + x))),
+                          vMul(cb, vLoad(b + x)));
+    vStore(out + x, vMul(y, s));
+  }
+#endif
+  for (; x < count; ++x) {
+    out[x] = (coeffs.r * r[x] + coeffs.g * g[x] + coeffs.b * b[x]) * scale;
+  }
+}
+
+void srgbInvOetfLUTRow(float* values, size_t count) {
+  for (size_t x = 0; x < count; ++x) {
+    values[x] = srgbInvOetfLUT(values[x]);
+  }
+}
+
+void hlgOetfLUTRow(float* values, size_t count) {
+  for (size_t x = 0; x < count; ++x) {
+    values[x] = hlgOetfLUT(values[x]);
+  }
+}
+
+void pqOetfLUTRow(float* values, size_t count) {
+  for (size_t x = 0; x < count; ++x) {
+    values[x] = pqOetfLUT(values[x]);
+  }
+}
+
+void encodeGainRow(const float* y_sdr, const float* y_hdr, size_t count,
+                   ultrahdr_metadata_ptr metadata, float log2MinContentBoost,
+                   float log2MaxContentBoost, uint8_t* out) {
+  // log2 has no vector instruction, so only the ratio and clamping are batched.
+  float gains[4];
+  size_t x = 0;
+#if USE_SIMD_ROW_KERNELS
+  const vfloat minBoost = vSet(metadata->minContentBoost);
+  const vfloat maxBoost = vSet(metadata->maxContentBoost);
+  for (; x + 4 <= count; x += 4) {
+    vStore(gains, vMin(vMax(vDiv(vLoad(y_hdr + x), vLoad(y_sdr + x)), minBoost), maxBoost));
+    for (size_t i = 0; i < 4; ++i) {
+      if (!(y_sdr[x + i] > 0.0f)) {
+        out[x + i] = encodeGain(y_sdr[x + i], y_hdr[x + i], metadata, log2MinContentBoost,
+                                log2MaxContentBoost);
+        continue;
+      }
+      out[x + i] = static_cast<uint8_t>((log2(gains[i]) - log2MinContentBoost)
+                                        / (log2MaxContentBoost - log2MinContentBoost)
+                                        * 255.0f);
+    }
+  }
+#endif
+  for (; x < count; ++x) {
+    out[x] = encodeGain(y_sdr[x], y_hdr[x], metadata, log2MinContentBoost, log2MaxContentBoost);
+  }
+}
+
+void sampleMapRow(jr_uncompressed_ptr map, size_t map_scale_factor, size_t y, size_t count,
+                  ShepardsIDW& weightTables, float* out) {
+  const uint8_t* map_data = reinterpret_cast<uint8_t*>(map->data);
+  const size_t map_width = map->width;
+  const size_t map_height = map->height;
+  const size_t y_lower = std::min(y / map_scale_factor, map_height - 1);
+  const size_t y_upper = std::min(y / map_scale_factor + 1, map_height - 1);
+  const size_t offset_y = y % map_scale_factor;
+  const uint8_t* row_lower = map_data + y_lower * map_width;
+  const uint8_t* row_upper = map_data + y_upper * map_width;
+
+  // Every map pixel covers map_scale_factor output pixels of the row, which all read the same
+  // four samples and only differ in their weights.
+  size_t x = 0;
+  for (size_t x_lower = 0; x < count; ++x_lower) {
+    const size_t x_lo = std::min(x_lower, map_width - 1);
+    const size_t x_up = std::min(x_lower + 1, map_width - 1);
+    const float e1 = mapUintToFloat(row_lower[x_lo]);
+    const float e2 = mapUintToFloat(row_upper[x_lo]);
+    const float e3 = mapUintToFloat(row_lower[x_up]);
+    const float e4 = mapUintToFloat(row_upper[x_up]);
+
+    float* weights = weightTables.mWeights;
+    if (x_lo == x_up && y_lower == y_upper) weights = weightTables.mWeightsC;
+    else if (x_lo == x_up) weights = weightTables.mWeightsNR;
+    else if (y_lower == y_upper) weights = weightTables.mWeightsNB;
+    weights += offset_y * map_scale_factor * 4;
+
+    for (size_t offset_x = 0; offset_x < map_scale_factor && x < count; ++offset_x, ++x) {
+      const float* w = weights + offset_x * 4;
+      out[x] = e1 * w[0] + e2 * w[1] + e3 * w[2] + e4 * w[3];
+    }
+  }
+}
+
+void applyGainLUTRow(float* r, float* g, float* b, const float* gain, size_t count,
+                     GainLUT& gainLUT, float displayBoost) {
+  size_t x = 0;
+#if USE_SIMD_ROW_KERNELS
+  // The table lookups are scalar, the scaling of the three channels is not.
+  const vfloat boost = vSet(displayBoost);
+  float factors[4];
+  for (; x + 4 <= count; x += 4) {
+    for (size_t i = 0; i < 4; ++i) {
+      factors[i] = gainLUT.getGainFactor(gain[x + i]);
+    }
+    const vfloat f = vLoad(factors);
+    vStore(r + x, vDiv(vMul(vLoad(r + x), f), boost));
+    vStore(g + x, vDiv(vMul(vLoad(g + x), f), boost));
+    vStore(b + x, vDiv(vMul(vLoad(b + x), f), boost));
+  }
+#endif
+  for (; x < count; ++x) {
+    const float factor = gainLUT.getGainFactor(gain[x]);
+    r[x] = r[x] * factor / displayBoost;
+    g[x] = g[x] * factor / displayBoost;
+    b[x] = b[x] * factor / displayBoost;
+  }
+}
+
+void colorToRgba1010102Row(const float* r, const float* g, const float* b, size_t count,
+                           uint32_t* out) {
+  size_t x = 0;
+#if USE_SIMD_ROW_KERNELS
+  for (; x + 4 <= count; x += 4) {
+    vStoreRgba1010102(out + x, vLoad(r + x), vLoad(g + x), vLoad(b + x));
+  }
+#endif
+  for (; x < count; ++x) {
+    out[x] = colorToRgba1010102({{{ r[x], g[x], b[x] }}});
+  }
+}
+
 } // namespace android::ultrahdr
@@ -500,6 +500,89 @@ uint32_t colorToRgba1010102(Color e_gamma);
  */
 uint64_t colorToRgbaF16(Color e_gamma);
 
+////////////////////////////////////////////////////////////////////////////////
+// Row kernels
+//
+// Planar variants of the per-pixel helpers above, used by JpegR::generateGainMap and
+// JpegR::applyGainMap to process a whole row per call. Each channel lives in its own array so
+// that the arithmetic runs on four pixels per instruction where NEON or SSE2 is available.
+// Results match the per-pixel helpers up to float rounding.
+
+/*
+ * Coefficients of the YUV->RGB matrices used by srgbYuvToRgb, p3YuvToRgb and bt2100YuvToRgb.
+ */
+struct YuvToRgbCoeffs {
+  float rCr, gCb, gCr, bCb;
+};
+YuvToRgbCoeffs getYuvToRgbCoeffs(ultrahdr_color_gamut gamut);
+
+/*
+ * Coefficients of srgbLuminance, p3Luminance and bt2100Luminance.
+ */
+struct LuminanceCoeffs {
+  float r, g, b;
+};
+LuminanceCoeffs getLuminanceCoeffs(ultrahdr_color_gamut gamut);
+
+/*
+ * Same as sampleYuv420 and sampleP010 for map pixels [0, count) of map row y. Writes the
+ * averaged Y, U and V values to the respective arrays.
+ */
+void sampleYuv420Row(jr_uncompressed_ptr image, size_t map_scale_factor, size_t y, size_t count,
+                     float* y_out, float* u_out, float* v_out);
+void sampleP010Row(jr_uncompressed_ptr image, size_t map_scale_factor, size_t y, size_t count,
+                   float* y_out, float* u_out, float* v_out);
+
+/*
+ * Same as getYuv420Pixel for pixels [0, count) of row y.
+ */
+void getYuv420Row(jr_uncompressed_ptr image, size_t y, size_t count, float* y_out, float* u_out,
+                  float* v_out);
+
+/*
+ * Converts |count| YUV pixels to clamped RGB in place: c0, c1 and c2 hold Y, U and V on input
+ * and R, G and B on output.
+ */
+void yuvToRgbRow(const YuvToRgbCoeffs& coeffs, float* c0, float* c1, float* c2, size_t count);
+
+/*
+ * Writes the luminance of |count| linear RGB pixels, multiplied by |scale|, to |out|.
+ */
+void luminanceRow(const LuminanceCoeffs& coeffs, const float* r, const float* g, const float* b,
+                  float scale, float* out, size_t count);
+
+/*
+ * Applies a LUT based transfer function, e.g. srgbInvOetfLUT, to |count| values in place.
+ */
+void srgbInvOetfLUTRow(float* values, size_t count);
+void hlgOetfLUTRow(float* values, size_t count);
+void pqOetfLUTRow(float* values, size_t count);
+
+/*
+ * Same as encodeGain for |count| pixels.
+ */
+void encodeGainRow(const float* y_sdr, const float* y_hdr, size_t count,
+                   ultrahdr_metadata_ptr metadata, float log2MinContentBoost,
+                   float log2MaxContentBoost, uint8_t* out);
+
+/*
+ * Same as sampleMap with Shepard's IDW tables for pixels [0, count) of row y.
+ */
+void sampleMapRow(jr_uncompressed_ptr map, size_t map_scale_factor, size_t y, size_t count,
+                  ShepardsIDW& weightTables, float* out);
+
+/*
+ * Same as applyGainLUT followed by a division by |displayBoost|, for |count| pixels in place.
+ */
+void applyGainLUTRow(float* r, float* g, float* b, const float* gain, size_t count,
+                     GainLUT& gainLUT, float displayBoost);
+
+/*
+ * Same as colorToRgba1010102 for |count| pixels.
+ */
+void colorToRgba1010102Row(const float* r, const float* g, const float* b, size_t count,
+                           uint32_t* out);
+
 } // namespace android::ultrahdr
 
 #endif // ANDROID_ULTRAHDR_RECOVERYMAPMATH_H
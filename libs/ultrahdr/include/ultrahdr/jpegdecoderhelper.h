@@ -24,6 +24,7 @@ extern "C" {
 #include <jpeglib.h>
 }
 #include <utils/Errors.h>
+#include <functional>
 #include <vector>
 
 // constraint on max width and max height is only due to device alloc constraints
@@ -38,6 +39,22 @@ namespace android::ultrahdr {
  */
 class JpegDecoderHelper {
 public:
+    /*
+     * A band of rows of a YUV420 image decoded by decompressImageInBands(). The U and V planes
+     * hold half as many rows as the Y plane. The pointers are only valid during the callback.
+     */
+    struct YuvBand {
+        const uint8_t* y;
+        const uint8_t* u;
+        const uint8_t* v;
+        size_t lumaStride;
+        size_t chromaStride;
+        // First row of the band in the image, and number of valid rows in the band.
+        size_t rowStart;
+        size_t rowCount;
+    };
+    typedef std::function<bool(const YuvBand& band)> BandCallback;
+
     JpegDecoderHelper();
     ~JpegDecoderHelper();
     /*
@@ -46,6 +63,16 @@ public:
      * Returns false if decompressing the image fails.
      */
     bool decompressImage(const void* image, int length, bool decodeToRGBA = false);
+    /*
+     * Decompresses a JPEG image with 4:2:0 sampling to YUV420 planar bands of |bandRows| rows,
+     * and passes each band to |callback| as soon as it has been decoded, so that only a single
+     * band is held in memory. |bandRows| is rounded up to a multiple of the MCU row height.
+     * The XMP, EXIF and ICC data and the image resolution are available once the first band is
+     * passed to |callback|; getDecompressedImagePtr() is not.
+     * Returns false if decompressing the image fails or if |callback| returns false.
+     */
+    bool decompressImageInBands(const void* image, int length, size_t bandRows,
+                                const BandCallback& callback);
     /*
      * Returns the decompressed raw image buffer pointer. This method must be called only after
      * calling decompressImage().
@@ -113,10 +140,13 @@ public:
                                       std::vector<uint8_t>* exifData);
 
 private:
-    bool decode(const void* image, int length, bool decodeToRGBA);
+    bool decode(const void* image, int length, bool decodeToRGBA,
+                const BandCallback* bandCallback = nullptr, size_t bandRows = 0);
     // Returns false if errors occur.
     bool decompress(jpeg_decompress_struct* cinfo, const uint8_t* dest, bool isSingleChannel);
     bool decompressYUV(jpeg_decompress_struct* cinfo, const uint8_t* dest);
+    bool decompressYUVInBands(jpeg_decompress_struct* cinfo, size_t bandRows,
+                              const BandCallback& callback);
     bool decompressRGBA(jpeg_decompress_struct* cinfo, const uint8_t* dest);
     bool decompressSingleChannel(jpeg_decompress_struct* cinfo, const uint8_t* dest);
     // Process 16 lines of Y and 16 lines of U/V each time.
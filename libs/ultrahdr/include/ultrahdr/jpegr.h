@@ -18,6 +18,7 @@
 #define ANDROID_ULTRAHDR_JPEGR_H
 
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 #include "ultrahdr/jpegdecoderhelper.h"
@@ -119,6 +120,15 @@ typedef struct jpegr_compressed_struct* jr_compressed_ptr;
 typedef struct jpegr_exif_struct* jr_exif_ptr;
 typedef struct jpegr_info_struct* jr_info_ptr;
 
+/*
+ * Receives the output of JpegR::decodeJPEGRInBands(). |rows| holds |row_count| rows of |width|
+ * pixels each, without padding, starting at row |row_start| of the |width| x |height| image. The
+ * rows are only valid for the duration of the call. Returning false stops decoding.
+ */
+typedef std::function<bool(const void* rows, size_t width, size_t height, size_t row_start,
+                           size_t row_count)>
+        JpegRBandSink;
+
 class JpegR {
 public:
     /*
@@ -281,6 +291,35 @@ public:
                          jr_uncompressed_ptr gainmap_image_ptr = nullptr,
                          ultrahdr_metadata_ptr metadata = nullptr);
 
+    /*
+     * Decode API, streaming
+     * Decompress JPEGR image in bands of rows.
+     *
+     * Same as decodeJPEGR(), except that the primary image is decoded a few MCU rows at a time,
+     * the gain map is applied to each band as soon as it is decoded, and the resulting rows are
+     * passed to |sink| instead of being written to a destination image. Only the gain map and a
+     * single band of the primary and output images are held in memory at any time, and the
+     * first rows are available long before the whole image is decoded.
+     *
+     * @param jpegr_image_ptr compressed JPEGR image.
+     * @param sink receives the decoded rows in order, see {@code JpegRBandSink}.
+     * @param max_display_boost (optional) the maximum available boost supported by a display,
+     *                          the value must be greater than or equal to 1.0.
+     * @param exif destination of the decoded EXIF metadata, written once all rows have been
+     *             decoded. The default value is NULL where the decoder will do nothing about it.
+     * @param output_format one of {@code ULTRAHDR_OUTPUT_HDR_LINEAR},
+     *                      {@code ULTRAHDR_OUTPUT_HDR_PQ} or {@code ULTRAHDR_OUTPUT_HDR_HLG}, with
+     *                      the same pixel formats as decodeJPEGR().
+     * @param metadata destination of the decoded metadata. The default value is NULL where the
+     *                 decoder will do nothing about it.
+     * @return NO_ERROR if decoding succeeds, ERROR_JPEGR_DECODE_CANCELED if |sink| stopped the
+     *         decoding, error code if another error occurs.
+     */
+    status_t decodeJPEGRInBands(jr_compressed_ptr jpegr_image_ptr, const JpegRBandSink& sink,
+                                float max_display_boost = FLT_MAX, jr_exif_ptr exif = nullptr,
+                                ultrahdr_output_format output_format = ULTRAHDR_OUTPUT_HDR_LINEAR,
+                                ultrahdr_metadata_ptr metadata = nullptr);
+
     /*
      * Gets Info from JPEGR file without decoding it.
      *
@@ -52,6 +52,7 @@ enum {
     ERROR_JPEGR_CALCULATION_ERROR       = JPEGR_RUNTIME_ERROR_BASE - 3,
     ERROR_JPEGR_METADATA_ERROR          = JPEGR_RUNTIME_ERROR_BASE - 4,
     ERROR_JPEGR_TONEMAP_ERROR           = JPEGR_RUNTIME_ERROR_BASE - 5,
+    ERROR_JPEGR_DECODE_CANCELED         = JPEGR_RUNTIME_ERROR_BASE - 6,
 
     ERROR_JPEGR_UNSUPPORTED_FEATURE     = -20000,
 };
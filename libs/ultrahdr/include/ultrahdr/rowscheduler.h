@@ -0,0 +1,77 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_ULTRAHDR_ROWSCHEDULER_H
+#define ANDROID_ULTRAHDR_ROWSCHEDULER_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android::ultrahdr {
+
+/*
+ * Work-stealing scheduler for the rows of an image.
+ *
+ * The rows are split into one contiguous range per worker. A worker takes jobs of |jobSize|
+ * rows from the front of its own range, and once that is exhausted steals the back half of the
+ * range of another worker. Every range is a single atomic word, so neither taking nor stealing
+ * a job needs a lock, and workers that finish early keep the slower ones from becoming the
+ * long pole.
+ */
+class RowScheduler {
+public:
+  /*
+   * @param numRows number of rows to process.
+   * @param numWorkers number of workers, including the calling thread of run().
+   * @param jobSize number of rows a worker takes at a time.
+   */
+  RowScheduler(size_t numRows, size_t numWorkers, size_t jobSize);
+
+  size_t getNumWorkers() const { return mNumWorkers; }
+
+  /*
+   * Claims the next job for |worker|, first from its own range and then by stealing.
+   *
+   * @return false once all rows have been claimed.
+   */
+  bool nextJob(size_t worker, size_t& rowStart, size_t& rowEnd);
+
+  /*
+   * Calls |fn| with every job on getNumWorkers() threads, one of which is the calling thread,
+   * and returns once all rows have been processed.
+   */
+  void run(const std::function<void(size_t rowStart, size_t rowEnd)>& fn);
+
+private:
+  // Remaining rows of a worker, with the first row in the upper and the end in the lower half.
+  // Aligned to a cache line so that workers do not contend on each other's ranges.
+  struct alignas(64) Range {
+    std::atomic<uint64_t> bounds;
+  };
+
+  bool steal(size_t worker);
+
+  const size_t mNumWorkers;
+  const size_t mJobSize;
+  std::unique_ptr<Range[]> mRanges;
+};
+
+} // namespace android::ultrahdr
+
+#endif // ANDROID_ULTRAHDR_ROWSCHEDULER_H
@@ -18,6 +18,7 @@
 
 #include <utils/Log.h>
 
+#include <algorithm>
 #include <errno.h>
 #include <setjmp.h>
 #include <string>
@@ -111,6 +112,17 @@ bool JpegDecoderHelper::decompressImage(const void* image, int length, bool deco
     return decode(image, length, decodeToRGBA);
 }
 
+bool JpegDecoderHelper::decompressImageInBands(const void* image, int length, size_t bandRows,
+                                               const BandCallback& callback) {
+    if (image == nullptr || length <= 0) {
+        ALOGE("Image size can not be handled: %d", length);
+        return false;
+    }
+    mResultBuffer.clear();
+    mXMPBuffer.clear();
+    return decode(image, length, false, &callback, bandRows);
+}
+
 void* JpegDecoderHelper::getDecompressedImagePtr() {
     return mResultBuffer.data();
 }
@@ -203,7 +215,8 @@ bool JpegDecoderHelper::extractEXIF(const void* image, int length) {
     return true;
 }
 
-bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA) {
+bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA,
+                               const BandCallback* bandCallback, size_t bandRows) {
     bool status = true;
     jpeg_decompress_struct cinfo;
     jpegrerror_mgr myerr;
@@ -300,8 +313,11 @@ bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA)
                 ALOGE("%s: decoding to YUV only supports 4:2:0 subsampling", __func__);
                 goto CleanUp;
             }
-            mResultBuffer.resize(cinfo.image_width * cinfo.image_height * 3 / 2, 0);
-        } else if (cinfo.jpeg_color_space == JCS_GRAYSCALE) {
+            // In band mode the buffer only holds a single band, see decompressYUVInBands().
+            if (bandCallback == nullptr) {
+                mResultBuffer.resize(cinfo.image_width * cinfo.image_height * 3 / 2, 0);
+            }
+        } else if (cinfo.jpeg_color_space == JCS_GRAYSCALE && bandCallback == nullptr) {
             mResultBuffer.resize(cinfo.image_width * cinfo.image_height, 0);
         } else {
             status = false;
@@ -314,8 +330,13 @@ bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA)
 
     cinfo.dct_method = JDCT_ISLOW;
     jpeg_start_decompress(&cinfo);
-    if (!decompress(&cinfo, static_cast<const uint8_t*>(mResultBuffer.data()),
-                    cinfo.jpeg_color_space == JCS_GRAYSCALE)) {
+    if (bandCallback != nullptr) {
+        if (!decompressYUVInBands(&cinfo, bandRows, *bandCallback)) {
+            status = false;
+            goto CleanUp;
+        }
+    } else if (!decompress(&cinfo, static_cast<const uint8_t*>(mResultBuffer.data()),
+                           cinfo.jpeg_color_space == JCS_GRAYSCALE)) {
         status = false;
         goto CleanUp;
     }
@@ -491,6 +512,52 @@ bool JpegDecoderHelper::decompressYUV(jpeg_decompress_struct* cinfo, const uint8
     return true;
 }
 
+bool JpegDecoderHelper::decompressYUVInBands(jpeg_decompress_struct* cinfo, size_t bandRows,
+                                             const BandCallback& callback) {
+    JSAMPROW y[kCompressBatchSize];
+    JSAMPROW cb[kCompressBatchSize / 2];
+    JSAMPROW cr[kCompressBatchSize / 2];
+    JSAMPARRAY planes[3]{y, cb, cr};
+
+    // libjpeg writes whole MCUs, so the band is decoded straight into planes with an aligned
+    // stride and a whole number of MCU rows.
+    const size_t aligned_width = ALIGNM(cinfo->image_width, kCompressBatchSize);
+    bandRows = ALIGNM(std::max<size_t>(bandRows, 1), kCompressBatchSize);
+    mResultBuffer.resize(aligned_width * bandRows * 3 / 2);
+    uint8_t* y_plane = mResultBuffer.data();
+    uint8_t* u_plane = y_plane + aligned_width * bandRows;
+    uint8_t* v_plane = u_plane + (aligned_width / 2) * (bandRows / 2);
+
+    while (cinfo->output_scanline < cinfo->image_height) {
+        const size_t rowStart = cinfo->output_scanline;
+        size_t rows = 0;
+        while (rows < bandRows && cinfo->output_scanline < cinfo->image_height) {
+            for (int i = 0; i < kCompressBatchSize; ++i) {
+                y[i] = y_plane + (rows + i) * aligned_width;
+            }
+            for (int i = 0; i < kCompressBatchSize / 2; ++i) {
+                size_t offset = (rows / 2 + i) * (aligned_width / 2);
+                cb[i] = u_plane + offset;
+                cr[i] = v_plane + offset;
+            }
+            int processed = jpeg_read_raw_data(cinfo, planes, kCompressBatchSize);
+            if (processed != kCompressBatchSize) {
+                ALOGE("Number of processed lines does not equal input lines.");
+                return false;
+            }
+            rows += kCompressBatchSize;
+        }
+
+        YuvBand band{y_plane,       u_plane,  v_plane,
+                     aligned_width, aligned_width / 2,
+                     rowStart,      std::min<size_t>(rows, cinfo->image_height - rowStart)};
+        if (!callback(band)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool JpegDecoderHelper::decompressSingleChannel(jpeg_decompress_struct* cinfo,
                                                 const uint8_t* dest) {
     JSAMPROW y[kCompressBatchSize];
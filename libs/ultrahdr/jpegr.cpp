@@ -15,17 +15,15 @@
  */
 
 #include <cmath>
-#include <condition_variable>
-#include <deque>
 #include <memory>
-#include <mutex>
-#include <thread>
+#include <vector>
 
 #include <ultrahdr/gainmapmath.h>
 #include <ultrahdr/icc.h>
 #include <ultrahdr/jpegr.h>
 #include <ultrahdr/jpegrutils.h>
 #include <ultrahdr/multipictureformat.h>
+#include <ultrahdr/rowscheduler.h>
 
 #include <image_io/base/data_segment_data_source.h>
 #include <image_io/jpeg/jpeg_info.h>
@@ -40,12 +38,8 @@ using namespace photos_editing_formats::image_io;
 
 namespace android::ultrahdr {
 
-#define USE_SRGB_INVOETF_LUT 1
-#define USE_HLG_OETF_LUT 1
-#define USE_PQ_OETF_LUT 1
 #define USE_HLG_INVOETF_LUT 1
 #define USE_PQ_INVOETF_LUT 1
-#define USE_APPLY_GAIN_LUT 1
 
 #define JPEGR_CHECK(x)          \
   {                             \
@@ -58,6 +52,17 @@ namespace android::ultrahdr {
 // JPEG compress quality (0 ~ 100) for gain map
 static const int kMapCompressQuality = 85;
 
+const size_t kJobSzInRows = 16;
+static_assert(kJobSzInRows > 0 && kJobSzInRows % kMapDimensionScaleFactor == 0,
+              "align job size to kMapDimensionScaleFactor");
+
+// Rows of the primary image decoded and passed to the sink at a time by decodeJPEGRInBands.
+// A multiple of the 16 row MCU height of 4:2:0 JPEGs, and of kJobSzInRows so that every band
+// splits into whole jobs.
+const size_t kDecodeBandRows = 64;
+static_assert(kDecodeBandRows % 16 == 0 && kDecodeBandRows % kJobSzInRows == 0,
+              "align band size to MCU rows and jobs");
+
 #define CONFIG_MULTITHREAD 1
 int GetCPUCoreCount() {
   int cpuCoreCount = 1;
@@ -746,63 +751,6 @@ status_t JpegR::compressGainMap(jr_uncompressed_ptr gainmap_image_ptr,
   return NO_ERROR;
 }
 
-const int kJobSzInRows = 16;
-static_assert(kJobSzInRows > 0 && kJobSzInRows % kMapDimensionScaleFactor == 0,
-              "align job size to kMapDimensionScaleFactor");
-
-class JobQueue {
-public:
-  bool dequeueJob(size_t& rowStart, size_t& rowEnd);
-  void enqueueJob(size_t rowStart, size_t rowEnd);
-  void markQueueForEnd();
-  void reset();
-
-private:
-  bool mQueuedAllJobs = false;
-  std::deque<std::tuple<size_t, size_t>> mJobs;
-  std::mutex mMutex;
-  std::condition_variable mCv;
-};
-
-bool JobQueue::dequeueJob(size_t& rowStart, size_t& rowEnd) {
-  std::unique_lock<std::mutex> lock{mMutex};
-  while (true) {
-    if (mJobs.empty()) {
-      if (mQueuedAllJobs) {
-        return false;
-      } else {
-        mCv.wait_for(lock, std::chrono::milliseconds(100));
-      }
-    } else {
-      auto it = mJobs.begin();
-      rowStart = std::get<0>(*it);
-      rowEnd = std::get<1>(*it);
-      mJobs.erase(it);
-      return true;
-    }
-  }
-  return false;
-}
-
-void JobQueue::enqueueJob(size_t rowStart, size_t rowEnd) {
-  std::unique_lock<std::mutex> lock{mMutex};
-  mJobs.push_back(std::make_tuple(rowStart, rowEnd));
-  lock.unlock();
-  mCv.notify_one();
-}
-
-void JobQueue::markQueueForEnd() {
-  std::unique_lock<std::mutex> lock{mMutex};
-  mQueuedAllJobs = true;
-  lock.unlock();
-  mCv.notify_all();
-}
-
-void JobQueue::reset() {
-  std::unique_lock<std::mutex> lock{mMutex};
-  mJobs.clear();
-  mQueuedAllJobs = false;
-}
 
 status_t JpegR::generateGainMap(jr_uncompressed_ptr yuv420_image_ptr,
                                 jr_uncompressed_ptr p010_image_ptr,
@@ -882,111 +830,69 @@ status_t JpegR::generateGainMap(jr_uncompressed_ptr yuv420_image_ptr,
   ColorTransformFn hdrGamutConversionFn =
           getHdrConversionFn(yuv420_image_ptr->colorGamut, p010_image_ptr->colorGamut);
 
-  ColorCalculationFn luminanceFn = nullptr;
-  ColorTransformFn sdrYuvToRgbFn = nullptr;
-  switch (yuv420_image_ptr->colorGamut) {
-    case ULTRAHDR_COLORGAMUT_BT709:
-      luminanceFn = srgbLuminance;
-      sdrYuvToRgbFn = srgbYuvToRgb;
-      break;
-    case ULTRAHDR_COLORGAMUT_P3:
-      luminanceFn = p3Luminance;
-      sdrYuvToRgbFn = p3YuvToRgb;
-      break;
-    case ULTRAHDR_COLORGAMUT_BT2100:
-      luminanceFn = bt2100Luminance;
-      sdrYuvToRgbFn = bt2100YuvToRgb;
-      break;
-    case ULTRAHDR_COLORGAMUT_UNSPECIFIED:
-      // Should be impossible to hit after input validation.
-      return ERROR_JPEGR_INVALID_COLORGAMUT;
-  }
-  if (sdr_is_601) {
-    sdrYuvToRgbFn = p3YuvToRgb;
-  }
-
-  ColorTransformFn hdrYuvToRgbFn = nullptr;
-  switch (p010_image_ptr->colorGamut) {
-    case ULTRAHDR_COLORGAMUT_BT709:
-      hdrYuvToRgbFn = srgbYuvToRgb;
-      break;
-    case ULTRAHDR_COLORGAMUT_P3:
-      hdrYuvToRgbFn = p3YuvToRgb;
-      break;
-    case ULTRAHDR_COLORGAMUT_BT2100:
-      hdrYuvToRgbFn = bt2100YuvToRgb;
-      break;
-    case ULTRAHDR_COLORGAMUT_UNSPECIFIED:
-      // Should be impossible to hit after input validation.
-      return ERROR_JPEGR_INVALID_COLORGAMUT;
-  }
-
-  std::mutex mutex;
-  const int threads = std::clamp(GetCPUCoreCount(), 1, 4);
-  size_t rowStep = threads == 1 ? image_height : kJobSzInRows;
-  JobQueue jobQueue;
-
-  std::function<void()> generateMap = [yuv420_image_ptr, p010_image_ptr, metadata, dest, hdrInvOetf,
-                                       hdrGamutConversionFn, luminanceFn, sdrYuvToRgbFn,
-                                       hdrYuvToRgbFn, hdr_white_nits, log2MinBoost, log2MaxBoost,
-                                       &jobQueue]() -> void {
-    size_t rowStart, rowEnd;
-    while (jobQueue.dequeueJob(rowStart, rowEnd)) {
-      for (size_t y = rowStart; y < rowEnd; ++y) {
-        for (size_t x = 0; x < dest->width; ++x) {
-          Color sdr_yuv_gamma = sampleYuv420(yuv420_image_ptr, kMapDimensionScaleFactor, x, y);
-          Color sdr_rgb_gamma = sdrYuvToRgbFn(sdr_yuv_gamma);
-          // We are assuming the SDR input is always sRGB transfer.
-#if USE_SRGB_INVOETF_LUT
-          Color sdr_rgb = srgbInvOetfLUT(sdr_rgb_gamma);
-#else
-          Color sdr_rgb = srgbInvOetf(sdr_rgb_gamma);
-#endif
-          float sdr_y_nits = luminanceFn(sdr_rgb) * kSdrWhiteNits;
-
-          Color hdr_yuv_gamma = sampleP010(p010_image_ptr, kMapDimensionScaleFactor, x, y);
-          Color hdr_rgb_gamma = hdrYuvToRgbFn(hdr_yuv_gamma);
-          Color hdr_rgb = hdrInvOetf(hdr_rgb_gamma);
-          hdr_rgb = hdrGamutConversionFn(hdr_rgb);
-          float hdr_y_nits = luminanceFn(hdr_rgb) * hdr_white_nits;
-
-          size_t pixel_idx = x + y * dest->width;
-          reinterpret_cast<uint8_t*>(dest->data)[pixel_idx] =
-                  encodeGain(sdr_y_nits, hdr_y_nits, metadata, log2MinBoost, log2MaxBoost);
-        }
+  const YuvToRgbCoeffs sdrYuvToRgbCoeffs = getYuvToRgbCoeffs(
+          sdr_is_601 ? ULTRAHDR_COLORGAMUT_P3 : yuv420_image_ptr->colorGamut);
+  const YuvToRgbCoeffs hdrYuvToRgbCoeffs = getYuvToRgbCoeffs(p010_image_ptr->colorGamut);
+  const LuminanceCoeffs luminanceCoeffs = getLuminanceCoeffs(yuv420_image_ptr->colorGamut);
+
+  const size_t rowStep = kJobSzInRows / kMapDimensionScaleFactor;
+  const size_t threads =
+          std::clamp<size_t>(GetCPUCoreCount(), 1,
+                             std::max<size_t>((map_height + rowStep - 1) / rowStep, 1));
+  RowScheduler scheduler(map_height, threads, rowStep);
+
+  auto generateMap = [yuv420_image_ptr, p010_image_ptr, metadata, dest, hdrInvOetf,
+                      hdrGamutConversionFn, sdrYuvToRgbCoeffs, hdrYuvToRgbCoeffs,
+                      luminanceCoeffs, hdr_white_nits, log2MinBoost,
+                      log2MaxBoost](size_t rowStart, size_t rowEnd) -> void {
+    // Planar scratch rows, reused for every row of the job.
+    const size_t width = dest->width;
+    std::vector<float> scratch(width * 8);
+    float* sdr_0 = scratch.data();
+    float* sdr_1 = sdr_0 + width;
+    float* sdr_2 = sdr_1 + width;
+    float* hdr_0 = sdr_2 + width;
+    float* hdr_1 = hdr_0 + width;
+    float* hdr_2 = hdr_1 + width;
+    float* sdr_y_nits = hdr_2 + width;
+    float* hdr_y_nits = sdr_y_nits + width;
+    for (size_t y = rowStart; y < rowEnd; ++y) {
+      sampleYuv420Row(yuv420_image_ptr, kMapDimensionScaleFactor, y, width, sdr_0, sdr_1, sdr_2);
+      yuvToRgbRow(sdrYuvToRgbCoeffs, sdr_0, sdr_1, sdr_2, width);
+      // We are assuming the SDR input is always sRGB transfer.
+      srgbInvOetfLUTRow(sdr_0, width);
+      srgbInvOetfLUTRow(sdr_1, width);
+      srgbInvOetfLUTRow(sdr_2, width);
+      luminanceRow(luminanceCoeffs, sdr_0, sdr_1, sdr_2, kSdrWhiteNits, sdr_y_nits, width);
+
+      sampleP010Row(p010_image_ptr, kMapDimensionScaleFactor, y, width, hdr_0, hdr_1, hdr_2);
+      yuvToRgbRow(hdrYuvToRgbCoeffs, hdr_0, hdr_1, hdr_2, width);
+      for (size_t x = 0; x < width; ++x) {
+        Color hdr_rgb = hdrInvOetf({{{ hdr_0[x], hdr_1[x], hdr_2[x] }}});
+        hdr_rgb = hdrGamutConversionFn(hdr_rgb);
+        hdr_0[x] = hdr_rgb.r;
+        hdr_1[x] = hdr_rgb.g;
+        hdr_2[x] = hdr_rgb.b;
       }
+      luminanceRow(luminanceCoeffs, hdr_0, hdr_1, hdr_2, hdr_white_nits, hdr_y_nits, width);
+
+      encodeGainRow(sdr_y_nits, hdr_y_nits, width, metadata, log2MinBoost, log2MaxBoost,
+                    reinterpret_cast<uint8_t*>(dest->data) + y * width);
     }
   };
 
   // generate map
-  std::vector<std::thread> workers;
-  for (int th = 0; th < threads - 1; th++) {
-    workers.push_back(std::thread(generateMap));
-  }
-
-  rowStep = (threads == 1 ? image_height : kJobSzInRows) / kMapDimensionScaleFactor;
-  for (size_t rowStart = 0; rowStart < map_height;) {
-    size_t rowEnd = std::min(rowStart + rowStep, map_height);
-    jobQueue.enqueueJob(rowStart, rowEnd);
-    rowStart = rowEnd;
-  }
-  jobQueue.markQueueForEnd();
-  generateMap();
-  std::for_each(workers.begin(), workers.end(), [](std::thread& t) { t.join(); });
+  scheduler.run(generateMap);
 
   map_data.release();
   return NO_ERROR;
 }
 
-status_t JpegR::applyGainMap(jr_uncompressed_ptr yuv420_image_ptr,
-                             jr_uncompressed_ptr gainmap_image_ptr, ultrahdr_metadata_ptr metadata,
-                             ultrahdr_output_format output_format, float max_display_boost,
-                             jr_uncompressed_ptr dest) {
-  if (yuv420_image_ptr == nullptr || gainmap_image_ptr == nullptr || metadata == nullptr ||
-      dest == nullptr || yuv420_image_ptr->data == nullptr ||
-      yuv420_image_ptr->chroma_data == nullptr || gainmap_image_ptr->data == nullptr) {
-    return ERROR_JPEGR_INVALID_NULL_PTR;
-  }
+// Checks that |metadata| and the resolution of the gain map are supported for a primary image of
+// |image_width| x |image_height| pixels.
+static status_t validateGainMap(size_t image_width, size_t image_height,
+                                jr_uncompressed_ptr gainmap_image_ptr,
+                                ultrahdr_metadata_ptr metadata) {
   if (metadata->version.compare(kJpegrVersion)) {
     ALOGE("Unsupported metadata version: %s", metadata->version.c_str());
     return ERROR_JPEGR_UNSUPPORTED_METADATA;
@@ -1007,8 +913,6 @@ status_t JpegR::applyGainMap(jr_uncompressed_ptr yuv420_image_ptr,
   }
 
   // TODO: remove once map scaling factor is computed based on actual map dims
-  size_t image_width = yuv420_image_ptr->width;
-  size_t image_height = yuv420_image_ptr->height;
   size_t map_width = image_width / kMapDimensionScaleFactor;
   size_t map_height = image_height / kMapDimensionScaleFactor;
   if (map_width != gainmap_image_ptr->width || map_height != gainmap_image_ptr->height) {
@@ -1017,6 +921,94 @@ status_t JpegR::applyGainMap(jr_uncompressed_ptr yuv420_image_ptr,
           (int)map_width, (int)map_height, gainmap_image_ptr->width, gainmap_image_ptr->height);
     return ERROR_JPEGR_INVALID_INPUT_TYPE;
   }
+  return NO_ERROR;
+}
+
+static size_t getOutputPixelSize(ultrahdr_output_format output_format) {
+  return output_format == ULTRAHDR_OUTPUT_HDR_LINEAR ? sizeof(uint64_t) : sizeof(uint32_t);
+}
+
+// Applies the gain map to the first |row_count| rows of |yuv420_image_ptr|, which are rows
+// [row_offset, row_offset + row_count) of the primary image, and writes them to |dest_data|
+// without padding.
+static void applyGainMapToRows(jr_uncompressed_ptr yuv420_image_ptr, size_t row_offset,
+                               size_t row_count, jr_uncompressed_ptr gainmap_image_ptr, ShepardsIDW& idwTable,
+                               GainLUT& gainLUT, ultrahdr_output_format output_format,
+                               float display_boost, void* dest_data) {
+  auto applyRecMap = [yuv420_image_ptr, row_offset, gainmap_image_ptr, dest_data, &idwTable,
+                      output_format, &gainLUT, display_boost](size_t rowStart,
+                                                              size_t rowEnd) -> void {
+    const size_t width = yuv420_image_ptr->width;
+    // TODO: determine map scaling factor based on actual map dims
+    const size_t map_scale_factor = kMapDimensionScaleFactor;
+
+    // Planar scratch rows, reused for every row of the job.
+    std::vector<float> scratch(width * 4);
+    float* c0 = scratch.data();
+    float* c1 = c0 + width;
+    float* c2 = c1 + width;
+    float* gain = c2 + width;
+    for (size_t y = rowStart; y < rowEnd; ++y) {
+      getYuv420Row(yuv420_image_ptr, y, width, c0, c1, c2);
+      // Assuming the sdr image is a decoded JPEG, we should always use Rec.601 YUV coefficients
+      yuvToRgbRow(getYuvToRgbCoeffs(ULTRAHDR_COLORGAMUT_P3), c0, c1, c2, width);
+      // We are assuming the SDR base image is always sRGB transfer.
+      srgbInvOetfLUTRow(c0, width);
+      srgbInvOetfLUTRow(c1, width);
+      srgbInvOetfLUTRow(c2, width);
+
+      sampleMapRow(gainmap_image_ptr, map_scale_factor, row_offset + y, width, idwTable, gain);
+      applyGainLUTRow(c0, c1, c2, gain, width, gainLUT, display_boost);
+
+      switch (output_format) {
+        case ULTRAHDR_OUTPUT_HDR_LINEAR: {
+          uint64_t* row = reinterpret_cast<uint64_t*>(dest_data) + y * width;
+          for (size_t x = 0; x < width; ++x) {
+            row[x] = colorToRgbaF16({{{ c0[x], c1[x], c2[x] }}});
+          }
+          break;
+        }
+        case ULTRAHDR_OUTPUT_HDR_HLG: {
+          hlgOetfLUTRow(c0, width);
+          hlgOetfLUTRow(c1, width);
+          hlgOetfLUTRow(c2, width);
+          colorToRgba1010102Row(c0, c1, c2, width,
+                                reinterpret_cast<uint32_t*>(dest_data) + y * width);
+          break;
+        }
+        case ULTRAHDR_OUTPUT_HDR_PQ: {
+          pqOetfLUTRow(c0, width);
+          pqOetfLUTRow(c1, width);
+          pqOetfLUTRow(c2, width);
+          colorToRgba1010102Row(c0, c1, c2, width,
+                                reinterpret_cast<uint32_t*>(dest_data) + y * width);
+          break;
+        }
+        default: {
+        }
+          // Should be impossible to hit after input validation.
+      }
+    }
+  };
+
+  const size_t threads =
+          std::clamp<size_t>(GetCPUCoreCount(), 1,
+                             std::max<size_t>((row_count + kJobSzInRows - 1) / kJobSzInRows, 1));
+  RowScheduler scheduler(row_count, threads, kJobSzInRows);
+  scheduler.run(applyRecMap);
+}
+
+status_t JpegR::applyGainMap(jr_uncompressed_ptr yuv420_image_ptr,
+                             jr_uncompressed_ptr gainmap_image_ptr, ultrahdr_metadata_ptr metadata,
+                             ultrahdr_output_format output_format, float max_display_boost,
+                             jr_uncompressed_ptr dest) {
+  if (yuv420_image_ptr == nullptr || gainmap_image_ptr == nullptr || metadata == nullptr ||
+      dest == nullptr || yuv420_image_ptr->data == nullptr ||
+      yuv420_image_ptr->chroma_data == nullptr || gainmap_image_ptr->data == nullptr) {
+    return ERROR_JPEGR_INVALID_NULL_PTR;
+  }
+  JPEGR_CHECK(validateGainMap(yuv420_image_ptr->width, yuv420_image_ptr->height,
+                              gainmap_image_ptr, metadata));
 
   dest->width = yuv420_image_ptr->width;
   dest->height = yuv420_image_ptr->height;
@@ -1024,97 +1016,114 @@ status_t JpegR::applyGainMap(jr_uncompressed_ptr yuv420_image_ptr,
   float display_boost = std::min(max_display_boost, metadata->maxContentBoost);
   GainLUT gainLUT(metadata, display_boost);
 
-  JobQueue jobQueue;
-  std::function<void()> applyRecMap = [yuv420_image_ptr, gainmap_image_ptr, metadata, dest,
-                                       &jobQueue, &idwTable, output_format, &gainLUT,
-                                       display_boost]() -> void {
-    size_t width = yuv420_image_ptr->width;
-    size_t height = yuv420_image_ptr->height;
-
-    size_t rowStart, rowEnd;
-    while (jobQueue.dequeueJob(rowStart, rowEnd)) {
-      for (size_t y = rowStart; y < rowEnd; ++y) {
-        for (size_t x = 0; x < width; ++x) {
-          Color yuv_gamma_sdr = getYuv420Pixel(yuv420_image_ptr, x, y);
-          // Assuming the sdr image is a decoded JPEG, we should always use Rec.601 YUV coefficients
-          Color rgb_gamma_sdr = p3YuvToRgb(yuv_gamma_sdr);
-          // We are assuming the SDR base image is always sRGB transfer.
-#if USE_SRGB_INVOETF_LUT
-          Color rgb_sdr = srgbInvOetfLUT(rgb_gamma_sdr);
-#else
-          Color rgb_sdr = srgbInvOetf(rgb_gamma_sdr);
-#endif
-          float gain;
-          // TODO: determine map scaling factor based on actual map dims
-          size_t map_scale_factor = kMapDimensionScaleFactor;
-          // TODO: If map_scale_factor is guaranteed to be an integer, then remove the following.
-          // Currently map_scale_factor is of type size_t, but it could be changed to a float
-          // later.
-          if (map_scale_factor != floorf(map_scale_factor)) {
-            gain = sampleMap(gainmap_image_ptr, map_scale_factor, x, y);
-          } else {
-            gain = sampleMap(gainmap_image_ptr, map_scale_factor, x, y, idwTable);
-          }
+  applyGainMapToRows(yuv420_image_ptr, 0, yuv420_image_ptr->height, gainmap_image_ptr, idwTable,
+                     gainLUT, output_format, display_boost, dest->data);
+  return NO_ERROR;
+}
 
-#if USE_APPLY_GAIN_LUT
-          Color rgb_hdr = applyGainLUT(rgb_sdr, gain, gainLUT);
-#else
-          Color rgb_hdr = applyGain(rgb_sdr, gain, metadata, display_boost);
-#endif
-          rgb_hdr = rgb_hdr / display_boost;
-          size_t pixel_idx = x + y * width;
-
-          switch (output_format) {
-            case ULTRAHDR_OUTPUT_HDR_LINEAR: {
-              uint64_t rgba_f16 = colorToRgbaF16(rgb_hdr);
-              reinterpret_cast<uint64_t*>(dest->data)[pixel_idx] = rgba_f16;
-              break;
-            }
-            case ULTRAHDR_OUTPUT_HDR_HLG: {
-#if USE_HLG_OETF_LUT
-              ColorTransformFn hdrOetf = hlgOetfLUT;
-#else
-              ColorTransformFn hdrOetf = hlgOetf;
-#endif
-              Color rgb_gamma_hdr = hdrOetf(rgb_hdr);
-              uint32_t rgba_1010102 = colorToRgba1010102(rgb_gamma_hdr);
-              reinterpret_cast<uint32_t*>(dest->data)[pixel_idx] = rgba_1010102;
-              break;
-            }
-            case ULTRAHDR_OUTPUT_HDR_PQ: {
-#if USE_PQ_OETF_LUT
-              ColorTransformFn hdrOetf = pqOetfLUT;
-#else
-              ColorTransformFn hdrOetf = pqOetf;
-#endif
-              Color rgb_gamma_hdr = hdrOetf(rgb_hdr);
-              uint32_t rgba_1010102 = colorToRgba1010102(rgb_gamma_hdr);
-              reinterpret_cast<uint32_t*>(dest->data)[pixel_idx] = rgba_1010102;
-              break;
-            }
-            default: {
-            }
-              // Should be impossible to hit after input validation.
-          }
-        }
-      }
+status_t JpegR::decodeJPEGRInBands(jr_compressed_ptr jpegr_image_ptr,
+                                   const JpegRBandSink& sink, float max_display_boost,
+                                   jr_exif_ptr exif, ultrahdr_output_format output_format,
+                                   ultrahdr_metadata_ptr metadata) {
+  if (jpegr_image_ptr == nullptr || jpegr_image_ptr->data == nullptr) {
+    ALOGE("received nullptr for compressed jpegr image");
+    return ERROR_JPEGR_INVALID_NULL_PTR;
+  }
+  if (!sink) {
+    ALOGE("received empty band sink");
+    return ERROR_JPEGR_INVALID_NULL_PTR;
+  }
+  if (max_display_boost < 1.0f) {
+    ALOGE("received bad value for max_display_boost %f", max_display_boost);
+    return ERROR_JPEGR_INVALID_INPUT_TYPE;
+  }
+  if (exif != nullptr && exif->data == nullptr) {
+    ALOGE("received nullptr address for exif data");
+    return ERROR_JPEGR_INVALID_INPUT_TYPE;
+  }
+  if (output_format != ULTRAHDR_OUTPUT_HDR_LINEAR && output_format != ULTRAHDR_OUTPUT_HDR_PQ &&
+      output_format != ULTRAHDR_OUTPUT_HDR_HLG) {
+    ALOGE("received bad value for output format %d", output_format);
+    return ERROR_JPEGR_INVALID_INPUT_TYPE;
+  }
+
+  jpegr_compressed_struct primary_jpeg_image, gainmap_jpeg_image;
+  JPEGR_CHECK(
+          extractPrimaryImageAndGainMap(jpegr_image_ptr, &primary_jpeg_image, &gainmap_jpeg_image));
+
+  // The gain map is a fraction of the size of the primary image and is sampled across band
+  // boundaries, so it is decoded in full up front.
+  JpegDecoderHelper jpeg_dec_obj_gm;
+  if (!jpeg_dec_obj_gm.decompressImage(gainmap_jpeg_image.data, gainmap_jpeg_image.length)) {
+    return ERROR_JPEGR_DECODE_ERROR;
+  }
+  if ((jpeg_dec_obj_gm.getDecompressedImageWidth() * jpeg_dec_obj_gm.getDecompressedImageHeight()) >
+      jpeg_dec_obj_gm.getDecompressedImageSize()) {
+    return ERROR_JPEGR_CALCULATION_ERROR;
+  }
+
+  jpegr_uncompressed_struct gainmap_image;
+  gainmap_image.data = jpeg_dec_obj_gm.getDecompressedImagePtr();
+  gainmap_image.width = jpeg_dec_obj_gm.getDecompressedImageWidth();
+  gainmap_image.height = jpeg_dec_obj_gm.getDecompressedImageHeight();
+
+  ultrahdr_metadata_struct uhdr_metadata;
+  if (!getMetadataFromXMP(static_cast<uint8_t*>(jpeg_dec_obj_gm.getXMPPtr()),
+                          jpeg_dec_obj_gm.getXMPSize(), &uhdr_metadata)) {
+    return ERROR_JPEGR_INVALID_METADATA;
+  }
+  if (metadata != nullptr) {
+    *metadata = uhdr_metadata;
+  }
+
+  size_t image_width, image_height;
+  JpegDecoderHelper jpeg_dec_obj_yuv420;
+  if (!jpeg_dec_obj_yuv420.getCompressedImageParameters(primary_jpeg_image.data,
+                                                        primary_jpeg_image.length, &image_width,
+                                                        &image_height, nullptr, nullptr)) {
+    return ERROR_JPEGR_DECODE_ERROR;
+  }
+  JPEGR_CHECK(validateGainMap(image_width, image_height, &gainmap_image, &uhdr_metadata));
+
+  ShepardsIDW idwTable(kMapDimensionScaleFactor);
+  float display_boost = std::min(max_display_boost, uhdr_metadata.maxContentBoost);
+  GainLUT gainLUT(&uhdr_metadata, display_boost);
+  std::vector<uint8_t> output(image_width * kDecodeBandRows * getOutputPixelSize(output_format));
+
+  bool sink_stopped = false;
+  auto applyToBand = [&](const JpegDecoderHelper::YuvBand& band) -> bool {
+    // The chroma planes of a band are sized for a full band even when the last band is shorter,
+    // so the height used to locate the V plane is derived from the plane layout.
+    jpegr_uncompressed_struct band_image;
+    band_image.data = const_cast<uint8_t*>(band.y);
+    band_image.width = static_cast<int>(image_width);
+    band_image.height = static_cast<int>(2 * (band.v - band.u) / band.chromaStride);
+    band_image.colorGamut = ULTRAHDR_COLORGAMUT_UNSPECIFIED;
+    band_image.chroma_data = const_cast<uint8_t*>(band.u);
+    band_image.luma_stride = static_cast<int>(band.lumaStride);
+    band_image.chroma_stride = static_cast<int>(band.chromaStride);
+
+    applyGainMapToRows(&band_image, band.rowStart, band.rowCount, &gainmap_image, idwTable,
+                       gainLUT, output_format, display_boost, output.data());
+    if (!sink(output.data(), image_width, image_height, band.rowStart, band.rowCount)) {
+      sink_stopped = true;
+      return false;
     }
+    return true;
   };
-
-  const int threads = std::clamp(GetCPUCoreCount(), 1, 4);
-  std::vector<std::thread> workers;
-  for (int th = 0; th < threads - 1; th++) {
-    workers.push_back(std::thread(applyRecMap));
+  if (!jpeg_dec_obj_yuv420.decompressImageInBands(primary_jpeg_image.data,
+                                                  primary_jpeg_image.length, kDecodeBandRows,
+                                                  applyToBand)) {
+    return sink_stopped ? ERROR_JPEGR_DECODE_CANCELED : ERROR_JPEGR_DECODE_ERROR;
   }
-  const int rowStep = threads == 1 ? yuv420_image_ptr->height : kJobSzInRows;
-  for (int rowStart = 0; rowStart < yuv420_image_ptr->height;) {
-    int rowEnd = std::min(rowStart + rowStep, yuv420_image_ptr->height);
-    jobQueue.enqueueJob(rowStart, rowEnd);
-    rowStart = rowEnd;
+
+  if (exif != nullptr) {
+    if (exif->length < jpeg_dec_obj_yuv420.getEXIFSize()) {
+      return ERROR_JPEGR_BUFFER_TOO_SMALL;
+    }
+    memcpy(exif->data, jpeg_dec_obj_yuv420.getEXIFPtr(), jpeg_dec_obj_yuv420.getEXIFSize());
+    exif->length = jpeg_dec_obj_yuv420.getEXIFSize();
   }
-  jobQueue.markQueueForEnd();
-  applyRecMap();
-  std::for_each(workers.begin(), workers.end(), [](std::thread& t) { t.join(); });
   return NO_ERROR;
 }
 
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include <ultrahdr/rowscheduler.h>
+
+namespace android::ultrahdr {
+
+static uint64_t packRange(size_t start, size_t end) {
+  return (static_cast<uint64_t>(start) << 32) | static_cast<uint32_t>(end);
+}
+
+static size_t rangeStart(uint64_t bounds) {
+  return static_cast<size_t>(bounds >> 32);
+}
+
+static size_t rangeEnd(uint64_t bounds) {
+  return static_cast<size_t>(bounds & 0xffffffff);
+}
+
+RowScheduler::RowScheduler(size_t numRows, size_t numWorkers, size_t jobSize)
+      : mNumWorkers(std::max<size_t>(numWorkers, 1)),
+        mJobSize(std::max<size_t>(jobSize, 1)),
+        mRanges(new Range[mNumWorkers]) {
+  // Hand out whole jobs so that only the last worker ends on a partial one.
+  const size_t numJobs = (numRows + mJobSize - 1) / mJobSize;
+  size_t start = 0;
+  for (size_t worker = 0; worker < mNumWorkers; worker++) {
+    const size_t jobs = numJobs / mNumWorkers + (worker < numJobs % mNumWorkers ? 1 : 0);
+    const size_t end = std::min(start + jobs * mJobSize, numRows);
+    mRanges[worker].bounds.store(packRange(start, end), std::memory_order_relaxed);
+    start = end;
+  }
+}
+
+bool RowScheduler::nextJob(size_t worker, size_t& rowStart, size_t& rowEnd) {
+  std::atomic<uint64_t>& own = mRanges[worker].bounds;
+  do {
+    uint64_t bounds = own.load(std::memory_order_acquire);
+    while (rangeStart(bounds) < rangeEnd(bounds)) {
+      const size_t start = rangeStart(bounds);
+      const size_t end = std::min(start + mJobSize, rangeEnd(bounds));
+      if (own.compare_exchange_weak(bounds, packRange(end, rangeEnd(bounds)),
+                                    std::memory_order_acq_rel, std::memory_order_acquire)) {
+        rowStart = start;
+        rowEnd = end;
+        return true;
+      }
+    }
+  } while (steal(worker));
+  return false;
+}
+
+bool RowScheduler::steal(size_t worker) {
+  // Rows that are in flight between a victim and a thief are always processed by the thief, so
+  // it is fine to give up once every range has been seen empty.
+  for (size_t i = 1; i < mNumWorkers; i++) {
+    std::atomic<uint64_t>& victim = mRanges[(worker + i) % mNumWorkers].bounds;
+    uint64_t bounds = victim.load(std::memory_order_acquire);
+    while (rangeStart(bounds) < rangeEnd(bounds)) {
+      const size_t start = rangeStart(bounds);
+      const size_t end = rangeEnd(bounds);
+      // Take the back half, or everything if that is no more than a single job.
+      const size_t split = end - start <= mJobSize ? start : end - (end - start) / 2;
+      if (victim.compare_exchange_weak(bounds, packRange(start, split),
+                                       std::memory_order_acq_rel, std::memory_order_acquire)) {
+        // Only the owner writes to its own range while it is empty.
+        mRanges[worker].bounds.store(packRange(split, end), std::memory_order_release);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void RowScheduler::run(const std::function<void(size_t rowStart, size_t rowEnd)>& fn) {
+  auto work = [this, &fn](size_t worker) {
+    size_t rowStart, rowEnd;
+    while (nextJob(worker, rowStart, rowEnd)) {
+      fn(rowStart, rowEnd);
+    }
+  };
+  std::vector<std::thread> workers;
+  workers.reserve(mNumWorkers - 1);
+  for (size_t worker = 1; worker < mNumWorkers; worker++) {
+    workers.emplace_back(work, worker);
+  }
+  work(0);
+  std::for_each(workers.begin(), workers.end(), [](std::thread& t) { t.join(); });
+}
+
+} // namespace android::ultrahdr
@@ -1159,6 +1159,104 @@ TEST_F(GainMapMathTest, SampleMap) {
   }
 }
 
+TEST_F(GainMapMathTest, SampleRows) {
+  jpegr_uncompressed_struct yuv420 = Yuv420Image();
+  jpegr_uncompressed_struct p010 = P010Image();
+  jpegr_uncompressed_struct map = MapImage();
+  float c0[8], c1[8], c2[8];
+
+  static const size_t kMapScaleFactor = 2;
+  for (size_t y = 0; y < 4 / kMapScaleFactor; ++y) {
+    sampleYuv420Row(&yuv420, kMapScaleFactor, y, 4 / kMapScaleFactor, c0, c1, c2);
+    for (size_t x = 0; x < 4 / kMapScaleFactor; ++x) {
+      EXPECT_YUV_EQ(Color({{{ c0[x], c1[x], c2[x] }}}),
+                    sampleYuv420(&yuv420, kMapScaleFactor, x, y));
+    }
+    sampleP010Row(&p010, kMapScaleFactor, y, 4 / kMapScaleFactor, c0, c1, c2);
+    for (size_t x = 0; x < 4 / kMapScaleFactor; ++x) {
+      EXPECT_YUV_EQ(Color({{{ c0[x], c1[x], c2[x] }}}),
+                    sampleP010(&p010, kMapScaleFactor, x, y));
+    }
+  }
+
+  for (size_t y = 0; y < 4; ++y) {
+    getYuv420Row(&yuv420, y, 4, c0, c1, c2);
+    for (size_t x = 0; x < 4; ++x) {
+      EXPECT_YUV_EQ(Color({{{ c0[x], c1[x], c2[x] }}}), getYuv420Pixel(&yuv420, x, y));
+    }
+  }
+
+  ShepardsIDW idwTable(kMapScaleFactor);
+  for (size_t y = 0; y < 4 * kMapScaleFactor; ++y) {
+    sampleMapRow(&map, kMapScaleFactor, y, 4 * kMapScaleFactor, idwTable, c0);
+    for (size_t x = 0; x < 4 * kMapScaleFactor; ++x) {
+      EXPECT_FLOAT_EQ(c0[x], sampleMap(&map, kMapScaleFactor, x, y, idwTable));
+    }
+  }
+}
+
+TEST_F(GainMapMathTest, ColorRows) {
+  // Not a multiple of four, so that both the vector and the scalar tail paths are covered.
+  const Color yuvs[] = {
+    YuvBlack(), YuvWhite(), SrgbYuvRed(), SrgbYuvGreen(), SrgbYuvBlue(), P3YuvRed(),
+    P3YuvGreen(), P3YuvBlue(), Bt2100YuvRed(), Bt2100YuvGreen(), Bt2100YuvBlue(),
+  };
+  const size_t count = sizeof(yuvs) / sizeof(yuvs[0]);
+  float c0[count], c1[count], c2[count], out[count];
+  uint32_t packed[count];
+  uint8_t gains[count];
+
+  const struct {
+    ultrahdr_color_gamut gamut;
+    ColorTransformFn yuvToRgb;
+    ColorCalculationFn luminance;
+  } gamuts[] = {
+    { ULTRAHDR_COLORGAMUT_BT709, srgbYuvToRgb, srgbLuminance },
+    { ULTRAHDR_COLORGAMUT_P3, p3YuvToRgb, p3Luminance },
+    { ULTRAHDR_COLORGAMUT_BT2100, bt2100YuvToRgb, bt2100Luminance },
+  };
+  for (const auto& gamut : gamuts) {
+    for (size_t i = 0; i < count; ++i) {
+      c0[i] = yuvs[i].y;
+      c1[i] = yuvs[i].u;
+      c2[i] = yuvs[i].v;
+    }
+    yuvToRgbRow(getYuvToRgbCoeffs(gamut.gamut), c0, c1, c2, count);
+    luminanceRow(getLuminanceCoeffs(gamut.gamut), c0, c1, c2, kSdrWhiteNits, out, count);
+    colorToRgba1010102Row(c0, c1, c2, count, packed);
+    for (size_t i = 0; i < count; ++i) {
+      Color rgb = gamut.yuvToRgb(yuvs[i]);
+      EXPECT_RGB_NEAR(Color({{{ c0[i], c1[i], c2[i] }}}), rgb);
+      EXPECT_NEAR(out[i], gamut.luminance(rgb) * kSdrWhiteNits, LuminanceEpsilon());
+      EXPECT_EQ(packed[i], colorToRgba1010102({{{ c0[i], c1[i], c2[i] }}}));
+    }
+  }
+
+  ultrahdr_metadata_struct metadata = { .maxContentBoost = 8.0f, .minContentBoost = 1.0f / 8.0f };
+  for (size_t i = 0; i < count; ++i) {
+    c0[i] = static_cast<float>(i) * 10.0f;
+    c1[i] = static_cast<float>(count - i) * 40.0f;
+  }
+  encodeGainRow(c0, c1, count, &metadata, log2(metadata.minContentBoost),
+                log2(metadata.maxContentBoost), gains);
+  for (size_t i = 0; i < count; ++i) {
+    EXPECT_EQ(gains[i], encodeGain(c0[i], c1[i], &metadata));
+  }
+
+  const float displayBoost = metadata.maxContentBoost;
+  GainLUT gainLUT(&metadata, displayBoost);
+  for (size_t i = 0; i < count; ++i) {
+    c0[i] = c1[i] = c2[i] = static_cast<float>(i) / static_cast<float>(count);
+    out[i] = static_cast<float>(count - i) / static_cast<float>(count);
+  }
+  applyGainLUTRow(c0, c1, c2, out, count, gainLUT, displayBoost);
+  for (size_t i = 0; i < count; ++i) {
+    const float value = static_cast<float>(i) / static_cast<float>(count);
+    Color expected = applyGainLUT({{{ value, value, value }}}, out[i], gainLUT) / displayBoost;
+    EXPECT_RGB_NEAR(Color({{{ c0[i], c1[i], c2[i] }}}), expected);
+  }
+}
+
 TEST_F(GainMapMathTest, ColorToRgba1010102) {
   EXPECT_EQ(colorToRgba1010102(RgbBlack()), 0x3 << 30);
   EXPECT_EQ(colorToRgba1010102(RgbWhite()), 0xFFFFFFFF);
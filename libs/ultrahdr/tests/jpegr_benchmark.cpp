@@ -0,0 +1,136 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+
+#include <benchmark/benchmark.h>
+#include <ultrahdr/jpegr.h>
+
+namespace android::ultrahdr {
+namespace {
+
+// Resolutions of common camera captures.
+const std::pair<size_t, size_t> k12MP = {4000, 3000};
+const std::pair<size_t, size_t> k50MP = {8160, 6144};
+
+// Synthetic P010 and YUV420 inputs with gradients in every plane, so that the gain map has
+// a range of values rather than a single constant.
+class Inputs {
+public:
+  Inputs(size_t width, size_t height)
+        : mWidth(width),
+          mHeight(height),
+          mP010(new uint16_t[width * height * 3 / 2]),
+          mYuv420(new uint8_t[width * height * 3 / 2]) {
+    for (size_t y = 0; y < height; y++) {
+      for (size_t x = 0; x < width; x++) {
+        mP010[y * width + x] = static_cast<uint16_t>((64 + (x + y) % 876) << 6);
+        mYuv420[y * width + x] = static_cast<uint8_t>((x + 2 * y) % 256);
+      }
+    }
+    uint16_t* p010Chroma = mP010.get() + width * height;
+    for (size_t i = 0; i < width * height / 2; i++) {
+      p010Chroma[i] = static_cast<uint16_t>((64 + i % 896) << 6);
+    }
+    uint8_t* yuv420Chroma = mYuv420.get() + width * height;
+    for (size_t i = 0; i < width * height / 2; i++) {
+      yuv420Chroma[i] = static_cast<uint8_t>(i % 256);
+    }
+  }
+
+  jpegr_uncompressed_struct p010() {
+    return {mP010.get(), static_cast<int>(mWidth), static_cast<int>(mHeight),
+            ULTRAHDR_COLORGAMUT_BT2100, mP010.get() + mWidth * mHeight, static_cast<int>(mWidth),
+            static_cast<int>(mWidth)};
+  }
+
+  jpegr_uncompressed_struct yuv420() {
+    return {mYuv420.get(), static_cast<int>(mWidth), static_cast<int>(mHeight),
+            ULTRAHDR_COLORGAMUT_BT709, mYuv420.get() + mWidth * mHeight,
+            static_cast<int>(mWidth), static_cast<int>(mWidth / 2)};
+  }
+
+private:
+  const size_t mWidth;
+  const size_t mHeight;
+  std::unique_ptr<uint16_t[]> mP010;
+  std::unique_ptr<uint8_t[]> mYuv420;
+};
+
+class JpegRBenchmark : public JpegR {
+public:
+  using JpegR::applyGainMap;
+  using JpegR::generateGainMap;
+};
+
+void BM_GenerateGainMap(benchmark::State& state, std::pair<size_t, size_t> size) {
+  Inputs inputs(size.first, size.second);
+  jpegr_uncompressed_struct p010 = inputs.p010();
+  jpegr_uncompressed_struct yuv420 = inputs.yuv420();
+  JpegRBenchmark jpegr;
+  for (auto _ : state) {
+    ultrahdr_metadata_struct metadata = {.version = kJpegrVersion};
+    jpegr_uncompressed_struct map = {};
+    if (jpegr.generateGainMap(&yuv420, &p010, ULTRAHDR_TF_HLG, &metadata, &map) != NO_ERROR) {
+      state.SkipWithError("generateGainMap failed");
+      break;
+    }
+    delete[] static_cast<uint8_t*>(map.data);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(size.first * size.second));
+}
+BENCHMARK_CAPTURE(BM_GenerateGainMap, 12MP, k12MP)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_GenerateGainMap, 50MP, k50MP)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+void BM_ApplyGainMap(benchmark::State& state, std::pair<size_t, size_t> size,
+                     ultrahdr_output_format format) {
+  Inputs inputs(size.first, size.second);
+  jpegr_uncompressed_struct p010 = inputs.p010();
+  jpegr_uncompressed_struct yuv420 = inputs.yuv420();
+  JpegRBenchmark jpegr;
+  ultrahdr_metadata_struct metadata = {.version = kJpegrVersion};
+  jpegr_uncompressed_struct map = {};
+  if (jpegr.generateGainMap(&yuv420, &p010, ULTRAHDR_TF_HLG, &metadata, &map) != NO_ERROR) {
+    state.SkipWithError("generateGainMap failed");
+    return;
+  }
+  std::unique_ptr<uint8_t[]> mapData(static_cast<uint8_t*>(map.data));
+  // Large enough for RGBA F16.
+  std::unique_ptr<uint64_t[]> output(new uint64_t[size.first * size.second]);
+  jpegr_uncompressed_struct dest = {.data = output.get()};
+  for (auto _ : state) {
+    if (jpegr.applyGainMap(&yuv420, &map, &metadata, format, metadata.maxContentBoost, &dest) !=
+        NO_ERROR) {
+      state.SkipWithError("applyGainMap failed");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(size.first * size.second));
+}
+BENCHMARK_CAPTURE(BM_ApplyGainMap, 12MP_HLG, k12MP, ULTRAHDR_OUTPUT_HDR_HLG)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+BENCHMARK_CAPTURE(BM_ApplyGainMap, 12MP_LINEAR, k12MP, ULTRAHDR_OUTPUT_HDR_LINEAR)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+BENCHMARK_CAPTURE(BM_ApplyGainMap, 50MP_HLG, k50MP, ULTRAHDR_OUTPUT_HDR_HLG)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+} // namespace
+} // namespace android::ultrahdr
+
+BENCHMARK_MAIN();
@@ -1342,6 +1342,54 @@ TEST(JpegRTest, DecodeAPIWithInvalidArgs) {
           << "fail, API allows invalid output format";
 }
 
+/* Test that decoding in bands produces the same image as a full decode */
+TEST(JpegRTest, DecodeInBandsMatchesDecode) {
+  UhdrUnCompressedStructWrapper rawImg(kImageWidth, kImageHeight, YCbCr_p010);
+  ASSERT_TRUE(rawImg.setImageColorGamut(ultrahdr_color_gamut::ULTRAHDR_COLORGAMUT_BT2100));
+  ASSERT_TRUE(rawImg.allocateMemory());
+  ASSERT_TRUE(rawImg.loadRawResource(kYCbCrP010FileName));
+  UhdrCompressedStructWrapper jpgImg(kImageWidth, kImageHeight);
+  ASSERT_TRUE(jpgImg.allocateMemory());
+  JpegR uHdrLib;
+  ASSERT_EQ(uHdrLib.encodeJPEGR(rawImg.getImageHandle(),
+                                ultrahdr_transfer_function::ULTRAHDR_TF_HLG,
+                                jpgImg.getImageHandle(), kQuality, nullptr),
+            OK);
+
+  for (auto format : {ULTRAHDR_OUTPUT_HDR_LINEAR, ULTRAHDR_OUTPUT_HDR_PQ}) {
+    const size_t pixelSize = format == ULTRAHDR_OUTPUT_HDR_LINEAR ? 8 : 4;
+    const size_t outSize = kImageWidth * kImageHeight * pixelSize;
+    std::unique_ptr<uint8_t[]> full = std::make_unique<uint8_t[]>(outSize);
+    jpegr_uncompressed_struct destImage{};
+    destImage.data = full.get();
+    ASSERT_EQ(uHdrLib.decodeJPEGR(jpgImg.getImageHandle(), &destImage, FLT_MAX, nullptr, format),
+              OK);
+
+    std::unique_ptr<uint8_t[]> banded = std::make_unique<uint8_t[]>(outSize);
+    size_t nextRow = 0;
+    auto sink = [&](const void* rows, size_t width, size_t height, size_t rowStart,
+                    size_t rowCount) {
+      EXPECT_EQ(kImageWidth, width);
+      EXPECT_EQ(kImageHeight, height);
+      EXPECT_EQ(nextRow, rowStart);
+      EXPECT_LE(rowStart + rowCount, height);
+      memcpy(banded.get() + rowStart * width * pixelSize, rows, rowCount * width * pixelSize);
+      nextRow = rowStart + rowCount;
+      return true;
+    };
+    ASSERT_EQ(uHdrLib.decodeJPEGRInBands(jpgImg.getImageHandle(), sink, FLT_MAX, nullptr, format),
+              OK);
+    ASSERT_EQ(kImageHeight, nextRow);
+    ASSERT_EQ(0, memcmp(full.get(), banded.get(), outSize));
+  }
+
+  // stopping in the sink cancels decoding
+  int calls = 0;
+  auto stop = [&](const void*, size_t, size_t, size_t, size_t) { return ++calls < 2; };
+  ASSERT_EQ(uHdrLib.decodeJPEGRInBands(jpgImg.getImageHandle(), stop), ERROR_JPEGR_DECODE_CANCELED);
+  ASSERT_EQ(2, calls);
+}
+
 TEST(JpegRTest, writeXmpThenRead) {
   ultrahdr_metadata_struct metadata_expected;
   metadata_expected.version = "1.0";
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <ultrahdr/rowscheduler.h>
+
+namespace android::ultrahdr {
+
+class RowSchedulerTest : public testing::TestWithParam<std::tuple<size_t, size_t, size_t>> {};
+
+TEST_P(RowSchedulerTest, ProcessesEveryRowOnce) {
+  const auto [numRows, numWorkers, jobSize] = GetParam();
+  std::vector<std::atomic<int>> visits(numRows);
+  std::atomic<size_t> jobs = 0;
+
+  RowScheduler scheduler(numRows, numWorkers, jobSize);
+  scheduler.run([&](size_t rowStart, size_t rowEnd) {
+    EXPECT_LT(rowStart, rowEnd);
+    EXPECT_LE(rowEnd - rowStart, jobSize);
+    for (size_t row = rowStart; row < rowEnd; row++) {
+      visits[row]++;
+    }
+    jobs++;
+  });
+
+  for (size_t row = 0; row < numRows; row++) {
+    EXPECT_EQ(visits[row], 1) << "row " << row;
+  }
+  EXPECT_GE(jobs, (numRows + jobSize - 1) / jobSize);
+}
+
+INSTANTIATE_TEST_SUITE_P(RowSchedulerParameterized, RowSchedulerTest,
+                         testing::Combine(testing::Values(0, 1, 17, 720, 3000),
+                                          testing::Values(1, 2, 8),
+                                          testing::Values(1, 4, 16)));
+
+TEST(RowSchedulerTest, StealsFromOtherWorkers) {
+  // Worker 1 never runs, so worker 0 has to steal all of its rows.
+  RowScheduler scheduler(64, 2, 4);
+  std::vector<bool> visited(64, false);
+  size_t rowStart, rowEnd;
+  while (scheduler.nextJob(0, rowStart, rowEnd)) {
+    for (size_t row = rowStart; row < rowEnd; row++) {
+      EXPECT_FALSE(visited[row]);
+      visited[row] = true;
+    }
+  }
+  for (size_t row = 0; row < 64; row++) {
+    EXPECT_TRUE(visited[row]) << "row " << row;
+  }
+  EXPECT_FALSE(scheduler.nextJob(1, rowStart, rowEnd));
+}
+
+} // namespace android::ultrahdr
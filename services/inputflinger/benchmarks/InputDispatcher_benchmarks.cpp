@@ -16,6 +16,7 @@
 
 #include <benchmark/benchmark.h>
 
+#include <NotifyArgsBuilders.h>
 #include <android/os/IInputConstants.h>
 #include <binder/Binder.h>
 #include <gui/constants.h>
@@ -42,6 +43,13 @@ constexpr int32_t DISPLAY_ID = ADISPLAY_ID_DEFAULT;
 
 static constexpr std::chrono::duration INJECT_EVENT_TIMEOUT = 5s;
 
+// Interval between samples of a high-rate stylus or touch screen.
+static constexpr nsecs_t SAMPLE_INTERVAL_1KHZ = 1'000'000;
+
+// Number of MOVE samples sent per gesture by the high-rate benchmarks, about one frame's worth
+// at 1kHz.
+static constexpr int MOVES_PER_GESTURE = 16;
+
 static nsecs_t now() {
     return systemTime(SYSTEM_TIME_MONOTONIC);
 }
@@ -136,6 +144,129 @@ static void benchmarkNotifyMotion(benchmark::State& state) {
     dispatcher.stop();
 }
 
+static NotifyMotionArgs generateTouchArgs(int32_t action, const std::vector<vec2>& points,
+                                          nsecs_t downTime, nsecs_t eventTime) {
+    MotionArgsBuilder builder(action, AINPUT_SOURCE_TOUCHSCREEN);
+    builder.deviceId(DEVICE_ID).displayId(DISPLAY_ID).downTime(downTime).eventTime(eventTime);
+    for (size_t i = 0; i < points.size(); i++) {
+        builder.pointer(PointerBuilder(/*id=*/i, ToolType::FINGER).x(points[i].x).y(points[i].y));
+    }
+    return builder.build();
+}
+
+/**
+ * A single-pointer gesture reported at 1kHz: one DOWN, a frame's worth of MOVE samples spaced
+ * 1ms apart, then UP. Every sample is consumed before the next one is sent, so the time per
+ * iteration is dominated by the per-sample cost of the dispatcher.
+ */
+static void benchmarkNotifyMotionAt1kHz(benchmark::State& state) {
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    sp<FakeWindowHandle> window =
+            sp<FakeWindowHandle>::make(application, dispatcher, "Fake Window", DISPLAY_ID);
+
+    dispatcher.onWindowInfosChanged({{*window->getInfo()}, {}, 0, 0});
+
+    for (auto _ : state) {
+        const nsecs_t downTime = now();
+        nsecs_t eventTime = downTime;
+        dispatcher.notifyMotion(
+                generateTouchArgs(AMOTION_EVENT_ACTION_DOWN, {{100, 100}}, downTime, eventTime));
+        window->consumeMotion();
+
+        for (int i = 1; i <= MOVES_PER_GESTURE; i++) {
+            eventTime += SAMPLE_INTERVAL_1KHZ;
+            dispatcher.notifyMotion(generateTouchArgs(AMOTION_EVENT_ACTION_MOVE,
+                                                      {{100.0f + i, 100.0f + i}}, downTime,
+                                                      eventTime));
+            window->consumeMotion();
+        }
+
+        eventTime += SAMPLE_INTERVAL_1KHZ;
+        dispatcher.notifyMotion(generateTouchArgs(AMOTION_EVENT_ACTION_UP,
+                                                  {{100.0f + MOVES_PER_GESTURE,
+                                                    100.0f + MOVES_PER_GESTURE}},
+                                                  downTime, eventTime));
+        window->consumeMotion();
+    }
+    state.SetItemsProcessed(state.iterations() * (MOVES_PER_GESTURE + 2));
+
+    dispatcher.stop();
+}
+
+/**
+ * A two-pointer gesture at 1kHz where each pointer is in a different window, so that every
+ * sample is split into one event per window.
+ */
+static void benchmarkNotifyMotionSplitAcrossWindows(benchmark::State& state) {
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    sp<FakeWindowHandle> left =
+            sp<FakeWindowHandle>::make(application, dispatcher, "Left Window", DISPLAY_ID);
+    left->setFrame(Rect(0, 0, 200, 400));
+    sp<FakeWindowHandle> right =
+            sp<FakeWindowHandle>::make(application, dispatcher, "Right Window", DISPLAY_ID);
+    right->setFrame(Rect(200, 0, 400, 400));
+
+    dispatcher.onWindowInfosChanged({{*left->getInfo(), *right->getInfo()}, {}, 0, 0});
+
+    const int32_t pointer1Down = AMOTION_EVENT_ACTION_POINTER_DOWN |
+            (1 << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT);
+    const int32_t pointer1Up =
+            AMOTION_EVENT_ACTION_POINTER_UP | (1 << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT);
+
+    for (auto _ : state) {
+        const nsecs_t downTime = now();
+        nsecs_t eventTime = downTime;
+        dispatcher.notifyMotion(
+                generateTouchArgs(AMOTION_EVENT_ACTION_DOWN, {{100, 100}}, downTime, eventTime));
+        left->consumeMotion();
+
+        eventTime += SAMPLE_INTERVAL_1KHZ;
+        dispatcher.notifyMotion(
+                generateTouchArgs(pointer1Down, {{100, 100}, {300, 100}}, downTime, eventTime));
+        // The right window gets a DOWN, and the left window a MOVE.
+        right->consumeMotion();
+        left->consumeMotion();
+
+        for (int i = 1; i <= MOVES_PER_GESTURE; i++) {
+            eventTime += SAMPLE_INTERVAL_1KHZ;
+            dispatcher.notifyMotion(generateTouchArgs(AMOTION_EVENT_ACTION_MOVE,
+                                                      {{100.0f + i, 100.0f + i},
+                                                       {300.0f + i, 100.0f + i}},
+                                                      downTime, eventTime));
+            left->consumeMotion();
+            right->consumeMotion();
+        }
+
+        const float offset = MOVES_PER_GESTURE;
+        eventTime += SAMPLE_INTERVAL_1KHZ;
+        dispatcher.notifyMotion(generateTouchArgs(pointer1Up,
+                                                  {{100 + offset, 100 + offset},
+                                                   {300 + offset, 100 + offset}},
+                                                  downTime, eventTime));
+        right->consumeMotion();
+        left->consumeMotion();
+
+        eventTime += SAMPLE_INTERVAL_1KHZ;
+        dispatcher.notifyMotion(generateTouchArgs(AMOTION_EVENT_ACTION_UP,
+                                                  {{100 + offset, 100 + offset}}, downTime,
+                                                  eventTime));
+        left->consumeMotion();
+    }
+    state.SetItemsProcessed(state.iterations() * (MOVES_PER_GESTURE + 4));
+
+    dispatcher.stop();
+}
+
 static void benchmarkInjectMotion(benchmark::State& state) {
     // Create dispatcher
     FakeInputDispatcherPolicy fakePolicy;
@@ -199,6 +330,8 @@ static void benchmarkOnWindowInfosChanged(benchmark::State& state) {
 } // namespace
 
 BENCHMARK(benchmarkNotifyMotion);
+BENCHMARK(benchmarkNotifyMotionAt1kHz);
+BENCHMARK(benchmarkNotifyMotionSplitAcrossWindows);
 BENCHMARK(benchmarkInjectMotion);
 BENCHMARK(benchmarkOnWindowInfosChanged);
 
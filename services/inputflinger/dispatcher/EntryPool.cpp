@@ -0,0 +1,125 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EntryPool.h"
+
+#include <android-base/no_destructor.h>
+#include <android-base/thread_annotations.h>
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace android::inputdispatcher {
+
+namespace {
+
+// Block sizes are multiples of the size class granularity, which keeps every block aligned for
+// any fundamental type.
+constexpr size_t GRANULARITY = alignof(std::max_align_t);
+constexpr size_t NUM_SIZE_CLASSES = EntryPool::MAX_BLOCK_SIZE / GRANULARITY;
+static_assert(EntryPool::MAX_BLOCK_SIZE % GRANULARITY == 0);
+
+// Number of blocks carved out of each slab.
+constexpr size_t BLOCKS_PER_SLAB = 32;
+
+class SizeClass {
+public:
+    void* allocate(size_t blockSize) {
+        std::scoped_lock lock(mLock);
+        if (mFreeList == nullptr) {
+            refillLocked(blockSize);
+        }
+        FreeBlock* block = mFreeList;
+        mFreeList = block->next;
+        mCachedBlocks--;
+        return block;
+    }
+
+    void deallocate(void* ptr) {
+        std::scoped_lock lock(mLock);
+        FreeBlock* block = static_cast<FreeBlock*>(ptr);
+        block->next = mFreeList;
+        mFreeList = block;
+        mCachedBlocks++;
+    }
+
+    size_t getCachedBlockCount() {
+        std::scoped_lock lock(mLock);
+        return mCachedBlocks;
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    std::mutex mLock;
+    FreeBlock* mFreeList GUARDED_BY(mLock) = nullptr;
+    size_t mCachedBlocks GUARDED_BY(mLock) = 0;
+
+    void refillLocked(size_t blockSize) REQUIRES(mLock) {
+        // Slabs are never released: the pool lives as long as the process, and its size is
+        // bounded by the peak number of entries in flight.
+        uint8_t* slab = static_cast<uint8_t*>(::operator new(blockSize * BLOCKS_PER_SLAB));
+        for (size_t i = BLOCKS_PER_SLAB; i > 0; i--) {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(slab + (i - 1) * blockSize);
+            block->next = mFreeList;
+            mFreeList = block;
+        }
+        mCachedBlocks += BLOCKS_PER_SLAB;
+    }
+};
+
+// Entries can be released from static destructors, so the size classes are never destroyed.
+std::array<SizeClass, NUM_SIZE_CLASSES>& getSizeClasses() {
+    static base::NoDestructor<std::array<SizeClass, NUM_SIZE_CLASSES>> sSizeClasses;
+    return *sSizeClasses;
+}
+
+size_t sizeClassIndex(size_t size) {
+    return (size == 0 ? 0 : (size - 1) / GRANULARITY);
+}
+
+} // namespace
+
+void* EntryPool::allocate(size_t size) {
+    if (size > MAX_BLOCK_SIZE) {
+        return ::operator new(size);
+    }
+    const size_t index = sizeClassIndex(size);
+    return getSizeClasses()[index].allocate((index + 1) * GRANULARITY);
+}
+
+void EntryPool::deallocate(void* ptr, size_t size) {
+    if (ptr == nullptr) {
+        return;
+    }
+    if (size > MAX_BLOCK_SIZE) {
+        ::operator delete(ptr);
+        return;
+    }
+    getSizeClasses()[sizeClassIndex(size)].deallocate(ptr);
+}
+
+size_t EntryPool::getCachedBlockCount(size_t size) {
+    if (size > MAX_BLOCK_SIZE) {
+        return 0;
+    }
+    return getSizeClasses()[sizeClassIndex(size)].getCachedBlockCount();
+}
+
+} // namespace android::inputdispatcher
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <memory>
+
+namespace android::inputdispatcher {
+
+/**
+ * Slab allocator for the short-lived objects that the dispatcher creates for every input event:
+ * EventEntry and DispatchEntry subclasses, and the shared_ptr control blocks that own them.
+ *
+ * Blocks are grouped into size classes. Each size class carves blocks out of slabs and keeps
+ * released blocks on a free list, so that in steady state (for example, a stylus reporting at
+ * 1kHz) dispatching an event does not reach the system allocator. Slabs are kept for the
+ * lifetime of the process. Requests larger than the largest size class fall through to
+ * ::operator new.
+ *
+ * Entries are allocated on the reader thread and released on the dispatcher thread (or by
+ * whoever drops the last reference), so every size class is guarded by its own lock.
+ */
+class EntryPool {
+public:
+    static void* allocate(size_t size);
+    static void deallocate(void* ptr, size_t size);
+
+    // Number of free blocks cached for allocations of the given size. Used by tests.
+    static size_t getCachedBlockCount(size_t size);
+
+    // Largest allocation that is served from the pool.
+    static constexpr size_t MAX_BLOCK_SIZE = 512;
+};
+
+/**
+ * Standard allocator backed by EntryPool, for use with std::allocate_shared and the allocator
+ * aware shared_ptr constructors.
+ */
+template <typename T>
+struct EntryAllocator {
+    using value_type = T;
+
+    EntryAllocator() = default;
+    template <typename U>
+    EntryAllocator(const EntryAllocator<U>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(EntryPool::allocate(n * sizeof(T))); }
+    void deallocate(T* ptr, size_t n) { EntryPool::deallocate(ptr, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const EntryAllocator<U>&) const {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const EntryAllocator<U>&) const {
+        return false;
+    }
+};
+
+/**
+ * Converts a uniquely owned entry into a shared one, taking the control block from the pool
+ * rather than from the system allocator.
+ */
+template <typename T>
+std::shared_ptr<T> toSharedEntry(std::unique_ptr<T> entry) {
+    return std::shared_ptr<T>(entry.release(), std::default_delete<T>(), EntryAllocator<T>());
+}
+
+} // namespace android::inputdispatcher
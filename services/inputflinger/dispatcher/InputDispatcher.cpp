@@ -444,7 +444,8 @@ std::unique_ptr<DispatchEntry> createDispatchEntry(const IdGenerator& idGenerato
                                           pointerCoords);
 
     std::unique_ptr<DispatchEntry> dispatchEntry =
-            std::make_unique<DispatchEntry>(std::move(combinedMotionEntry), inputTargetFlags,
+            std::make_unique<DispatchEntry>(toSharedEntry(std::move(combinedMotionEntry)),
+                                            inputTargetFlags,
                                             *transform, *displayTransform,
                                             inputTarget.globalScaleFactor, uid, vsyncId, windowId);
     return dispatchEntry;
@@ -1265,7 +1266,7 @@ bool InputDispatcher::shouldPruneInboundQueueLocked(const MotionEntry& motionEnt
 
 bool InputDispatcher::enqueueInboundEventLocked(std::unique_ptr<EventEntry> newEntry) {
     bool needWake = mInboundQueue.empty();
-    mInboundQueue.push_back(std::move(newEntry));
+    mInboundQueue.push_back(toSharedEntry(std::move(newEntry)));
     const EventEntry& entry = *(mInboundQueue.back());
     traceInboundQueueLengthLocked();
 
@@ -1560,12 +1561,12 @@ std::shared_ptr<KeyEntry> InputDispatcher::synthesizeKeyRepeatLocked(nsecs_t cur
     uint32_t policyFlags = entry->policyFlags &
             (POLICY_FLAG_RAW_MASK | POLICY_FLAG_PASS_TO_USER | POLICY_FLAG_TRUSTED);
 
-    std::shared_ptr<KeyEntry> newEntry =
+    std::shared_ptr<KeyEntry> newEntry = toSharedEntry(
             std::make_unique<KeyEntry>(mIdGenerator.nextId(), /*injectionState=*/nullptr,
                                        currentTime, entry->deviceId, entry->source,
                                        entry->displayId, policyFlags, entry->action, entry->flags,
                                        entry->keyCode, entry->scanCode, entry->metaState,
-                                       entry->repeatCount + 1, entry->downTime);
+                                       entry->repeatCount + 1, entry->downTime));
 
     newEntry->syntheticRepeat = true;
     if (mTracer) {
@@ -1639,7 +1640,7 @@ void InputDispatcher::enqueueFocusEventLocked(const sp<IBinder>& windowToken, bo
                            });
 
     // Maintain the order of focus events. Insert the entry after all other focus events.
-    mInboundQueue.insert(it.base(), std::move(focusEntry));
+    mInboundQueue.insert(it.base(), toSharedEntry(std::move(focusEntry)));
 }
 
 void InputDispatcher::dispatchFocusLocked(nsecs_t currentTime,
@@ -3330,7 +3331,8 @@ void InputDispatcher::prepareDispatchCycleLocked(nsecs_t currentTime,
                 logOutboundMotionDetails("  ", *splitMotionEntry);
             }
             enqueueDispatchEntryAndStartDispatchCycleLocked(currentTime, connection,
-                                                            std::move(splitMotionEntry),
+                                                            toSharedEntry(
+                                                                    std::move(splitMotionEntry)),
                                                             inputTarget);
             return;
         }
@@ -3458,8 +3460,9 @@ void InputDispatcher::enqueueDispatchEntryLocked(const std::shared_ptr<Connectio
                     }
                     // Generate a new MotionEntry with a new eventId using the resolved action and
                     // flags.
-                    resolvedMotion = std::make_shared<
-                            MotionEntry>(mIdGenerator.nextId(), motionEntry.injectionState,
+                    resolvedMotion = std::allocate_shared<
+                            MotionEntry>(EntryAllocator<MotionEntry>(), mIdGenerator.nextId(),
+                                         motionEntry.injectionState,
                                          motionEntry.eventTime, motionEntry.deviceId,
                                          motionEntry.source, motionEntry.displayId,
                                          motionEntry.policyFlags, resolvedAction,
@@ -6821,7 +6824,7 @@ void InputDispatcher::disablePointerCaptureForcedLocked() {
 
     auto entry = std::make_unique<PointerCaptureChangedEntry>(mIdGenerator.nextId(), now(),
                                                               mCurrentPointerCaptureRequest);
-    mInboundQueue.push_front(std::move(entry));
+    mInboundQueue.push_front(toSharedEntry(std::move(entry)));
 }
 
 void InputDispatcher::setPointerCaptureLocked(bool enable) {
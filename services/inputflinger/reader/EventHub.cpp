@@ -51,9 +51,12 @@
 #include <utils/Log.h>
 #include <utils/Timers.h>
 
+#include <atomic>
 #include <filesystem>
+#include <functional>
 #include <optional>
 #include <regex>
+#include <thread>
 #include <utility>
 
 #include "EventHub.h"
@@ -81,6 +84,9 @@ static constexpr int32_t FF_WEAK_MAGNITUDE_CHANNEL_IDX = 1;
 
 static constexpr size_t EVENT_BUFFER_SIZE = 256;
 
+// Largest number of threads that probe input devices at the same time.
+static constexpr size_t MAX_DEVICE_PROBE_THREADS = 4;
+
 // Mapping for input battery class node IDs lookup.
 // https://www.kernel.org/doc/Documentation/power/power_supply_class.txt
 static const std::unordered_map<std::string, InputBatteryClass> BATTERY_CLASSES =
@@ -218,6 +224,29 @@ static bool isV4lScanningEnabled() {
     return property_get_bool("ro.input.video_enabled", /*default_value=*/true);
 }
 
+/**
+ * Calls work(i) for every i in [0, count), spreading the calls over up to maxThreads threads,
+ * including the calling thread. Returns once all of the calls have returned.
+ */
+static void runInParallel(size_t count, size_t maxThreads,
+                          const std::function<void(size_t)>& work) {
+    std::atomic<size_t> next = 0;
+    auto runWorker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            work(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    const size_t threadCount = std::min(count, maxThreads);
+    for (size_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(runWorker);
+    }
+    runWorker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
 static nsecs_t processEventTimestamp(const struct input_event& event) {
     // Use the time specified in the event instead of the current time
     // so that downstream code can get more accurate estimates of
@@ -537,6 +566,8 @@ EventHub::Device::Device(int fd, int32_t id, std::string path, InputDeviceIdenti
         ffEffectId(-1),
         associatedDevice(std::move(assocDev)),
         controllerNumber(0),
+        driverVersion(0),
+        probeTime(0),
         enabled(true),
         isVirtual(fd < 0),
         currentFrameDropped(false) {}
@@ -2242,13 +2273,60 @@ void EventHub::reportDeviceAddedForStatisticsLocked(const InputDeviceIdentifier&
 }
 
 void EventHub::openDeviceLocked(const std::string& devicePath) {
+    openDevicesLocked({devicePath});
+}
+
+void EventHub::openDevicesLocked(const std::vector<std::string>& devicePaths) {
+    const nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    // Identify the devices on this thread, so that they are assigned ids in the order of their
+    // paths, as if they had been opened one after another.
+    std::vector<std::unique_ptr<Device>> devices;
+    for (const std::string& devicePath : devicePaths) {
+        const bool isDuplicate =
+                std::any_of(devices.begin(), devices.end(),
+                            [&](const auto& device) { return device->path == devicePath; });
+        if (isDuplicate) {
+            continue;
+        }
+        std::unique_ptr<Device> device = openDeviceNodeLocked(devicePath);
+        if (device != nullptr) {
+            devices.push_back(std::move(device));
+        }
+    }
+
+    // Probing is most of the cost of opening a device: it reads the capabilities of the device
+    // and parses its configuration, key layout and key character map files. It only touches the
+    // device being probed, so the devices are probed in parallel. This matters at boot, and when
+    // a dock exposes many HID interfaces at once.
+    std::vector<status_t> keyMapStatuses(devices.size(), NAME_NOT_FOUND);
+    runInParallel(devices.size(), MAX_DEVICE_PROBE_THREADS,
+                  [&](size_t i) { keyMapStatuses[i] = devices[i]->probe(); });
+
+    // Commit the results in order, as if the devices had been opened one after another.
+    nsecs_t longestProbeTime = 0;
+    for (size_t i = 0; i < devices.size(); i++) {
+        longestProbeTime = std::max(longestProbeTime, devices[i]->probeTime);
+        finishOpeningDeviceLocked(std::move(devices[i]), keyMapStatuses[i]);
+    }
+
+    if (devices.size() > 1) {
+        const nsecs_t elapsed = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+        ALOGI("Probed %zu input devices in %.1fms, slowest device took %.1fms", devices.size(),
+              ns2us(elapsed) / 1000.0, ns2us(longestProbeTime) / 1000.0);
+    }
+}
+
+std::unique_ptr<EventHub::Device> EventHub::openDeviceNodeLocked(const std::string& devicePath) {
+    const nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+
     // If an input device happens to register around the time when EventHub's constructor runs, it
     // is possible that the same input event node (for example, /dev/input/event3) will be noticed
     // in both 'inotify' callback and also in the 'scanDirLocked' pass. To prevent duplicate devices
     // from getting registered, ensure that this path is not already covered by an existing device.
     for (const auto& [deviceId, device] : mDevices) {
         if (device->path == devicePath) {
-            return; // device was already registered
+            return nullptr; // device was already registered
         }
     }
 
@@ -2259,7 +2337,7 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
     int fd = open(devicePath.c_str(), O_RDWR | O_CLOEXEC | O_NONBLOCK);
     if (fd < 0) {
         ALOGE("could not open %s, %s\n", devicePath.c_str(), strerror(errno));
-        return;
+        return nullptr;
     }
 
     InputDeviceIdentifier identifier;
@@ -2278,7 +2356,7 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
         if (identifier.name == item) {
             ALOGI("ignoring event id %s driver %s\n", devicePath.c_str(), item.c_str());
             close(fd);
-            return;
+            return nullptr;
         }
     }
 
@@ -2287,7 +2365,7 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
     if (ioctl(fd, EVIOCGVERSION, &driverVersion)) {
         ALOGE("could not get driver version for %s, %s\n", devicePath.c_str(), strerror(errno));
         close(fd);
-        return;
+        return nullptr;
     }
 
     // Get device identifier.
@@ -2295,7 +2373,7 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
     if (ioctl(fd, EVIOCGID, &inputId)) {
         ALOGE("could not get device input id for %s, %s\n", devicePath.c_str(), strerror(errno));
         close(fd);
-        return;
+        return nullptr;
     }
     identifier.bus = inputId.bustype;
     identifier.product = inputId.product;
@@ -2329,131 +2407,121 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
         }
     }
 
-    // Fill in the descriptor.
-    assignDescriptorLocked(identifier);
-
     // Allocate device.  (The device object takes ownership of the fd at this point.)
+    // The descriptor is assigned once the device is known to be kept, see
+    // finishOpeningDeviceLocked.
     int32_t deviceId = mNextDeviceId++;
     std::unique_ptr<Device> device =
             std::make_unique<Device>(fd, deviceId, devicePath, identifier,
                                      obtainAssociatedDeviceLocked(devicePath));
+    device->driverVersion = driverVersion;
+    device->probeTime = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+    return device;
+}
 
-    ALOGV("add device %d: %s\n", deviceId, devicePath.c_str());
-    ALOGV("  bus:        %04x\n"
-          "  vendor      %04x\n"
-          "  product     %04x\n"
-          "  version     %04x\n",
-          identifier.bus, identifier.vendor, identifier.product, identifier.version);
-    ALOGV("  name:       \"%s\"\n", identifier.name.c_str());
-    ALOGV("  location:   \"%s\"\n", identifier.location.c_str());
-    ALOGV("  unique id:  \"%s\"\n", identifier.uniqueId.c_str());
-    ALOGV("  descriptor: \"%s\"\n", identifier.descriptor.c_str());
-    ALOGV("  driver:     v%d.%d.%d\n", driverVersion >> 16, (driverVersion >> 8) & 0xff,
-          driverVersion & 0xff);
+status_t EventHub::Device::probe() {
+    const nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
 
     // Load the configuration file for the device.
-    device->loadConfigurationLocked();
+    loadConfigurationLocked();
 
     // Figure out the kinds of events the device reports.
-    device->readDeviceBitMask(EVIOCGBIT(EV_KEY, 0), device->keyBitmask);
-    device->readDeviceBitMask(EVIOCGBIT(EV_ABS, 0), device->absBitmask);
-    device->readDeviceBitMask(EVIOCGBIT(EV_REL, 0), device->relBitmask);
-    device->readDeviceBitMask(EVIOCGBIT(EV_SW, 0), device->swBitmask);
-    device->readDeviceBitMask(EVIOCGBIT(EV_LED, 0), device->ledBitmask);
-    device->readDeviceBitMask(EVIOCGBIT(EV_FF, 0), device->ffBitmask);
-    device->readDeviceBitMask(EVIOCGBIT(EV_MSC, 0), device->mscBitmask);
-    device->readDeviceBitMask(EVIOCGPROP(0), device->propBitmask);
+    readDeviceBitMask(EVIOCGBIT(EV_KEY, 0), keyBitmask);
+    readDeviceBitMask(EVIOCGBIT(EV_ABS, 0), absBitmask);
+    readDeviceBitMask(EVIOCGBIT(EV_REL, 0), relBitmask);
+    readDeviceBitMask(EVIOCGBIT(EV_SW, 0), swBitmask);
+    readDeviceBitMask(EVIOCGBIT(EV_LED, 0), ledBitmask);
+    readDeviceBitMask(EVIOCGBIT(EV_FF, 0), ffBitmask);
+    readDeviceBitMask(EVIOCGBIT(EV_MSC, 0), mscBitmask);
+    readDeviceBitMask(EVIOCGPROP(0), propBitmask);
 
     // See if this is a device with keys. This could be full keyboard, or other devices like
     // gamepads, joysticks, and styluses with buttons that should generate key presses.
-    bool haveKeyboardKeys =
-            device->keyBitmask.any(0, BTN_MISC) || device->keyBitmask.any(BTN_WHEEL, KEY_MAX + 1);
-    bool haveGamepadButtons = device->keyBitmask.any(BTN_MISC, BTN_MOUSE) ||
-            device->keyBitmask.any(BTN_JOYSTICK, BTN_DIGI);
-    bool haveStylusButtons = device->keyBitmask.test(BTN_STYLUS) ||
-            device->keyBitmask.test(BTN_STYLUS2) || device->keyBitmask.test(BTN_STYLUS3);
+    bool haveKeyboardKeys = keyBitmask.any(0, BTN_MISC) || keyBitmask.any(BTN_WHEEL, KEY_MAX + 1);
+    bool haveGamepadButtons =
+            keyBitmask.any(BTN_MISC, BTN_MOUSE) || keyBitmask.any(BTN_JOYSTICK, BTN_DIGI);
+    bool haveStylusButtons = keyBitmask.test(BTN_STYLUS) || keyBitmask.test(BTN_STYLUS2) ||
+            keyBitmask.test(BTN_STYLUS3);
     if (haveKeyboardKeys || haveGamepadButtons || haveStylusButtons) {
-        device->classes |= InputDeviceClass::KEYBOARD;
+        classes |= InputDeviceClass::KEYBOARD;
     }
 
     // See if this is a cursor device such as a trackball or mouse.
-    if (device->keyBitmask.test(BTN_MOUSE) && device->relBitmask.test(REL_X) &&
-        device->relBitmask.test(REL_Y)) {
-        device->classes |= InputDeviceClass::CURSOR;
+    if (keyBitmask.test(BTN_MOUSE) && relBitmask.test(REL_X) && relBitmask.test(REL_Y)) {
+        classes |= InputDeviceClass::CURSOR;
     }
 
     // See if the device is specially configured to be of a certain type.
-    if (device->configuration) {
-        std::string deviceType = device->configuration->getString("device.type").value_or("");
+    if (configuration) {
+        std::string deviceType = configuration->getString("device.type").value_or("");
         if (deviceType == "rotaryEncoder") {
-            device->classes |= InputDeviceClass::ROTARY_ENCODER;
+            classes |= InputDeviceClass::ROTARY_ENCODER;
         } else if (deviceType == "externalStylus") {
-            device->classes |= InputDeviceClass::EXTERNAL_STYLUS;
+            classes |= InputDeviceClass::EXTERNAL_STYLUS;
         }
     }
 
     // See if this is a touch pad.
     // Is this a new modern multi-touch driver?
-    if (device->absBitmask.test(ABS_MT_POSITION_X) && device->absBitmask.test(ABS_MT_POSITION_Y)) {
+    if (absBitmask.test(ABS_MT_POSITION_X) && absBitmask.test(ABS_MT_POSITION_Y)) {
         // Some joysticks such as the PS3 controller report axes that conflict
         // with the ABS_MT range.  Try to confirm that the device really is
         // a touch screen.
-        if (device->keyBitmask.test(BTN_TOUCH) || !haveGamepadButtons) {
-            device->classes |= (InputDeviceClass::TOUCH | InputDeviceClass::TOUCH_MT);
-            if (device->propBitmask.test(INPUT_PROP_POINTER) &&
-                !device->keyBitmask.any(BTN_TOOL_PEN, BTN_TOOL_FINGER) && !haveStylusButtons) {
-                device->classes |= InputDeviceClass::TOUCHPAD;
+        if (keyBitmask.test(BTN_TOUCH) || !haveGamepadButtons) {
+            classes |= (InputDeviceClass::TOUCH | InputDeviceClass::TOUCH_MT);
+            if (propBitmask.test(INPUT_PROP_POINTER) &&
+                !keyBitmask.any(BTN_TOOL_PEN, BTN_TOOL_FINGER) && !haveStylusButtons) {
+                classes |= InputDeviceClass::TOUCHPAD;
             }
         }
         // Is this an old style single-touch driver?
-    } else if (device->keyBitmask.test(BTN_TOUCH) && device->absBitmask.test(ABS_X) &&
-               device->absBitmask.test(ABS_Y)) {
-        device->classes |= InputDeviceClass::TOUCH;
+    } else if (keyBitmask.test(BTN_TOUCH) && absBitmask.test(ABS_X) && absBitmask.test(ABS_Y)) {
+        classes |= InputDeviceClass::TOUCH;
         // Is this a stylus that reports contact/pressure independently of touch coordinates?
-    } else if ((device->absBitmask.test(ABS_PRESSURE) || device->keyBitmask.test(BTN_TOUCH)) &&
-               !device->absBitmask.test(ABS_X) && !device->absBitmask.test(ABS_Y)) {
-        device->classes |= InputDeviceClass::EXTERNAL_STYLUS;
+    } else if ((absBitmask.test(ABS_PRESSURE) || keyBitmask.test(BTN_TOUCH)) &&
+               !absBitmask.test(ABS_X) && !absBitmask.test(ABS_Y)) {
+        classes |= InputDeviceClass::EXTERNAL_STYLUS;
     }
 
     // See if this device is a joystick.
     // Assumes that joysticks always have gamepad buttons in order to distinguish them
     // from other devices such as accelerometers that also have absolute axes.
     if (haveGamepadButtons) {
-        auto assumedClasses = device->classes | InputDeviceClass::JOYSTICK;
+        auto assumedClasses = classes | InputDeviceClass::JOYSTICK;
         for (int i = 0; i <= ABS_MAX; i++) {
-            if (device->absBitmask.test(i) &&
+            if (absBitmask.test(i) &&
                 (getAbsAxisUsage(i, assumedClasses).test(InputDeviceClass::JOYSTICK))) {
-                device->classes = assumedClasses;
+                classes = assumedClasses;
                 break;
             }
         }
     }
 
     // Check whether this device is an accelerometer.
-    if (device->propBitmask.test(INPUT_PROP_ACCELEROMETER)) {
-        device->classes |= InputDeviceClass::SENSOR;
+    if (propBitmask.test(INPUT_PROP_ACCELEROMETER)) {
+        classes |= InputDeviceClass::SENSOR;
     }
 
     // Check whether this device has switches.
     for (int i = 0; i <= SW_MAX; i++) {
-        if (device->swBitmask.test(i)) {
-            device->classes |= InputDeviceClass::SWITCH;
+        if (swBitmask.test(i)) {
+            classes |= InputDeviceClass::SWITCH;
             break;
         }
     }
 
     // Check whether this device supports the vibrator.
-    if (device->ffBitmask.test(FF_RUMBLE)) {
-        device->classes |= InputDeviceClass::VIBRATOR;
+    if (ffBitmask.test(FF_RUMBLE)) {
+        classes |= InputDeviceClass::VIBRATOR;
     }
 
     // Configure virtual keys.
-    if ((device->classes.test(InputDeviceClass::TOUCH))) {
+    if ((classes.test(InputDeviceClass::TOUCH))) {
         // Load the virtual keys for the touch screen, if any.
         // We do this now so that we can make sure to load the keymap if necessary.
-        bool success = device->loadVirtualKeyMapLocked();
+        bool success = loadVirtualKeyMapLocked();
         if (success) {
-            device->classes |= InputDeviceClass::KEYBOARD;
+            classes |= InputDeviceClass::KEYBOARD;
         }
     }
 
@@ -2461,47 +2529,48 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
     // We need to do this for joysticks too because the key layout may specify axes, and for
     // sensor as well because the key layout may specify the axes to sensor data mapping.
     status_t keyMapStatus = NAME_NOT_FOUND;
-    if (device->classes.any(InputDeviceClass::KEYBOARD | InputDeviceClass::JOYSTICK |
-                            InputDeviceClass::SENSOR)) {
+    if (classes.any(InputDeviceClass::KEYBOARD | InputDeviceClass::JOYSTICK |
+                    InputDeviceClass::SENSOR)) {
         // Load the keymap for the device.
-        keyMapStatus = device->loadKeyMapLocked();
+        keyMapStatus = loadKeyMapLocked();
     }
 
     // Configure the keyboard, gamepad or virtual keyboard.
-    if (device->classes.test(InputDeviceClass::KEYBOARD)) {
-        // Register the keyboard as a built-in keyboard if it is eligible.
-        if (!keyMapStatus && mBuiltInKeyboardId == NO_BUILT_IN_KEYBOARD &&
-            isEligibleBuiltInKeyboard(device->identifier, device->configuration.get(),
-                                      &device->keyMap)) {
-            mBuiltInKeyboardId = device->id;
-        }
-
+    if (classes.test(InputDeviceClass::KEYBOARD)) {
         // 'Q' key support = cheap test of whether this is an alpha-capable kbd
-        if (device->hasKeycodeLocked(AKEYCODE_Q)) {
-            device->classes |= InputDeviceClass::ALPHAKEY;
+        if (hasKeycodeLocked(AKEYCODE_Q)) {
+            classes |= InputDeviceClass::ALPHAKEY;
         }
 
         // See if this device has a D-pad.
         if (std::all_of(DPAD_REQUIRED_KEYCODES.begin(), DPAD_REQUIRED_KEYCODES.end(),
-                        [&](int32_t keycode) { return device->hasKeycodeLocked(keycode); })) {
-            device->classes |= InputDeviceClass::DPAD;
+                        [&](int32_t keycode) { return hasKeycodeLocked(keycode); })) {
+            classes |= InputDeviceClass::DPAD;
         }
 
         // See if this device has a gamepad.
         if (std::any_of(GAMEPAD_KEYCODES.begin(), GAMEPAD_KEYCODES.end(),
-                        [&](int32_t keycode) { return device->hasKeycodeLocked(keycode); })) {
-            device->classes |= InputDeviceClass::GAMEPAD;
+                        [&](int32_t keycode) { return hasKeycodeLocked(keycode); })) {
+            classes |= InputDeviceClass::GAMEPAD;
         }
 
         // See if this device has any stylus buttons that we would want to fuse with touch data.
-        if (!device->classes.any(InputDeviceClass::TOUCH | InputDeviceClass::TOUCH_MT) &&
-            !device->classes.any(InputDeviceClass::ALPHAKEY) &&
+        if (!classes.any(InputDeviceClass::TOUCH | InputDeviceClass::TOUCH_MT) &&
+            !classes.any(InputDeviceClass::ALPHAKEY) &&
             std::any_of(STYLUS_BUTTON_KEYCODES.begin(), STYLUS_BUTTON_KEYCODES.end(),
-                        [&](int32_t keycode) { return device->hasKeycodeLocked(keycode); })) {
-            device->classes |= InputDeviceClass::EXTERNAL_STYLUS;
+                        [&](int32_t keycode) { return hasKeycodeLocked(keycode); })) {
+            classes |= InputDeviceClass::EXTERNAL_STYLUS;
         }
     }
 
+    probeTime += systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+    return keyMapStatus;
+}
+
+void EventHub::finishOpeningDeviceLocked(std::unique_ptr<Device> device, status_t keyMapStatus) {
+    const int32_t deviceId = device->id;
+    const std::string& devicePath = device->path;
+
     // If the device isn't recognized as something we handle, don't monitor it.
     if (device->classes == ftl::Flags<InputDeviceClass>(0)) {
         ALOGV("Dropping device: id=%d, path='%s', name='%s'", deviceId, devicePath.c_str(),
@@ -2509,6 +2578,30 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
         return;
     }
 
+    // Fill in the descriptor.
+    assignDescriptorLocked(device->identifier);
+    const InputDeviceIdentifier& identifier = device->identifier;
+
+    ALOGV("add device %d: %s\n", deviceId, devicePath.c_str());
+    ALOGV("  bus:        %04x\n"
+          "  vendor      %04x\n"
+          "  product     %04x\n"
+          "  version     %04x\n",
+          identifier.bus, identifier.vendor, identifier.product, identifier.version);
+    ALOGV("  name:       \"%s\"\n", identifier.name.c_str());
+    ALOGV("  location:   \"%s\"\n", identifier.location.c_str());
+    ALOGV("  unique id:  \"%s\"\n", identifier.uniqueId.c_str());
+    ALOGV("  descriptor: \"%s\"\n", identifier.descriptor.c_str());
+    ALOGV("  driver:     v%d.%d.%d\n", device->driverVersion >> 16,
+          (device->driverVersion >> 8) & 0xff, device->driverVersion & 0xff);
+
+    // Register the keyboard as a built-in keyboard if it is eligible.
+    if (device->classes.test(InputDeviceClass::KEYBOARD) && !keyMapStatus &&
+        mBuiltInKeyboardId == NO_BUILT_IN_KEYBOARD &&
+        isEligibleBuiltInKeyboard(identifier, device->configuration.get(), &device->keyMap)) {
+        mBuiltInKeyboardId = deviceId;
+    }
+
     // Classify InputDeviceClass::BATTERY.
     if (device->associatedDevice && !device->associatedDevice->batteryInfos.empty()) {
         device->classes |= InputDeviceClass::BATTERY;
@@ -2542,11 +2635,12 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
     device->configureFd();
 
     ALOGI("New device: id=%d, fd=%d, path='%s', name='%s', classes=%s, "
-          "configuration='%s', keyLayout='%s', keyCharacterMap='%s', builtinKeyboard=%s, ",
-          deviceId, fd, devicePath.c_str(), device->identifier.name.c_str(),
+          "configuration='%s', keyLayout='%s', keyCharacterMap='%s', builtinKeyboard=%s, "
+          "probeTime=%.1fms",
+          deviceId, device->fd, devicePath.c_str(), device->identifier.name.c_str(),
           device->classes.string().c_str(), device->configurationFile.c_str(),
           device->keyMap.keyLayoutFile.c_str(), device->keyMap.keyCharacterMapFile.c_str(),
-          toString(mBuiltInKeyboardId == deviceId));
+          toString(mBuiltInKeyboardId == deviceId), ns2us(device->probeTime) / 1000.0);
 
     addDeviceLocked(std::move(device));
 }
@@ -2776,26 +2870,35 @@ base::Result<void> EventHub::readNotifyLocked() {
 
     if (sizeRead < EVENT_SIZE) return Errorf("could not get event, %s", strerror(errno));
 
+    // Devices that are created together, such as the interfaces of a newly connected dock, are
+    // opened together so that they can be probed in parallel.
+    std::vector<std::string> createdDevicePaths;
     for (ssize_t eventPos = 0; sizeRead >= EVENT_SIZE;) {
         const inotify_event* event;
         event = (const inotify_event*)(eventBuffer + eventPos);
         if (event->len == 0) continue;
 
-        handleNotifyEventLocked(*event);
+        handleNotifyEventLocked(*event, createdDevicePaths);
 
         const ssize_t eventSize = EVENT_SIZE + event->len;
         sizeRead -= eventSize;
         eventPos += eventSize;
     }
+    openDevicesLocked(createdDevicePaths);
     return {};
 }
 
-void EventHub::handleNotifyEventLocked(const inotify_event& event) {
+void EventHub::handleNotifyEventLocked(const inotify_event& event,
+                                       std::vector<std::string>& createdDevicePaths) {
     if (event.wd == mDeviceInputWd) {
         std::string filename = std::string(DEVICE_INPUT_PATH) + "/" + event.name;
         if (event.mask & IN_CREATE) {
-            openDeviceLocked(filename);
+            createdDevicePaths.push_back(filename);
         } else {
+            // Open the devices that were created before this one was removed, in case this is
+            // one of them.
+            openDevicesLocked(createdDevicePaths);
+            createdDevicePaths.clear();
             ALOGI("Removing device '%s' due to inotify event\n", filename.c_str());
             closeDeviceByPathLocked(filename);
         }
@@ -2817,9 +2920,11 @@ void EventHub::handleNotifyEventLocked(const inotify_event& event) {
 }
 
 status_t EventHub::scanDirLocked(const std::string& dirname) {
+    std::vector<std::string> devicePaths;
     for (const auto& entry : std::filesystem::directory_iterator(dirname)) {
-        openDeviceLocked(entry.path());
+        devicePaths.push_back(entry.path());
     }
+    openDevicesLocked(devicePaths);
     return 0;
 }
 
@@ -2885,6 +2990,8 @@ void EventHub::dump(std::string& dump) const {
             }
             dump += StringPrintf(INDENT3 "ConfigurationFile: %s\n",
                                  device->configurationFile.c_str());
+            dump += StringPrintf(INDENT3 "ProbeTime: %.1fms\n",
+                                 ns2us(device->probeTime) / 1000.0);
             dump += StringPrintf(INDENT3 "VideoDevice: %s\n",
                                  device->videoDevice ? device->videoDevice->dump().c_str()
                                                      : "<none>");
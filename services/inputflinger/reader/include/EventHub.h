@@ -626,7 +626,9 @@ private:
         int fd; // may be -1 if device is closed
         const int32_t id;
         const std::string path;
-        const InputDeviceIdentifier identifier;
+        // Not const because the descriptor is only assigned once the device has been probed and
+        // is known to be kept.
+        InputDeviceIdentifier identifier;
 
         std::unique_ptr<TouchVideoDevice> videoDevice;
 
@@ -662,6 +664,10 @@ private:
 
         int32_t controllerNumber;
 
+        int driverVersion;
+        // Time spent opening and probing the device, for startup instrumentation.
+        nsecs_t probeTime;
+
         Device(int fd, int32_t id, std::string path, InputDeviceIdentifier identifier,
                std::shared_ptr<const AssociatedDevice> assocDev);
         ~Device();
@@ -694,12 +700,28 @@ private:
         bool currentFrameDropped;
         void trackInputEvent(const struct input_event& event);
         void readDeviceState();
+
+        /**
+         * Reads the capabilities of the device, loads its configuration and key maps, and
+         * determines its classes, apart from those that depend on other devices.
+         * Only touches this device, so devices can be probed in parallel, off the reader thread.
+         * Returns the status of loading the key map.
+         */
+        status_t probe();
     };
 
     /**
      * Create a new device for the provided path.
      */
     void openDeviceLocked(const std::string& devicePath) REQUIRES(mLock);
+    /**
+     * Create new devices for the provided paths. The devices are probed in parallel, and added
+     * in the order of the paths.
+     */
+    void openDevicesLocked(const std::vector<std::string>& devicePaths) REQUIRES(mLock);
+    std::unique_ptr<Device> openDeviceNodeLocked(const std::string& devicePath) REQUIRES(mLock);
+    void finishOpeningDeviceLocked(std::unique_ptr<Device> device, status_t keyMapStatus)
+            REQUIRES(mLock);
     void openVideoDeviceLocked(const std::string& devicePath) REQUIRES(mLock);
     /**
      * Try to associate a video device with an input device. If the association succeeds,
@@ -732,7 +754,8 @@ private:
     status_t scanVideoDirLocked(const std::string& dirname) REQUIRES(mLock);
     void scanDevicesLocked() REQUIRES(mLock);
     base::Result<void> readNotifyLocked() REQUIRES(mLock);
-    void handleNotifyEventLocked(const inotify_event&) REQUIRES(mLock);
+    void handleNotifyEventLocked(const inotify_event&,
+                                 std::vector<std::string>& createdDevicePaths) REQUIRES(mLock);
 
     Device* getDeviceLocked(int32_t deviceId) const REQUIRES(mLock);
     Device* getDeviceByPathLocked(const std::string& devicePath) const REQUIRES(mLock);
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../Entry.h"
+#include "../EntryPool.h"
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+namespace android::inputdispatcher {
+
+// --- EntryPoolTest ---
+
+TEST(EntryPoolTest, ReleasedBlockIsReused) {
+    void* first = EntryPool::allocate(100);
+    EntryPool::deallocate(first, 100);
+    void* second = EntryPool::allocate(100);
+    ASSERT_EQ(first, second);
+    EntryPool::deallocate(second, 100);
+}
+
+TEST(EntryPoolTest, SizesInTheSameClassShareBlocks) {
+    void* first = EntryPool::allocate(97);
+    EntryPool::deallocate(first, 97);
+    void* second = EntryPool::allocate(112);
+    ASSERT_EQ(first, second);
+    EntryPool::deallocate(second, 112);
+}
+
+TEST(EntryPoolTest, LargeAllocationsBypassThePool) {
+    const size_t size = EntryPool::MAX_BLOCK_SIZE + 1;
+    const size_t cached = EntryPool::getCachedBlockCount(EntryPool::MAX_BLOCK_SIZE);
+    void* ptr = EntryPool::allocate(size);
+    ASSERT_NE(nullptr, ptr);
+    EntryPool::deallocate(ptr, size);
+    ASSERT_EQ(cached, EntryPool::getCachedBlockCount(EntryPool::MAX_BLOCK_SIZE));
+}
+
+TEST(EntryPoolTest, EntriesReturnTheirBlocks) {
+    // Make sure the size class has a slab, so that creating the entry doesn't allocate one.
+    EntryPool::deallocate(EntryPool::allocate(sizeof(DeviceResetEntry)), sizeof(DeviceResetEntry));
+    const size_t cached = EntryPool::getCachedBlockCount(sizeof(DeviceResetEntry));
+    {
+        std::shared_ptr<const EventEntry> entry =
+                toSharedEntry(std::make_unique<DeviceResetEntry>(/*id=*/1, /*eventTime=*/0,
+                                                                 /*deviceId=*/2));
+        ASSERT_EQ(2, static_cast<const DeviceResetEntry&>(*entry).deviceId);
+    }
+    ASSERT_EQ(cached, EntryPool::getCachedBlockCount(sizeof(DeviceResetEntry)));
+}
+
+TEST(EntryPoolTest, AllocateOnOneThreadReleaseOnAnother) {
+    constexpr size_t kCount = 1000;
+    std::vector<void*> blocks;
+    std::thread producer([&]() {
+        for (size_t i = 0; i < kCount; i++) {
+            blocks.push_back(EntryPool::allocate(200));
+        }
+    });
+    producer.join();
+    std::thread consumer([&]() {
+        for (void* block : blocks) {
+            EntryPool::deallocate(block, 200);
+        }
+    });
+    consumer.join();
+    ASSERT_GE(EntryPool::getCachedBlockCount(200), kCount);
+}
+
+} // namespace android::inputdispatcher
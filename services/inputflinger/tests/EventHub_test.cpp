@@ -197,6 +197,33 @@ TEST_F(EventHubTest, DevicesWithMatchingUniqueIdsAreUnique) {
     waitForDeviceClose(deviceId2);
 }
 
+/**
+ * Ensure that devices that are opened together, as in the initial scan, are all added, each with
+ * its own id and descriptor.
+ */
+TEST_F(EventHubTest, DevicesOpenedTogether_AreAllAdded) {
+    std::unique_ptr<UinputHomeKey> keyboard2 = createUinputDevice<UinputHomeKey>();
+    int32_t deviceId2;
+    ASSERT_NO_FATAL_FAILURE(deviceId2 = waitForDeviceCreation());
+
+    // A new EventHub probes all of the existing devices in a single scan.
+    EventHub eventHub;
+    std::vector<int32_t> keyboardIds;
+    for (const RawEvent& event : eventHub.getEvents(/*timeoutMillis=*/0)) {
+        if (event.type == EventHubInterface::DEVICE_ADDED &&
+            eventHub.getDeviceIdentifier(event.deviceId).name == mKeyboard->getName()) {
+            keyboardIds.push_back(event.deviceId);
+        }
+    }
+    ASSERT_EQ(2u, keyboardIds.size());
+    EXPECT_NE(keyboardIds[0], keyboardIds[1]);
+    EXPECT_NE(eventHub.getDeviceIdentifier(keyboardIds[0]).descriptor,
+              eventHub.getDeviceIdentifier(keyboardIds[1]).descriptor);
+
+    keyboard2.reset();
+    waitForDeviceClose(deviceId2);
+}
+
 /**
  * Ensure that input_events are generated with monotonic clock.
  * That means input_event should receive a timestamp that is in the future of the time
@@ -36,7 +36,13 @@ BackgroundExecutor::BackgroundExecutor() : Singleton<BackgroundExecutor>() {
     mThread = std::thread([&]() {
         while (!mDone) {
             LOG_ALWAYS_FATAL_IF(sem_wait(&mSemaphore), "sem_wait failed (%d)", errno);
+            // Each post is for one push, but pop() returns nothing while an earlier push is
+            // still being published, so wait for it instead of dropping this post.
             auto callbacks = mCallbacksQueue.pop();
+            while (!callbacks && !mDone) {
+                std::this_thread::yield();
+                callbacks = mCallbacksQueue.pop();
+            }
             if (!callbacks) {
                 continue;
             }
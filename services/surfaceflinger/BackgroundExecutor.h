@@ -40,7 +40,8 @@ private:
     sem_t mSemaphore;
     std::atomic_bool mDone = false;
 
-    LocklessQueue<Callbacks> mCallbacksQueue;
+    static constexpr size_t kCallbacksQueueCapacity = 64;
+    BoundedLocklessQueue<Callbacks> mCallbacksQueue{kCallbacksQueueCapacity};
     std::thread mThread;
 };
 
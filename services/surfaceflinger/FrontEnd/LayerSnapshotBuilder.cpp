@@ -19,8 +19,11 @@
 #undef LOG_TAG
 #define LOG_TAG "SurfaceFlinger"
 
+#include <pthread.h>
+#include <condition_variable>
 #include <numeric>
 #include <optional>
+#include <thread>
 
 #include <ftl/small_map.h>
 #include <gui/TraceUtils.h>
@@ -365,8 +368,95 @@ LayerSnapshot LayerSnapshotBuilder::getRootSnapshot() {
     return snapshot;
 }
 
+// Runs a batch of independent tasks on a fixed set of threads. The thread that calls run() works
+// on the batch too and returns once every task has finished.
+class LayerSnapshotBuilder::SubtreeWorkerPool {
+public:
+    explicit SubtreeWorkerPool(size_t workerCount) {
+        for (size_t i = 0; i < workerCount; i++) {
+            mThreads.emplace_back([this]() {
+                pthread_setname_np(pthread_self(), "SnapshotWorker");
+                workerLoop();
+            });
+        }
+    }
+
+    ~SubtreeWorkerPool() {
+        {
+            std::scoped_lock lock(mMutex);
+            mStop = true;
+        }
+        mWorkAvailable.notify_all();
+        for (auto& thread : mThreads) {
+            thread.join();
+        }
+    }
+
+    size_t getWorkerCount() const { return mThreads.size(); }
+
+    void run(std::vector<std::function<void()>>& tasks) {
+        {
+            std::scoped_lock lock(mMutex);
+            mTasks = &tasks;
+            mNextTask = 0;
+            mPendingTasks = tasks.size();
+        }
+        mWorkAvailable.notify_all();
+
+        std::unique_lock lock(mMutex);
+        while (mNextTask < tasks.size()) {
+            runNextTaskLocked(lock);
+        }
+        mTasksDone.wait(lock, [this]() { return mPendingTasks == 0; });
+        mTasks = nullptr;
+    }
+
+private:
+    void workerLoop() {
+        std::unique_lock lock(mMutex);
+        while (true) {
+            mWorkAvailable.wait(lock, [this]() {
+                return mStop || (mTasks && mNextTask < mTasks->size());
+            });
+            if (mStop) {
+                return;
+            }
+            runNextTaskLocked(lock);
+        }
+    }
+
+    void runNextTaskLocked(std::unique_lock<std::mutex>& lock) {
+        std::function<void()>& task = (*mTasks)[mNextTask++];
+        lock.unlock();
+        task();
+        lock.lock();
+        if (--mPendingTasks == 0) {
+            mTasksDone.notify_all();
+        }
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mWorkAvailable;
+    std::condition_variable mTasksDone;
+    std::vector<std::function<void()>>* mTasks = nullptr;
+    size_t mNextTask = 0;
+    size_t mPendingTasks = 0;
+    bool mStop = false;
+    std::vector<std::thread> mThreads;
+};
+
 LayerSnapshotBuilder::LayerSnapshotBuilder() {}
 
+LayerSnapshotBuilder::~LayerSnapshotBuilder() = default;
+
+void LayerSnapshotBuilder::setSubtreeUpdateWorkerCount(size_t workerCount) {
+    if (workerCount == 0) {
+        mSubtreeWorkerPool.reset();
+    } else if (!mSubtreeWorkerPool || mSubtreeWorkerPool->getWorkerCount() != workerCount) {
+        mSubtreeWorkerPool = std::make_unique<SubtreeWorkerPool>(workerCount);
+    }
+}
+
 LayerSnapshotBuilder::LayerSnapshotBuilder(Args args) : LayerSnapshotBuilder() {
     args.forceUpdate = ForceUpdateFlags::ALL;
     updateSnapshots(args);
@@ -400,8 +490,12 @@ bool LayerSnapshotBuilder::tryFastUpdate(const Args& args) {
     for (const RequestedLayerState* requested : args.layerLifecycleManager.getChangedLayers()) {
         auto range = mIdToSnapshots.equal_range(requested->id);
         for (auto it = range.first; it != range.second; it++) {
-            it->second->merge(*requested, forceUpdate, args.displayChanges, args.forceFullDamage,
-                              primaryDisplayRotationFlags);
+            LayerSnapshot& snapshot = *it->second;
+            snapshot.merge(*requested, forceUpdate, args.displayChanges, args.forceFullDamage,
+                           primaryDisplayRotationFlags);
+            if (snapshot.globalZ < mHotFields.size()) {
+                mHotFields.set(snapshot.globalZ, snapshot);
+            }
         }
     }
 
@@ -446,7 +540,7 @@ void LayerSnapshotBuilder::updateSnapshots(const Args& args) {
         LayerHierarchy::ScopedAddToTraversalPath addChildToPath(root, args.root.getLayer()->id,
                                                                 LayerHierarchy::Variant::Attached);
         updateSnapshotsInHierarchy(args, args.root, root, rootSnapshot, /*depth=*/0);
-    } else {
+    } else if (!mSubtreeWorkerPool || !updateSubtreesInParallel(args, rootSnapshot)) {
         for (auto& [childHierarchy, variant] : args.root.mChildren) {
             LayerHierarchy::ScopedAddToTraversalPath addChildToPath(root,
                                                                     childHierarchy->getLayer()->id,
@@ -460,6 +554,9 @@ void LayerSnapshotBuilder::updateSnapshots(const Args& args) {
     updateTouchableRegionCrop(args);
 
     const bool hasUnreachableSnapshots = sortSnapshotsByZ(args);
+    // Snapshots destroyed below are never in the interesting range, so the table can be
+    // refreshed now.
+    updateHotFields();
 
     // Destroy unreachable snapshots for clone layers. And destroy snapshots for non-clone
     // layers if the layer have been destroyed.
@@ -523,15 +620,7 @@ const LayerSnapshot& LayerSnapshotBuilder::updateSnapshotsInHierarchy(
                                     "builder_stack_overflow_transactions.winscope");
 
     const RequestedLayerState* layer = hierarchy.getLayer();
-    LayerSnapshot* snapshot = getSnapshot(traversalPath);
-    const bool newSnapshot = snapshot == nullptr;
-    uint32_t primaryDisplayRotationFlags = getPrimaryDisplayRotationFlags(args.displays);
-    if (newSnapshot) {
-        snapshot = createSnapshot(traversalPath, *layer, parentSnapshot);
-        snapshot->merge(*layer, /*forceUpdate=*/true, /*displayChanges=*/true, args.forceFullDamage,
-                        primaryDisplayRotationFlags);
-        snapshot->changes |= RequestedLayerState::Changes::Created;
-    }
+    LayerSnapshot* snapshot = getOrCreateSnapshot(args, traversalPath, *layer, parentSnapshot);
 
     if (traversalPath.isRelative()) {
         bool parentIsRelative = traversalPath.variant == LayerHierarchy::Variant::Relative;
@@ -556,6 +645,122 @@ const LayerSnapshot& LayerSnapshotBuilder::updateSnapshotsInHierarchy(
     return *snapshot;
 }
 
+bool LayerSnapshotBuilder::updateSubtreesInParallel(const Args& args,
+                                                    const LayerSnapshot& rootSnapshot) {
+    const auto& children = args.root.mChildren;
+    if (children.size() < 2) {
+        return false;
+    }
+    ATRACE_NAME("UpdateSnapshotsInParallel");
+
+    // Create missing snapshots up front, in the same order as the sequential walk, so the
+    // snapshot list and lookup maps are not modified while the workers run. Subtrees that reach
+    // the same snapshot, through relative z for example, are merged into one group.
+    std::vector<size_t> groupOf(children.size());
+    std::iota(groupOf.begin(), groupOf.end(), 0);
+    auto findGroup = [&groupOf](size_t i) {
+        while (groupOf[i] != i) {
+            groupOf[i] = groupOf[groupOf[i]];
+            i = groupOf[i];
+        }
+        return i;
+    };
+
+    std::unordered_map<const LayerSnapshot*, size_t> snapshotOwners;
+    std::vector<LayerSnapshot*> visited;
+    LayerHierarchy::TraversalPath root = LayerHierarchy::TraversalPath::ROOT;
+    for (size_t i = 0; i < children.size(); i++) {
+        auto& [childHierarchy, variant] = children[i];
+        LayerHierarchy::ScopedAddToTraversalPath addChildToPath(root,
+                                                                childHierarchy->getLayer()->id,
+                                                                variant);
+        visited.clear();
+        createSnapshotsInHierarchy(args, *childHierarchy, root, rootSnapshot, /*depth=*/0,
+                                   visited);
+        for (const LayerSnapshot* snapshot : visited) {
+            auto [it, inserted] = snapshotOwners.emplace(snapshot, i);
+            if (inserted) {
+                continue;
+            }
+            const size_t a = findGroup(it->second);
+            const size_t b = findGroup(i);
+            if (a != b) {
+                groupOf[std::max(a, b)] = std::min(a, b);
+            }
+        }
+    }
+
+    // Each group keeps its subtrees in z-order. sortSnapshotsByZ runs afterwards on this thread,
+    // so the final order does not depend on how the groups were scheduled.
+    std::vector<std::vector<size_t>> groups;
+    std::unordered_map<size_t, size_t> groupIndex;
+    for (size_t i = 0; i < children.size(); i++) {
+        auto [it, inserted] = groupIndex.emplace(findGroup(i), groups.size());
+        if (inserted) {
+            groups.emplace_back();
+        }
+        groups[it->second].push_back(i);
+    }
+    if (groups.size() < 2) {
+        return false;
+    }
+
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(groups.size());
+    for (auto& group : groups) {
+        tasks.emplace_back([this, &args, &children, &rootSnapshot, &group]() {
+            LayerHierarchy::TraversalPath path = LayerHierarchy::TraversalPath::ROOT;
+            for (size_t i : group) {
+                auto& [childHierarchy, variant] = children[i];
+                LayerHierarchy::ScopedAddToTraversalPath addChildToPath(path,
+                                                                        childHierarchy->getLayer()
+                                                                                ->id,
+                                                                        variant);
+                updateSnapshotsInHierarchy(args, *childHierarchy, path, rootSnapshot,
+                                           /*depth=*/0);
+            }
+        });
+    }
+    mSubtreeWorkerPool->run(tasks);
+    return true;
+}
+
+void LayerSnapshotBuilder::createSnapshotsInHierarchy(const Args& args,
+                                                      const LayerHierarchy& hierarchy,
+                                                      LayerHierarchy::TraversalPath& traversalPath,
+                                                      const LayerSnapshot& parentSnapshot,
+                                                      int depth,
+                                                      std::vector<LayerSnapshot*>& outVisited) {
+    LLOG_ALWAYS_FATAL_WITH_TRACE_IF(depth > 50,
+                                    "Cycle detected in LayerSnapshotBuilder. See "
+                                    "builder_stack_overflow_transactions.winscope");
+
+    LayerSnapshot* snapshot =
+            getOrCreateSnapshot(args, traversalPath, *hierarchy.getLayer(), parentSnapshot);
+    outVisited.push_back(snapshot);
+    for (auto& [childHierarchy, variant] : hierarchy.mChildren) {
+        LayerHierarchy::ScopedAddToTraversalPath addChildToPath(traversalPath,
+                                                                childHierarchy->getLayer()->id,
+                                                                variant);
+        createSnapshotsInHierarchy(args, *childHierarchy, traversalPath, *snapshot, depth + 1,
+                                   outVisited);
+    }
+}
+
+LayerSnapshot* LayerSnapshotBuilder::getOrCreateSnapshot(
+        const Args& args, const LayerHierarchy::TraversalPath& traversalPath,
+        const RequestedLayerState& layer, const LayerSnapshot& parentSnapshot) {
+    LayerSnapshot* snapshot = getSnapshot(traversalPath);
+    if (snapshot) {
+        return snapshot;
+    }
+    snapshot = createSnapshot(traversalPath, layer, parentSnapshot);
+    snapshot->merge(layer, /*forceUpdate=*/true, /*displayChanges=*/true, args.forceFullDamage,
+                    getPrimaryDisplayRotationFlags(args.displays));
+    snapshot->changes |= RequestedLayerState::Changes::Created;
+    return snapshot;
+}
+
 LayerSnapshot* LayerSnapshotBuilder::getSnapshot(uint32_t layerId) const {
     if (layerId == UNASSIGNED_LAYER_ID) {
         return nullptr;
@@ -1089,6 +1294,7 @@ void LayerSnapshotBuilder::updateInput(LayerSnapshot& snapshot,
     }
 
     if (requested.touchCropId != UNASSIGNED_LAYER_ID || path.isClone()) {
+        std::scoped_lock lock(mNeedsTouchableRegionCropMutex);
         mNeedsTouchableRegionCrop.insert(path);
     }
     auto cropLayerSnapshot = getSnapshot(requested.touchCropId);
@@ -1121,11 +1327,18 @@ std::vector<std::unique_ptr<LayerSnapshot>>& LayerSnapshotBuilder::getSnapshots(
     return mSnapshots;
 }
 
+void LayerSnapshotBuilder::updateHotFields() {
+    const size_t count = static_cast<size_t>(mNumInterestingSnapshots);
+    mHotFields.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        mHotFields.set(i, *mSnapshots[i]);
+    }
+}
+
 void LayerSnapshotBuilder::forEachVisibleSnapshot(const ConstVisitor& visitor) const {
-    for (int i = 0; i < mNumInterestingSnapshots; i++) {
-        LayerSnapshot& snapshot = *mSnapshots[(size_t)i];
-        if (!snapshot.isVisible) continue;
-        visitor(snapshot);
+    for (size_t i = 0; i < mHotFields.size(); i++) {
+        if (!mHotFields.isVisible(i)) continue;
+        visitor(*mSnapshots[i]);
     }
 }
 
@@ -1144,10 +1357,9 @@ void LayerSnapshotBuilder::forEachVisibleSnapshot(const ConstVisitor& visitor,
 }
 
 void LayerSnapshotBuilder::forEachVisibleSnapshot(const Visitor& visitor) {
-    for (int i = 0; i < mNumInterestingSnapshots; i++) {
-        std::unique_ptr<LayerSnapshot>& snapshot = mSnapshots.at((size_t)i);
-        if (!snapshot->isVisible) continue;
-        visitor(snapshot);
+    for (size_t i = 0; i < mHotFields.size(); i++) {
+        if (!mHotFields.isVisible(i)) continue;
+        visitor(mSnapshots.at(i));
     }
 }
 
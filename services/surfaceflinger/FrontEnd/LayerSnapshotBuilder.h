@@ -16,10 +16,14 @@
 
 #pragma once
 
+#include <atomic>
+#include <mutex>
+
 #include "FrontEnd/DisplayInfo.h"
 #include "FrontEnd/LayerLifecycleManager.h"
 #include "LayerHierarchy.h"
 #include "LayerSnapshot.h"
+#include "LayerSnapshotHotFields.h"
 #include "RequestedLayerState.h"
 
 namespace android::surfaceflinger::frontend {
@@ -61,10 +65,17 @@ public:
         LayerSnapshot rootSnapshot = getRootSnapshot();
     };
     LayerSnapshotBuilder();
+    ~LayerSnapshotBuilder();
 
     // Rebuild the snapshots from scratch.
     LayerSnapshotBuilder(Args);
 
+    // Opt-in: update the subtrees under the root on |workerCount| worker threads in addition to
+    // the calling thread. Subtrees that share snapshots, for example through relative z, are
+    // always updated together on one thread in their original order, so the result matches the
+    // single threaded walk. Zero, the default, disables the worker pool.
+    void setSubtreeUpdateWorkerCount(size_t workerCount);
+
     // Update an existing set of snapshot using change flags in RequestedLayerState
     // and LayerLifecycleManager. This needs to be called before
     // LayerLifecycleManager.commitChanges is called as that function will clear all
@@ -89,15 +100,32 @@ public:
     // Visit each snapshot interesting to input reverse z-order
     void forEachInputSnapshot(const ConstVisitor& visitor) const;
 
+    // Hot fields of the snapshots visited by forEachVisibleSnapshot, indexed by globalZ. Stays
+    // valid while snapshots are moved out for composition.
+    const LayerSnapshotHotFields& getHotFields() const { return mHotFields; }
+
 private:
     friend class LayerSnapshotTest;
 
+    class SubtreeWorkerPool;
+
     // return true if we were able to successfully update the snapshots via
     // the fast path.
     bool tryFastUpdate(const Args& args);
 
     void updateSnapshots(const Args& args);
 
+    // Returns false if the subtrees could not be split, in which case the caller should walk the
+    // hierarchy itself.
+    bool updateSubtreesInParallel(const Args& args, const LayerSnapshot& rootSnapshot);
+    LayerSnapshot* getOrCreateSnapshot(const Args&, const LayerHierarchy::TraversalPath&,
+                                       const RequestedLayerState&,
+                                       const LayerSnapshot& parentSnapshot);
+    void createSnapshotsInHierarchy(const Args&, const LayerHierarchy& hierarchy,
+                                    LayerHierarchy::TraversalPath& traversalPath,
+                                    const LayerSnapshot& parentSnapshot, int depth,
+                                    std::vector<LayerSnapshot*>& outVisited);
+
     const LayerSnapshot& updateSnapshotsInHierarchy(const Args&, const LayerHierarchy& hierarchy,
                                                     LayerHierarchy::TraversalPath& traversalPath,
                                                     const LayerSnapshot& parentSnapshot, int depth);
@@ -123,6 +151,7 @@ private:
     void updateFrameRateFromChildSnapshot(LayerSnapshot& snapshot,
                                           const LayerSnapshot& childSnapshot, const Args& args);
     void updateTouchableRegionCrop(const Args& args);
+    void updateHotFields();
 
     std::unordered_map<LayerHierarchy::TraversalPath, LayerSnapshot*,
                        LayerHierarchy::TraversalPathHash>
@@ -130,11 +159,15 @@ private:
     std::multimap<uint32_t, LayerSnapshot*> mIdToSnapshots;
 
     // Track snapshots that needs touchable region crop from other snapshots
+    std::mutex mNeedsTouchableRegionCropMutex;
     std::unordered_set<LayerHierarchy::TraversalPath, LayerHierarchy::TraversalPathHash>
             mNeedsTouchableRegionCrop;
     std::vector<std::unique_ptr<LayerSnapshot>> mSnapshots;
-    bool mResortSnapshots = false;
+    // Written from worker threads when subtrees are updated in parallel.
+    std::atomic<bool> mResortSnapshots = false;
     int mNumInterestingSnapshots = 0;
+    LayerSnapshotHotFields mHotFields;
+    std::unique_ptr<SubtreeWorkerPool> mSubtreeWorkerPool;
 };
 
 } // namespace android::surfaceflinger::frontend
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <ui/LayerStack.h>
+#include <ui/Rect.h>
+
+#include "LayerSnapshot.h"
+
+namespace android::surfaceflinger::frontend {
+
+// Copies of the LayerSnapshot fields that are read on every frame by traversals over the
+// visible snapshots, stored as parallel arrays indexed by globalZ. Walking these arrays streams
+// through contiguous memory instead of dereferencing every snapshot, most of which are skipped.
+//
+// Only the first size() snapshots in z-order (the ones that are visible or have input) are
+// tracked. LayerSnapshotBuilder keeps the table in sync with its snapshots on every update.
+class LayerSnapshotHotFields {
+public:
+    size_t size() const { return mLayerIds.size(); }
+
+    void resize(size_t size) {
+        mLayerIds.resize(size);
+        mVisible.resize(size);
+        mOutputFilters.resize(size);
+        mVisibleBounds.resize(size);
+    }
+
+    void clear() { resize(0); }
+
+    void set(size_t z, const LayerSnapshot& snapshot) {
+        mLayerIds[z] = snapshot.path.id;
+        mVisible[z] = snapshot.isVisible;
+        mOutputFilters[z] = snapshot.outputFilter;
+        mVisibleBounds[z] = snapshot.transformedBoundsWithoutTransparentRegion;
+    }
+
+    uint32_t layerId(size_t z) const { return mLayerIds[z]; }
+    bool isVisible(size_t z) const { return mVisible[z]; }
+    const ui::LayerFilter& outputFilter(size_t z) const { return mOutputFilters[z]; }
+    const Rect& visibleBounds(size_t z) const { return mVisibleBounds[z]; }
+
+private:
+    std::vector<uint32_t> mLayerIds;
+    // uint8_t rather than bool so that elements are addressable and the loop vectorizes.
+    std::vector<uint8_t> mVisible;
+    std::vector<ui::LayerFilter> mOutputFilters;
+    std::vector<Rect> mVisibleBounds;
+};
+
+} // namespace android::surfaceflinger::frontend
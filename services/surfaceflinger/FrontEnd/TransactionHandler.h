@@ -88,7 +88,10 @@ private:
     TransactionReadiness applyFilters(TransactionFlushState&);
     std::unordered_map<sp<IBinder>, std::queue<TransactionState>, IListenerHash>
             mPendingTransactionQueues;
-    LocklessQueue<TransactionState> mLocklessTransactionQueue;
+    // Sized to absorb a burst of transactions from all binder threads between two frames. Any
+    // overflow spills to the heap rather than being dropped.
+    static constexpr size_t kTransactionQueueCapacity = 256;
+    BoundedLocklessQueue<TransactionState> mLocklessTransactionQueue{kTransactionQueueCapacity};
     std::atomic<size_t> mPendingTransactionCount = 0;
     ftl::SmallVector<TransactionFilter, 2> mTransactionReadyFilters;
 
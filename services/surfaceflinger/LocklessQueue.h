@@ -16,6 +16,9 @@
 
 #pragma once
 #include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
 #include <optional>
 
 template <typename T>
@@ -42,41 +45,173 @@ public:
     public:
         T mValue;
         std::atomic<Entry*> mNext;
-        Entry(T value) : mValue(value) {}
+        Entry(T value) : mValue(std::move(value)) {}
     };
     std::atomic<Entry*> mPush = nullptr;
     std::atomic<Entry*> mPop = nullptr;
-    bool isEmpty() { return (mPush.load() == nullptr) && (mPop.load() == nullptr); }
+    bool isEmpty() {
+        return (mPush.load(std::memory_order_acquire) == nullptr) &&
+                (mPop.load(std::memory_order_relaxed) == nullptr);
+    }
 
     void push(T value) {
-        Entry* entry = new Entry(value);
-        Entry* previousHead = mPush.load(/*std::memory_order_relaxed*/);
+        Entry* entry = new Entry(std::move(value));
+        Entry* previousHead = mPush.load(std::memory_order_relaxed);
         do {
-            entry->mNext = previousHead;
-        } while (!mPush.compare_exchange_weak(previousHead, entry)); /*std::memory_order_release*/
+            entry->mNext.store(previousHead, std::memory_order_relaxed);
+        } while (!mPush.compare_exchange_weak(previousHead, entry, std::memory_order_release,
+                                              std::memory_order_relaxed));
     }
     std::optional<T> pop() {
-        Entry* popped = mPop.load(/*std::memory_order_acquire*/);
+        // mPop is only touched by the single consumer, so relaxed is enough here.
+        Entry* popped = mPop.load(std::memory_order_relaxed);
         if (popped) {
-            // Single consumer so this is fine
-            mPop.store(popped->mNext /* , std::memory_order_release */);
-            auto value = popped->mValue;
+            mPop.store(popped->mNext.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            auto value = std::move(popped->mValue);
             delete popped;
             return std::move(value);
         } else {
-            Entry* grabbedList = mPush.exchange(nullptr /* , std::memory_order_acquire */);
+            Entry* grabbedList = mPush.exchange(nullptr, std::memory_order_acquire);
             if (!grabbedList) return std::nullopt;
             // Reverse the list
-            while (grabbedList->mNext) {
-                Entry* next = grabbedList->mNext;
-                grabbedList->mNext = popped;
+            while (Entry* next = grabbedList->mNext.load(std::memory_order_relaxed)) {
+                grabbedList->mNext.store(popped, std::memory_order_relaxed);
                 popped = grabbedList;
                 grabbedList = next;
             }
-            mPop.store(popped /* , std::memory_order_release */);
-            auto value = grabbedList->mValue;
+            mPop.store(popped, std::memory_order_relaxed);
+            auto value = std::move(grabbedList->mValue);
             delete grabbedList;
             return std::move(value);
         }
     }
 };
+
+// Bounded multi producer single consumer queue that does not allocate on push or pop.
+//
+// Values are stored in a fixed ring of slots. Each slot carries a sequence number that tells
+// producers and the consumer whose turn it is: a slot at ring position `pos` is free for the
+// producer that claims `pos` when its sequence equals `pos`, and holds a value for the consumer
+// when its sequence equals `pos + 1`. Producers claim positions with a CAS on mEnqueuePos and
+// publish with a release store on the slot sequence, so the consumer never needs a CAS.
+//
+// When the ring is full, the OverflowPolicy decides what happens. With Reject, push returns
+// false and the value is left untouched. With Spill, the value goes to an unbounded
+// LocklessQueue and the consumer drains it only once the ring is empty. Producers keep spilling
+// while anything is left in the spill list, which preserves FIFO order for each producer.
+template <typename T>
+class BoundedLocklessQueue {
+public:
+    enum class OverflowPolicy { Spill, Reject };
+
+    explicit BoundedLocklessQueue(size_t capacity, OverflowPolicy policy = OverflowPolicy::Spill)
+          : mCapacity(std::bit_ceil(capacity < 2 ? size_t{2} : capacity)),
+            mMask(mCapacity - 1),
+            mPolicy(policy),
+            mSlots(std::make_unique<Slot[]>(mCapacity)) {
+        for (size_t i = 0; i < mCapacity; i++) {
+            mSlots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedLocklessQueue(const BoundedLocklessQueue&) = delete;
+    BoundedLocklessQueue& operator=(const BoundedLocklessQueue&) = delete;
+
+    size_t capacity() const { return mCapacity; }
+
+    bool isEmpty() {
+        return mEnqueuePos.load(std::memory_order_acquire) ==
+                mDequeuePos.load(std::memory_order_relaxed) &&
+                mSpillCount.load(std::memory_order_acquire) == 0;
+    }
+
+    // Safe to call from multiple threads. Returns false if the ring is full and the overflow
+    // policy is Reject.
+    bool push(T value) {
+        if (mSpillCount.load(std::memory_order_acquire) == 0 && tryPushRing(value)) {
+            return true;
+        }
+        if (mPolicy == OverflowPolicy::Reject) {
+            return false;
+        }
+        mSpillCount.fetch_add(1, std::memory_order_release);
+        mSpill.push(std::move(value));
+        return true;
+    }
+
+    // Must only be called from the consumer thread. May return std::nullopt while a producer is
+    // still publishing a value, in which case the value shows up on a later call.
+    std::optional<T> pop() {
+        if (auto value = tryPopRing()) {
+            return value;
+        }
+        if (mSpillCount.load(std::memory_order_acquire) == 0) {
+            return std::nullopt;
+        }
+        // Anything pushed to the ring before a spill is visible now; drain it first.
+        if (auto value = tryPopRing()) {
+            return value;
+        }
+        if (mEnqueuePos.load(std::memory_order_acquire) !=
+            mDequeuePos.load(std::memory_order_relaxed)) {
+            return std::nullopt;
+        }
+        auto value = mSpill.pop();
+        if (value) {
+            mSpillCount.fetch_sub(1, std::memory_order_release);
+        }
+        return value;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        std::optional<T> value;
+    };
+
+    bool tryPushRing(T& value) {
+        size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &mSlots[pos & mMask];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+            if (diff == 0) {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value.emplace(std::move(value));
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> tryPopRing() {
+        const size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+        Slot& slot = mSlots[pos & mMask];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+            return std::nullopt;
+        }
+        std::optional<T> value = std::move(slot.value);
+        slot.value.reset();
+        slot.sequence.store(pos + mCapacity, std::memory_order_release);
+        mDequeuePos.store(pos + 1, std::memory_order_relaxed);
+        return value;
+    }
+
+    const size_t mCapacity;
+    const size_t mMask;
+    const OverflowPolicy mPolicy;
+    std::unique_ptr<Slot[]> mSlots;
+
+    // Producers and the consumer each own a cache line.
+    alignas(64) std::atomic<size_t> mEnqueuePos = 0;
+    alignas(64) std::atomic<size_t> mDequeuePos = 0;
+    alignas(64) std::atomic<size_t> mSpillCount = 0;
+    LocklessQueue<T> mSpill;
+};
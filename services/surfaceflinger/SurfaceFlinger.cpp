@@ -489,6 +489,12 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory) : SurfaceFlinger(factory, SkipI
     mBackpressureGpuComposition = base::GetBoolProperty("debug.sf.enable_gl_backpressure"s, true);
     ALOGI_IF(mBackpressureGpuComposition, "Enabling backpressure for GPU composition");
 
+    const unsigned snapshotUpdateWorkers =
+            base::GetUintProperty("debug.sf.snapshot_update_workers"s, 0u);
+    mLayerSnapshotBuilder.setSubtreeUpdateWorkerCount(snapshotUpdateWorkers);
+    ALOGI_IF(snapshotUpdateWorkers, "Updating layer snapshots with %u worker threads",
+             snapshotUpdateWorkers);
+
     property_get("ro.surface_flinger.supports_background_blur", value, "0");
     bool supportsBlurs = atoi(value);
     mSupportsBlur = supportsBlurs;
@@ -2501,14 +2507,16 @@ bool SurfaceFlinger::updateLayerSnapshots(VsyncId vsyncId, nsecs_t frameTimeNs,
         }
 
         updateLayerHistory(latchTime);
-        mLayerSnapshotBuilder.forEachVisibleSnapshot([&](const frontend::LayerSnapshot& snapshot) {
-            if (mLayersIdsWithQueuedFrames.find(snapshot.path.id) ==
-                mLayersIdsWithQueuedFrames.end())
-                return;
+        const frontend::LayerSnapshotHotFields& hotFields = mLayerSnapshotBuilder.getHotFields();
+        for (size_t z = 0; z < hotFields.size(); z++) {
+            if (!hotFields.isVisible(z) ||
+                mLayersIdsWithQueuedFrames.find(hotFields.layerId(z)) ==
+                        mLayersIdsWithQueuedFrames.end())
+                continue;
             Region visibleReg;
-            visibleReg.set(snapshot.transformedBoundsWithoutTransparentRegion);
-            invalidateLayerStack(snapshot.outputFilter, visibleReg);
-        });
+            visibleReg.set(hotFields.visibleBounds(z));
+            invalidateLayerStack(hotFields.outputFilter(z), visibleReg);
+        }
 
         for (auto& destroyedLayer : mLayerLifecycleManager.getDestroyedLayers()) {
             mLegacyLayers.erase(destroyedLayer->id);
@@ -6967,9 +6975,11 @@ status_t SurfaceFlinger::CheckTransactCodeCredentials(uint32_t code) {
         case GET_DISPLAY_COLOR_MODES:
         case GET_DISPLAY_MODES:
         case GET_SCHEDULING_POLICY:
+        case GET_LAYER_STATE_ENCODING:
         // Calling setTransactionState is safe, because you need to have been
         // granted a reference to Client* and Handle* to do anything with it.
-        case SET_TRANSACTION_STATE: {
+        case SET_TRANSACTION_STATE:
+        case SET_TRANSACTION_STATE_COMPACT: {
             // This is not sensitive information, so should not require permission control.
             return OK;
         }
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <Tracing/TransactionProtoParser.h>
+#include <layerproto/LayerProtoHeader.h>
+
+#include "LayerHierarchyTest.h"
+
+namespace android::surfaceflinger::frontend {
+namespace {
+
+using namespace std::chrono_literals;
+
+// Worker counts compared by every benchmark. Zero is the single threaded walk.
+const std::vector<int64_t> kWorkerCounts = {0, 1, 3};
+
+// A phone or tablet with several tasks per display: every task is a root layer with an app
+// window, a surface view and a few decor layers, spread over |displayCount| layer stacks.
+class SyntheticLayerStack : public LayerSnapshotTestBase {
+public:
+    SyntheticLayerStack(uint32_t layerCount, uint32_t displayCount) {
+        for (uint32_t displayId = 0; displayId < displayCount; displayId++) {
+            mFrontEndDisplayInfos.emplace_or_replace(ui::LayerStack::fromValue(displayId),
+                                                     DisplayInfo{});
+        }
+        uint32_t id = 100;
+        uint32_t task = 0;
+        while (mLayerIds.size() < layerCount) {
+            const uint32_t root = id++;
+            createRootLayer(root);
+            setLayerStack(root, static_cast<int32_t>(task++ % displayCount));
+            mLayerIds.push_back(root);
+            for (uint32_t child = 0; child < 4 && mLayerIds.size() < layerCount; child++) {
+                const uint32_t childId = id++;
+                createLayer(childId, root);
+                setCrop(childId, Rect(0, 0, 1000, 1000));
+                setColor(childId);
+                mLayerIds.push_back(childId);
+            }
+        }
+        mHierarchyBuilder.update(mLifecycleManager);
+    }
+
+    void TestBody() override {}
+
+    std::chrono::nanoseconds updateSnapshots(LayerSnapshotBuilder& builder,
+                                LayerSnapshotBuilder::ForceUpdateFlags forceUpdate) {
+        if (mLifecycleManager.getGlobalChanges().test(RequestedLayerState::Changes::Hierarchy)) {
+            mHierarchyBuilder.update(mLifecycleManager);
+        }
+        LayerSnapshotBuilder::Args args{.root = mHierarchyBuilder.getHierarchy(),
+                                        .layerLifecycleManager = mLifecycleManager,
+                                        .forceUpdate = forceUpdate,
+                                        .displays = mFrontEndDisplayInfos,
+                                        .globalShadowSettings = globalShadowSettings,
+                                        .supportedLayerGenericMetadata = {},
+                                        .genericLayerMetadataKeyMap = {}};
+        const auto start = std::chrono::steady_clock::now();
+        builder.update(args);
+        const auto end = std::chrono::steady_clock::now();
+        mLifecycleManager.commitChanges();
+        return end - start;
+    }
+
+    // Animates the alpha of every fourth layer, like a window transition.
+    void animate(float alpha) {
+        for (size_t i = 0; i < mLayerIds.size(); i += 4) {
+            setAlpha(mLayerIds[i], alpha);
+        }
+    }
+
+    // Hides every third layer, like occluded windows in the task stack.
+    void hideSome() {
+        for (size_t i = 0; i < mLayerIds.size(); i += 3) {
+            hideLayer(mLayerIds[i]);
+        }
+    }
+
+private:
+    std::vector<uint32_t> mLayerIds;
+};
+
+void BM_SnapshotFullUpdate(benchmark::State& state) {
+    SyntheticLayerStack layerStack(static_cast<uint32_t>(state.range(0)), /*displayCount=*/2);
+    LayerSnapshotBuilder builder;
+    builder.setSubtreeUpdateWorkerCount(static_cast<size_t>(state.range(1)));
+    for (auto _ : state) {
+        const std::chrono::nanoseconds elapsed =
+                layerStack.updateSnapshots(builder, LayerSnapshotBuilder::ForceUpdateFlags::ALL);
+        state.SetIterationTime(std::chrono::duration<double>(elapsed).count());
+    }
+}
+BENCHMARK(BM_SnapshotFullUpdate)
+        ->ArgsProduct({{200, 500, 1000}, kWorkerCounts})
+        ->ArgNames({"layers", "workers"})
+        ->UseManualTime();
+
+void BM_SnapshotAnimationUpdate(benchmark::State& state) {
+    SyntheticLayerStack layerStack(static_cast<uint32_t>(state.range(0)), /*displayCount=*/2);
+    LayerSnapshotBuilder builder;
+    builder.setSubtreeUpdateWorkerCount(static_cast<size_t>(state.range(1)));
+    layerStack.updateSnapshots(builder, LayerSnapshotBuilder::ForceUpdateFlags::ALL);
+    float alpha = 0.f;
+    for (auto _ : state) {
+        state.PauseTiming();
+        alpha = alpha >= 1.f ? 0.f : alpha + 0.1f;
+        layerStack.animate(alpha);
+        state.ResumeTiming();
+        const std::chrono::nanoseconds elapsed =
+                layerStack.updateSnapshots(builder, LayerSnapshotBuilder::ForceUpdateFlags::NONE);
+        state.SetIterationTime(std::chrono::duration<double>(elapsed).count());
+    }
+}
+BENCHMARK(BM_SnapshotAnimationUpdate)
+        ->ArgsProduct({{200, 500, 1000}, kWorkerCounts})
+        ->ArgNames({"layers", "workers"})
+        ->UseManualTime();
+
+// Compares the per frame walk over the visible snapshots through the hot field table with a
+// walk that dereferences every snapshot. Cache misses for both can be compared by running with
+// --benchmark_perf_counters=CYCLES,CACHE-MISSES or under simpleperf stat.
+void BM_ForEachVisibleSnapshot(benchmark::State& state) {
+    SyntheticLayerStack layerStack(static_cast<uint32_t>(state.range(0)), /*displayCount=*/2);
+    layerStack.hideSome();
+    LayerSnapshotBuilder builder;
+    layerStack.updateSnapshots(builder, LayerSnapshotBuilder::ForceUpdateFlags::ALL);
+    const bool useHotFields = state.range(1) != 0;
+    for (auto _ : state) {
+        int32_t width = 0;
+        if (useHotFields) {
+            const LayerSnapshotHotFields& hotFields = builder.getHotFields();
+            for (size_t z = 0; z < hotFields.size(); z++) {
+                if (hotFields.isVisible(z)) {
+                    width += hotFields.visibleBounds(z).width();
+                }
+            }
+        } else {
+            for (const auto& snapshot : builder.getSnapshots()) {
+                if (snapshot->isVisible) {
+                    width += snapshot->transformedBoundsWithoutTransparentRegion.width();
+                }
+            }
+        }
+        benchmark::DoNotOptimize(width);
+    }
+}
+BENCHMARK(BM_ForEachVisibleSnapshot)
+        ->ArgsProduct({{200, 500, 1000}, {0, 1}})
+        ->ArgNames({"layers", "hotFields"});
+
+// Replays a transaction trace the same way LayerTraceGenerator does and reports the time spent
+// in LayerSnapshotBuilder::update, which is what the main thread pays for every frame.
+void BM_SnapshotTraceReplay(benchmark::State& state, const std::string& tracePath) {
+    perfetto::protos::TransactionTraceFile traceFile;
+    std::fstream input(tracePath, std::ios::in | std::ios::binary);
+    if (!input || !traceFile.ParseFromIstream(&input)) {
+        state.SkipWithError(("Failed to parse " + tracePath).c_str());
+        return;
+    }
+
+    size_t maxSnapshots = 0;
+    for (auto _ : state) {
+        TransactionProtoParser parser(std::make_unique<TransactionProtoParser::FlingerDataMapper>());
+        LayerLifecycleManager lifecycleManager;
+        LayerHierarchyBuilder hierarchyBuilder;
+        LayerSnapshotBuilder snapshotBuilder;
+        snapshotBuilder.setSubtreeUpdateWorkerCount(static_cast<size_t>(state.range(0)));
+        DisplayInfos displayInfos;
+        ShadowSettings globalShadowSettings{.ambientColor = {1, 1, 1, 1}};
+        std::chrono::nanoseconds elapsed = 0ns;
+
+        for (int i = 0; i < traceFile.entry_size(); i++) {
+            const perfetto::protos::TransactionTraceEntry& entry = traceFile.entry(i);
+            std::vector<std::unique_ptr<RequestedLayerState>> addedLayers;
+            for (int j = 0; j < entry.added_layers_size(); j++) {
+                LayerCreationArgs args;
+                parser.fromProto(entry.added_layers(j), args);
+                addedLayers.emplace_back(std::make_unique<RequestedLayerState>(args));
+            }
+            std::vector<TransactionState> transactions;
+            for (int j = 0; j < entry.transactions_size(); j++) {
+                TransactionState transaction = parser.fromProto(entry.transactions(j));
+                for (auto& resolvedComposerState : transaction.states) {
+                    if ((resolvedComposerState.state.what & layer_state_t::eInputInfoChanged) &&
+                        !resolvedComposerState.state.windowInfoHandle->getInfo()->inputConfig.test(
+                                gui::WindowInfo::InputConfig::NO_INPUT_CHANNEL)) {
+                        resolvedComposerState.state.windowInfoHandle->editInfo()->token =
+                                sp<BBinder>::make();
+                    }
+                }
+                transactions.emplace_back(std::move(transaction));
+            }
+            std::vector<std::pair<uint32_t, std::string>> destroyedHandles;
+            for (int j = 0; j < entry.destroyed_layer_handles_size(); j++) {
+                destroyedHandles.push_back({entry.destroyed_layer_handles(j), ""});
+            }
+            const bool displayChanged = entry.displays_changed();
+            if (displayChanged) {
+                parser.fromProto(entry.displays(), displayInfos);
+            }
+
+            lifecycleManager.addLayers(std::move(addedLayers));
+            lifecycleManager.applyTransactions(transactions, /*ignoreUnknownHandles=*/true);
+            lifecycleManager.onHandlesDestroyed(destroyedHandles, /*ignoreUnknownHandles=*/true);
+            hierarchyBuilder.update(lifecycleManager);
+
+            LayerSnapshotBuilder::Args args{.root = hierarchyBuilder.getHierarchy(),
+                                            .layerLifecycleManager = lifecycleManager,
+                                            .displays = displayInfos,
+                                            .displayChanges = displayChanged,
+                                            .globalShadowSettings = globalShadowSettings,
+                                            .supportedLayerGenericMetadata = {},
+                                            .genericLayerMetadataKeyMap = {}};
+            const auto start = std::chrono::steady_clock::now();
+            snapshotBuilder.update(args);
+            elapsed += std::chrono::steady_clock::now() - start;
+            lifecycleManager.commitChanges();
+            maxSnapshots = std::max(maxSnapshots, snapshotBuilder.getSnapshots().size());
+        }
+        state.SetIterationTime(std::chrono::duration<double>(elapsed).count());
+    }
+    state.counters["frames"] = traceFile.entry_size();
+    state.counters["maxSnapshots"] = static_cast<double>(maxSnapshots);
+}
+
+// Registers a trace replay benchmark for every transaction trace in the testdata directory
+// next to the binary, plus any trace passed with --trace=<path>.
+void registerTraceBenchmarks(int* argc, char** argv) {
+    std::vector<std::string> tracePaths;
+    int remaining = 1;
+    for (int i = 1; i < *argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--trace=")) {
+            tracePaths.emplace_back(arg.substr(strlen("--trace=")));
+        } else {
+            argv[remaining++] = argv[i];
+        }
+    }
+    *argc = remaining;
+
+    const std::filesystem::path testdata =
+            std::filesystem::path(base::GetExecutableDirectory()) / "testdata";
+    std::error_code ec;
+    for (const auto& file : std::filesystem::directory_iterator(testdata, ec)) {
+        const std::string name = file.path().filename().string();
+        if (name.starts_with("transactions_trace_") && name.ends_with(".winscope")) {
+            tracePaths.push_back(file.path().string());
+        }
+    }
+
+    for (const std::string& path : tracePaths) {
+        benchmark::RegisterBenchmark(("BM_SnapshotTraceReplay/" +
+                                      std::filesystem::path(path).filename().string())
+                                             .c_str(),
+                                     BM_SnapshotTraceReplay, path)
+                ->ArgsProduct({kWorkerCounts})
+                ->ArgNames({"workers"})
+                ->UseManualTime();
+    }
+}
+
+} // namespace
+} // namespace android::surfaceflinger::frontend
+
+int main(int argc, char** argv) {
+    android::surfaceflinger::frontend::registerTraceBenchmarks(&argc, argv);
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
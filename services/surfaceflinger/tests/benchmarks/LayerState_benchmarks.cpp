@@ -0,0 +1,93 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <binder/Parcel.h>
+#include <gui/LayerState.h>
+
+namespace android {
+namespace {
+
+using Encoding = layer_state_t::Encoding;
+
+// One frame of a window animation: every layer moves and fades, and one in eight also gets a
+// new buffer, which is what Transaction::apply sends to SurfaceFlinger.
+std::vector<ComposerState> animationFrame(size_t layerCount) {
+    std::vector<ComposerState> states(layerCount);
+    for (size_t i = 0; i < layerCount; i++) {
+        layer_state_t& s = states[i].state;
+        s.layerId = static_cast<int32_t>(i);
+        s.what = layer_state_t::ePositionChanged | layer_state_t::eAlphaChanged |
+                layer_state_t::eMatrixChanged;
+        s.x = static_cast<float>(i);
+        s.y = static_cast<float>(i) * 2.f;
+        s.color.a = 0.5f;
+        s.matrix.dsdx = s.matrix.dtdy = 0.9f;
+        if (i % 8 == 0) {
+            s.what |= layer_state_t::eBufferChanged | layer_state_t::eDataspaceChanged;
+            s.bufferData = std::make_shared<BufferData>();
+            s.dataspace = ui::Dataspace::V0_SRGB;
+        }
+    }
+    return states;
+}
+
+// The layer states half of BpSurfaceComposer::setTransactionState.
+void BM_WriteLayerStates(benchmark::State& state, Encoding encoding) {
+    const auto states = animationFrame(static_cast<size_t>(state.range(0)));
+    size_t bytes = 0;
+    for (auto _ : state) {
+        Parcel parcel;
+        for (const auto& s : states) {
+            s.write(parcel, encoding);
+        }
+        bytes = parcel.dataSize();
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.counters["parcel_bytes"] = static_cast<double>(bytes);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// The layer states half of BnSurfaceComposer::onTransact for SET_TRANSACTION_STATE.
+void BM_ReadLayerStates(benchmark::State& state, Encoding encoding) {
+    const auto states = animationFrame(static_cast<size_t>(state.range(0)));
+    Parcel parcel;
+    for (const auto& s : states) {
+        s.write(parcel, encoding);
+    }
+    for (auto _ : state) {
+        parcel.setDataPosition(0);
+        for (size_t i = 0; i < states.size(); i++) {
+            ComposerState s;
+            s.read(parcel, encoding);
+            benchmark::DoNotOptimize(s);
+        }
+    }
+    state.counters["parcel_bytes"] = static_cast<double>(parcel.dataSize());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_CAPTURE(BM_WriteLayerStates, full, Encoding::FULL)->Arg(10)->Arg(100)->Arg(500);
+BENCHMARK_CAPTURE(BM_WriteLayerStates, compact, Encoding::COMPACT)->Arg(10)->Arg(100)->Arg(500);
+BENCHMARK_CAPTURE(BM_ReadLayerStates, full, Encoding::FULL)->Arg(10)->Arg(100)->Arg(500);
+BENCHMARK_CAPTURE(BM_ReadLayerStates, compact, Encoding::COMPACT)->Arg(10)->Arg(100)->Arg(500);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
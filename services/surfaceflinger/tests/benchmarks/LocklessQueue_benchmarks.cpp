@@ -0,0 +1,100 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "LocklessQueue.h"
+
+namespace android {
+namespace {
+
+// Roughly the size of a small TransactionState payload, so copies are not free.
+using Payload = std::array<uint64_t, 16>;
+
+// Pushes |kBurst| values from each of state.range(0) producer threads and drains them from the
+// benchmark thread, which plays the role of the SurfaceFlinger main thread.
+template <typename Queue, typename... Args>
+void runProducers(benchmark::State& state, Args... args) {
+    constexpr int kBurst = 1024;
+    const int producerCount = static_cast<int>(state.range(0));
+    for (auto _ : state) {
+        Queue queue(args...);
+        std::atomic<bool> start = false;
+        std::vector<std::thread> producers;
+        for (int p = 0; p < producerCount; p++) {
+            producers.emplace_back([&queue, &start]() {
+                while (!start.load(std::memory_order_acquire)) {
+                }
+                for (int i = 0; i < kBurst; i++) {
+                    queue.push(Payload{static_cast<uint64_t>(i)});
+                }
+            });
+        }
+        start.store(true, std::memory_order_release);
+        int received = 0;
+        while (received < producerCount * kBurst) {
+            if (auto value = queue.pop()) {
+                benchmark::DoNotOptimize(value);
+                received++;
+            }
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * producerCount * kBurst);
+}
+
+void BM_LocklessQueue(benchmark::State& state) {
+    runProducers<LocklessQueue<Payload>>(state);
+}
+BENCHMARK(BM_LocklessQueue)->Arg(1)->Arg(4)->Arg(16)->Arg(32)->UseRealTime();
+
+void BM_BoundedLocklessQueue(benchmark::State& state) {
+    runProducers<BoundedLocklessQueue<Payload>>(state, static_cast<size_t>(state.range(1)));
+}
+BENCHMARK(BM_BoundedLocklessQueue)
+        ->ArgsProduct({{1, 4, 16, 32}, {64, 256, 4096}})
+        ->UseRealTime();
+
+// Uncontended push/pop pair, which is the common case when transactions trickle in.
+void BM_LocklessQueue_PushPop(benchmark::State& state) {
+    LocklessQueue<Payload> queue;
+    for (auto _ : state) {
+        queue.push(Payload{});
+        benchmark::DoNotOptimize(queue.pop());
+    }
+}
+BENCHMARK(BM_LocklessQueue_PushPop);
+
+void BM_BoundedLocklessQueue_PushPop(benchmark::State& state) {
+    BoundedLocklessQueue<Payload> queue(256);
+    for (auto _ : state) {
+        queue.push(Payload{});
+        benchmark::DoNotOptimize(queue.pop());
+    }
+}
+BENCHMARK(BM_BoundedLocklessQueue_PushPop);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
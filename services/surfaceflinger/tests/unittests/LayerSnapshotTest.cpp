@@ -101,6 +101,23 @@ protected:
                     actualVisibleLayerIdsInZOrder.push_back(snapshot.path.id);
                 });
         EXPECT_EQ(expectedVisibleLayerIdsInZOrder, actualVisibleLayerIdsInZOrder);
+        verifyHotFields(actualBuilder);
+    }
+
+    void verifyHotFields(LayerSnapshotBuilder& builder) {
+        const LayerSnapshotHotFields& hotFields = builder.getHotFields();
+        ASSERT_LE(hotFields.size(), builder.getSnapshots().size());
+        for (size_t z = 0; z < hotFields.size(); z++) {
+            const LayerSnapshot& snapshot = *builder.getSnapshots()[z];
+            SCOPED_TRACE(snapshot.getDebugString());
+            EXPECT_EQ(snapshot.path.id, hotFields.layerId(z));
+            EXPECT_EQ(snapshot.isVisible, hotFields.isVisible(z));
+            EXPECT_EQ(snapshot.outputFilter.layerStack, hotFields.outputFilter(z).layerStack);
+            EXPECT_EQ(snapshot.outputFilter.toInternalDisplay,
+                      hotFields.outputFilter(z).toInternalDisplay);
+            EXPECT_EQ(snapshot.transformedBoundsWithoutTransparentRegion,
+                      hotFields.visibleBounds(z));
+        }
     }
 
     LayerSnapshot* getSnapshot(uint32_t layerId) { return mSnapshotBuilder.getSnapshot(layerId); }
@@ -1258,4 +1275,112 @@ TEST_F(LayerSnapshotTest, canOccludePresentation) {
     EXPECT_EQ(getSnapshot(1221)->inputInfo.canOccludePresentation, true);
 }
 
+TEST_F(LayerSnapshotTest, hotFieldsFollowUpdates) {
+    // The second buffer update only has content changes and takes the fast path, which
+    // refreshes the changed snapshot in place.
+    for (uint64_t bufferId = 1; bufferId <= 2; bufferId++) {
+        setBuffer(1,
+                  std::make_shared<renderengine::mock::FakeExternalTexture>(1U /*width*/,
+                                                                            1U /*height*/,
+                                                                            bufferId,
+                                                                            HAL_PIXEL_FORMAT_RGBA_8888,
+                                                                            0ULL /*usage*/));
+        UPDATE_AND_VERIFY(mSnapshotBuilder, STARTING_ZORDER);
+    }
+
+    setAlpha(12, 0.5f);
+    hideLayer(13);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, {1, 11, 111, 12, 121, 122, 1221, 2});
+    EXPECT_TRUE(mSnapshotBuilder.getHotFields().isVisible(getSnapshot(12)->globalZ));
+}
+
+// Updates |parallelBuilder|, which splits root subtrees across worker threads, alongside
+// mSnapshotBuilder and checks that both produce the same snapshots.
+class LayerSnapshotParallelUpdateTest : public LayerSnapshotTest {
+protected:
+    LayerSnapshotParallelUpdateTest() {
+        mParallelBuilder.setSubtreeUpdateWorkerCount(2);
+        updateBothAndCompare(LayerSnapshotBuilder::ForceUpdateFlags::ALL);
+    }
+
+    void updateBothAndCompare(LayerSnapshotBuilder::ForceUpdateFlags forceUpdate =
+                                      LayerSnapshotBuilder::ForceUpdateFlags::NONE) {
+        if (mLifecycleManager.getGlobalChanges().test(RequestedLayerState::Changes::Hierarchy)) {
+            mHierarchyBuilder.update(mLifecycleManager);
+        }
+        LayerSnapshotBuilder::Args args{.root = mHierarchyBuilder.getHierarchy(),
+                                        .layerLifecycleManager = mLifecycleManager,
+                                        .forceUpdate = forceUpdate,
+                                        .includeMetadata = false,
+                                        .displays = mFrontEndDisplayInfos,
+                                        .globalShadowSettings = globalShadowSettings,
+                                        .supportsBlur = true,
+                                        .supportedLayerGenericMetadata = {},
+                                        .genericLayerMetadataKeyMap = {}};
+        mSnapshotBuilder.update(args);
+        mParallelBuilder.update(args);
+        mLifecycleManager.commitChanges();
+
+        auto& expected = mSnapshotBuilder.getSnapshots();
+        auto& actual = mParallelBuilder.getSnapshots();
+        ASSERT_EQ(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            SCOPED_TRACE(expected[i]->getDebugString());
+            EXPECT_EQ(expected[i]->path, actual[i]->path);
+            EXPECT_EQ(expected[i]->globalZ, actual[i]->globalZ);
+            EXPECT_EQ(expected[i]->getIsVisible(), actual[i]->getIsVisible());
+            EXPECT_EQ(expected[i]->isHiddenByPolicyFromRelativeParent,
+                      actual[i]->isHiddenByPolicyFromRelativeParent);
+            EXPECT_EQ(static_cast<float>(expected[i]->color.a),
+                      static_cast<float>(actual[i]->color.a));
+            EXPECT_EQ(expected[i]->geomLayerBounds, actual[i]->geomLayerBounds);
+            EXPECT_EQ(expected[i]->transformedBounds, actual[i]->transformedBounds);
+        }
+    }
+
+    LayerSnapshotBuilder mParallelBuilder;
+};
+
+TEST_F(LayerSnapshotParallelUpdateTest, matchesSequentialUpdate) {
+    for (uint32_t id = 3; id < 10; id++) {
+        createRootLayer(id);
+        createLayer(id * 10 + 1, id);
+        createLayer(id * 100 + 11, id * 10 + 1);
+    }
+    updateBothAndCompare();
+
+    setAlpha(1, 0.5f);
+    setCrop(31, Rect(0, 0, 10, 10));
+    hideLayer(41);
+    updateBothAndCompare();
+
+    setZ(5, -1);
+    destroyLayerHandle(6);
+    updateBothAndCompare();
+}
+
+TEST_F(LayerSnapshotParallelUpdateTest, relativeLayersAcrossSubtrees) {
+    createRootLayer(3);
+    createLayer(31, 3);
+    updateBothAndCompare();
+
+    // 13 is attached under 1 but drawn relative to 2, so both subtrees touch its snapshot.
+    reparentRelativeLayer(13, 2);
+    hideLayer(2);
+    updateBothAndCompare();
+
+    reparentRelativeLayer(31, 11);
+    showLayer(2);
+    updateBothAndCompare();
+}
+
+TEST_F(LayerSnapshotParallelUpdateTest, mirrorsAcrossSubtrees) {
+    createRootLayer(3);
+    mirrorLayer(/*layer*/ 4, /*parent*/ 3, /*layerToMirror*/ 12);
+    updateBothAndCompare();
+
+    setAlpha(12, 0.5f);
+    updateBothAndCompare();
+}
+
 } // namespace android::surfaceflinger::frontend
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "LocklessQueue.h"
+
+namespace android {
+namespace {
+
+using Queue = BoundedLocklessQueue<int>;
+
+TEST(BoundedLocklessQueueTest, roundsCapacityUpToPowerOfTwo) {
+    EXPECT_EQ(8u, Queue(5).capacity());
+    EXPECT_EQ(16u, Queue(16).capacity());
+    EXPECT_EQ(2u, Queue(0).capacity());
+}
+
+TEST(BoundedLocklessQueueTest, popsInOrder) {
+    Queue queue(4);
+    EXPECT_TRUE(queue.isEmpty());
+    EXPECT_FALSE(queue.pop().has_value());
+
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 4; i++) {
+            EXPECT_TRUE(queue.push(i));
+        }
+        EXPECT_FALSE(queue.isEmpty());
+        for (int i = 0; i < 4; i++) {
+            EXPECT_EQ(i, queue.pop());
+        }
+        EXPECT_TRUE(queue.isEmpty());
+    }
+}
+
+TEST(BoundedLocklessQueueTest, rejectsWhenFull) {
+    Queue queue(2, Queue::OverflowPolicy::Reject);
+    EXPECT_TRUE(queue.push(1));
+    EXPECT_TRUE(queue.push(2));
+    EXPECT_FALSE(queue.push(3));
+    EXPECT_EQ(1, queue.pop());
+    EXPECT_TRUE(queue.push(4));
+    EXPECT_EQ(2, queue.pop());
+    EXPECT_EQ(4, queue.pop());
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+TEST(BoundedLocklessQueueTest, spillsInOrderWhenFull) {
+    Queue queue(2);
+    for (int i = 0; i < 10; i++) {
+        EXPECT_TRUE(queue.push(i));
+    }
+    // Once a value has spilled, pushes keep spilling until the spill list is drained.
+    EXPECT_EQ(0, queue.pop());
+    EXPECT_TRUE(queue.push(10));
+    for (int i = 1; i <= 10; i++) {
+        EXPECT_EQ(i, queue.pop());
+    }
+    EXPECT_TRUE(queue.isEmpty());
+    EXPECT_FALSE(queue.pop().has_value());
+}
+
+TEST(BoundedLocklessQueueTest, movesValues) {
+    BoundedLocklessQueue<std::unique_ptr<int>> queue(2);
+    queue.push(std::make_unique<int>(1));
+    queue.push(std::make_unique<int>(2));
+    queue.push(std::make_unique<int>(3));
+    for (int i = 1; i <= 3; i++) {
+        auto value = queue.pop();
+        ASSERT_TRUE(value.has_value());
+        EXPECT_EQ(i, **value);
+    }
+}
+
+TEST(BoundedLocklessQueueTest, multipleProducersKeepPerProducerOrder) {
+    constexpr int kProducers = 8;
+    constexpr int kValuesPerProducer = 10000;
+    BoundedLocklessQueue<std::pair<int, int>> queue(16);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; p++) {
+        producers.emplace_back([&queue, p]() {
+            for (int i = 0; i < kValuesPerProducer; i++) {
+                queue.push({p, i});
+            }
+        });
+    }
+
+    int next[kProducers] = {};
+    int received = 0;
+    while (received < kProducers * kValuesPerProducer) {
+        auto value = queue.pop();
+        if (!value) {
+            std::this_thread::yield();
+            continue;
+        }
+        const auto [producer, sequence] = *value;
+        ASSERT_EQ(next[producer], sequence);
+        next[producer]++;
+        received++;
+    }
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+} // namespace
+} // namespace android